@@ -0,0 +1,300 @@
+/**
+ * Crawler core micro-benchmarks
+ * URL normalization, URLFrontier enqueue/dequeue with N contending
+ * threads, merge_all_buffers and compute_pagerank on a generated
+ * power-law domain graph. Each case runs until min_seconds and reports
+ * time per iteration and items per second (link extraction has its own
+ * benchmark, parser_bench)
+ *
+ * Usage: core_bench [min_seconds] [filter] [scale]
+ *   min_seconds - Minimum run time per case (default 1.0)
+ *   filter      - Only run cases whose name contains this (default all)
+ *   scale       - Graph size multiplier for the storage cases (default 1)
+ */
+#include "parser.h"
+#include "parsed_url.h"
+#include "storage_manager.h"
+#include "url_frontier.h"
+#include "synthetic_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Results are stored here so the compiler can't drop the work
+volatile size_t benchmark_sink = 0;
+
+struct BenchResult {
+    double seconds = 0.0;       // Timed part only
+    uint64_t iterations = 0;
+    uint64_t items = 0;
+};
+
+// Silences the [INFO] lines StorageManager prints on every merge and rank
+class QuietCout {
+public:
+    QuietCout() : saved(std::cout.rdbuf(nullptr)) {}
+    ~QuietCout() {
+        std::cout.rdbuf(saved);
+        std::cout.clear();
+    }
+
+private:
+    std::streambuf* saved;
+};
+
+std::string format_time(double seconds) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    if (seconds < 1e-6) {
+        out << seconds * 1e9 << " ns";
+    } else if (seconds < 1e-3) {
+        out << seconds * 1e6 << " us";
+    } else {
+        out << seconds * 1e3 << " ms";
+    }
+    return out.str();
+}
+
+void report(const std::string& name, const BenchResult& result, const char* items) {
+    double per_iteration = result.seconds / static_cast<double>(result.iterations);
+    double rate = static_cast<double>(result.items) / result.seconds / 1e6;
+    std::cout << "[BENCH] " << std::left << std::setw(34) << name << std::right
+              << std::setw(14) << format_time(per_iteration) << "/iter"
+              << std::setw(9) << result.iterations << " iters"
+              << std::fixed << std::setprecision(2) << std::setw(10) << rate
+              << " M " << items << "/s" << std::endl;
+}
+
+/**
+ * Repeat body until min_seconds of timed work
+ * @param body Runs one iteration, adds its own timed seconds and items
+ */
+BenchResult repeat(double min_seconds, const std::function<void(BenchResult&)>& body) {
+    BenchResult result;
+    do {
+        body(result);
+        result.iterations++;
+    } while (result.seconds < min_seconds);
+    return result;
+}
+
+double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Spellings the crawler meets: case, default ports, dot segments, fragments
+std::vector<std::string> url_corpus() {
+    std::vector<std::string> urls;
+    for (int i = 0; i < 1024; i++) {
+        std::string n = std::to_string(i);
+        switch (i % 4) {
+        case 0:
+            urls.push_back("HTTP://WWW.Example" + n + ".COM:80/a/./b/../page" + n + ".html#top");
+            break;
+        case 1:
+            urls.push_back("https://user@docs.example.org:443/guide/" + n + "/../index.html?q=" + n);
+            break;
+        case 2:
+            urls.push_back("  https://cdn.example.net/static/v" + n + "/app.js  ");
+            break;
+        default:
+            urls.push_back("http://example.com/");
+            break;
+        }
+    }
+    return urls;
+}
+
+void bench_normalize(double min_seconds, const std::string& filter) {
+    std::vector<std::string> urls = url_corpus();
+    Parser parser;
+    if (std::string("normalize_url").find(filter) != std::string::npos) {
+        report("normalize_url", repeat(min_seconds, [&](BenchResult& r) {
+            size_t bytes = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& url : urls) {
+                bytes += parser.normalize_url(url).size();
+            }
+            r.seconds += since(start);
+            r.items += urls.size();
+            benchmark_sink = bytes;
+        }), "urls");
+    }
+
+    if (std::string("parsed_url/resolve").find(filter) != std::string::npos) {
+        ParsedUrl base;
+        ParsedUrl::parse("https://example.com/docs/guide/index.html", base);
+        const char* references[] = {"../api/ref.html", "/about", "?page=2", "#section",
+                                    "//cdn.example.net/x.js", "chapter1.html",
+                                    "https://other.org/a/b/../c"};
+        ParsedUrl out;
+        report("parsed_url/resolve", repeat(min_seconds, [&](BenchResult& r) {
+            size_t resolved = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int round = 0; round < 128; round++) {
+                for (const char* reference : references) {
+                    resolved += ParsedUrl::resolve(base, reference, out);
+                }
+            }
+            r.seconds += since(start);
+            benchmark_sink = resolved;
+            r.items += 128 * (sizeof(references) / sizeof(references[0]));
+        }), "urls");
+    }
+}
+
+// Every thread admits its own URLs in link-sized batches and drains its
+// partition (stealing once it is empty), like workers and I/O loops do
+void bench_frontier(double min_seconds, const std::string& filter, int threads) {
+    std::string name = "frontier/threads:" + std::to_string(threads);
+    if (name.find(filter) == std::string::npos) {
+        return;
+    }
+    const size_t per_thread = 50000;
+    const size_t batch = 64;
+    const uint32_t hosts = 4096;
+
+    report(name, repeat(min_seconds, [&](BenchResult& r) {
+        URLFrontier frontier;
+        HostPolicy policy;
+        policy.max_connections = 1 << 20;      // Measure the queues, not politeness
+        frontier.init("", 64, static_cast<size_t>(threads), VisitedSetOptions(), policy);
+
+        // URL strings are built before the clock starts
+        std::vector<std::vector<std::string>> urls(threads);
+        for (int t = 0; t < threads; t++) {
+            uint64_t state = static_cast<uint64_t>(t);
+            urls[t].reserve(per_thread);
+            for (size_t i = 0; i < per_thread; i++) {
+                urls[t].push_back("https://h" + std::to_string(SyntheticGraph::zipf(state, hosts)) +
+                                  ".bench/t" + std::to_string(t) + "/" + std::to_string(i));
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) {
+            pool.emplace_back([&frontier, &urls, t]() {
+                std::vector<std::string> pending;
+                FrontierEntry entry;
+                int64_t wait_ms = 0;
+                for (size_t i = 0; i < urls[t].size(); i += batch) {
+                    size_t end = std::min(urls[t].size(), i + batch);
+                    pending.assign(std::make_move_iterator(urls[t].begin() + i),
+                                   std::make_move_iterator(urls[t].begin() + end));
+                    frontier.batch_enqueue(pending, 1);
+                    for (size_t n = 0; n < batch / 2 && frontier.try_dequeue(entry, t, wait_ms); n++) {
+                        frontier.release_host(entry.url, 200);
+                        frontier.complete_task();
+                    }
+                }
+                while (frontier.try_dequeue(entry, t, wait_ms)) {
+                    frontier.release_host(entry.url, 200);
+                    frontier.complete_task();
+                }
+            });
+        }
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        r.seconds += since(start);
+        r.items += 2 * per_thread * static_cast<uint64_t>(threads);     // Enqueue + dequeue
+    }), "ops");
+}
+
+// Pages spread over the thread buffers the way workers fill them; page
+// p belongs to domain p % domains, so low domains get the most in-links
+void fill_storage(StorageManager& storage, int buffers, uint32_t pages, uint32_t domains,
+                  uint32_t links, uint64_t& total_links) {
+    std::vector<uint32_t> targets;
+    std::vector<ParsedUrl> parsed;
+    PageLinks out;
+    for (uint32_t p = 0; p < pages; p++) {
+        SyntheticGraph::page_links(p, pages, links, targets);
+        parsed.resize(targets.size());
+        for (size_t i = 0; i < targets.size(); i++) {
+            ParsedUrl::parse("http://d" + std::to_string(targets[i] % domains) + ".bench/p" +
+                             std::to_string(targets[i]) + ".html", parsed[i]);
+        }
+        std::string domain = "d" + std::to_string(p % domains) + ".bench";
+        storage.add_page(static_cast<int>(p % static_cast<uint32_t>(buffers)), domain, parsed, out);
+        total_links += targets.size();
+    }
+}
+
+void bench_storage(double min_seconds, const std::string& filter, int threads, int scale) {
+    const uint32_t pages = 20000 * static_cast<uint32_t>(scale);
+    const uint32_t domains = 5000 * static_cast<uint32_t>(scale);
+    const uint32_t links = 16;
+    const int buffers = std::max(threads, 4);
+
+    std::string merge_name = "merge_all_buffers/threads:" + std::to_string(threads);
+    if (merge_name.find(filter) != std::string::npos) {
+        report(merge_name, repeat(min_seconds, [&](BenchResult& r) {
+            QuietCout quiet;
+            StorageManager storage;
+            storage.init(buffers);
+            uint64_t total_links = 0;
+            fill_storage(storage, buffers, pages, domains, links, total_links);
+            auto start = std::chrono::steady_clock::now();
+            storage.merge_all_buffers(threads);
+            r.seconds += since(start);
+            r.items += total_links;
+        }), "links");
+    }
+
+    std::string rank_name = "compute_pagerank/threads:" + std::to_string(threads);
+    if (rank_name.find(filter) != std::string::npos) {
+        StorageManager storage;
+        uint64_t total_links = 0;
+        {
+            QuietCout quiet;
+            storage.init(buffers);
+            fill_storage(storage, buffers, pages, domains, links, total_links);
+            storage.merge_all_buffers(threads);
+        }
+        uint64_t edges = storage.graph().num_edges();
+        report(rank_name, repeat(min_seconds, [&](BenchResult& r) {
+            QuietCout quiet;
+            auto start = std::chrono::steady_clock::now();
+            storage.compute_pagerank(30, 0.0, threads);     // Always the full 30 sweeps
+            r.seconds += since(start);
+            r.items += 30 * edges;
+        }), "edges");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double min_seconds = (argc > 1) ? std::stod(argv[1]) : 1.0;
+    std::string filter = (argc > 2) ? argv[2] : "";
+    int scale = (argc > 3) ? std::max(1, std::stoi(argv[3])) : 1;
+
+    int max_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> thread_counts = {1};
+    for (int t = 2; t <= std::max(8, max_threads); t *= 2) {
+        thread_counts.push_back(t);
+    }
+    std::cout << "[BENCH] " << max_threads << " hardware thread(s); storage graph "
+              << 20000 * scale << " pages, " << 5000 * scale << " domains" << std::endl;
+
+    bench_normalize(min_seconds, filter);
+    for (int threads : thread_counts) {
+        bench_frontier(min_seconds, filter, threads);
+    }
+    for (int threads : thread_counts) {
+        if (threads == 1 || threads <= max_threads) {
+            bench_storage(min_seconds, filter, threads, scale);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * Link extraction micro-benchmark
+ * Compares the std::regex extractor the crawler used to ship with the
+ * single-pass LinkScanner, single-threaded, reported as MB/s per core;
+ * the scanner is also run once per SIMD level the CPU supports
+ *
+ * Usage: parser_bench [corpus_dir] [min_seconds]
+ *   corpus_dir  - Directory of saved HTML pages (synthetic pages if omitted)
+ *   min_seconds - Minimum run time per variant (default 1.0)
+ */
+#include "parser.h"
+#include "link_scanner.h"
+#include "simd_scan.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> load_corpus(const std::string& dir) {
+    std::vector<std::string> pages;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::ifstream in(entry.path(), std::ios::binary);
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        if (!buffer.str().empty()) {
+            pages.push_back(buffer.str());
+        }
+    }
+    return pages;
+}
+
+// Link-dense pages with scripts, comments and mixed quoting, plus an
+// inline script bundle the size real pages tend to carry
+std::vector<std::string> synthetic_corpus() {
+    std::string bundle;
+    for (int i = 0; i < 600; i++) {
+        bundle += "function f" + std::to_string(i) + "(a, b) { return a < b ? a : b; }\n";
+    }
+
+    std::vector<std::string> pages;
+    for (int p = 0; p < 32; p++) {
+        std::string html = "<!DOCTYPE html><html><head><title>Page</title>"
+                           "<base href=\"https://example.com/docs/\">"
+                           "<script>var s = '<a href=\"/not-a-link\">';" + bundle +
+                           "</script></head><body>";
+        for (int i = 0; i < 400; i++) {
+            html += "<p class=\"text\">Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+                    "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua.</p>\n";
+            html += "<a href=\"/page" + std::to_string(p * 1000 + i) + ".html\">link</a> ";
+            html += "<a class='x' href='https://other" + std::to_string(i % 17) + ".org/x'>ext</a>\n";
+            if (i % 10 == 0) {
+                html += "<!-- <a href=\"/commented\"> --><img src=\"/img" + std::to_string(i) + ".png\">\n";
+            }
+        }
+        html += "</body></html>";
+        pages.push_back(std::move(html));
+    }
+    return pages;
+}
+
+// The extractor Parser::extract_links used before the scanner
+size_t regex_scan(const std::string& html) {
+    std::regex href_regex(R"(href\s*=\s*[\"']([^\"']+)[\"'])");
+    std::smatch match;
+    size_t found = 0;
+    std::string::const_iterator search_start(html.cbegin());
+    while (std::regex_search(search_start, html.cend(), match, href_regex)) {
+        found += match[1].length() > 0;
+        search_start = match.suffix().first;
+    }
+    return found;
+}
+
+size_t scanner_scan(const std::string& html) {
+    LinkScanner scanner(html);
+    LinkToken token;
+    size_t found = 0;
+    while (scanner.next(token)) {
+        found++;
+    }
+    return found;
+}
+
+std::vector<std::string> regex_extract(Parser& parser, const std::string& html,
+                                       const std::string& base_url) {
+    std::vector<std::string> links;
+    std::regex href_regex(R"(href\s*=\s*[\"']([^\"']+)[\"'])");
+    std::smatch match;
+    std::string::const_iterator search_start(html.cbegin());
+    while (std::regex_search(search_start, html.cend(), match, href_regex)) {
+        std::string url = match[1];
+        if (!url.empty() && url.length() <= 10000) {
+            if (url.rfind("http://", 0) != 0 && url.rfind("https://", 0) != 0) {
+                url = parser.resolve_relative_url(base_url, url);
+            }
+            url = parser.normalize_url(url);
+            if (parser.is_valid_url(url)) {
+                links.push_back(url);
+            }
+        }
+        search_start = match.suffix().first;
+    }
+    return links;
+}
+
+struct BenchResult {
+    double mb_per_s = 0.0;
+    size_t items = 0;
+};
+
+BenchResult run(const std::vector<std::string>& pages, double min_seconds,
+                const std::function<size_t(const std::string&)>& body) {
+    size_t total_bytes = 0;
+    for (const auto& page : pages) total_bytes += page.size();
+
+    BenchResult result;
+    size_t rounds = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do {
+        size_t items = 0;
+        for (const auto& page : pages) {
+            items += body(page);
+        }
+        result.items = items;
+        rounds++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_seconds);
+
+    result.mb_per_s = (static_cast<double>(total_bytes) * rounds) / (1024.0 * 1024.0) / elapsed;
+    return result;
+}
+
+void report(const std::string& name, const BenchResult& result, double baseline) {
+    std::cout << "[BENCH] " << std::left << std::setw(26) << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << result.mb_per_s
+              << " MB/s  " << std::setw(8) << result.items << " links";
+    if (baseline > 0.0) {
+        std::cout << "  (" << std::setprecision(1) << result.mb_per_s / baseline << "x)";
+    }
+    std::cout << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> pages;
+    if (argc > 1 && argv[1][0] != '\0') {
+        try {
+            pages = load_corpus(argv[1]);
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] Cannot read corpus: " << e.what() << std::endl;
+            return 1;
+        }
+        if (pages.empty()) {
+            std::cerr << "[ERROR] No pages found in " << argv[1] << std::endl;
+            return 1;
+        }
+    } else {
+        pages = synthetic_corpus();
+    }
+    double min_seconds = (argc > 2) ? std::stod(argv[2]) : 1.0;
+
+    size_t total_bytes = 0;
+    for (const auto& page : pages) total_bytes += page.size();
+    std::cout << "[BENCH] Corpus: " << pages.size() << " pages, "
+              << total_bytes / 1024 << " KB" << std::endl;
+
+    Parser parser;
+    const std::string base_url = "https://example.com/docs/index.html";
+
+    Simd::Level best = Simd::active_level();
+    BenchResult regex_raw = run(pages, min_seconds, regex_scan);
+    report("scan: std::regex", regex_raw, 0.0);
+
+    const Simd::Level levels[] = {Simd::Level::Scalar, Simd::Level::SSE2,
+                                  Simd::Level::AVX2, Simd::Level::NEON};
+    for (Simd::Level level : levels) {
+        if (!Simd::force_level(level)) {
+            continue;
+        }
+        BenchResult scanner_raw = run(pages, min_seconds, scanner_scan);
+        report(std::string("scan: LinkScanner/") + Simd::level_name(level),
+               scanner_raw, regex_raw.mb_per_s);
+    }
+    Simd::force_level(best);
+
+    BenchResult regex_full = run(pages, min_seconds, [&](const std::string& html) {
+        return regex_extract(parser, html, base_url).size();
+    });
+    BenchResult scanner_full = run(pages, min_seconds, [&](const std::string& html) {
+        return parser.extract_links(html, base_url).size();
+    });
+    report("extract_links: regex", regex_full, 0.0);
+    report("extract_links: scanner", scanner_full, regex_full.mb_per_s);
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#!/bin/bash
+# End-to-end throughput against parser thread count on the synthetic site
+#
+# Usage: bench/scaling.sh [build_dir] [thread counts...]
+#   build_dir      - Directory with crawler and synthetic_server (default build)
+#   thread counts  - Parser threads to try (default 1 2 4 8)
+#
+# Environment: PAGES (20000), HOSTS (4), LINKS (16), LATENCY_MS (5),
+# JITTER_MS (5), IO_THREADS (2), RUNS (3), PORT (8780), GZIP (0)
+#
+# Results go to <build_dir>/scaling/metrics.csv and the report next to it
+
+set -e
+
+BUILD_DIR=$(cd "${1:-build}" && pwd)
+shift || true
+THREAD_COUNTS=${*:-1 2 4 8}
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+
+PAGES=${PAGES:-20000}
+HOSTS=${HOSTS:-4}
+LINKS=${LINKS:-16}
+LATENCY_MS=${LATENCY_MS:-5}
+JITTER_MS=${JITTER_MS:-5}
+IO_THREADS=${IO_THREADS:-2}
+RUNS=${RUNS:-3}
+PORT=${PORT:-8780}
+GZIP=${GZIP:-0}
+
+for binary in crawler synthetic_server; do
+    if [ ! -x "$BUILD_DIR/$binary" ]; then
+        echo "[ERROR] $BUILD_DIR/$binary not found (make benchmarks)"
+        exit 1
+    fi
+done
+
+OUT_DIR="$BUILD_DIR/scaling"
+mkdir -p "$OUT_DIR"
+rm -f "$OUT_DIR/metrics.csv"
+
+"$BUILD_DIR/synthetic_server" --port "$PORT" --hosts "$HOSTS" --pages "$PAGES" \
+    --links "$LINKS" --latency-ms "$LATENCY_MS" --jitter-ms "$JITTER_MS" --gzip "$GZIP" \
+    > "$OUT_DIR/server.log" 2>&1 &
+SERVER_PID=$!
+trap 'kill $SERVER_PID 2>/dev/null || true' EXIT
+sleep 0.5
+if ! kill -0 $SERVER_PID 2>/dev/null; then
+    cat "$OUT_DIR/server.log"
+    exit 1
+fi
+
+# Every run crawls the whole site, so each one does identical work
+for threads in $THREAD_COUNTS; do
+    for run in $(seq 1 "$RUNS"); do
+        (cd "$OUT_DIR" && "$BUILD_DIR/crawler" "http://127.0.0.1:$PORT/" "$PAGES" "$threads" \
+            --io-threads "$IO_THREADS" --graph-file "" > "crawl_${threads}_${run}.log" 2>&1)
+        echo "[INFO] $threads thread(s), run $run: $(tail -n 1 "$OUT_DIR/metrics.csv" | cut -d, -f6) pages/s"
+    done
+done
+
+python3 "$SCRIPT_DIR/../metrics_analyzer.py" "$OUT_DIR/metrics.csv"
@@ -0,0 +1,66 @@
+#ifndef SYNTHETIC_GRAPH_H
+#define SYNTHETIC_GRAPH_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Deterministic power-law link graph shared by the benchmarks and the
+ * synthetic server, so a page's links depend only on its ID and the
+ * graph size
+ */
+namespace SyntheticGraph {
+
+/**
+ * splitmix64 step: advances state and returns the next value
+ */
+inline uint64_t next(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Uniform double in [0, 1)
+ */
+inline double uniform(uint64_t& state) {
+    return static_cast<double>(next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Zipf-like pick in [0, n): n^u - 1 for uniform u gives P(k) ~ 1/(k+1),
+ * so low IDs collect most of the in-links
+ */
+inline uint32_t zipf(uint64_t& state, uint32_t n) {
+    uint32_t k = static_cast<uint32_t>(std::pow(static_cast<double>(n), uniform(state))) - 1;
+    return k < n ? k : n - 1;
+}
+
+/**
+ * Out-links of one page
+ * The two tree links (2i+1, 2i+2) make every page reachable from page 0
+ * within log2(pages) hops; the rest are Zipf picks
+ * @param page Page ID
+ * @param pages Number of pages in the graph
+ * @param links Links per page
+ * @param out Target page IDs (cleared first)
+ */
+inline void page_links(uint32_t page, uint32_t pages, uint32_t links,
+                       std::vector<uint32_t>& out) {
+    out.clear();
+    uint64_t state = 0x5eed0000ULL + page;
+    for (uint64_t child = 2ULL * page + 1; child <= 2ULL * page + 2 && out.size() < links; child++) {
+        if (child < pages) {
+            out.push_back(static_cast<uint32_t>(child));
+        }
+    }
+    while (out.size() < links) {
+        out.push_back(zipf(state, pages));
+    }
+}
+
+}  // namespace SyntheticGraph
+
+#endif // SYNTHETIC_GRAPH_H
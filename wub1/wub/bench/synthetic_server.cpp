@@ -0,0 +1,577 @@
+/**
+ * Loopback HTTP server for reproducible end-to-end crawl benchmarks
+ * Serves a synthetic power-law site (see synthetic_graph.h): page i lives
+ * on host i % hosts, each host is its own port, and every response is
+ * held back by a fixed latency plus a per-page jitter. The same options
+ * always produce the same pages, links and delays, so crawler throughput
+ * can be compared across builds and thread counts.
+ * One epoll thread handles every connection (HTTP/1.1 keep-alive); held
+ * responses wait on a timer heap, not on threads
+ *
+ * Usage: synthetic_server [options]
+ *   --port <n>        First port; host h listens on port + h (default 8780)
+ *   --hosts <n>       Number of hosts (default 4)
+ *   --pages <n>       Pages in the site (default 100000)
+ *   --links <n>       Links per page (default 16)
+ *   --page-kb <n>     Approximate page size (default 4)
+ *   --latency-ms <n>  Delay before every response (default 0)
+ *   --jitter-ms <n>   Extra per-page delay, 0..n ms (default 0)
+ *   --bind <ip>       Listen address (default 127.0.0.1)
+ *   --gzip <0|1>      Gzip pages for clients that accept it (needs zlib, default 0)
+ *
+ * The seed is http://<bind>:<port>/ (page 0). Stop with Ctrl-C
+ */
+#include "synthetic_graph.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+struct Options {
+    int port = 8780;
+    int hosts = 4;
+    uint32_t pages = 100000;
+    uint32_t links = 16;
+    size_t page_bytes = 4096;
+    int latency_ms = 0;
+    int jitter_ms = 0;
+    std::string bind = "127.0.0.1";
+    bool gzip = false;
+};
+
+struct Connection {
+    int fd = -1;
+    int host = 0;                   // Index of the port it came in on
+    std::string in;                 // Request bytes not handled yet
+    std::string out;                // Response being written
+    size_t out_pos = 0;
+    std::string held;               // Response waiting for its timer
+    bool waiting = false;
+    bool close_after = false;
+    bool writing = false;           // EPOLLOUT registered
+    uint64_t serial = 0;            // Tells a live timer from one of a closed fd
+};
+
+struct Timer {
+    int64_t due_ms;
+    int fd;
+    uint64_t serial;
+    bool operator>(const Timer& other) const { return due_ms > other.due_ms; }
+};
+
+// Request head size limit (a crawler's GET is a few hundred bytes)
+const size_t MAX_REQUEST_BYTES = 16384;
+
+const char* const WORDS[] = {"crawl", "graph", "frontier", "latency", "thread", "socket",
+                             "buffer", "parser", "domain", "anchor", "queue", "kernel",
+                             "cache", "vector", "signal", "stream"};
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_signal(int) {
+    stop_requested = 1;
+}
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]" << std::endl;
+    std::cout << "  --port <n>        First port; host h listens on port + h (default 8780)" << std::endl;
+    std::cout << "  --hosts <n>       Number of hosts (default 4)" << std::endl;
+    std::cout << "  --pages <n>       Pages in the site (default 100000)" << std::endl;
+    std::cout << "  --links <n>       Links per page (default 16)" << std::endl;
+    std::cout << "  --page-kb <n>     Approximate page size (default 4)" << std::endl;
+    std::cout << "  --latency-ms <n>  Delay before every response (default 0)" << std::endl;
+    std::cout << "  --jitter-ms <n>   Extra per-page delay, 0..n ms (default 0)" << std::endl;
+    std::cout << "  --bind <ip>       Listen address (default 127.0.0.1)" << std::endl;
+    std::cout << "  --gzip <0|1>      Gzip pages for clients that accept it (needs zlib, default 0)" << std::endl;
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "[ERROR] Missing value for " << flag << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (flag == "--port") {
+                options.port = std::stoi(value);
+            } else if (flag == "--hosts") {
+                options.hosts = std::stoi(value);
+            } else if (flag == "--pages") {
+                options.pages = static_cast<uint32_t>(std::stoul(value));
+            } else if (flag == "--links") {
+                options.links = static_cast<uint32_t>(std::stoul(value));
+            } else if (flag == "--page-kb") {
+                options.page_bytes = std::stoul(value) * 1024;
+            } else if (flag == "--latency-ms") {
+                options.latency_ms = std::stoi(value);
+            } else if (flag == "--jitter-ms") {
+                options.jitter_ms = std::stoi(value);
+            } else if (flag == "--bind") {
+                options.bind = value;
+            } else if (flag == "--gzip") {
+                options.gzip = std::stoi(value) != 0;
+            } else {
+                std::cerr << "[ERROR] Unknown option: " << flag << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "[ERROR] Invalid value for " << flag << ": " << value << std::endl;
+            return false;
+        }
+    }
+    if (options.hosts <= 0 || options.port <= 0 || options.port + options.hosts - 1 > 65535) {
+        std::cerr << "[ERROR] --port and --hosts must give ports within 1-65535" << std::endl;
+        return false;
+    }
+#ifndef HAVE_ZLIB
+    if (options.gzip) {
+        std::cerr << "[ERROR] --gzip needs a build with zlib" << std::endl;
+        return false;
+    }
+#endif
+    if (options.pages == 0 || options.latency_ms < 0 || options.jitter_ms < 0) {
+        std::cerr << "[ERROR] --pages must be positive and delays non-negative" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+class SyntheticServer {
+public:
+    explicit SyntheticServer(const Options& opts) : options(opts) {}
+
+    ~SyntheticServer() {
+        for (auto& entry : connections) {
+            ::close(entry.first);
+        }
+        for (int fd : listeners) {
+            ::close(fd);
+        }
+        if (epoll_fd >= 0) {
+            ::close(epoll_fd);
+        }
+    }
+
+    /**
+     * Bind every host's port
+     * @return false (after printing why) if one cannot be bound
+     */
+    bool listen() {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            std::cerr << "[ERROR] epoll_create1: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        for (int host = 0; host < options.hosts; host++) {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(options.port + host));
+            if (inet_pton(AF_INET, options.bind.c_str(), &addr.sin_addr) != 1) {
+                std::cerr << "[ERROR] Invalid bind address " << options.bind << std::endl;
+                return false;
+            }
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int one = 1;
+            if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+                ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+                ::listen(fd, 1024) < 0) {
+                std::cerr << "[ERROR] Cannot listen on " << options.bind << ":"
+                          << options.port + host << ": " << std::strerror(errno) << std::endl;
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                return false;
+            }
+            listeners.push_back(fd);
+            listener_host[fd] = host;
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+        }
+        return true;
+    }
+
+    void run() {
+        std::vector<epoll_event> events(256);
+        while (!stop_requested) {
+            int timeout = 1000;
+            if (!timers.empty()) {
+                timeout = static_cast<int>(std::max<int64_t>(0, timers.top().due_ms - now_ms()));
+            }
+            int n = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout);
+            if (n < 0 && errno != EINTR) {
+                std::cerr << "[ERROR] epoll_wait: " << std::strerror(errno) << std::endl;
+                return;
+            }
+            for (int i = 0; i < n; i++) {
+                int fd = events[i].data.fd;
+                auto listener = listener_host.find(fd);
+                if (listener != listener_host.end()) {
+                    accept_all(fd, listener->second);
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end()) {
+                    continue;
+                }
+                Connection& connection = it->second;
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close_connection(fd);
+                    continue;
+                }
+                if ((events[i].events & EPOLLIN) && !read_all(connection)) {
+                    close_connection(fd);
+                    continue;
+                }
+                if ((events[i].events & EPOLLOUT) && !flush(connection)) {
+                    continue;               // Closed
+                }
+                advance(connection);
+            }
+            fire_timers();
+        }
+    }
+
+    void print_stats() const {
+        std::cout << "[INFO] Served " << pages_served << " pages, " << not_found
+                  << " not found, " << bytes_sent / 1024 << " KB on " << accepted
+                  << " connections" << std::endl;
+    }
+
+private:
+    Options options;
+    int epoll_fd = -1;
+    std::vector<int> listeners;
+    std::unordered_map<int, int> listener_host;
+    std::unordered_map<int, Connection> connections;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t next_serial = 0;
+
+    uint64_t pages_served = 0;
+    uint64_t not_found = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t accepted = 0;
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, op, fd, &event);
+    }
+
+    void accept_all(int listen_fd, int host) {
+        while (true) {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;                     // EAGAIN, or out of fds until some close
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            Connection& connection = connections[fd];
+            connection.fd = fd;
+            connection.host = host;
+            watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+            accepted++;
+        }
+    }
+
+    void close_connection(int fd) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+    }
+
+    // false once the peer closed or the request head is too large
+    bool read_all(Connection& connection) {
+        char chunk[16384];
+        while (true) {
+            ssize_t got = ::recv(connection.fd, chunk, sizeof(chunk), 0);
+            if (got > 0) {
+                connection.in.append(chunk, static_cast<size_t>(got));
+                if (connection.in.size() > 4 * MAX_REQUEST_BYTES) {
+                    return false;           // Pipelining this far ahead isn't a crawler
+                }
+                continue;
+            }
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            return got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+
+    // Write what the socket takes; false if the connection was closed
+    bool flush(Connection& connection) {
+        while (connection.out_pos < connection.out.size()) {
+            ssize_t n = ::send(connection.fd, connection.out.data() + connection.out_pos,
+                               connection.out.size() - connection.out_pos, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!connection.writing) {
+                    watch(connection.fd, EPOLLIN | EPOLLOUT, EPOLL_CTL_MOD);
+                    connection.writing = true;
+                }
+                return true;
+            }
+            if (n <= 0) {
+                close_connection(connection.fd);
+                return false;
+            }
+            connection.out_pos += static_cast<size_t>(n);
+            bytes_sent += static_cast<uint64_t>(n);
+        }
+        connection.out.clear();
+        connection.out_pos = 0;
+        if (connection.writing) {
+            watch(connection.fd, EPOLLIN, EPOLL_CTL_MOD);
+            connection.writing = false;
+        }
+        if (connection.close_after) {
+            close_connection(connection.fd);
+            return false;
+        }
+        return true;
+    }
+
+    // Answer buffered requests one at a time, in order
+    void advance(Connection& connection) {
+        while (!connection.waiting && connection.out.empty()) {
+            size_t head_end = connection.in.find("\r\n\r\n");
+            if (head_end == std::string::npos) {
+                if (connection.in.size() > MAX_REQUEST_BYTES) {
+                    close_connection(connection.fd);
+                }
+                return;
+            }
+            std::string head = connection.in.substr(0, head_end);
+            connection.in.erase(0, head_end + 4);
+
+            int delay_ms = 0;
+            connection.held = respond(connection, head, delay_ms);
+            if (delay_ms > 0) {
+                connection.waiting = true;
+                connection.serial = ++next_serial;
+                timers.push(Timer{now_ms() + delay_ms, connection.fd, connection.serial});
+                return;
+            }
+            connection.out.swap(connection.held);
+            if (!flush(connection)) {
+                return;
+            }
+        }
+    }
+
+    void fire_timers() {
+        int64_t now = now_ms();
+        while (!timers.empty() && timers.top().due_ms <= now) {
+            Timer timer = timers.top();
+            timers.pop();
+            auto it = connections.find(timer.fd);
+            if (it == connections.end() || it->second.serial != timer.serial ||
+                !it->second.waiting) {
+                continue;                   // Closed while held (the fd may be reused)
+            }
+            Connection& connection = it->second;
+            connection.waiting = false;
+            connection.out.swap(connection.held);
+            if (flush(connection)) {
+                advance(connection);
+            }
+        }
+    }
+
+    // Build the response to one request head; sets delay_ms for pages
+    std::string respond(Connection& connection, const std::string& head, int& delay_ms) {
+        size_t method_end = head.find(' ');
+        size_t target_end = head.find(' ', method_end + 1);
+        std::string method = head.substr(0, method_end);
+        std::string target = (method_end == std::string::npos || target_end == std::string::npos)
+                                 ? std::string()
+                                 : head.substr(method_end + 1, target_end - method_end - 1);
+        std::string lower = head;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        connection.close_after = lower.find("\r\nconnection: close") != std::string::npos ||
+                                 lower.find(" http/1.0") != std::string::npos;
+
+        if (method != "GET" && method != "HEAD") {
+            return reply("405 Method Not Allowed", "", connection.close_after);
+        }
+        uint32_t page = 0;
+        if (!page_for(target, connection.host, page)) {
+            not_found++;
+            return reply("404 Not Found", "", connection.close_after);
+        }
+        pages_served++;
+        delay_ms = options.latency_ms;
+        if (options.jitter_ms > 0) {
+            uint64_t state = page;
+            delay_ms += static_cast<int>(SyntheticGraph::next(state) %
+                                         static_cast<uint64_t>(options.jitter_ms + 1));
+        }
+        std::string body = page_html(page);
+        const char* encoding = nullptr;
+        if (options.gzip && accepts_gzip(lower)) {
+            body = gzip_body(body);
+            encoding = "gzip";
+        }
+        return reply("200 OK", method == "HEAD" ? "" : body, connection.close_after, body.size(),
+                     encoding);
+    }
+
+    // Looks for gzip in the Accept-Encoding header of a lowercased head
+    static bool accepts_gzip(const std::string& lower_head) {
+        size_t start = lower_head.find("\r\naccept-encoding:");
+        if (start == std::string::npos) {
+            return false;
+        }
+        size_t end = lower_head.find("\r\n", start + 2);
+        return lower_head.substr(start, end - start).find("gzip") != std::string::npos;
+    }
+
+    // Default-level gzip of one page (a few KiB: one deflate call)
+    static std::string gzip_body(const std::string& body) {
+#ifdef HAVE_ZLIB
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            return body;
+        }
+        std::string out(deflateBound(&stream, static_cast<uLong>(body.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        stream.avail_out = static_cast<uInt>(out.size());
+        deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        return out;
+#else
+        return body;
+#endif
+    }
+
+    // "/" is page 0; "/p/<id>.html" is page id, on its own host only
+    bool page_for(const std::string& target, int host, uint32_t& page) const {
+        if (target == "/" || target == "/index.html") {
+            page = 0;
+        } else if (target.compare(0, 3, "/p/") == 0 && target.size() > 8 &&
+                   target.compare(target.size() - 5, 5, ".html") == 0) {
+            std::string digits = target.substr(3, target.size() - 8);
+            if (digits.empty() || digits.size() > 9 ||
+                digits.find_first_not_of("0123456789") != std::string::npos) {
+                return false;
+            }
+            page = static_cast<uint32_t>(std::stoul(digits));
+        } else {
+            return false;
+        }
+        return page < options.pages && static_cast<int>(page % options.hosts) == host;
+    }
+
+    std::string page_url(uint32_t page) const {
+        std::string url = "http://" + options.bind + ":" +
+                          std::to_string(options.port + static_cast<int>(page % options.hosts));
+        return page == 0 ? url + "/" : url + "/p/" + std::to_string(page) + ".html";
+    }
+
+    std::string page_html(uint32_t page) const {
+        std::string id = std::to_string(page);
+        std::string html = "<!DOCTYPE html><html><head><title>Page " + id +
+                           "</title></head><body><h1>Page " + id + "</h1>\n";
+        thread_local std::vector<uint32_t> targets;
+        SyntheticGraph::page_links(page, options.pages, options.links, targets);
+        for (uint32_t target : targets) {
+            html += "<a href=\"" + page_url(target) + "\">Page " + std::to_string(target) + "</a>\n";
+        }
+
+        // Filler text differs per page so near-duplicate detection stays quiet
+        uint64_t state = 0xf111e5ULL ^ page;
+        const size_t word_count = sizeof(WORDS) / sizeof(WORDS[0]);
+        while (html.size() + 20 < options.page_bytes) {
+            html += "<p>";
+            for (int w = 0; w < 12; w++) {
+                html += WORDS[SyntheticGraph::next(state) % word_count];
+                html += w == 11 ? "." : " ";
+            }
+            html += "</p>\n";
+        }
+        html += "</body></html>\n";
+        return html;
+    }
+
+    static std::string reply(const char* status, const std::string& body, bool close_after,
+                             size_t content_length = std::string::npos,
+                             const char* encoding = nullptr) {
+        if (content_length == std::string::npos) {
+            content_length = body.size();
+        }
+        std::string response = "HTTP/1.1 ";
+        response += status;
+        if (encoding) {
+            response += "\r\nContent-Encoding: ";
+            response += encoding;
+        }
+        response += "\r\nContent-Type: text/html\r\nContent-Length: ";
+        response += std::to_string(content_length);
+        response += close_after ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n";
+        response += body;
+        return response;
+    }
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct sigaction action{};
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    SyntheticServer server(options);
+    if (!server.listen()) {
+        return 1;
+    }
+    std::cout << "[INFO] Serving " << options.pages << " pages (" << options.links
+              << " links each) on " << options.hosts << " host(s), ports " << options.port
+              << "-" << options.port + options.hosts - 1 << ", latency " << options.latency_ms
+              << " ms + 0-" << options.jitter_ms << " ms"
+              << (options.gzip ? ", gzip" : "") << std::endl;
+    std::cout << "[INFO] Seed: http://" << options.bind << ":" << options.port << "/" << std::endl;
+
+    server.run();
+    server.print_stats();
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <cstdint>
+
+/**
+ * Process-wide heap allocation counters
+ * alloc_stats.cpp replaces the global operator new/delete with versions
+ * that count into cache-line-striped slots (one per thread, modulo the
+ * slot count), so counting adds no shared-line traffic between threads.
+ * The counters are what the per-page allocation figures in the crawl stats
+ * are computed from
+ */
+struct AllocStats {
+    uint64_t allocations = 0;   // operator new calls
+    uint64_t frees = 0;         // operator delete calls (non-null)
+    uint64_t bytes = 0;         // Bytes requested through operator new
+
+    /**
+     * Sum of all slots right now (relaxed; a consistent-enough snapshot for stats)
+     */
+    static AllocStats snapshot();
+};
+
+#endif // ALLOC_STATS_H
@@ -0,0 +1,27 @@
+#ifndef BODY_CONSUMER_H
+#define BODY_CONSUMER_H
+
+#include <string_view>
+
+/**
+ * Receives a response body piece by piece while it downloads
+ * (streaming mode of FetchEngine; only 2xx bodies are delivered)
+ */
+class BodyConsumer {
+public:
+    virtual ~BodyConsumer() = default;
+
+    /**
+     * Take the next piece of the body
+     * @param chunk Bytes as delivered by curl; only valid during the call
+     * @return false to stop the transfer (budget reached)
+     */
+    virtual bool consume(std::string_view chunk) = 0;
+
+    /**
+     * Called once after the last piece (also after an early stop)
+     */
+    virtual void finish() = 0;
+};
+
+#endif // BODY_CONSUMER_H
@@ -0,0 +1,237 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bounded multi-producer multi-consumer ring between pipeline stages
+ * try_push() and try_pop() are lock-free: each claims a cell with one CAS
+ * on its position counter and hands the cell over through the cell's
+ * sequence number (Vyukov's bounded queue). The blocking push() and pop()
+ * spin briefly, then sleep on a condition variable; the other side only
+ * takes the mutex to wake a sleeper when one is registered, so a busy
+ * pipeline never touches it
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue() = default;
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * Allocate the ring (before any producer or consumer starts)
+     * @param min_capacity Rounded up to a power of two, at least 2
+     */
+    void init(size_t min_capacity) {
+        size_t size = 2;
+        while (size < min_capacity) {
+            size <<= 1;
+        }
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mask = size - 1;
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+        high_water.store(0, std::memory_order_relaxed);
+        closed.store(false);
+    }
+
+    /**
+     * Add an item unless the ring is full
+     * @param item Moved from only on success
+     */
+    bool try_push(T& item) {
+        if (!enqueue(item)) {
+            return false;
+        }
+        wake(sleeping_consumers, not_empty);
+        return true;
+    }
+
+    /**
+     * Take the oldest item unless the ring is empty
+     */
+    bool try_pop(T& out) {
+        if (!dequeue(out)) {
+            return false;
+        }
+        wake(sleeping_producers, not_full);
+        return true;
+    }
+
+    /**
+     * Add an item, waiting while the ring is full (backpressure)
+     * @return false if the queue was closed first (item untouched)
+     */
+    bool push(T& item) {
+        for (int spin = 0; spin < SPIN_TRIES; spin++) {
+            if (closed.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            if (try_push(item)) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        if (!sleep_until(sleeping_producers, not_full, [&]() { return enqueue(item); })) {
+            return false;
+        }
+        wake(sleeping_consumers, not_empty);
+        return true;
+    }
+
+    /**
+     * Take the oldest item, waiting while the ring is empty
+     * @return false once the queue is closed (items still queued are left)
+     */
+    bool pop(T& out) {
+        for (int spin = 0; spin < SPIN_TRIES; spin++) {
+            if (closed.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            if (try_pop(out)) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        if (!sleep_until(sleeping_consumers, not_empty, [&]() { return dequeue(out); })) {
+            return false;
+        }
+        wake(sleeping_producers, not_full);
+        return true;
+    }
+
+    /**
+     * Fail every blocked and later push() and pop()
+     */
+    void close() {
+        closed.store(true);
+        std::lock_guard<std::mutex> lock(mutex);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    /**
+     * Items queued (approximate while producers or consumers run)
+     */
+    size_t size() const {
+        size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    /**
+     * Most items ever queued at once
+     */
+    size_t peak() const { return high_water.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence{0};
+        T value;
+    };
+
+    static constexpr int SPIN_TRIES = 64;
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+    alignas(64) std::atomic<size_t> high_water{0};
+    std::atomic<bool> closed{false};
+
+    // Slow path only
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::atomic<int> sleeping_consumers{0};
+    std::atomic<int> sleeping_producers{0};
+
+    bool enqueue(T& item) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;           // Still holds the item from a lap ago: full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        size_t depth = pos + 1 - dequeue_pos.load(std::memory_order_relaxed);
+        size_t seen = high_water.load(std::memory_order_relaxed);
+        while (depth > seen && depth <= capacity() &&
+               !high_water.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    bool dequeue(T& out) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;           // Not written yet: empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // The fences pair with those in sleep_until(): either the sleeper's
+    // retry sees our item (or free cell), or we see the sleeper
+    void wake(std::atomic<int>& sleepers, std::condition_variable& cv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_one();
+        }
+    }
+
+    template <typename Attempt>
+    bool sleep_until(std::atomic<int>& sleepers, std::condition_variable& cv, Attempt attempt) {
+        std::unique_lock<std::mutex> lock(mutex);
+        sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool done = false;
+        while (!closed.load() && !(done = attempt())) {
+            cv.wait(lock);
+        }
+        sleepers.fetch_sub(1);
+        return done;
+    }
+};
+
+#endif // BOUNDED_QUEUE_H
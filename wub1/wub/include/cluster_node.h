@@ -0,0 +1,260 @@
+#ifndef CLUSTER_NODE_H
+#define CLUSTER_NODE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "storage_manager.h"
+
+/**
+ * Cluster traffic counters (for stats)
+ */
+struct ClusterStats {
+    uint64_t urls_sent = 0;         // Links handed to their owning node
+    uint64_t urls_received = 0;     // Links other nodes handed to this one
+    uint64_t urls_dropped = 0;      // Links for a node that could not be reached
+    uint64_t batches_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+};
+
+/**
+ * One node of a multi-process crawl
+ * Every node gets the same node list; a host belongs to the node its
+ * host key hashes to, so each host's frontier queue, politeness state
+ * and visited URLs live on exactly one node. Links to hosts owned
+ * elsewhere are batched per peer and sent over one TCP connection per
+ * peer in length-prefixed binary frames (varint depth, float priority,
+ * varint-prefixed URL); the owner admits them into its frontier.
+ *
+ * Node 0 coordinates. Every node reports whether it is idle (nothing
+ * outstanding) with its sent and received link counts; the crawl is over
+ * once two consecutive rounds of reports are all idle with matching,
+ * unchanged counts, so no batch can still be in transit, or once the
+ * nodes crawled max_pages between them. Node 0 then tells every node to
+ * stop and gathers their merged graphs for the final PageRank.
+ *
+ * Threads: one sender (batch flushes, status reports, termination
+ * checks on node 0) and one receiver (all incoming connections); the
+ * callbacks run on the receiver thread
+ */
+class ClusterNode {
+public:
+    /**
+     * Links received for this node's hosts, in runs of equal depth
+     * (the vectors may be moved from)
+     */
+    using UrlSink = std::function<void(std::vector<std::string>& urls, uint32_t depth,
+                                       std::vector<float>& priorities)>;
+
+    /**
+     * Local state for a status report
+     * @param idle Set if nothing is queued, in flight or being parsed
+     * @param pages Set to the pages crawled so far
+     */
+    using StatusProbe = std::function<void(bool& idle, uint64_t& pages)>;
+
+    /**
+     * Called once when the coordinator ends the crawl
+     */
+    using StopHandler = std::function<void()>;
+
+    ClusterNode();
+    ~ClusterNode();
+
+    ClusterNode(const ClusterNode&) = delete;
+    ClusterNode& operator=(const ClusterNode&) = delete;
+
+    /**
+     * Parse a comma-separated "host:port" list
+     * @return false if an entry has no port
+     */
+    static bool parse_nodes(const std::string& list, std::vector<std::string>& nodes);
+
+    /**
+     * Bind this node's address (call before start, so a busy port fails early)
+     * @param nodes "host:port" of every node, the same list on every node
+     * @param self Index of this node in nodes
+     * @throws std::runtime_error if the address cannot be resolved or bound
+     */
+    void listen(const std::vector<std::string>& nodes, int self);
+
+    /**
+     * Start exchanging links and status with the other nodes
+     * @param sink Admits links received for local hosts
+     * @param probe Reports local idleness and progress
+     * @param on_stop Ends the local crawl
+     * @param max_pages Pages the whole cluster crawls (checked on node 0)
+     */
+    void start(UrlSink sink, StatusProbe probe, StopHandler on_stop, uint64_t max_pages);
+
+    /**
+     * Stop handing received links to the sink (call before tearing down
+     * what it feeds); once this returns the sink is not running and is
+     * never called again. Later links are counted as received and dropped
+     */
+    void detach_sink();
+
+    /**
+     * Stop the threads and close every connection
+     */
+    void stop();
+
+    bool enabled() const { return listen_fd >= 0; }
+    bool coordinator() const { return self_id == 0; }
+    int self() const { return self_id; }
+    size_t size() const { return addresses.size(); }
+
+    /**
+     * Node owning a host
+     * @param host Host key (HostScheduler::host_key())
+     */
+    int owner(std::string_view host) const;
+
+    /**
+     * Queue a link for the node owning its host (sent within FLUSH_MS)
+     * Ignored once the crawl has stopped
+     */
+    void send(int node, std::string_view url, uint32_t depth, float priority);
+
+    /**
+     * Block until the coordinator has ended the crawl
+     */
+    void wait_stop();
+
+    /**
+     * Send this node's merged graph to the coordinator (not on node 0)
+     * Call after the crawl stopped and merge_all_buffers()
+     * @throws std::runtime_error if the coordinator cannot be reached
+     */
+    void send_graph(const StorageManager& storage);
+
+    /**
+     * Wait for every other node's graph and fold it into storage's
+     * buffers (node 0, before merge_all_buffers())
+     * @param timeout_seconds Give up on nodes that haven't sent theirs by then
+     * @return Number of graphs merged
+     */
+    size_t gather(StorageManager& storage, int timeout_seconds);
+
+    ClusterStats stats() const;
+
+    static constexpr size_t BATCH_URLS = 512;       // Flush a peer's batch early at this size
+    static constexpr int FLUSH_MS = 20;             // Longest a link waits in a batch
+    static constexpr int STATUS_MS = 100;           // Status report interval
+    static constexpr int CONNECT_TIMEOUT_MS = 30000;    // Peers may start later than us
+
+private:
+    // Frame types; a frame is u32 payload length, u8 type, payload
+    enum class Frame : uint8_t {
+        Hello = 1,          // varint node, varint cluster size
+        Urls = 2,           // varint count, count x (varint depth, f32 priority, varint-prefixed URL)
+        Status = 3,         // varint node, u8 idle, varint sent, varint received, varint pages
+        Stop = 4,
+        GraphNames = 5,     // varint count, count x varint-prefixed domain
+        GraphLinks = 6,     // varint count, count x (varint source, varint visits,
+                            //   varint degree, degree x (varint target, varint weight))
+        GraphEnd = 7,
+    };
+
+    struct Peer;
+    struct Connection;
+
+    /**
+     * Last report of one node (node 0 only)
+     */
+    struct Report {
+        bool idle = false;
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        uint64_t pages = 0;
+        uint64_t sequence = 0;      // 0 until the node first reported
+    };
+
+    std::vector<std::string> addresses;
+    int self_id = -1;
+    int listen_fd = -1;
+    int wake_fd = -1;               // Wakes the receiver for stop()
+    std::unique_ptr<Peer[]> peers;  // Outgoing side, one per node (own slot unused)
+
+    std::mutex sink_mutex;          // Held while the sink runs
+    UrlSink sink;
+    StatusProbe probe;
+    StopHandler on_stop;
+    uint64_t max_pages = 0;
+
+    std::thread sender;
+    std::thread receiver;
+    std::atomic<bool> running{false};
+    std::mutex sender_mutex;
+    std::condition_variable sender_cv;
+    bool flush_now = false;
+
+    std::mutex stop_mutex;
+    std::condition_variable stop_cv;
+    std::atomic<bool> stopped{false};   // The crawl has ended (STOP seen or sent)
+
+    // Termination detection (node 0, sender thread except reports)
+    std::mutex report_mutex;
+    std::vector<Report> reports;
+    std::vector<Report> last_wave;
+    bool last_wave_balanced = false;
+
+    // Graph frames per node, decoded by gather() on the caller's thread
+    std::mutex graph_mutex;
+    std::condition_variable graph_cv;
+    std::vector<std::vector<std::pair<Frame, std::vector<uint8_t>>>> graph_frames;
+    std::vector<bool> graph_done;
+
+    std::atomic<uint64_t> urls_sent{0};
+    std::atomic<uint64_t> urls_received{0};
+    std::atomic<uint64_t> urls_dropped{0};
+    std::atomic<uint64_t> batches_sent{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> bytes_received{0};
+
+    /**
+     * Write one frame to a peer, connecting first if needed
+     * @return false if the peer cannot be reached
+     */
+    bool write_frame(int node, Frame type, const std::vector<uint8_t>& payload);
+
+    /**
+     * Send a peer's pending batch
+     */
+    void flush_peer(int node);
+
+    /**
+     * Status of this node; counters are read around the probe so a
+     * report never shows a batch as received before its links are queued
+     */
+    Report local_report();
+
+    /**
+     * Record a report and end the crawl if the cluster is done (node 0)
+     */
+    void check_termination();
+
+    /**
+     * End the crawl everywhere (node 0) or locally (STOP received)
+     */
+    void finish(bool broadcast);
+
+    /**
+     * Handle one complete frame from a connection
+     */
+    void dispatch(Connection& connection, Frame type, const uint8_t* p, const uint8_t* end);
+
+    void run_sender();
+    void run_receiver();
+};
+
+#endif // CLUSTER_NODE_H
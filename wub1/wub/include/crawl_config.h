@@ -0,0 +1,66 @@
+#ifndef CRAWL_CONFIG_H
+#define CRAWL_CONFIG_H
+
+#include <string>
+#include <vector>
+#include "visited_set.h"
+#include "host_scheduler.h"
+#include "frontier_spill.h"
+#include "logger.h"
+
+/**
+ * How the frontier orders URLs within and across hosts
+ */
+enum class FrontierPriority {
+    Fifo,       // Discovery order
+    Depth,      // Shallowest first (breadth-first)
+    PageRank    // Live rank of the target domain, discounted by depth
+};
+
+/**
+ * Crawl settings collected from the command line
+ * Positional arguments fill the first three fields, optional
+ * --flags override the defaults below
+ */
+struct CrawlConfig {
+    std::string seed_url;
+    int max_pages = 0;
+    int num_threads = 0;        // Parser worker threads
+    int store_threads = 0;      // Storage/enqueue threads (0 = parser workers store their own pages)
+    size_t parse_queue = 1024;  // Downloaded pages waiting for a parser (caps fetches ahead of parsing)
+    size_t store_queue = 1024;  // Parsed pages waiting for a store thread
+    int io_threads = 2;         // Event-loop threads driving curl_multi
+    int max_inflight = 512;     // Concurrent transfers across all I/O threads
+    int frontier_shards = 64;   // Lock-striped URLFrontier shards
+    int pagerank_iterations = 30;       // PageRank iteration cap
+    double pagerank_tolerance = 1e-6;   // PageRank L1 convergence threshold
+    bool live_pagerank = true;          // Maintain incremental ranks during the crawl
+    VisitedSetOptions visited;          // Frontier visited-set backend
+    HostPolicy politeness;              // Per-host connections and crawl delay
+    bool robots = true;                 // Fetch and obey each host's robots.txt
+    bool sitemaps = false;              // Queue the URLs of sitemaps listed in robots.txt
+    std::string sitemap_url;            // Sitemap to queue at the start (empty = none)
+    FrontierPriority priority = FrontierPriority::Depth;   // Frontier ordering
+    FrontierSpillOptions frontier_spill;    // In-memory URL cap and segment directory
+    std::string checkpoint_dir;         // Crawl journal directory (empty = no checkpoints)
+    int checkpoint_interval = 30;       // Seconds between checkpoints
+    bool resume = false;                // Load checkpoint_dir before crawling
+    std::string fetch_cache;            // Conditional re-crawl cache file (empty = none)
+    bool stream_parse = true;           // Extract links from body pieces as they arrive
+    size_t max_page_bytes = 0;          // Cut bodies at this size (0 = unlimited)
+    size_t max_page_links = 0;          // Stop reading a page after this many links (0 = unlimited)
+    bool compression = true;            // Offer gzip/deflate/br/zstd; curl decodes as bodies arrive
+    size_t max_decoded_bytes = 32 * 1024 * 1024;    // Cut compressed bodies that decode past this (0 = unlimited)
+    int near_duplicate_bits = 0;        // SimHash distance of a near-duplicate page (0 = off)
+    bool dns_prefetch = true;           // Resolve new hosts ahead of their first fetch
+    std::vector<std::string> cluster_nodes;     // "host:port" of every node (empty = single process)
+    int cluster_node = 0;               // This process's index in cluster_nodes
+    LogOptions log;                     // Level, per-URL sampling and destination of the log
+    int metrics_interval = 10;          // Seconds between stage-metric dumps (0 = only at the end)
+    std::string metrics_file;           // Final stage metrics as CSV (empty = none)
+    int metrics_port = 0;               // Prometheus endpoint port (0 = no endpoint)
+    std::string metrics_bind = "127.0.0.1";     // Address the endpoint listens on
+    std::string graph_file = "crawl_graph.bin";    // Binary graph export (empty = none)
+};
+
+#endif // CRAWL_CONFIG_H
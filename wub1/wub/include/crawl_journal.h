@@ -0,0 +1,153 @@
+#ifndef CRAWL_JOURNAL_H
+#define CRAWL_JOURNAL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "host_scheduler.h"
+#include "domain_table.h"
+#include "csr_graph.h"
+
+/**
+ * Append-only crawl journal for checkpoint and resume
+ * The crawl state is never copied; instead every change is appended to
+ * a binary log as it happens:
+ *   admit-p<i>.log   URLs admitted by frontier partition i (url, depth, priority)
+ *   pages-t<i>.log   pages finished by worker i (URL fingerprint, source
+ *                    domain, target domains) and failed URLs (fingerprint)
+ *   domains.log      domain names in ID order
+ * A checkpoint flushes the page logs, then the admission logs, then the
+ * new domain names, syncs them and atomically replaces MANIFEST with the
+ * valid length of every file. That order makes the cut consistent: a
+ * page is only logged after its links were admitted, and its domains
+ * were interned before it was logged. Appenders only copy into a buffer
+ * under a per-file lock, so a checkpoint pauses nobody for longer than
+ * a write() into the page cache.
+ * On resume the files are truncated to the manifest lengths, mapped
+ * read-only and replayed: admitted URLs rebuild the visited set, and
+ * those without a page record (queued or in flight at the checkpoint)
+ * are queued again. Logging then continues in the same files.
+ * I/O errors throw std::runtime_error
+ */
+class CrawlJournal {
+public:
+    CrawlJournal();
+    ~CrawlJournal();
+
+    CrawlJournal(const CrawlJournal&) = delete;
+    CrawlJournal& operator=(const CrawlJournal&) = delete;
+
+    /**
+     * Open a journal directory
+     * @param dir Directory (created if missing)
+     * @param num_partitions Frontier partitions (one admission log each)
+     * @param num_workers Parser workers (one page log each)
+     * @param resume Load the last checkpoint; otherwise the directory must not hold one
+     */
+    void open(const std::string& dir, size_t num_partitions, size_t num_workers, bool resume);
+
+    /**
+     * True if open() loaded an existing checkpoint
+     */
+    bool resumed() const;
+
+    /**
+     * Append admitted URLs (frontier, during push)
+     */
+    void log_admitted(size_t partition, const std::vector<FrontierEntry>& entries);
+
+    /**
+     * Append a finished page (worker, after its links were enqueued)
+     * @param edges The page's out-edges with their link counts
+     */
+    void log_page(size_t worker, uint64_t url_fingerprint, uint32_t source,
+                  const std::vector<WeightedEdge>& edges);
+
+    /**
+     * Append a URL that finished without a page (failed download)
+     */
+    void log_done(size_t worker, uint64_t url_fingerprint);
+
+    /**
+     * Write a checkpoint now
+     * @param domains Domain table whose new names are appended
+     */
+    void checkpoint(const DomainTable& domains);
+
+    /**
+     * Checkpoint periodically on a background thread
+     * @param interval_seconds Seconds between checkpoints
+     * @param domains Domain table (must outlive stop())
+     */
+    void start(int interval_seconds, const DomainTable& domains);
+
+    /**
+     * Stop the background thread and write a final checkpoint
+     */
+    void stop();
+
+    /**
+     * Replay domain names in ID order (resume only)
+     */
+    void replay_domains(const std::function<void(std::string_view name)>& visit) const;
+
+    /**
+     * Replay page and failure records (resume only)
+     * @param page Called per finished page; edges may be moved from
+     *             (pages logged as plain target lists arrive folded into counts)
+     * @param done Called per failed URL
+     */
+    void replay_pages(const std::function<void(uint64_t fingerprint, uint32_t source,
+                                               std::vector<WeightedEdge>& edges)>& page,
+                      const std::function<void(uint64_t fingerprint)>& done) const;
+
+    /**
+     * Replay admitted URLs (resume only)
+     */
+    void replay_admissions(const std::function<void(FrontierEntry&& entry)>& visit) const;
+
+private:
+    struct LogFile;
+
+    std::string directory;
+    bool loaded = false;
+    std::unique_ptr<LogFile> domain_log;
+    std::vector<std::unique_ptr<LogFile>> admit_logs;
+    std::vector<std::unique_ptr<LogFile>> page_logs;
+    std::vector<std::unique_ptr<LogFile>> frozen_logs;  // From a run with more partitions or workers
+    size_t domains_logged = 0;
+    std::atomic<uint64_t> pages_logged{0};
+    std::atomic<uint64_t> urls_logged{0};
+
+    std::mutex checkpoint_mutex;            // One checkpoint at a time
+    std::mutex timer_mutex;
+    std::condition_variable timer_cv;
+    bool stopping = false;
+    const DomainTable* timer_domains = nullptr;
+    std::thread timer;
+
+    /**
+     * Open or create one log, truncated to its checkpointed length
+     */
+    std::unique_ptr<LogFile> open_log(const std::string& name, size_t valid_bytes) const;
+
+    /**
+     * Map a log's checkpointed bytes and walk them
+     */
+    static void scan(const LogFile& log, const std::function<void(const uint8_t*, const uint8_t*)>& visit);
+
+    /**
+     * Logs (own and frozen) whose names start with prefix
+     */
+    std::vector<const LogFile*> logs_with_prefix(const std::string& prefix) const;
+};
+
+#endif // CRAWL_JOURNAL_H
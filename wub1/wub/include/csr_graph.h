@@ -0,0 +1,44 @@
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Out-edge to one domain and how many links on the page pointed there
+ */
+struct WeightedEdge {
+    uint32_t target;
+    uint32_t weight;
+};
+
+/**
+ * Compressed sparse row adjacency over dense domain IDs
+ * Out-edges of node v are targets[offsets[v] .. offsets[v+1]), each
+ * distinct; weights (parallel to targets) counts the links behind an
+ * edge, and every edge weighs 1 when it is empty
+ */
+struct CsrGraph {
+    std::vector<uint64_t> offsets;      // Size num_nodes() + 1
+    std::vector<uint32_t> targets;
+    std::vector<uint32_t> weights;      // Empty or parallel to targets
+
+    size_t num_nodes() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t num_edges() const { return targets.size(); }
+    uint64_t out_degree(uint32_t v) const { return offsets[v + 1] - offsets[v]; }
+
+    /**
+     * Number of links out of v (sum of its edge weights)
+     */
+    uint64_t out_weight(uint32_t v) const;
+
+    /**
+     * Reverse every edge (in-edge lists become out-edge lists)
+     * Sources within each reversed list stay in ascending order and
+     * weights travel with their edges
+     */
+    CsrGraph transpose() const;
+};
+
+#endif // CSR_GRAPH_H
@@ -0,0 +1,133 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * DNS cache counters (for stats)
+ */
+struct DnsStats {
+    size_t hosts = 0;           // Names in the cache (resolved, failed or pending)
+    size_t resolved = 0;        // Lookups that returned addresses
+    size_t failed = 0;          // Lookups that returned none
+    size_t hits = 0;            // Transfers handed cached addresses
+    size_t misses = 0;          // Transfers left to curl's own resolver
+};
+
+/**
+ * Process-wide DNS cache with asynchronous prefetch
+ * One resolver thread resolves names ahead of their first fetch: the
+ * frontier reports every host it has not seen before, and the name is
+ * looked up while its URLs wait in the queue. With c-ares (HAVE_CARES)
+ * all lookups run concurrently on one channel and every answer carries
+ * its TTL; otherwise the thread calls getaddrinfo() one name at a time
+ * and entries live for DEFAULT_TTL_SECONDS.
+ * Transfers get the addresses through CURLOPT_RESOLVE with the "+" prefix
+ * (see resolve_entry()), which puts them into the shared curl DNS cache
+ * with the normal cache timeout, so curl never has to resolve a name the
+ * cache already knows. Names that are not ready yet are left to curl.
+ * Lookups take a shared lock; the resolver takes the exclusive lock only
+ * to store an answer
+ */
+class DnsCache {
+public:
+    DnsCache();
+    ~DnsCache();
+
+    DnsCache(const DnsCache&) = delete;
+    DnsCache& operator=(const DnsCache&) = delete;
+
+    /**
+     * Start the resolver thread
+     * @throws std::runtime_error if the resolver cannot be initialized
+     */
+    void start();
+
+    /**
+     * Stop the resolver thread, dropping lookups still queued
+     */
+    void stop();
+
+    /**
+     * Resolve a host in the background unless it is cached or queued
+     * @param host Host, optionally with ":port" (e.g. a frontier host key)
+     */
+    void prefetch(std::string_view host);
+
+    /**
+     * CURLOPT_RESOLVE entry for a URL's host, if its addresses are cached
+     * and fresh ("+host:port:addr[,addr...]"); a miss queues a prefetch
+     * @param url Absolute http(s) URL
+     * @param entry Set on a hit
+     * @return true on a hit
+     */
+    bool resolve_entry(std::string_view url, std::string& entry);
+
+    /**
+     * Name of the compiled-in resolver ("c-ares" or "getaddrinfo")
+     */
+    static const char* backend_name();
+
+    DnsStats stats() const;
+
+    static constexpr int DEFAULT_TTL_SECONDS = 300;     // getaddrinfo gives no TTL
+    static constexpr int MIN_TTL_SECONDS = 30;          // Floor for short or zero TTLs
+    static constexpr int MAX_TTL_SECONDS = 3600;
+    static constexpr int NEGATIVE_TTL_SECONDS = 30;     // Failed names are retried after this
+    static constexpr size_t MAX_HOSTS = 1 << 20;        // Stop prefetching new names beyond this
+
+private:
+    struct Entry {
+        std::string addresses;      // curl syntax: "1.2.3.4,[2001:db8::1]"; empty = failed
+        int64_t expires_ms = 0;     // Steady clock; 0 while pending
+        bool pending = true;
+    };
+
+    struct Backend;                 // c-ares channel or nothing (getaddrinfo)
+
+    mutable std::shared_mutex cache_mutex;
+    std::unordered_map<std::string, Entry> cache;
+
+    std::mutex queue_mutex;
+    std::deque<std::string> queue;  // Names waiting for the resolver
+    int wake_fd = -1;
+    std::thread resolver;
+    std::atomic<bool> running{false};
+    std::unique_ptr<Backend> backend;
+
+    std::atomic<size_t> resolved{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+
+    /**
+     * Queue a lookup if the name is unknown or expired
+     * @param name Host name without port
+     */
+    void request(std::string_view name, int64_t now_ms);
+
+    /**
+     * Store an answer
+     * @param addresses curl syntax, empty if the name did not resolve
+     * @param ttl_seconds Lifetime of the answer
+     */
+    void store(const std::string& name, std::string addresses, int ttl_seconds);
+
+    /**
+     * Resolver thread body
+     */
+    void run();
+};
+
+#endif // DNS_CACHE_H
@@ -0,0 +1,80 @@
+#ifndef DOMAIN_TABLE_H
+#define DOMAIN_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+/**
+ * Concurrent domain interning table
+ * Maps each domain string to a dense uint32_t ID (0, 1, 2, ... in order
+ * of first sight) so graphs can be stored as integer arrays. Lookups
+ * take one lock-striped shard, picked by hash; only the first sighting
+ * of a domain also takes the name-list lock. Each name is stored once;
+ * shard maps key on views of the stored names
+ */
+class DomainTable {
+public:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+    /**
+     * @param num_shards Number of lock stripes (rounded up to a power of two)
+     */
+    explicit DomainTable(size_t num_shards = 64);
+
+    DomainTable(const DomainTable&) = delete;
+    DomainTable& operator=(const DomainTable&) = delete;
+
+    /**
+     * Get the ID of a domain, assigning the next free ID if it is new
+     * @param domain Domain name (e.g. "example.com")
+     * @return Dense ID
+     */
+    uint32_t intern(std::string_view domain);
+
+    /**
+     * Look up a domain without inserting it
+     * @return ID, or INVALID_ID if the domain was never interned
+     */
+    uint32_t find(std::string_view domain) const;
+
+    /**
+     * Name of an interned domain
+     * @param id ID returned by intern()
+     */
+    const std::string& name(uint32_t id) const;
+
+    /**
+     * Number of interned domains (IDs are 0 .. size()-1)
+     */
+    size_t size() const;
+
+    /**
+     * Approximate heap bytes used by names and index (for stats)
+     */
+    size_t memory_bytes() const;
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string_view, uint32_t> ids;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t shard_mask = 0;
+
+    // Deque keeps element addresses stable, so shard keys stay valid
+    mutable std::mutex names_mutex;
+    std::deque<std::string> names;
+
+    /**
+     * Pick the shard owning a domain
+     */
+    Shard& shard_for(std::string_view domain) const;
+};
+
+#endif // DOMAIN_TABLE_H
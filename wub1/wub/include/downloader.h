@@ -2,10 +2,44 @@
 #define DOWNLOADER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <curl/curl.h>
+#include "body_consumer.h"
+#include "hash64.h"
 
+/**
+ * Where one transfer's body goes (see Downloader::configure_handle)
+ */
+struct BodyTarget {
+    std::string* buffer = nullptr;      // Buffered mode: append here
+    BodyConsumer* consumer = nullptr;   // Streaming mode: hand pieces over instead
+    Hash64::Stream* content = nullptr;  // Also hash the delivered bytes here, if set
+    CURL* easy = nullptr;               // Handle of the transfer (status check)
+    size_t max_bytes = 0;               // Stop after this many body bytes (0 = unlimited)
+    size_t max_decoded_bytes = 0;       // Same for compressed bodies, counted after decoding
+    size_t received = 0;                // Body bytes kept so far (decoded)
+    bool started = false;               // First piece seen, status checked
+    bool deliver = false;               // Status is 2xx; other bodies are dropped
+    bool encoded = false;               // Sent with a Content-Encoding curl decodes for us
+    bool truncated = false;             // Stopped early by a byte limit or the consumer
+    bool decode_limited = false;        // The limit that stopped it was max_decoded_bytes
+};
+
+/**
+ * Thin wrapper over libcurl
+ * Keeps one long-lived easy handle per instance (one per thread) so
+ * consecutive blocking downloads reuse its connections, and attaches every
+ * handle to a process-wide share for the DNS and TLS session caches
+ */
 class Downloader {
 public:
+    Downloader() = default;
+    ~Downloader();
+
+    Downloader(const Downloader&) = delete;
+    Downloader& operator=(const Downloader&) = delete;
+
     /**
      * Download HTML content from URL using libcurl
      * @param url URL to download
@@ -34,12 +68,96 @@ public:
      */
     std::string get_protocol(const std::string& url);
 
+    /**
+     * Choose what download() and configure_handle() ask servers for
+     * With compression on, every encoding this libcurl can decode
+     * (gzip, deflate, and brotli/zstd when built in) is offered, and curl
+     * decodes as the body arrives, so buffers and stream consumers only
+     * ever see plain bytes
+     * @param enabled Send Accept-Encoding (default on)
+     * @param max_decoded_bytes Cut a compressed body once it decodes to
+     *        this many bytes, so a tiny response can't expand without bound
+     *        (0 = unlimited)
+     */
+    void set_compression(bool enabled, size_t max_decoded_bytes);
+
+    /**
+     * Apply the crawler's standard transfer options to an easy handle
+     * Shared by the blocking download() path and the async FetchEngine
+     * @param curl Easy handle to configure
+     * @param url URL to fetch (must outlive the transfer)
+     * @param buffer Response body destination
+     */
+    void configure_handle(CURL* curl, const std::string& url, std::string* buffer);
+
+    /**
+     * Same options, with the body going to a BodyTarget
+     * Non-2xx bodies are dropped as they arrive; a 2xx body is buffered
+     * (reserved up front from Content-Length) or streamed into the
+     * target's consumer. Reaching max_bytes (or, for a compressed body,
+     * the decoded limit), or the consumer refusing a piece, aborts the
+     * transfer with CURLE_WRITE_ERROR and sets truncated
+     * @param curl Easy handle to configure
+     * @param url URL to fetch (must outlive the transfer)
+     * @param target Body destination (must outlive the transfer)
+     */
+    void configure_handle(CURL* curl, const std::string& url, BodyTarget* target);
+
+    /**
+     * Check whether an HTTP status carries a usable body
+     * @param http_code Response status
+     * @return true for 2xx responses
+     */
+    static bool is_success(long http_code);
+
+    /**
+     * Check whether a conditional request found the page unchanged
+     * @param http_code Response status
+     * @return true for 304 Not Modified
+     */
+    static bool is_not_modified(long http_code);
+
+    /**
+     * Request headers for a conditional GET
+     * @param etag Sent as If-None-Match (skipped if empty)
+     * @param last_modified Sent as If-Modified-Since (skipped if empty)
+     * @return List for CURLOPT_HTTPHEADER, nullptr if both are empty;
+     *         free it with curl_slist_free_all after the transfer
+     */
+    static curl_slist* conditional_headers(std::string_view etag, std::string_view last_modified);
+
+    /**
+     * Read the validators of a finished transfer's final response
+     * @param curl Easy handle of the transfer
+     * @param etag Set to the ETag header (empty if absent)
+     * @param last_modified Set to the Last-Modified header (empty if absent)
+     * Both stay empty with libcurl older than 7.83 (no header API)
+     */
+    static void response_validators(CURL* curl, std::string& etag, std::string& last_modified);
+
+    /**
+     * Get the process-wide share object (DNS cache + TLS session cache)
+     * curl keys both caches by host, so every host gets its own entries
+     * while all threads and I/O loops see the same cache
+     */
+    static CURLSH* shared_handle();
+
 private:
+    CURL* handle = nullptr;     // Reused by download() across calls
+    bool compression = true;
+    size_t max_decoded_bytes = 32 * 1024 * 1024;
+
+
     /**
      * libcurl write callback for capturing response
      */
     static size_t write_callback(void* contents, size_t size, 
                                   size_t nmemb, std::string* userp);
+
+    /**
+     * libcurl write callback for a BodyTarget
+     */
+    static size_t body_callback(char* contents, size_t size, size_t nmemb, BodyTarget* target);
 };
 
 #endif // DOWNLOADER_H
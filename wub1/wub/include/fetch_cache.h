@@ -0,0 +1,153 @@
+#ifndef FETCH_CACHE_H
+#define FETCH_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "parsed_url.h"
+#include "output_file.h"
+#include "varint.h"
+
+/**
+ * One page of the previous run, as found in the cache
+ * The views point into the cache file mapping and stay valid until the
+ * cache is destroyed
+ */
+struct CachedPage {
+    uint64_t content_hash = 0;      // Hash64::Stream digest of the body
+    std::string_view etag;          // Empty if the server sent none
+    std::string_view last_modified;
+    std::string_view links;         // Encoded link list (FetchCache::for_each_link)
+    uint32_t slot = 0;              // Record index in the file
+};
+
+/**
+ * Counters for the end-of-crawl summary
+ */
+struct FetchCacheStats {
+    size_t loaded = 0;      // Pages read from the previous run
+    size_t stored = 0;      // Pages written with new content or validators
+    size_t kept = 0;        // Pages revisited and found unchanged
+    size_t carried = 0;     // Pages not revisited, copied over by commit()
+};
+
+/**
+ * Persistent fetch cache for recurring crawls
+ * Keyed by the fingerprint of the normalized URL, it remembers per page
+ * the validators (ETag, Last-Modified), a hash of the body and every
+ * link extracted from it, so the next run can send a conditional
+ * request and, on a 304 or an unchanged body, replay the links instead
+ * of parsing the page again.
+ * The file is a header followed by length-prefixed records:
+ *   u64 URL fingerprint, u64 content hash, varint-prefixed ETag and
+ *   Last-Modified, varint link count, varint-prefixed link URLs
+ * open() maps the previous run's file read-only and indexes it (the last
+ * record of a URL wins); lookups never lock. Workers append this run's
+ * records to path.tmp, and commit() copies the pages that were not
+ * revisited before renaming it into place, so a crawl that stops early
+ * forgets nothing.
+ * I/O errors throw std::runtime_error
+ */
+class FetchCache {
+public:
+    FetchCache();
+    ~FetchCache();
+
+    FetchCache(const FetchCache&) = delete;
+    FetchCache& operator=(const FetchCache&) = delete;
+
+    /**
+     * Load the cache file (if it exists) and start the next one
+     * @param path Cache file; written to path.tmp until commit()
+     * @throws std::runtime_error if the file is not a fetch cache or path.tmp cannot be created
+     */
+    void open(const std::string& path);
+
+    /**
+     * True after open()
+     */
+    bool is_open() const { return out != nullptr; }
+
+    /**
+     * Look a page up in the previous run (thread-safe, lock-free)
+     * @param url_key Hash64 fingerprint of the page URL
+     * @param page Filled on a hit
+     * @return true if the page was cached
+     */
+    bool find(uint64_t url_key, CachedPage& page) const;
+
+    /**
+     * Visit the cached links of a page in document order
+     * @param visit Called with each link URL (a view into the cache file)
+     */
+    template <typename Visit>
+    static void for_each_link(const CachedPage& page, Visit&& visit) {
+        // Records are validated by open(), so decoding cannot run past the end
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(page.links.data());
+        const uint8_t* end = p + page.links.size();
+        uint64_t count = Varint::get(p, end);
+        for (uint64_t i = 0; i < count; i++) {
+            size_t length = static_cast<size_t>(Varint::get(p, end));
+            visit(std::string_view(reinterpret_cast<const char*>(p), length));
+            p += length;
+        }
+    }
+
+    /**
+     * Record a page fetched this run (worker, before its links are moved on)
+     * @param url_key Hash64 fingerprint of the page URL
+     * @param content_hash Hash64::Stream digest of the body
+     * @param links Every link of the page, as extracted
+     */
+    void store(uint64_t url_key, uint64_t content_hash, std::string_view etag,
+               std::string_view last_modified, const std::vector<ParsedUrl>& links);
+
+    /**
+     * Carry a revisited, unchanged page over to the next run as it was
+     */
+    void keep(const CachedPage& page);
+
+    /**
+     * Copy the pages not revisited, then replace the cache file
+     * @throws std::runtime_error on I/O errors
+     */
+    void commit();
+
+    FetchCacheStats stats() const;
+
+private:
+    struct Slot {
+        uint64_t url_key;
+        uint64_t offset;            // Record start (its length prefix) in the mapping
+        uint64_t bytes;             // Whole record, length prefix included
+    };
+
+    std::string path;
+    const uint8_t* base = nullptr;  // Previous run's file, mapped read-only
+    size_t size = 0;
+    std::vector<Slot> slots;
+    std::unordered_map<uint64_t, uint32_t> index;       // URL fingerprint -> slot
+    std::unique_ptr<std::atomic<bool>[]> revisited;     // Per slot: superseded this run
+
+    mutable std::mutex out_mutex;
+    std::unique_ptr<OutputFile> out;
+    FetchCacheStats counters;
+
+    /**
+     * Index the records of the mapped file
+     */
+    void load();
+
+    /**
+     * Mark the previous record of a URL as superseded
+     */
+    void supersede(uint64_t url_key);
+};
+
+#endif // FETCH_CACHE_H
@@ -0,0 +1,242 @@
+#ifndef FETCH_ENGINE_H
+#define FETCH_ENGINE_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <cstdint>
+#include "downloader.h"
+#include "dns_cache.h"
+
+/**
+ * What a transfer fetches; only pages go through the frontier and parsers
+ */
+enum class FetchKind : uint8_t {
+    Page,
+    Robots,     // A host's robots.txt
+    Sitemap     // A sitemap or sitemap index
+};
+
+/**
+ * URL handed from the frontier to an I/O thread
+ */
+struct FetchRequest {
+    std::string url;
+    FetchKind kind = FetchKind::Page;   // Passed through
+    uint32_t depth = 0;         // Link distance from the seed, passed through
+    std::string_view etag;      // Validators of the cached copy, for a conditional
+    std::string_view last_modified;     // request (must outlive the transfer)
+};
+
+/**
+ * Completed transfer handed from an I/O thread to the parser workers
+ */
+struct FetchResult {
+    std::string url;
+    std::string body;           // Empty when the body was streamed
+    std::unique_ptr<BodyConsumer> stream;   // Consumer made for this request, if any (also on failure)
+    size_t body_bytes = 0;      // Body bytes received (buffered or streamed)
+    long http_code = 0;
+    bool ok = false;            // Transfer succeeded with a 2xx status
+    bool not_modified = false;  // Conditional request answered 304 (no body)
+    bool truncated = false;     // Body cut short by the byte or consumer budget
+    int loop_id = 0;            // I/O loop that fetched it
+    FetchKind kind = FetchKind::Page;   // From the FetchRequest
+    uint32_t depth = 0;         // From the FetchRequest
+    uint64_t content_hash = 0;  // Hash64::Stream digest of the body (conditional mode, ok only)
+    std::string etag;           // Response validators (conditional mode, ok only)
+    std::string last_modified;
+};
+
+/**
+ * Connection reuse counters (for stats)
+ */
+struct FetchStats {
+    size_t connections_reused = 0;  // Transfers that opened no new connection
+    size_t connections_new = 0;
+    size_t http2_transfers = 0;
+    size_t handles_reused = 0;      // Transfers served by a pooled easy handle
+    size_t bodies_reused = 0;       // Buffered transfers given a recycled body buffer
+    size_t compressed_transfers = 0;    // Bodies that arrived with a Content-Encoding
+};
+
+/**
+ * Asynchronous download engine built on curl_multi_socket_action
+ * Each I/O thread owns one multi handle and one epoll instance and keeps
+ * many transfers in flight; completed bodies are passed to a sink
+ * Easy handles are pooled per loop and HTTP/2 streams are multiplexed
+ * onto existing connections
+ * With a stream factory set, 2xx bodies are not buffered: every piece is
+ * handed to the request's BodyConsumer on the I/O thread as it arrives,
+ * and the consumer travels to the sink in FetchResult::stream
+ */
+class FetchEngine {
+public:
+    /**
+     * Pulls the next URL to fetch for one I/O loop
+     * @return false when no URL is available right now
+     */
+    using Source = std::function<bool(int loop_id, FetchRequest& request)>;
+
+    /**
+     * Receives every finished transfer (successful or not)
+     */
+    using Sink = std::function<void(FetchResult&& result)>;
+
+    /**
+     * Creates the consumer for one request's body (on the I/O thread)
+     * @return nullptr to buffer this body instead
+     */
+    using StreamFactory = std::function<std::unique_ptr<BodyConsumer>(int loop_id,
+                                                                      const FetchRequest& request)>;
+
+    FetchEngine();
+    ~FetchEngine();
+
+    /**
+     * Start I/O threads
+     * @param io_threads Number of event-loop threads
+     * @param max_inflight Maximum concurrent transfers across all threads
+     * @param source Callback supplying URLs
+     * @param sink Callback consuming finished transfers
+     */
+    void start(int io_threads, int max_inflight, Source source, Sink sink);
+
+    /**
+     * Cap the body size of every transfer (call before start)
+     * A longer body is cut at the cap and the transfer aborted; it still
+     * counts as ok with truncated set
+     * @param max_bytes Byte limit, 0 = unlimited
+     */
+    void set_max_body_bytes(size_t max_bytes);
+
+    /**
+     * Offer compressed responses and cap what they decode to (call before start)
+     * See Downloader::set_compression; a body cut at the decoded limit
+     * counts as truncated like one cut at max_body_bytes
+     * @param enabled Send Accept-Encoding
+     * @param max_decoded_bytes Decoded size limit of a compressed body, 0 = unlimited
+     */
+    void set_compression(bool enabled, size_t max_decoded_bytes);
+
+    /**
+     * Stream bodies into consumers instead of buffering them (call before start)
+     */
+    void set_stream_factory(StreamFactory factory);
+
+    /**
+     * Send each request's validators as conditional headers and report
+     * the response's validators and body hash (call before start)
+     */
+    void set_conditional(bool enabled);
+
+    /**
+     * Hand each transfer the addresses its host already resolved to
+     * (CURLOPT_RESOLVE), so curl only resolves names the cache lacks
+     * (call before start)
+     * @param cache Shared DNS cache, or nullptr to let curl resolve everything
+     */
+    void set_dns_cache(DnsCache* cache);
+
+    /**
+     * Hand a consumed body buffer back to its loop for the next buffered
+     * transfer (its capacity is kept; oversized buffers are freed)
+     * @param loop_id Loop that fetched it (FetchResult::loop_id)
+     * @param body Buffer to recycle
+     */
+    void recycle_body(int loop_id, std::string&& body);
+
+    /**
+     * Wake idle I/O threads so they pull from the source again
+     * Call after new URLs become available
+     */
+    void notify();
+
+    /**
+     * Wake one I/O loop if it has room for more transfers
+     * @param loop_id Loop whose queue just received URLs
+     */
+    void notify(int loop_id);
+
+    /**
+     * Wake loops that are parked with nothing in flight so they can steal
+     */
+    void notify_idle();
+
+    /**
+     * Make a loop poll the source again after a delay even if nothing
+     * wakes it (for URLs held back by politeness limits)
+     * Safe to call from the source callback
+     * @param loop_id Loop to wake
+     * @param delay_ms Delay from now in milliseconds
+     */
+    void retry_after(int loop_id, int64_t delay_ms);
+
+    /**
+     * Get number of I/O loops
+     */
+    int loop_count() const;
+
+    /**
+     * Stop all I/O threads, aborting transfers still in flight
+     */
+    void stop();
+
+    /**
+     * Get number of transfers currently in flight (for stats)
+     */
+    size_t inflight() const;
+
+    /**
+     * Get connection reuse counters (for stats)
+     */
+    FetchStats stats() const;
+
+private:
+    struct IoLoop;
+
+    std::vector<std::unique_ptr<IoLoop>> loops;
+    std::vector<std::thread> threads;
+    std::atomic<bool> running{false};
+    std::atomic<size_t> inflight_{0};
+    std::atomic<size_t> connections_reused{0};
+    std::atomic<size_t> connections_new{0};
+    std::atomic<size_t> http2_transfers{0};
+    std::atomic<size_t> handles_reused{0};
+    std::atomic<size_t> bodies_reused{0};
+    std::atomic<size_t> compressed_transfers{0};
+    Source source;
+    Sink sink;
+    StreamFactory stream_factory;
+    size_t max_body_bytes = 0;
+    bool conditional = false;
+    DnsCache* dns_cache = nullptr;
+    Downloader downloader;
+
+    /**
+     * Event loop body for one I/O thread
+     */
+    void run_loop(IoLoop& loop);
+
+    /**
+     * Add transfers until the loop reaches its in-flight budget
+     */
+    void fill_loop(IoLoop& loop);
+
+    /**
+     * Collect finished transfers from the multi handle
+     */
+    void drain_completed(IoLoop& loop);
+
+    /**
+     * Feed curl's phase timings of a finished transfer to the metrics
+     * @param new_connection Lookup, connect and TLS only mean something then
+     */
+    static void record_timings(CURL* easy, bool new_connection);
+};
+
+#endif // FETCH_ENGINE_H
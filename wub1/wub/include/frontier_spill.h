@@ -0,0 +1,116 @@
+#ifndef FRONTIER_SPILL_H
+#define FRONTIER_SPILL_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+#include "host_scheduler.h"
+
+/**
+ * Frontier spill settings (for the whole frontier, divided across partitions)
+ */
+struct FrontierSpillOptions {
+    std::string dir;                // Segment files go here
+    size_t max_memory_urls = 0;     // Queued URLs kept in memory (0 = unlimited, no spill)
+};
+
+/**
+ * Overflow queue for one frontier partition, kept in append-only segment
+ * files
+ * URLs are buffered into blocks; each block is sorted and front-coded
+ * (shared prefix length, suffix, depth, priority), which packs same-host
+ * runs to a few bytes per URL. Blocks are appended to the current
+ * segment until it reaches its size limit. Refill maps the oldest
+ * sealed segment read-only and decodes it front to back, one block per
+ * call; consumed segments are unmapped and deleted.
+ * Blocks come back in write order; the URLs inside a block come back
+ * sorted. Not thread-safe: the owning partition serializes calls.
+ * I/O errors throw std::runtime_error
+ */
+class FrontierSpill {
+public:
+    /**
+     * @param dir Directory for segment files (must exist)
+     * @param partition_id Partition index (names the files)
+     */
+    FrontierSpill(std::string dir, size_t partition_id);
+    ~FrontierSpill();
+
+    FrontierSpill(const FrontierSpill&) = delete;
+    FrontierSpill& operator=(const FrontierSpill&) = delete;
+
+    /**
+     * Queue a URL; writes a block once enough are buffered
+     * @throws std::runtime_error if the block can't be written (the URL
+     *         stays buffered)
+     */
+    void push(FrontierEntry&& entry);
+
+    /**
+     * Read back the oldest block (or the unwritten buffer if nothing is on disk)
+     * @param out URLs are appended here
+     * @return Number of URLs appended (0 if the spill is empty)
+     * @throws std::runtime_error if the segment can't be mapped
+     */
+    size_t refill(std::vector<FrontierEntry>& out);
+
+    /**
+     * Number of URLs not yet read back
+     */
+    size_t size() const;
+
+    /**
+     * URLs waiting in memory for a full block (not on disk yet)
+     */
+    size_t buffered() const;
+
+    /**
+     * Bytes in segment files not yet deleted
+     */
+    size_t disk_bytes() const;
+
+    /**
+     * Total URLs and bytes written since construction (for stats)
+     */
+    uint64_t urls_written() const;
+    uint64_t bytes_written() const;
+
+private:
+    struct Segment {
+        std::string path;
+        int fd = -1;
+        size_t bytes = 0;
+        size_t urls = 0;
+        const uint8_t* map = nullptr;   // Set while being read
+        size_t offset = 0;              // Read cursor
+    };
+
+    std::string prefix;
+    std::vector<FrontierEntry> pending;     // Not yet encoded
+    std::vector<uint8_t> block;             // Encode buffer, reused
+    std::deque<Segment> segments;           // Oldest first; back() is being written
+    bool back_open = false;                 // segments.back() still takes appends
+    size_t next_segment = 0;
+    size_t queued = 0;
+    uint64_t total_urls = 0;
+    uint64_t total_bytes = 0;
+
+    /**
+     * Encode the pending URLs as one block and append it
+     */
+    void flush_block();
+
+    /**
+     * Stop appending to the current segment so it can be read
+     */
+    void seal();
+
+    /**
+     * Unmap, close and delete a segment
+     */
+    static void discard(Segment& segment);
+};
+
+#endif // FRONTIER_SPILL_H
@@ -0,0 +1,130 @@
+#ifndef GRAPH_FILE_H
+#define GRAPH_FILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "csr_graph.h"
+#include "domain_table.h"
+
+/**
+ * Sections of a graph file, in file order
+ */
+enum class GraphSection : uint32_t {
+    NameOffsets,    // uint64[num_nodes + 1]: byte range of each name in Names
+    Names,          // char[]: domain names back to back, no separators
+    Offsets,        // uint64[num_nodes + 1]: CSR row offsets
+    Targets,        // uint32[num_edges]: CSR column indices
+    Weights,        // uint32[num_edges]: links behind each edge (empty: all 1)
+    VisitCounts,    // int32[num_nodes]: pages crawled per domain (0: destination-only)
+    Ranks,          // float64[num_nodes]: PageRank (empty if not computed)
+    Count
+};
+
+const size_t GRAPH_SECTION_COUNT = static_cast<size_t>(GraphSection::Count);
+
+/**
+ * Byte range of one section in the file
+ */
+struct GraphFileSection {
+    uint64_t offset;            // From the start of the file; a multiple of GRAPH_FILE_ALIGNMENT
+    uint64_t bytes;
+};
+
+/**
+ * Fixed header at offset 0 (little-endian, as written by x86-64 and ARM)
+ */
+struct GraphFileHeader {
+    char magic[8];              // "WUBGRAPH"
+    uint32_t version;           // GRAPH_FILE_VERSION
+    uint32_t section_count;     // GRAPH_SECTION_COUNT
+    uint64_t num_nodes;
+    uint64_t num_edges;
+    GraphFileSection sections[GRAPH_SECTION_COUNT];
+};
+
+const uint32_t GRAPH_FILE_VERSION = 1;
+const size_t GRAPH_FILE_ALIGNMENT = 64;
+
+/**
+ * Columns of a merged crawl graph to export
+ */
+struct GraphColumns {
+    const DomainTable* domains = nullptr;
+    const CsrGraph* graph = nullptr;
+    const std::vector<int>* visit_counts = nullptr;
+    const std::vector<double>* ranks = nullptr;     // May be empty
+};
+
+/**
+ * Binary columnar graph export
+ * The header is followed by the sections, each starting on a 64-byte
+ * boundary, so a reader maps the file and uses every column in place
+ * (e.g. numpy.memmap at the section offset). Columns already held in
+ * memory are written with writev() straight from their vectors
+ */
+namespace GraphFile {
+
+/**
+ * Write a graph file (via a temporary file renamed into place)
+ * @throws std::runtime_error on I/O errors
+ */
+void write(const std::string& path, const GraphColumns& columns);
+
+}  // namespace GraphFile
+
+/**
+ * Read-only mapping of a graph file; accessors point into the mapping
+ */
+class GraphFileView {
+public:
+    GraphFileView() = default;
+    ~GraphFileView();
+
+    GraphFileView(const GraphFileView&) = delete;
+    GraphFileView& operator=(const GraphFileView&) = delete;
+
+    /**
+     * Map a file and check its header and section bounds
+     * @throws std::runtime_error if it cannot be read or is not a valid graph file
+     */
+    void open(const std::string& path);
+
+    uint64_t num_nodes() const { return header->num_nodes; }
+    uint64_t num_edges() const { return header->num_edges; }
+
+    /**
+     * Name of node v
+     */
+    std::string_view name(uint64_t v) const;
+
+    const uint64_t* offsets() const { return section<uint64_t>(GraphSection::Offsets); }
+    const uint32_t* targets() const { return section<uint32_t>(GraphSection::Targets); }
+
+    /**
+     * Per-edge link counts, or nullptr if every edge weighs 1
+     */
+    const uint32_t* weights() const { return section<uint32_t>(GraphSection::Weights); }
+
+    const int32_t* visit_counts() const { return section<int32_t>(GraphSection::VisitCounts); }
+
+    /**
+     * PageRank per node, or nullptr if the file has none
+     */
+    const double* ranks() const { return section<double>(GraphSection::Ranks); }
+
+private:
+    const char* base = nullptr;
+    size_t size = 0;
+    const GraphFileHeader* header = nullptr;
+
+    template <typename T>
+    const T* section(GraphSection which) const {
+        const GraphFileSection& s = header->sections[static_cast<size_t>(which)];
+        return s.bytes ? reinterpret_cast<const T*>(base + s.offset) : nullptr;
+    }
+};
+
+#endif // GRAPH_FILE_H
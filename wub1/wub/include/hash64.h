@@ -0,0 +1,57 @@
+#ifndef HASH64_H
+#define HASH64_H
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Fast 64-bit string hash (wyhash final version 4 construction)
+ * Used for URL fingerprints: at 64 bits, a crawl of a billion URLs has a
+ * collision probability around 3%, so a fingerprint set is exact in practice
+ */
+namespace Hash64 {
+
+/**
+ * Hash a byte string
+ * @param data Bytes to hash
+ * @param seed Optional seed for independent hash families
+ */
+uint64_t hash(std::string_view data, uint64_t seed = 0);
+
+/**
+ * Cheap 64-bit mixer (for deriving more hash values from one)
+ */
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * Hash of a byte stream that arrives in pieces (response bodies)
+ * Bytes are hashed in fixed 4 KiB blocks chained through the seed, so
+ * the digest depends only on the bytes, never on how they were split.
+ * It is not equal to hash() of the same bytes
+ */
+class Stream {
+public:
+    void update(std::string_view piece);
+    uint64_t digest() const;
+    void reset();
+
+private:
+    static constexpr size_t BLOCK_BYTES = 4096;
+
+    uint64_t state = 0;
+    uint64_t length = 0;
+    size_t pending = 0;             // Bytes of the current block in block[]
+    char block[BLOCK_BYTES];
+};
+
+}  // namespace Hash64
+
+#endif // HASH64_H
@@ -0,0 +1,211 @@
+#ifndef HOST_SCHEDULER_H
+#define HOST_SCHEDULER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+class RobotsRules;
+
+/**
+ * Per-host politeness limits
+ */
+struct HostPolicy {
+    int max_connections = 4;        // Transfers in flight per host
+    int crawl_delay_ms = 0;         // Minimum gap between fetch starts on one host
+    int max_backoff_ms = 60000;     // Cap for the 429/503 back-off
+    bool wait_for_robots = false;   // Hold a new host's URLs until set_robots()
+    int max_crawl_delay_ms = 30000; // Cap for a robots.txt Crawl-delay
+};
+
+/**
+ * One queued URL
+ */
+struct FrontierEntry {
+    std::string url;
+    float priority = 0.0f;          // Higher is fetched first
+    uint32_t depth = 0;             // Link distance from the seed
+};
+
+/**
+ * In-flight transfers on one host (for stats)
+ */
+struct HostLoad {
+    std::string host;
+    int inflight = 0;
+};
+
+/**
+ * Mercator-style two-level queue for one frontier partition
+ * Every host has its own back queue ordered by priority (FIFO among
+ * equal priorities). Hosts that may fetch now sit in a ready heap keyed
+ * on their best URL; hosts held back by crawl delay or back-off sit in a
+ * heap keyed on their next-allowed time and move over when it passes.
+ * A host at its connection limit is in neither heap until release(), so
+ * pop() only ever returns URLs that can be fetched immediately.
+ * A host can carry robots.txt rules: URLs they disallow are refused at
+ * push(), and their Crawl-delay replaces the policy's when it is longer.
+ * While a host waits for its rules it is gated: URLs queue but the host
+ * is in neither heap.
+ * Not thread-safe: the owning frontier partition calls it under its lock
+ */
+class HostScheduler {
+public:
+    /**
+     * Set the limits applied to every host
+     */
+    void set_policy(const HostPolicy& policy);
+
+    /**
+     * Queue a URL on its host
+     * @param host Host key (see host_key())
+     * @param entry URL with its priority
+     * @param now_ms Steady-clock time in milliseconds
+     * @return false if the host's robots.txt disallows the URL (not queued)
+     */
+    bool push(std::string_view host, FrontierEntry&& entry, int64_t now_ms);
+
+    /**
+     * Attach a host's robots.txt rules and open its gate
+     * URLs already queued that the rules disallow are dropped
+     * @param host Host key (created if not seen yet)
+     * @param rules Compiled rules
+     * @param now_ms Steady-clock time in milliseconds
+     * @return Number of queued URLs dropped
+     */
+    size_t set_robots(std::string_view host, std::shared_ptr<const RobotsRules> rules,
+                      int64_t now_ms);
+
+    /**
+     * Whether a host has been queued here before
+     * @param host Host key (see host_key())
+     */
+    bool has_host(std::string_view host) const;
+
+    /**
+     * Take the best URL from a host that may fetch now
+     * Counts the URL as in flight on its host until release()
+     * @param now_ms Steady-clock time in milliseconds
+     * @param entry Output parameter for the URL
+     * @param next_ready_ms Set to when a waiting host becomes ready (-1 if none)
+     * @return false if no host is ready
+     */
+    bool pop(int64_t now_ms, FrontierEntry& entry, int64_t& next_ready_ms);
+
+    /**
+     * Record that a fetch from a host finished
+     * 429 and 503 responses double the host's back-off, other responses reset it
+     * @param host Host key of the fetched URL
+     * @param http_code Response status (0 if the transfer failed)
+     * @param now_ms Steady-clock time in milliseconds
+     * @return true if the host can fetch again right away
+     */
+    bool release(std::string_view host, long http_code, int64_t now_ms);
+
+    /**
+     * Number of queued URLs
+     */
+    size_t size() const;
+
+    /**
+     * Number of hosts seen
+     */
+    size_t host_count() const;
+
+    /**
+     * Number of 429/503 back-offs applied (for stats)
+     */
+    uint64_t backoff_count() const;
+
+    /**
+     * Append every host with a transfer in flight (for stats)
+     * Costs one entry per busy host, however many hosts were seen
+     */
+    void busy_hosts(std::vector<HostLoad>& out) const;
+
+    /**
+     * Host key of a normalized URL: its authority (host[:port])
+     */
+    static std::string_view host_key(std::string_view url);
+
+    /**
+     * Path and query of a normalized URL: everything after its host key
+     */
+    static std::string_view path_of(std::string_view url);
+
+private:
+    struct Item {
+        FrontierEntry entry;
+        uint64_t sequence = 0;      // Arrival order, breaks priority ties
+    };
+
+    struct HostQueue {
+        std::string name;
+        std::vector<Item> urls;     // Binary heap, best first
+        int inflight = 0;
+        uint32_t busy_slot = 0;     // Index in busy while inflight > 0
+        int64_t next_allowed_ms = 0;
+        int backoff_ms = 0;
+        int crawl_delay_ms = 0;     // Policy delay, or the robots.txt one if longer
+        std::shared_ptr<const RobotsRules> robots;     // Null until known (or not fetched)
+        uint32_t version = 0;       // Invalidates older heap entries
+        bool scheduled = false;     // In the ready or waiting heap
+        bool ready = false;         // In the ready heap
+        bool gated = false;         // Waiting for robots.txt: never scheduled
+    };
+
+    struct ReadyEntry {
+        float priority;
+        uint64_t sequence;
+        uint32_t host;
+        uint32_t version;
+    };
+
+    struct WaitingEntry {
+        int64_t time_ms;
+        uint32_t host;
+        uint32_t version;
+    };
+
+    HostPolicy policy;
+    std::unordered_map<std::string_view, uint32_t> host_ids;   // Views into HostQueue::name
+    std::deque<HostQueue> hosts;                               // Deque keeps names in place
+    std::vector<ReadyEntry> ready_heap;
+    std::vector<WaitingEntry> waiting_heap;
+    std::vector<uint32_t> busy;                                // Hosts with inflight > 0
+    size_t queued = 0;
+    uint64_t next_sequence = 0;
+    uint64_t backoffs = 0;
+
+    // Heap orderings: best URL / host on top, earliest time on top
+    static bool item_less(const Item& a, const Item& b);
+    static bool ready_less(const ReadyEntry& a, const ReadyEntry& b);
+    static bool waiting_less(const WaitingEntry& a, const WaitingEntry& b);
+
+    /**
+     * Find a host, creating its queue on first sight
+     */
+    uint32_t host_id(std::string_view host);
+
+    /**
+     * Add a host to the ready heap under its current version
+     */
+    void push_ready(uint32_t id);
+
+    /**
+     * Put a host with queued URLs and a free connection into a heap
+     */
+    void schedule(uint32_t id, int64_t now_ms);
+
+    /**
+     * Move hosts whose next-allowed time has passed into the ready heap
+     */
+    void promote(int64_t now_ms);
+};
+
+#endif // HOST_SCHEDULER_H
@@ -0,0 +1,172 @@
+#ifndef INCREMENTAL_PAGERANK_H
+#define INCREMENTAL_PAGERANK_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <queue>
+#include <utility>
+#include <cstdint>
+#include "csr_graph.h"
+
+/**
+ * Live PageRank estimates maintained while the crawl runs
+ * Push-based residual propagation: every node keeps an estimate p and a
+ * residual r with the invariant
+ *     p(v) + r(v) = (1 - d) + d * sum over u->v of w(u,v) * p(u) / outdeg(u)
+ * where w(u,v) counts u's links to v and outdeg(u) all of u's links.
+ * Pushing u moves r(u) into p(u) and spreads d * r(u) * w(u,v) / outdeg(u)
+ * onto its targets. Changing u's out-links only adjusts the residuals of the
+ * old and new targets, so the estimates are never recomputed from scratch.
+ * Nodes are pushed largest residual first (Gauss-Southwell; priorities
+ * as of when a node was queued) until every |r(u)| is below the threshold.
+ * Dangling nodes keep their mass instead of spreading it uniformly, so
+ * estimates approximate the batch ranks; they make a good warm start
+ * for PageRank::compute.
+ * Producers only append to a pending list; a background thread applies
+ * batches and publishes an immutable snapshot that readers load without
+ * touching the propagation state
+ */
+class IncrementalPageRank {
+public:
+    /**
+     * Published estimates (unnormalized; divide by total)
+     */
+    struct Snapshot {
+        std::vector<double> scores;
+        double total = 0.0;
+        uint64_t pushes = 0;
+        uint64_t batches = 0;
+    };
+
+    IncrementalPageRank() = default;
+    ~IncrementalPageRank();
+
+    IncrementalPageRank(const IncrementalPageRank&) = delete;
+    IncrementalPageRank& operator=(const IncrementalPageRank&) = delete;
+
+    /**
+     * Start the propagation thread
+     * @param damping Damping factor (same as the batch computation)
+     * @param threshold Push a node once |r(u)| exceeds threshold * max(1, outdeg(u))
+     */
+    void start(double damping = 0.85, double threshold = 1e-4);
+
+    /**
+     * Apply all pending batches, propagate to the threshold, publish a
+     * final snapshot and join the thread
+     */
+    void stop();
+
+    /**
+     * True between start() and stop()
+     */
+    bool running() const { return active.load(std::memory_order_acquire); }
+
+    /**
+     * Replace a node's out-links (thread-safe, applied asynchronously)
+     * @param source Node ID (dense, e.g. from DomainTable)
+     * @param targets New out-link targets with their link counts
+     */
+    void update_out_edges(uint32_t source, std::vector<WeightedEdge> targets);
+
+    /**
+     * Add to a node's out-links (thread-safe, applied asynchronously)
+     * Counts of a target it already links to add up
+     * @param source Node ID
+     * @param targets Additional out-link targets with their link counts,
+     *                ordered by target like the links they join
+     */
+    void add_out_edges(uint32_t source, std::vector<WeightedEdge> targets);
+
+    /**
+     * Latest published snapshot (never null after start())
+     */
+    std::shared_ptr<const Snapshot> snapshot() const;
+
+    /**
+     * Normalized estimate for one node from the latest snapshot
+     */
+    double rank(uint32_t id) const;
+
+    /**
+     * Normalized estimates for nodes 0 .. num_nodes-1 (zero if unseen)
+     */
+    std::vector<double> estimates(size_t num_nodes) const;
+
+    /**
+     * Highest-ranked nodes from the latest snapshot
+     * @param k Number of entries
+     * @return (node ID, normalized score), best first
+     */
+    std::vector<std::pair<uint32_t, double>> top(size_t k) const;
+
+private:
+    struct Batch {
+        uint32_t source;
+        std::vector<WeightedEdge> targets;
+        bool add = false;               // Merge into the current links instead of replacing them
+    };
+
+    // Producer side
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    std::vector<Batch> pending;
+    bool stopping = false;
+    std::atomic<bool> active{false};
+
+    // Owned by the propagation thread
+    double damping = 0.85;
+    double threshold = 1e-4;
+    std::vector<std::vector<WeightedEdge>> out_edges;
+    std::vector<uint64_t> out_weight;   // Links out of each node
+    std::vector<double> estimate;
+    std::vector<double> residual;
+    std::vector<uint8_t> queued;
+    std::priority_queue<std::pair<double, uint32_t>> work;
+    uint64_t pushes = 0;
+    uint64_t batches = 0;
+
+    std::shared_ptr<const Snapshot> published;
+    std::thread worker;
+
+    /**
+     * Propagation thread main loop
+     */
+    void run();
+
+    /**
+     * Replace (or add to) one node's out-links and repair the invariant
+     */
+    void apply(Batch& batch);
+
+    /**
+     * Grow state to cover id; new nodes start with residual (1 - d)
+     */
+    void ensure_node(uint32_t id);
+
+    /**
+     * Add to a residual and queue the node if it crossed the threshold
+     */
+    void add_residual(uint32_t id, double delta);
+
+    /**
+     * Push threshold of a node
+     */
+    double limit(uint32_t id) const;
+
+    /**
+     * Move r(u) into p(u) and spread it over u's out-links
+     */
+    void push(uint32_t u);
+
+    /**
+     * Copy the estimates into a new snapshot
+     */
+    void publish();
+};
+
+#endif // INCREMENTAL_PAGERANK_H
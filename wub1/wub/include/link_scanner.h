@@ -0,0 +1,170 @@
+#ifndef LINK_SCANNER_H
+#define LINK_SCANNER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/**
+ * Which attribute a link came from
+ */
+enum class LinkAttr {
+    Href,
+    Src
+};
+
+/**
+ * One link-bearing attribute found in the document
+ * Views point into the scanned buffer (no copies, no entity decoding)
+ */
+struct LinkToken {
+    std::string_view url;       // Attribute value with quotes and outer whitespace stripped
+    std::string_view tag;       // Tag name as written (e.g. "a", "IFRAME", "base")
+    LinkAttr attr = LinkAttr::Href;
+};
+
+/**
+ * Receives the document text the scanner skips over (text between tags;
+ * not comments, markup or script/style contents)
+ */
+class TextSink {
+public:
+    virtual ~TextSink() = default;
+
+    /**
+     * Next run of text; a run may stop inside a word when a streamed
+     * piece ends, and the word goes on in the next run
+     */
+    virtual void text(std::string_view run) = 0;
+
+    /**
+     * A tag starts here: the text before it has ended
+     * May be reported more than once for the same tag in a streamed body
+     */
+    virtual void boundary() = 0;
+};
+
+/**
+ * Scanner position carried across the chunks of a streamed document
+ */
+struct LinkScanState {
+    enum class Mode {
+        Text,       // Between tags
+        Tag,        // Inside a start tag's attribute list
+        Comment,    // Inside <!-- -->
+        Markup,     // Inside <!...>, <?...> or an end tag
+        RawText     // Inside <script> or <style> text
+    };
+    Mode mode = Mode::Text;
+    std::string name;           // Open tag (Tag) or raw-text element (RawText)
+};
+
+/**
+ * Single-pass HTML tokenizer for href/src attributes
+ * Walks the buffer once without allocating. Understands double, single
+ * and unquoted attribute values, skips comments, doctype/processing
+ * instructions, end tags and the raw text of <script> and <style> blocks
+ * (their own src attribute is still reported)
+ * Text between tags, attribute names and quoted values are skipped with
+ * the vectorized searches in simd_scan.h; only '=' and '>' positions
+ * inside a tag are looked at by scalar code
+ */
+class LinkScanner {
+public:
+    /**
+     * @param html Document to scan; must outlive the scanner and its tokens
+     */
+    explicit LinkScanner(std::string_view html);
+
+    /**
+     * Scan one piece of a streamed document
+     * Constructs cut off by the end of the buffer are not reported: next()
+     * stops in front of them, records the mode in state and consumed()
+     * tells where the next buffer must begin. Comments and raw text are
+     * skipped without being carried over
+     * @param html Unconsumed tail of the previous buffer followed by new bytes
+     * @param state Carried state; read here, updated when next() returns false
+     * @param last Final buffer: scan to the end like a complete document
+     */
+    LinkScanner(std::string_view html, LinkScanState& state, bool last = false);
+
+    /**
+     * Advance to the next href/src attribute
+     * @param token Output token
+     * @return false once the end of the document is reached
+     */
+    bool next(LinkToken& token);
+
+    /**
+     * Also hand the text between tags to sink (call before next())
+     */
+    void set_text_sink(TextSink* sink) { text_sink = sink; }
+
+    /**
+     * Case-insensitive ASCII comparison of a tag or attribute name
+     * @param name Name as written in the document
+     * @param lower Lowercase reference
+     */
+    static bool name_equals(std::string_view name, std::string_view lower);
+
+    /**
+     * Bytes fully scanned; the rest of a streamed buffer must be fed again
+     * (the whole buffer for a complete document)
+     */
+    size_t consumed() const;
+
+private:
+    std::string_view html;
+    size_t pos = 0;
+    bool in_tag = false;        // Positioned inside a start tag's attribute list
+    std::string_view tag;       // Current start tag name
+    LinkScanState* stream = nullptr;    // Set when scanning a streamed piece
+    bool partial = false;       // More bytes follow: stop at unfinished constructs
+    LinkScanState::Mode resume_mode = LinkScanState::Mode::Text;
+    bool stalled = false;       // Streamed piece ended inside a construct
+    size_t keep_from;           // Start of the unconsumed tail
+    TextSink* text_sink = nullptr;
+
+    /**
+     * Stop a streamed scan in front of an unfinished construct
+     * @param from First byte the next piece must include
+     * @param mode Mode to resume in
+     * @param name Tag or raw-text element name to carry
+     */
+    void stall(size_t from, LinkScanState::Mode mode, std::string_view name = std::string_view());
+
+    /**
+     * Parse attributes of the current start tag until a link is found
+     * @return true if token was filled
+     */
+    bool scan_attributes(LinkToken& token);
+
+    /**
+     * Finish a start tag: skip raw text of script/style elements
+     */
+    void end_start_tag();
+
+    /**
+     * Handle markup at '<' that is not a start tag
+     * @return true if consumed, false if a start tag begins here
+     */
+    bool skip_non_start_tag();
+
+    /**
+     * Index of the first c at or after from (html.size() if none)
+     */
+    size_t find_byte(size_t from, char c) const;
+
+    /**
+     * Move pos past the first occurrence of needle (or to the end)
+     * @param mode Mode to resume in if a streamed piece ends first
+     */
+    void skip_past(std::string_view needle, LinkScanState::Mode mode);
+
+    /**
+     * Move pos to the closing tag of a raw-text element
+     */
+    void skip_raw_text(std::string_view closing_name);
+};
+
+#endif // LINK_SCANNER_H
@@ -0,0 +1,120 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/**
+ * Severity of a log record; a record is kept if it is at or above the
+ * configured level
+ */
+enum class LogLevel : uint8_t {
+    Error,
+    Warning,
+    Info,
+    Debug       // Per-URL events
+};
+
+/**
+ * What a record describes; fixes the meaning of its fields
+ */
+enum class LogEvent : uint8_t {
+    Message,        // text = free text
+    PageFetched,    // a = body bytes, b = 1 if truncated, text = domain
+    FetchFailed,    // text = URL
+    UrlRejected,    // text = URL that does not parse
+    LinksFound,     // a = links, b = distinct target domains
+    UrlsEnqueued,   // a = URLs admitted to the frontier
+    NearDuplicate,  // a = links not enqueued
+    WorkerStopped   // a = pages the worker processed
+};
+
+struct LogOptions {
+    LogLevel level = LogLevel::Info;    // Quiet: no per-URL events
+    uint32_t sample = 1;                // Keep per-URL events of 1 in sample pages
+    std::string path;                   // Output file (empty = stdout)
+};
+
+/**
+ * Totals since Log::start()
+ */
+struct LogCounters {
+    uint64_t written = 0;       // Lines written out
+    uint64_t dropped = 0;       // Records lost to a full ring
+    uint64_t sampled_out = 0;   // Per-URL records skipped by sampling
+};
+
+/**
+ * Asynchronous process-wide logger
+ * Each thread appends fixed-size binary records to its own single-producer
+ * ring: no lock, no formatting and no syscall on the logging thread. One
+ * background writer drains every ring, orders the records by time and
+ * writes them as compact key=value lines with one write() per drain.
+ * A full ring drops the record (counted) instead of blocking its thread.
+ * Per-URL events carry the URL fingerprint; sampling keeps or skips all
+ * events of a page together
+ */
+namespace Log {
+
+/**
+ * Start the writer thread
+ * @throws std::runtime_error if the output file cannot be opened
+ */
+void start(const LogOptions& options);
+
+/**
+ * Write out everything still queued and join the writer
+ */
+void stop();
+
+/**
+ * Write out everything queued so far (call before printing to stdout
+ * directly, so the lines stay in order)
+ */
+void flush();
+
+/**
+ * Name this thread's records carry (e.g. "T3"); unnamed threads are
+ * numbered in order of their first record
+ */
+void set_thread_name(std::string_view name);
+
+/**
+ * True if records at this level are kept
+ */
+bool enabled(LogLevel level);
+
+/**
+ * Queue one record (a no-op unless started and enabled)
+ * @param key URL fingerprint for per-URL events (subject to sampling), 0 otherwise
+ * @param a, b Numeric fields, see LogEvent
+ * @param text Text field (cut to the record's capacity)
+ */
+void event(LogLevel level, LogEvent what, uint64_t key, uint64_t a = 0, uint64_t b = 0,
+           std::string_view text = std::string_view());
+
+/**
+ * Queue a free-text record
+ */
+void message(LogLevel level, std::string_view text);
+
+/**
+ * Totals so far
+ */
+LogCounters counters();
+
+/**
+ * Parse a level name: error, warning, info or debug
+ * @return false if the name is unknown
+ */
+bool parse_level(const std::string& name, LogLevel& level);
+
+/**
+ * Name of a level as parse_level() accepts it
+ */
+const char* level_name(LogLevel level);
+
+}  // namespace Log
+
+#endif // LOGGER_H
@@ -0,0 +1,201 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/**
+ * Distributions recorded on the hot path (times are in nanoseconds)
+ */
+enum class Metric : uint8_t {
+    DnsTime,            // Name lookup (new connections only)
+    ConnectTime,        // TCP connect after the lookup (new connections only)
+    TlsTime,            // TLS handshake after connect (new https connections only)
+    FirstByteTime,      // Request sent to first response byte
+    TransferTime,       // First byte to last byte
+    ParseTime,          // Link extraction for one page (all of its pieces)
+    FrontierLockWait,   // Time blocked on a contended frontier shard or partition lock
+    EnqueueBatch,       // URLs per batch_enqueue call (a count, not a time)
+    IoIdle,             // An I/O loop waiting with nothing in flight (no ready host or backoff)
+    WorkerIdle,         // A parser worker waiting for a downloaded page
+    StoreQueueWait,     // A parser worker blocked on a full store queue
+    StoreIdle,          // A store worker waiting for a parsed page
+    Count
+};
+
+/**
+ * Monotonic event counters
+ */
+enum class Counter : uint8_t {
+    Transfers,          // Finished transfers
+    FetchErrors,        // Transfers that failed or got a non-2xx status (304 aside)
+    BodyBytes,          // Body bytes received (decoded)
+    LinksFound,         // Links extracted
+    UrlsAdmitted,       // URLs new to the frontier
+    PagesReplayed,      // Unchanged pages whose links came from the fetch cache
+    NearDuplicates,     // Pages whose links were dropped as near-duplicates
+    ParseQueueFull,     // Transfers not started because the parse queue was full
+    WireBytes,          // The same bodies as sent, before decompression
+    DecodeLimited,      // Compressed bodies cut at the decoded size limit
+    RobotsDisallowed,   // Admitted URLs dropped because robots.txt disallows them
+    SitemapUrls,        // Page URLs read from sitemaps
+    Count
+};
+
+const size_t METRIC_COUNT = static_cast<size_t>(Metric::Count);
+const size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+
+// Response statuses are counted per code: 0 (transfer failed) to 599
+const size_t STATUS_CODES = 600;
+
+class PrometheusText;
+
+/**
+ * HDR-style log-linear histogram
+ * Values below 16 have their own buckets; above that every power of two
+ * is split into 16 equal sub-buckets, so a reported value is within
+ * 1/16 (about 6%) of the true one. Values past 2^40 (18 minutes in ns)
+ * land in the last bucket
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - SUB_BITS) * SUB_BUCKETS;
+
+    /**
+     * Bucket index of a value
+     */
+    static size_t bucket_of(uint64_t value);
+
+    /**
+     * Smallest value that falls into a bucket
+     */
+    static uint64_t bucket_low(size_t bucket);
+
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;         // Number of values
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    /**
+     * Value at or below which a fraction q of the samples lie
+     * (midpoint of its bucket, capped at max; 0 when empty)
+     */
+    uint64_t percentile(double q) const;
+
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+};
+
+/**
+ * Sum of every thread's metrics at one moment
+ */
+struct MetricsSnapshot {
+    LatencyHistogram histograms[METRIC_COUNT];
+    uint64_t counters[COUNTER_COUNT] = {};
+    uint64_t statuses[STATUS_CODES] = {};       // Finished transfers by response status
+
+    const LatencyHistogram& operator[](Metric metric) const {
+        return histograms[static_cast<size_t>(metric)];
+    }
+    uint64_t operator[](Counter counter) const {
+        return counters[static_cast<size_t>(counter)];
+    }
+
+    /**
+     * What was recorded after earlier was taken
+     * (max is kept from this snapshot: it cannot be subtracted)
+     */
+    MetricsSnapshot since(const MetricsSnapshot& earlier) const;
+};
+
+/**
+ * Lock-free per-thread hot-path instrumentation
+ * Each thread records into its own cache-line-aligned slot (one per
+ * thread, modulo the slot count, like AllocStats) with relaxed atomic
+ * adds; snapshot() sums the slots without stopping anyone
+ */
+namespace Metrics {
+
+/**
+ * Add one value to a distribution
+ */
+void record(Metric metric, uint64_t value);
+
+/**
+ * Add to a counter
+ */
+void add(Counter counter, uint64_t amount = 1);
+
+/**
+ * Count a finished transfer under its response status
+ * @param http_code Status, 0 if the transfer failed (codes past 599 count as 599)
+ */
+void count_status(long http_code);
+
+/**
+ * Sum of one counter over all slots (cheaper than a full snapshot)
+ */
+uint64_t total(Counter counter);
+
+/**
+ * Sum of all slots right now (relaxed; good enough for reporting)
+ */
+MetricsSnapshot snapshot();
+
+/**
+ * Short name of a metric or counter (e.g. "dns", "parse")
+ */
+const char* name(Metric metric);
+const char* name(Counter counter);
+
+/**
+ * True if the metric holds nanoseconds (false for counts)
+ */
+bool is_time(Metric metric);
+
+/**
+ * One line per non-empty metric: count, p50, p90, p99, max and mean,
+ * then the counters
+ * @param tag Line prefix (e.g. "[METRICS]")
+ */
+void print(std::ostream& out, const MetricsSnapshot& snapshot, const char* tag);
+
+/**
+ * Write a snapshot as CSV (metric,count,p50,p90,p99,p999,max,mean; times in us)
+ * @throws std::runtime_error if the file cannot be written
+ */
+void write_csv(const std::string& path, const MetricsSnapshot& snapshot);
+
+/**
+ * Add a snapshot in Prometheus form: stage times as summaries in seconds
+ * (quantiles over the whole crawl), the counters and responses by status
+ */
+void write_prometheus(PrometheusText& out, const MetricsSnapshot& snapshot);
+
+/**
+ * Records the time from construction to destruction
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Metric timed) : metric(timed), started(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        record(metric, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Metric metric;
+    std::chrono::steady_clock::time_point started;
+};
+
+}  // namespace Metrics
+
+#endif // METRICS_H
@@ -0,0 +1,109 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+/**
+ * Builds a page in the Prometheus text exposition format (0.0.4)
+ */
+class PrometheusText {
+public:
+    /**
+     * Start a metric family: its HELP and TYPE lines
+     * @param type "counter", "gauge" or "summary"
+     */
+    void family(std::string_view name, const char* type, std::string_view help);
+
+    /**
+     * One sample without labels
+     */
+    void sample(std::string_view name, double value);
+
+    /**
+     * One sample with a single label (the value is escaped)
+     */
+    void sample(std::string_view name, std::string_view label, std::string_view label_value,
+                double value);
+
+    /**
+     * One sample with two labels
+     */
+    void sample(std::string_view name, std::string_view label, std::string_view label_value,
+                std::string_view label2, std::string_view label2_value, double value);
+
+    const std::string& str() const { return text; }
+
+private:
+    std::string text;
+
+    void label_pair(std::string_view label, std::string_view value);
+    void value_line(double value);
+};
+
+/**
+ * Minimal HTTP endpoint for Prometheus scrapes
+ * One background thread accepts a connection at a time and answers
+ * GET /metrics with the page the render callback builds at that moment;
+ * the crawl's threads are never involved in a scrape
+ */
+class MetricsServer {
+public:
+    /**
+     * Fills the page for one scrape (called on the server thread)
+     */
+    using Render = std::function<void(PrometheusText& out)>;
+
+    MetricsServer() = default;
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * Bind and listen (call before start, so a busy port fails early)
+     * @param address IPv4 address to bind (e.g. "127.0.0.1" or "0.0.0.0")
+     * @param port TCP port
+     * @throws std::runtime_error if the address is invalid or the port cannot be bound
+     */
+    void listen(const std::string& address, int port);
+
+    /**
+     * Serve scrapes on a background thread until stop()
+     */
+    void start(Render render);
+
+    /**
+     * Stop serving and close the socket
+     */
+    void stop();
+
+    /**
+     * Number of scrapes answered (for stats)
+     */
+    uint64_t scrapes() const;
+
+private:
+    int listen_fd = -1;
+    int wake_fd = -1;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> scrapes_{0};
+    Render render;
+
+    /**
+     * Accept loop of the server thread
+     */
+    void run();
+
+    /**
+     * Read one request from a client and write the response
+     */
+    void handle(int client_fd);
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,72 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Free list of reusable objects, shared by the threads that hand them around
+ * Objects keep their heap capacity between uses (a body string, an
+ * extractor's vectors), so a warm crawl recycles memory instead of going
+ * back to malloc for every page. Objects released while the pool already
+ * holds max_idle are simply destroyed
+ */
+template <typename T>
+class ObjectPool {
+public:
+    /**
+     * @param max_idle Most objects kept for reuse
+     */
+    explicit ObjectPool(size_t max_idle = 256) : limit(max_idle) {}
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    /**
+     * Take a pooled object
+     * @param out Receives the object (left untouched if the pool is empty)
+     * @return false if the pool was empty
+     */
+    bool acquire(T& out) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                out = std::move(idle.back());
+                idle.pop_back();
+                reused.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        missed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * Give an object back for reuse
+     */
+    void release(T object) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.size() < limit) {
+            idle.push_back(std::move(object));
+        }
+    }
+
+    /**
+     * Acquisitions served from the pool / that found it empty (for stats)
+     */
+    uint64_t reuse_count() const { return reused.load(std::memory_order_relaxed); }
+    uint64_t miss_count() const { return missed.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex;
+    std::vector<T> idle;
+    size_t limit;
+    std::atomic<uint64_t> reused{0};
+    std::atomic<uint64_t> missed{0};
+};
+
+#endif // OBJECT_POOL_H
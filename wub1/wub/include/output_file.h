@@ -0,0 +1,87 @@
+#ifndef OUTPUT_FILE_H
+#define OUTPUT_FILE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Buffered writer for export files
+ * Text and numbers are formatted straight into a 1 MiB buffer with
+ * std::to_chars and written out a chunk at a time; large binary blocks
+ * skip the buffer and go out with writev() next to whatever is pending.
+ * The data goes to path.tmp, and commit() renames it over path, so
+ * readers never see a half-written file.
+ * I/O errors throw std::runtime_error
+ */
+class OutputFile {
+public:
+    /**
+     * Create path.tmp for writing
+     * @throws std::runtime_error if it cannot be created
+     */
+    explicit OutputFile(const std::string& path);
+
+    /**
+     * Removes the temporary file unless commit() was called
+     */
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    void append(std::string_view text);
+    void append(char c);
+
+    /**
+     * Decimal integer
+     */
+    void append(uint64_t value);
+
+    /**
+     * Fixed-point number, like printf("%.*f")
+     */
+    void append_fixed(double value, int precision);
+
+    /**
+     * Raw bytes; blocks larger than the buffer are not copied
+     */
+    void write_block(const void* data, size_t bytes);
+
+    /**
+     * Write zeros up to the next multiple of alignment
+     */
+    void pad_to(size_t alignment);
+
+    /**
+     * Bytes written so far (the offset of the next byte)
+     */
+    uint64_t offset() const { return written + used; }
+
+    /**
+     * Write out the buffer, close the file and rename it into place
+     */
+    void commit();
+
+private:
+    std::string path;
+    std::string temp_path;
+    int fd = -1;
+    std::unique_ptr<char[]> buffer;
+    size_t used = 0;
+    uint64_t written = 0;       // Bytes already handed to the kernel
+
+    /**
+     * Make room for n bytes in the buffer (n must fit in it)
+     */
+    char* reserve(size_t n);
+
+    /**
+     * Write the buffer, then data, with as few writev() calls as possible
+     */
+    void flush(const void* data = nullptr, size_t bytes = 0);
+};
+
+#endif // OUTPUT_FILE_H
@@ -0,0 +1,51 @@
+#ifndef PAGERANK_H
+#define PAGERANK_H
+
+#include <vector>
+#include "csr_graph.h"
+
+/**
+ * PageRank settings
+ */
+struct PageRankOptions {
+    int max_iterations = 30;        // Backstop if the tolerance is never reached
+    double tolerance = 1e-6;        // Stop once the L1 change of an iteration drops below this
+    double damping = 0.85;
+    int num_threads = 1;            // Upper bound; small graphs use fewer
+    bool log_iterations = true;     // Print residual and time per iteration
+    bool warm_start = false;        // Start from the ranks passed in (if sized to the graph)
+};
+
+/**
+ * Outcome of a PageRank run
+ */
+struct PageRankStats {
+    int iterations = 0;
+    double residual = 0.0;          // L1 change of the last iteration
+    bool converged = false;
+    int threads = 1;
+    double elapsed_ms = 0.0;
+};
+
+/**
+ * Pull-based parallel PageRank over a CSR graph
+ * Each thread owns a contiguous node range balanced by in-edge count and
+ * writes only its own ranks, so no atomics are needed. Per-node dense
+ * passes (contributions, dangling mass, normalization, residual) use the
+ * vectorized kernels in simd_math.h
+ */
+namespace PageRank {
+
+/**
+ * Compute ranks for every node of graph
+ * @param graph Out-edge CSR (transposed internally)
+ * @param options Iteration, tolerance and threading settings
+ * @param ranks Output, one score per node summing to 1.0
+ * @return Iteration count, final residual and timing
+ */
+PageRankStats compute(const CsrGraph& graph, const PageRankOptions& options,
+                      std::vector<double>& ranks);
+
+}  // namespace PageRank
+
+#endif // PAGERANK_H
@@ -0,0 +1,93 @@
+#ifndef PARSED_URL_H
+#define PARSED_URL_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/**
+ * HTTP(S) URL parsed once into a normalized string plus component offsets
+ * Normalization (RFC 3986 section 6): lowercase scheme and host, drop
+ * userinfo, default ports and the fragment, remove dot segments from the
+ * path. A bare root path is dropped ("https://a.com/" -> "https://a.com")
+ * to match the crawler's visited-set keys.
+ * Component accessors return views into str(); they stay valid as long
+ * as the ParsedUrl is alive and unmodified (moving it is fine, views are
+ * rebuilt from offsets on every call)
+ */
+class ParsedUrl {
+public:
+    /**
+     * Parse an absolute http/https URL
+     * @param input URL text (surrounding whitespace is ignored)
+     * @param out Parsed result
+     * @return false if not an absolute http/https URL with a host
+     */
+    static bool parse(std::string_view input, ParsedUrl& out);
+
+    /**
+     * Resolve a reference against a base URL (RFC 3986 section 5.2)
+     * Handles absolute, scheme-relative, absolute-path, query-only,
+     * fragment-only and relative-path references
+     * @param base Already parsed base URL
+     * @param reference Link as written in the document
+     * @param out Resolved, normalized URL
+     * @return false if the result is not a crawlable http/https URL
+     */
+    static bool resolve(const ParsedUrl& base, std::string_view reference,
+                        ParsedUrl& out);
+
+    /**
+     * Remove "." and ".." segments from a path (RFC 3986 section 5.2.4)
+     * @param path Path starting with '/' or empty
+     * @param out Receives the cleaned path (cleared first)
+     */
+    static void remove_dot_segments(std::string_view path, std::string& out);
+
+    /**
+     * Full normalized URL
+     */
+    const std::string& str() const { return href; }
+
+    /**
+     * Give up the normalized string (leaves this object empty)
+     */
+    std::string release();
+
+    bool empty() const { return href.empty(); }
+
+    std::string_view scheme() const { return view(0, scheme_end); }
+    std::string_view host() const { return view(host_begin, host_end); }
+    std::string_view port() const;
+    std::string_view path() const { return view(port_end, path_end); }
+    std::string_view query() const;
+
+    /**
+     * Host and explicit port without a leading "www."
+     * This is the graph key used by StorageManager (e.g. "example.com")
+     */
+    std::string_view domain() const;
+
+    /**
+     * Best-effort registrable domain (eTLD+1) of the host
+     * Uses a small built-in list of two-level public suffixes
+     * ("co.uk", "com.au", ...) rather than the full public suffix list
+     */
+    std::string_view registrable_domain() const;
+
+    bool is_https() const { return scheme_end == 5; }
+
+private:
+    std::string href;
+    uint32_t scheme_end = 0;    // "http" / "https"
+    uint32_t host_begin = 0;    // After "://"
+    uint32_t host_end = 0;
+    uint32_t port_end = 0;      // Equals host_end when no port
+    uint32_t path_end = 0;      // Query starts after '?' at path_end
+
+    std::string_view view(uint32_t begin, uint32_t end) const {
+        return std::string_view(href).substr(begin, end - begin);
+    }
+};
+
+#endif // PARSED_URL_H
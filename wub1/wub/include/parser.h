@@ -2,18 +2,139 @@
 #define PARSER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstdint>
+#include "parsed_url.h"
+#include "link_scanner.h"
+#include "body_consumer.h"
+#include "simhash.h"
+
+/**
+ * Incremental link extraction for a body that arrives in pieces
+ * Each piece goes through a streaming LinkScanner; only the construct cut
+ * off at its end (a split tag, or the last bytes of a comment or script)
+ * is carried to the next one, so a page costs its links plus a small
+ * carry instead of the whole document. Links are resolved against the
+ * page URL or the first <base href>, exactly as extract_parsed_links does
+ * Optionally the same pass computes the SimHash of the page text
+ */
+class LinkExtractor : public BodyConsumer {
+public:
+    /**
+     * @param page Parsed URL of the page
+     * @param max_links Stop once this many links were found (0 = unlimited)
+     * @param fingerprint Also feed the page text to simhash()
+     */
+    explicit LinkExtractor(const ParsedUrl& page, size_t max_links = 0, bool fingerprint = false);
+
+    LinkExtractor(const LinkExtractor&) = delete;
+    LinkExtractor& operator=(const LinkExtractor&) = delete;
+
+    /**
+     * Start over on another page, keeping the carry and link buffers
+     * (for pooled extractors)
+     * @param page Parsed URL of the new page
+     * @param max_links Stop once this many links were found (0 = unlimited)
+     * @param fingerprint Also feed the page text to simhash()
+     */
+    void reset(const ParsedUrl& page, size_t max_links = 0, bool fingerprint = false);
+
+    /**
+     * Scan the next piece of the body
+     * @return false once max_links is reached
+     */
+    bool consume(std::string_view chunk) override;
+
+    /**
+     * Scan whatever is still carried as the end of the document
+     */
+    void finish() override;
+
+    /**
+     * Scan a complete document in one call
+     */
+    void scan(std::string_view html);
+
+    /**
+     * Links found so far, in document order
+     */
+    std::vector<ParsedUrl>& links();
+
+    /**
+     * True if extraction stopped at max_links
+     */
+    bool limit_reached() const;
+
+    /**
+     * Time spent extracting links from this page so far (all pieces)
+     */
+    uint64_t parse_nanos() const { return parse_ns; }
+
+    /**
+     * True if this page's text is being fingerprinted
+     */
+    bool fingerprinting() const { return fingerprint; }
+
+    /**
+     * SimHash of the text scanned so far (when fingerprinting)
+     */
+    SimHash& simhash() { return text_hash; }
+
+private:
+    ParsedUrl page;
+    ParsedUrl base_override;            // From <base href>
+    const ParsedUrl* base;
+    bool base_seen = false;
+    size_t max_links;
+    bool full = false;
+    bool fingerprint = false;
+    uint64_t parse_ns = 0;
+    LinkScanState state;
+    std::string carry;                  // Unfinished construct from the last piece
+    std::vector<ParsedUrl> found;
+    ParsedUrl link;                     // Resolve target, reused
+    SimHash text_hash;
+
+    /**
+     * Record one scanned attribute
+     * @return false once max_links is reached
+     */
+    bool handle(const LinkToken& token);
+
+    /**
+     * Hand the page text to text_hash if fingerprinting
+     */
+    void attach(LinkScanner& scanner);
+
+    /**
+     * Decide whether a scanned attribute points at a crawlable page
+     * (any href, src only on frame/iframe)
+     */
+    static bool is_followable(const LinkToken& token);
+};
 
 class Parser {
 public:
     /**
      * Extract all links from HTML content
+     * Single pass over the document with LinkScanner; honors <base href>
      * @param html HTML content to parse
      * @param base_url Base URL for resolving relative URLs
      * @return Vector of absolute URLs found
      */
     std::vector<std::string> extract_links(const std::string& html, 
                                            const std::string& base_url);
+
+    /**
+     * Extract links as parsed URLs (no string round trip for callers that
+     * need the domain or other components of every link)
+     * @param html HTML content to parse
+     * @param base Parsed URL of the page
+     * @return Resolved, normalized links in document order
+     */
+    std::vector<ParsedUrl> extract_parsed_links(std::string_view html,
+                                                const ParsedUrl& base);
     
     /**
      * Extract domain name from full URL
@@ -30,9 +151,9 @@ public:
     bool is_valid_url(const std::string& url);
     
     /**
-     * Normalize URL (remove fragments, standardize format)
+     * Normalize URL (see ParsedUrl for the exact rules)
      * @param url URL to normalize
-     * @return Normalized URL
+     * @return Normalized URL, or the trimmed input if it does not parse
      */
     std::string normalize_url(const std::string& url);
     
@@ -40,21 +161,10 @@ public:
      * Resolve relative URL against base URL
      * @param base Base URL
      * @param relative Relative URL
-     * @return Absolute URL
+     * @return Absolute URL, empty if the result is not http/https
      */
     std::string resolve_relative_url(const std::string& base, 
                                      const std::string& relative);
-
-private:
-    /**
-     * Remove query parameters and fragments
-     */
-    std::string remove_query_fragment(const std::string& url);
-    
-    /**
-     * Check if URL is relative
-     */
-    bool is_relative_url(const std::string& url);
 };
 
 #endif // PARSER_H
@@ -0,0 +1,95 @@
+#ifndef ROBOTS_FETCHER_H
+#define ROBOTS_FETCHER_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "fetch_engine.h"
+#include "robots_rules.h"
+
+/**
+ * Robots and sitemap counters (for stats)
+ */
+struct RobotsStats {
+    size_t requested = 0;       // Hosts whose robots.txt was requested
+    size_t fetched = 0;         // robots.txt files compiled (2xx)
+    size_t missing = 0;         // 4xx: every path allowed
+    size_t unreachable = 0;     // 5xx, 429 or failed transfer: every path disallowed
+    size_t delayed_hosts = 0;   // Hosts whose robots.txt sets a Crawl-delay
+    size_t sitemaps = 0;        // Sitemaps and sitemap indexes requested
+};
+
+/**
+ * Queue of robots.txt and sitemap fetches waiting for an I/O loop
+ * The frontier reports each new host once, so each robots.txt is fetched
+ * once per crawl; the I/O loops take these fetches ahead of page URLs.
+ * A finished robots.txt is turned into rules as RFC 9309 says: a 2xx
+ * body is compiled, a 4xx means no restrictions, and a 5xx (or no answer
+ * at all) means the whole host is off limits.
+ * Sitemaps are fetched at most once each, up to MAX_SITEMAPS per crawl
+ * and MAX_NESTING index levels below the first sitemap
+ * All methods are thread-safe
+ */
+class RobotsFetcher {
+public:
+    static constexpr size_t MAX_SITEMAPS = 64;
+    static constexpr uint32_t MAX_NESTING = 2;
+
+    /**
+     * Queue the robots.txt of a host
+     * @param url Any URL on the host (its scheme and authority are used)
+     */
+    void request_robots(std::string_view url);
+
+    /**
+     * Queue a sitemap unless it was requested before or the budget is spent
+     * @param url Absolute sitemap URL
+     * @param nesting Sitemap indexes above it (0 for robots.txt and --sitemap)
+     * @return true if queued
+     */
+    bool request_sitemap(const std::string& url, uint32_t nesting);
+
+    /**
+     * Take the next queued fetch (FetchEngine source)
+     * @param request Filled with the URL and its kind (depth = nesting)
+     * @return false if nothing is queued
+     */
+    bool next(FetchRequest& request);
+
+    /**
+     * Rules for a finished robots.txt transfer
+     * @param result Buffered transfer of kind Robots
+     * @param agent Product token to match in User-agent lines
+     * @return Compiled, allow-all or disallow-all rules (never null)
+     */
+    std::shared_ptr<const RobotsRules> rules_for(const FetchResult& result, std::string_view agent);
+
+    /**
+     * robots.txt URL of the host of a URL ("scheme://authority/robots.txt")
+     */
+    static std::string robots_url(std::string_view url);
+
+    /**
+     * Snapshot the counters
+     */
+    RobotsStats stats() const;
+
+private:
+    mutable std::mutex mutex;
+    std::deque<FetchRequest> pending;
+    std::unordered_set<std::string> sitemaps_seen;
+    std::atomic<size_t> queued{0};      // pending.size(), read without the lock
+    std::atomic<size_t> requested{0};
+    std::atomic<size_t> fetched{0};
+    std::atomic<size_t> missing{0};
+    std::atomic<size_t> unreachable{0};
+    std::atomic<size_t> delayed_hosts{0};
+};
+
+#endif // ROBOTS_FETCHER_H
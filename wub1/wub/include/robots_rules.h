@@ -0,0 +1,91 @@
+#ifndef ROBOTS_RULES_H
+#define ROBOTS_RULES_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * One host's robots.txt, compiled for the admission check (RFC 9309)
+ * Allow and Disallow paths of the groups that apply to us are merged
+ * into one byte trie, so a URL is tested in a single walk over its path
+ * with no allocation: the deepest rule on the walk is the longest (most
+ * specific) match, and Allow beats Disallow on a tie. The few patterns
+ * with '*' or '$' are kept aside and tried only when they are longer
+ * than the trie's match. Paths are compared as raw octets, the way
+ * they appear in the normalized URL
+ */
+class RobotsRules {
+public:
+    /**
+     * Compile a robots.txt body
+     * Uses the groups naming our product token (case-insensitive), or
+     * the "*" groups when none does; several matching groups are merged.
+     * Only the first MAX_BYTES are read
+     * @param text File contents
+     * @param agent Product token to look for (e.g. "WebCrawler")
+     * @return Compiled rules (never null)
+     */
+    static std::shared_ptr<const RobotsRules> parse(std::string_view text, std::string_view agent);
+
+    /**
+     * Rules that block every path (robots.txt unreachable)
+     */
+    static std::shared_ptr<const RobotsRules> disallow_all();
+
+    /**
+     * Check a URL path against the rules
+     * @param path Path plus query as it appears in the URL ("" = "/")
+     * @return true if we may fetch it
+     */
+    bool allowed(std::string_view path) const;
+
+    /**
+     * Crawl-delay of the chosen groups in milliseconds (0 if none)
+     */
+    int crawl_delay_ms() const { return delay_ms; }
+
+    /**
+     * Sitemap URLs listed anywhere in the file
+     */
+    const std::vector<std::string>& sitemaps() const { return sitemap_urls; }
+
+    /**
+     * Allow and Disallow rules compiled
+     */
+    size_t rule_count() const { return rules; }
+
+    static constexpr size_t MAX_BYTES = 500 * 1024;     // RFC 9309 minimum parse limit
+
+private:
+    // Flattened trie: a node's children are edges [first_edge, first_edge + edge_count),
+    // sorted by byte
+    struct Node {
+        uint32_t first_edge = 0;
+        uint16_t edge_count = 0;
+        int8_t rule = 0;                // +1 Allow, -1 Disallow, 0 none
+    };
+
+    struct Pattern {
+        std::string pattern;            // May contain '*' and a final '$'
+        bool allow = false;
+    };
+
+    std::vector<Node> nodes;            // nodes[0] is the root (empty path)
+    std::vector<uint8_t> edge_bytes;
+    std::vector<uint32_t> edge_targets;
+    std::vector<Pattern> patterns;
+    std::vector<std::string> sitemap_urls;
+    int delay_ms = 0;
+    size_t rules = 0;
+
+    /**
+     * Match a '*'/'$' pattern against a whole path (no allocation)
+     */
+    static bool pattern_matches(std::string_view pattern, std::string_view path);
+};
+
+#endif // ROBOTS_RULES_H
@@ -0,0 +1,42 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cstddef>
+
+/**
+ * Vectorized double-array kernels for the PageRank dense passes
+ * Follow the implementation level chosen in simd_scan.h (AVX2/SSE2 on
+ * x86-64, NEON on AArch64, scalar elsewhere), including force_level().
+ * Reductions use several accumulators, so results may differ from a
+ * sequential sum in the last bits
+ */
+namespace Simd {
+
+/**
+ * Sum of a[0..n)
+ */
+double sum(const double* a, size_t n);
+
+/**
+ * Dot product of a[0..n) and b[0..n)
+ */
+double dot(const double* a, const double* b, size_t n);
+
+/**
+ * dst[i] = a[i] * b[i]
+ */
+void multiply(double* dst, const double* a, const double* b, size_t n);
+
+/**
+ * a[i] *= factor
+ */
+void scale(double* a, size_t n, double factor);
+
+/**
+ * Sum of |a[i] - b[i]|
+ */
+double l1_distance(const double* a, const double* b, size_t n);
+
+}  // namespace Simd
+
+#endif // SIMD_MATH_H
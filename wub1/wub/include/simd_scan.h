@@ -0,0 +1,50 @@
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include <cstddef>
+
+/**
+ * Vectorized byte searches for the HTML scanner hot loop
+ * The best implementation for the running CPU is picked once at startup
+ * (AVX2 or SSE2 on x86-64, NEON on AArch64, scalar elsewhere)
+ */
+namespace Simd {
+
+enum class Level {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+/**
+ * Get the implementation currently in use
+ */
+Level active_level();
+
+/**
+ * Get a printable name for an implementation level
+ */
+const char* level_name(Level level);
+
+/**
+ * Force an implementation (benchmarks); levels the CPU lacks are ignored
+ * @return true if the requested level is now active
+ */
+bool force_level(Level level);
+
+/**
+ * Find first occurrence of c in [begin, end)
+ * @return Pointer to the match, or end if not found
+ */
+const char* find_char(const char* begin, const char* end, char c);
+
+/**
+ * Find first occurrence of either a or b in [begin, end)
+ * @return Pointer to the match, or end if not found
+ */
+const char* find_char2(const char* begin, const char* end, char a, char b);
+
+}  // namespace Simd
+
+#endif // SIMD_SCAN_H
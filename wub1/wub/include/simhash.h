@@ -0,0 +1,106 @@
+#ifndef SIMHASH_H
+#define SIMHASH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include "link_scanner.h"
+
+/**
+ * 64-bit SimHash of a page's text (Charikar)
+ * Fed by LinkScanner with the text between tags, so the fingerprint is
+ * computed in the same pass as the link scan. Features are word bigrams:
+ * every bit of a feature's hash votes +1 or -1, and the fingerprint keeps
+ * the sign of each total. Pages that share most of their text end up a
+ * few bits apart. A word split across body pieces is carried over, so a
+ * streamed page gets the same fingerprint as the whole document
+ */
+class SimHash : public TextSink {
+public:
+    SimHash();
+
+    /**
+     * Start over on another page
+     */
+    void reset();
+
+    void text(std::string_view run) override;
+    void boundary() override;
+
+    /**
+     * Fingerprint of everything seen so far (ends a pending word)
+     */
+    uint64_t digest();
+
+    /**
+     * Features counted so far; short pages make unreliable fingerprints
+     */
+    size_t features() const { return count; }
+
+private:
+    static constexpr int BITS = 64;
+
+    int32_t votes[BITS];
+    uint64_t previous = 0;          // Hash of the last word (bigram context)
+    size_t count = 0;
+    std::string partial;            // Word cut off by the end of a text run
+
+    /**
+     * Count one word
+     */
+    void add_word(std::string_view word);
+};
+
+/**
+ * Recently seen SimHash fingerprints with banded LSH lookup
+ * The 64 bits are cut into max_distance + 1 bands; two fingerprints at
+ * most max_distance bits apart agree on at least one whole band, so only
+ * the buckets of their bands are compared. Every band has a fixed table
+ * of small FIFO buckets, so memory is bounded and old pages fall out as
+ * new ones arrive.
+ * Thread-safe: buckets are guarded by striped locks, so two near-equal
+ * pages checked at the same moment may both pass
+ */
+class SimHashIndex {
+public:
+    /**
+     * @param max_distance Largest Hamming distance counted as a near-duplicate (1-7)
+     * @param bucket_bits log2 of the buckets per band
+     */
+    explicit SimHashIndex(int max_distance = 3, int bucket_bits = 16);
+
+    SimHashIndex(const SimHashIndex&) = delete;
+    SimHashIndex& operator=(const SimHashIndex&) = delete;
+
+    /**
+     * Check a fingerprint against the recent ones, then remember it
+     * @return true if a remembered fingerprint is within max_distance bits
+     */
+    bool check_and_insert(uint64_t fingerprint);
+
+    /**
+     * Fingerprints remembered per band bucket
+     */
+    static constexpr size_t BUCKET_SLOTS = 4;
+
+private:
+    static constexpr size_t LOCK_STRIPES = 64;
+
+    int max_distance;
+    int bands;
+    size_t buckets;                 // Per band, a power of two
+    std::unique_ptr<uint64_t[]> slots;      // [band][bucket][slot], 0 = empty
+    std::unique_ptr<uint8_t[]> cursors;     // [band][bucket]: next slot to overwrite
+    std::mutex stripes[LOCK_STRIPES];
+
+    /**
+     * Bucket of a fingerprint in one band (index across all bands)
+     */
+    size_t bucket_of(uint64_t fingerprint, int band) const;
+};
+
+#endif // SIMHASH_H
@@ -0,0 +1,108 @@
+#ifndef SITEMAP_STREAM_H
+#define SITEMAP_STREAM_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstddef>
+#include "body_consumer.h"
+
+/**
+ * Streaming reader of a sitemap or sitemap index (sitemaps.org XML)
+ * Picks the <loc> values out of body pieces as they arrive, so a large
+ * sitemap is never held in memory: only a carry of the last unfinished
+ * <loc> survives between pieces, and URLs are handed on in batches. It
+ * is a text scan, not an XML parser: entities and CDATA in <loc> are
+ * decoded, everything else is skipped. A <sitemapindex> root marks the
+ * URLs as further sitemaps. gzip-compressed files (.xml.gz served
+ * without a Content-Encoding) are inflated piece by piece when built
+ * with zlib; without it they stop the scan
+ */
+class SitemapStream : public BodyConsumer {
+public:
+    /**
+     * Receives a batch of URLs (the vector may be moved from; it is cleared after)
+     * @param index true if they are sitemaps listed by a sitemap index
+     */
+    using Flush = std::function<void(std::vector<std::string>& urls, bool index)>;
+
+    static constexpr size_t MAX_URLS = 50000;       // Per file, as the protocol allows
+    static constexpr size_t BATCH_URLS = 512;
+    static constexpr size_t MAX_LOC_BYTES = 4096;   // Longer <loc> values are skipped
+    static constexpr size_t MAX_INFLATED_BYTES = 50 << 20;  // Per gzip file, as the protocol allows
+
+    /**
+     * @param flush Batch receiver, called on the thread feeding the stream
+     */
+    explicit SitemapStream(Flush flush);
+    ~SitemapStream() override;
+
+    bool consume(std::string_view chunk) override;
+    void finish() override;
+
+    /**
+     * URLs handed to the flush callback so far
+     */
+    size_t url_count() const { return urls; }
+
+    /**
+     * Whether the file is a sitemap index
+     */
+    bool is_index() const { return index; }
+
+    /**
+     * Whether the body looked gzip-compressed
+     */
+    bool compressed() const { return gzipped; }
+
+    /**
+     * Whether a compressed body could not be read: no zlib, corrupt, or
+     * over MAX_INFLATED_BYTES (URLs found before that were kept)
+     */
+    bool unreadable() const { return inflate_failed; }
+
+    /**
+     * Whether gzip-compressed sitemaps can be read in this build
+     */
+    static bool can_inflate();
+
+private:
+    struct Inflater;
+
+    Flush flush;
+    std::unique_ptr<Inflater> inflater;     // Set while reading a gzip body
+    std::string carry;                  // Unscanned tail of the previous piece
+    std::vector<std::string> batch;
+    size_t urls = 0;
+    bool started = false;
+    bool index = false;
+    bool gzipped = false;
+    bool inflate_failed = false;
+
+    /**
+     * Scan a piece of the (decoded) body for <loc> values
+     * @return false to stop the transfer
+     */
+    bool scan(std::string_view chunk);
+
+    /**
+     * Inflate a piece of a gzip body and scan what comes out
+     * @return false to stop the transfer
+     */
+    bool inflate_piece(std::string_view chunk);
+
+    /**
+     * Decode one <loc> value and add it to the batch
+     * @return false once MAX_URLS is reached
+     */
+    bool add_loc(std::string_view value);
+
+    /**
+     * Hand the batch to the callback
+     */
+    void flush_batch();
+};
+
+#endif // SITEMAP_STREAM_H
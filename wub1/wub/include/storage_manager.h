@@ -4,17 +4,45 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <unordered_set>
 #include <numeric>
+#include <memory_resource>
+#include <cstdint>
+#include "parsed_url.h"
+#include "domain_table.h"
+#include "csr_graph.h"
+#include "pagerank.h"
+#include "incremental_pagerank.h"
+
+/**
+ * One domain's out-edges and visits as seen by one thread
+ * Edges up to combined are sorted by target with one entry per target;
+ * pages appended after that are folded in once they outgrow that part
+ */
+struct DomainLinks {
+    std::vector<WeightedEdge> edges;
+    size_t combined = 0;
+    int visits = 0;
+};
 
 /**
  * Per-thread local buffer for graph data
  * No locking - each thread has its own buffer
+ * Domains are interned IDs from StorageManager's DomainTable
  */
 struct ThreadLocalBuffer {
-    std::unordered_map<std::string, std::vector<std::string>> local_graph;
-    std::unordered_map<std::string, int> local_visit_count;
-    std::unordered_set<std::string> local_domains;
+    std::unordered_map<uint32_t, DomainLinks> local_graph;
+};
+
+/**
+ * One page's links after StorageManager::add_page
+ * URLs are distinct and in document order, with their fingerprint and
+ * domain ID alongside; keep one per worker so the capacity is reused
+ */
+struct PageLinks {
+    std::vector<std::string> urls;          // Moved out of the parsed links
+    std::vector<uint64_t> fingerprints;     // Hash64 of each URL
+    std::vector<uint32_t> domain_ids;       // Interned domain of each URL
+    std::vector<WeightedEdge> edges;        // The page's own edges, by target
 };
 
 /**
@@ -38,32 +66,94 @@ public:
     
     /**
      * Record a page visit in thread-local buffer
+     * The one per-page pass over its links: interns each link's domain,
+     * drops repeated URLs and builds one edge per distinct target domain
+     * weighted by how many links point there. The edges are added to the
+     * domain's: every page of a domain counts toward its out-links
      * @param thread_id Thread ID
      * @param domain Domain of page
-     * @param outgoing_links Links found on page
+     * @param outgoing_links Parsed links found on page (their strings are moved out)
+     * @param out Distinct URLs for the frontier, and the stored edges
+     * @param scratch Per-page temporaries (e.g. an arena released after the page)
+     * @return Source domain ID
+     */
+    uint32_t add_page(int thread_id, std::string_view domain,
+                      std::vector<ParsedUrl>& outgoing_links, PageLinks& out,
+                      std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+    /**
+     * Intern a domain replayed from a crawl journal
+     * Replay in ID order into an empty table to get the same IDs back
+     * @return Domain ID
+     */
+    uint32_t restore_domain(std::string_view domain);
+
+    /**
+     * Record a page replayed from a crawl journal (into buffer 0)
+     * @param source Source domain ID
+     * @param edges The page's out-edges with link counts
+     */
+    void restore_page(uint32_t source, std::vector<WeightedEdge>& edges);
+
+    /**
+     * Fold in one domain's merged links from another cluster node (into buffer 0)
+     * Call before merge_all_buffers
+     * @param source Source domain ID (from restore_domain())
+     * @param edges Out-edges with link counts, any order (sorted in place)
+     * @param visits Pages the other node crawled on the domain
+     */
+    void merge_remote_domain(uint32_t source, std::vector<WeightedEdge>& edges, int visits);
+    
+    /**
+     * Keep live PageRank estimates while pages are added
+     * Call before crawling starts; compute_pagerank() then warm-starts
+     * from the live estimates
      */
-    void add_page(int thread_id, const std::string& domain, 
-                  const std::vector<std::string>& outgoing_links);
+    void start_live_pagerank();
+
+    /**
+     * Live estimates (empty unless start_live_pagerank() was called)
+     */
+    const IncrementalPageRank& live_pagerank() const { return live_ranks; }
     
     /**
      * Merge all thread-local buffers into global graph
+     * Domains are hash-partitioned across threads; each thread unions the
+     * edge lists of its domains from every buffer (weights of a shared
+     * target add up), moving rather than copying, and writes them into
+     * the CSR arrays. The buffers are freed
      * Call AFTER all threads complete
+     * @param num_threads Threads to use (small graphs use fewer)
      */
-    void merge_all_buffers();
+    void merge_all_buffers(int num_threads = 1);
     
     /**
      * Compute PageRank using iterative algorithm
-     * @param iterations Number of iterations (default 30)
+     * Parallel pull-based sweep over the CSR graph (see pagerank.h),
+     * warm-started from the live estimates when they were enabled
+     * @param iterations Maximum number of iterations (default 30)
+     * @param tolerance Stop early once the L1 change drops below this
+     * @param num_threads Threads to use (small graphs use fewer)
      */
-    void compute_pagerank(int iterations = 30);
+    void compute_pagerank(int iterations = 30, double tolerance = 1e-6,
+                          int num_threads = 1);
     
     /**
      * Export results to CSV files
      * @param crawled_file Output file for crawled pages
      * @param ranking_file Output file for PageRank results
+     * @throws std::runtime_error if a file cannot be written
      */
     void export_to_csv(const std::string& crawled_file, 
                        const std::string& ranking_file);
+
+    /**
+     * Export the merged graph, visit counts and ranks as one binary
+     * columnar file that can be mapped and used in place (see graph_file.h)
+     * @param graph_file Output file
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void export_binary(const std::string& graph_file) const;
     
     /**
      * Get all domains in graph
@@ -80,18 +170,30 @@ public:
      */
     int get_visit_count(const std::string& domain) const;
 
+    /**
+     * Domain interning table shared by all threads
+     */
+    const DomainTable& domains() const { return domain_table; }
+
+    /**
+     * Merged graph (valid after merge_all_buffers)
+     */
+    const CsrGraph& graph() const { return link_graph; }
+
+    /**
+     * Pages crawled per domain ID (valid after merge_all_buffers)
+     */
+    const std::vector<int>& visit_counts() const { return visit_count; }
+
 private:
     std::vector<ThreadLocalBuffer> thread_buffers;
+    DomainTable domain_table;
+    IncrementalPageRank live_ranks;
     
-    // Merged graph after all threads complete
-    std::unordered_map<std::string, std::vector<std::string>> link_graph;
-    std::unordered_map<std::string, int> visit_count;
-    std::unordered_map<std::string, double> pagerank;
-    
-    /**
-     * Internal PageRank calculation
-     */
-    void pagerank_iteration(int iterations);
+    // Merged graph after all threads complete, indexed by domain ID
+    CsrGraph link_graph;
+    std::vector<int> visit_count;       // 0 for destination-only domains
+    std::vector<double> pagerank;
 };
 
 #endif // STORAGE_MANAGER_H
@@ -4,50 +4,263 @@
 #include <string>
 #include <thread>
 #include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory_resource>
+#include "crawl_config.h"
 #include "url_frontier.h"
 #include "storage_manager.h"
 #include "downloader.h"
+#include "fetch_engine.h"
 #include "parser.h"
+#include "object_pool.h"
+#include "alloc_stats.h"
+#include "metrics_server.h"
+#include "fetch_cache.h"
+#include "cluster_node.h"
+#include "bounded_queue.h"
+#include "robots_fetcher.h"
 
 /**
- * Manages worker thread pool
- * No locking - threads pull work from URLFrontier independently
+ * A page on its way from a parser worker to a store worker
+ */
+struct ParsedPage {
+    std::string url;
+    uint64_t url_key = 0;               // Hash64 of url
+    ParsedUrl page;                     // Parsed url (domain() keys the graph)
+    std::vector<ParsedUrl> links;       // Pooled; returned once stored
+    uint32_t depth = 0;
+    int loop_id = 0;                    // I/O loop that fetched it
+    bool failed = false;                // Fetch failed or URL rejected: only retire it
+    bool near_duplicate = false;        // Record the edges, don't follow the links
+};
+
+/**
+ * Manages the crawl pipeline
+ * A few I/O threads keep transfers in flight through FetchEngine;
+ * parser worker threads consume completed bodies and feed new links
+ * back into the URLFrontier. Each I/O loop owns one frontier partition
+ * and the hosts hashed to it, so connections to a host stay on one loop;
+ * loops with no ready host take ready URLs from their peers
+ * By default links are extracted on the I/O threads while a body
+ * downloads (LinkExtractor), and workers only record and enqueue them
+ * With a FetchCache, requests carry the previous run's validators, and a
+ * page that comes back 304 or with the same body hash replays its cached
+ * links instead of being parsed
+ * With near-duplicate detection on, the extractor also fingerprints the
+ * page text (SimHash), and a page close to a recent one is recorded in
+ * the graph but its links are not enqueued
+ *
+ * Stages are joined by bounded lock-free rings (BoundedQueue): I/O loops
+ * push finished transfers to the parser workers, which either record and
+ * enqueue each page themselves or, with store threads, push the parsed
+ * page to a separate storage/enqueue stage. A full ring pushes back: an
+ * I/O loop starts a transfer only with a parse-queue slot reserved for
+ * its result, and a parser blocks while the store queue is full
+ *
+ * With robots.txt on, a host's URLs wait in the frontier until its
+ * robots.txt is in: the first URL on a host queues that fetch, which the
+ * I/O loops take ahead of pages and finish on the I/O thread. Sitemaps
+ * are read the same way, streamed, and their URLs go straight into the
+ * frontier
  */
 class ThreadManager {
 public:
     /**
-     * Start crawling with worker threads
-     * @param num_threads Number of worker threads
-     * @param max_pages Maximum pages to crawl
-     * @param seed_url Starting URL
+     * Start crawling with I/O and parser threads
+     * @param config Crawl settings (seed, limits, thread counts)
      * @param storage_manager Storage manager instance
+     * @param journal Open journal to log to and resume from, or nullptr
+     * @param fetch_cache Open fetch cache for conditional requests, or nullptr
+     * @param cluster Listening cluster node to share the crawl with, or nullptr
      */
-    void start(int num_threads, int max_pages, 
-               const std::string& seed_url,
-               StorageManager& storage_manager);
-    
+    void start(const CrawlConfig& config, StorageManager& storage_manager,
+               CrawlJournal* journal = nullptr, FetchCache* fetch_cache = nullptr,
+               ClusterNode* cluster = nullptr);
+
     /**
      * Wait for all threads to complete
      */
     void wait_completion();
-    
+
     /**
      * Get number of pages crawled so far
      */
     int get_pages_crawled() const;
 
+    /**
+     * Whether an error stopped the crawl before it was done
+     */
+    bool stopped_by_error() const;
+
+    /**
+     * Live crawl telemetry for a Prometheus scrape (MetricsServer render
+     * callback): throughput, frontier size, busy hosts, responses by
+     * status and the stage histograms
+     * Reads the crawl's atomics and counters; only the busy-host list
+     * takes a partition lock, once per scrape
+     */
+    void write_prometheus(PrometheusText& out) const;
+
 private:
     std::vector<std::thread> workers;
+    std::vector<std::thread> store_workers;
+    int store_threads = 0;                  // 0 = parser workers store their own pages
+    std::thread progress_thread;
     URLFrontier frontier;
+    FetchEngine fetch_engine;
+    DnsCache dns_cache;
     std::atomic<int> pages_crawled{0};
+    std::atomic<int> pages_reserved{0};     // Crawled + in flight + being parsed
     std::atomic<int> max_pages_limit{0};
-    
+    std::atomic<bool> crawl_done{false};
+    std::atomic<double> pages_per_second{0.0};  // Over the last progress tick
+    std::atomic<double> bytes_per_second{0.0};
+    std::chrono::steady_clock::time_point started_at;
+    FrontierPriority priority_mode = FrontierPriority::Depth;
+    CrawlJournal* journal = nullptr;
+    FetchCache* fetch_cache = nullptr;
+    ClusterNode* cluster = nullptr;         // Null in a single-process crawl
+    size_t max_page_links = 0;              // 0 = unlimited
+    std::unique_ptr<SimHashIndex> near_duplicates;     // Recent page fingerprints (null = off)
+    bool dns_prefetch = false;              // dns_cache is running
+    int metrics_interval = 0;               // Seconds between stage-metric dumps (0 = off)
+    std::string metrics_file;               // Final stage metrics CSV (empty = none)
+    std::vector<std::unique_ptr<ObjectPool<std::unique_ptr<LinkExtractor>>>> extractor_pools;  // Per I/O loop
+    std::vector<ParsedUrl> loop_pages;      // Page URL scratch for each loop's stream factory
+    AllocStats alloc_at_start;              // Heap counters when the crawl started
+    RobotsFetcher robots;                   // robots.txt and sitemap fetches
+    bool robots_enabled = false;
+    bool follow_sitemaps = false;           // Read sitemaps listed in robots.txt
+
+    // Stage queues: I/O loops -> parser workers -> store workers
+    BoundedQueue<FetchResult> parse_queue;
+    BoundedQueue<ParsedPage> store_queue;
+    std::atomic<int> parse_credits{0};      // parse_queue slots not promised to a transfer
+    std::atomic<bool> credit_waiters{false};    // A loop was turned away for lack of credits
+    ObjectPool<std::vector<ParsedUrl>> link_lists{1024};   // ParsedPage::links between stages
+    std::mutex done_mutex;
+    std::condition_variable done_cv;        // Wakes the progress thread at the end
+    std::string stop_error;                 // Why the crawl stopped early (under done_mutex)
+    std::atomic<bool> stopped_early{false};
+
+    /**
+     * Per-thread scratch of the storage/enqueue step; containers keep
+     * their capacity from page to page
+     */
+    struct StoreScratch {
+        StoreScratch();
+        std::vector<std::byte> arena_buffer;
+        std::pmr::monotonic_buffer_resource arena;     // add_page temporaries, reset per page
+        std::vector<float> priorities;
+        PageLinks page_links;
+        uint64_t pages_done = 0;
+    };
+
+    /**
+     * FetchEngine source: reserve a page slot and dequeue a URL
+     * @param loop_id Requesting I/O loop (its frontier partition)
+     */
+    bool next_fetch_url(int loop_id, FetchRequest& request);
+
+    /**
+     * FetchEngine sink: free the host's slot and hand a finished
+     * transfer to the parser workers
+     */
+    void on_fetch_complete(FetchResult&& result);
+
+    /**
+     * Attach a finished robots.txt to its host and queue its sitemaps
+     * (on the I/O thread)
+     */
+    void on_robots_complete(FetchResult& result);
+
+    /**
+     * Queue a sitemap fetch, counted as outstanding until it finishes
+     * @param nesting Sitemap indexes above it
+     */
+    void request_sitemap(const std::string& url, uint32_t nesting);
+
+    /**
+     * SitemapStream flush: queue page URLs in the frontier, or the
+     * sitemaps a sitemap index lists
+     * @param urls Batch from the stream (moved from)
+     * @param nesting Sitemap indexes above the file they came from
+     */
+    void enqueue_sitemap_urls(std::vector<std::string>& urls, bool index, uint32_t nesting);
+
+    /**
+     * Return a finished transfer's extractor and body buffer to their pools
+     */
+    void recycle(FetchResult& result);
+
+    /**
+     * Mark one URL as fully processed and detect crawl completion
+     */
+    void finish_url();
+
+    /**
+     * Stop the crawl and wake every waiting thread
+     */
+    void signal_done();
+
+    /**
+     * Stop the crawl after an error it can't continue past (spill I/O)
+     */
+    void fail(const std::string& error);
+
+    /**
+     * Rebuild storage and frontier from a resumed journal
+     * @return Number of pages already crawled
+     */
+    int restore_from_journal(StorageManager& storage_manager);
+
     /**
-     * Worker thread main loop
-     * @param thread_id ID of this thread
+     * Frontier priorities for the links found on one page
+     * @param links The page's distinct links from StorageManager::add_page
+     * @param depth Depth of the links
+     * @param priorities Filled with one priority per URL (capacity is reused)
+     */
+    void link_priorities(const PageLinks& links, uint32_t depth,
+                         const StorageManager& storage_manager,
+                         std::vector<float>& priorities) const;
+
+    /**
+     * Send the links whose hosts belong to other cluster nodes to their
+     * owners and keep only the local ones (in order)
+     * @param links The page's distinct links, compacted in place
+     * @param priorities Parallel to links.urls, compacted with them
+     * @param depth Depth of the links
+     */
+    void route_links(PageLinks& links, std::vector<float>& priorities, uint32_t depth);
+
+    /**
+     * Record a parsed page, enqueue its links and retire its URL
+     * @param writer Storage buffer and journal writer of the calling thread
+     * @param parsed The page (its links are moved out)
+     * @param scratch The calling thread's scratch
+     */
+    void store_page(int writer, StorageManager& storage_manager, ParsedPage& parsed,
+                    StoreScratch& scratch);
+
+    /**
+     * Give a parse_queue slot back to the I/O loops
+     */
+    void release_parse_credit();
+
+    /**
+     * Parser worker main loop
+     * @param thread_id ID of this thread (its storage buffer when it stores pages itself)
      * @param storage_manager Reference to storage
      */
     void worker_loop(int thread_id, StorageManager& storage_manager);
+
+    /**
+     * Store worker main loop (only with store threads)
+     * @param thread_id ID of this thread, its storage buffer and journal writer
+     */
+    void store_loop(int thread_id, StorageManager& storage_manager);
 };
 
 #endif // THREAD_MANAGER_H
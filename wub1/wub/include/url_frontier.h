@@ -2,76 +2,340 @@
 #define URL_FRONTIER_H
 
 #include <string>
-#include <queue>
-#include <unordered_set>
+#include <string_view>
+#include <vector>
 #include <atomic>
 #include <mutex>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <cstdint>
+#include "visited_set.h"
+#include "host_scheduler.h"
+#include "frontier_spill.h"
+#include "crawl_journal.h"
+#include <unordered_set>
 
 /**
- * URL frontier with minimal locking
- * Uses a single mutex ONLY for the queue operations (dequeue/enqueue)
- * This is necessary for std::queue thread-safety
+ * Per-shard lock statistics (for stats)
+ */
+struct FrontierShardStats {
+    size_t visited = 0;
+    size_t visited_bytes = 0;       // Heap held by the shard's visited set
+    size_t spilled_bytes = 0;       // Visited-set bytes spilled to disk
+    uint64_t lock_acquisitions = 0;
+    uint64_t lock_contended = 0;    // Acquisitions that found the lock held
+};
+
+/**
+ * Per-partition scheduler statistics (for stats)
+ */
+struct FrontierQueueStats {
+    size_t queued = 0;
+    size_t hosts = 0;               // Hosts owned by this partition
+    uint64_t steals = 0;            // URLs other workers took from this partition
+    uint64_t backoffs = 0;          // 429/503 back-offs applied
+    size_t spilled = 0;             // Queued URLs over the cap (segments + spill_buffered)
+    size_t spill_buffered = 0;      // Of those, waiting in memory for a full block
+    uint64_t spill_urls = 0;        // URLs written to segment files so far
+    uint64_t spill_bytes = 0;       // Bytes written to segment files so far
+};
+
+/**
+ * URL frontier: sharded admission plus per-worker politeness partitions
+ * The visited check for a URL touches exactly one lock-striped shard,
+ * picked by hash. Admitted URLs go to the partition owning their host
+ * (also picked by hash), whose HostScheduler hands out only URLs from
+ * hosts below their connection limit and past their crawl delay, best
+ * priority first. A worker pops its own partition first and takes a
+ * ready URL from a peer's partition when its own has none; the host's
+ * limits stay with the owning partition either way.
+ * With a spill directory, each partition keeps a bounded number of URLs
+ * in its scheduler and appends the rest to a FrontierSpill, refilling
+ * from it a block at a time once the in-memory part is half empty.
+ * Robots.txt rules handed to set_robots() are checked as URLs reach
+ * their host's scheduler, under the partition lock: a disallowed URL is
+ * counted and dropped there, before it takes a queue slot.
+ * Termination is tracked as an outstanding-task count: a URL stays
+ * outstanding from admission until complete_task() is called for it
  */
 class URLFrontier {
 public:
     /**
      * Initialize frontier with seed URL
-     * @param seed_url Starting URL
+     * @param seed_url Starting URL (placed on worker 0's queue)
+     * @param num_shards Number of visited-set shards (rounded up to a power of two)
+     * @param num_workers Number of per-worker queues
+     * @param visited_options Visited-set backend for every shard
+     * @param host_policy Per-host connection limit and crawl delay
+     * @param spill_options In-memory URL cap and segment directory
      */
-    void init(const std::string& seed_url);
-    
+    void init(const std::string& seed_url, size_t num_shards = 16,
+              size_t num_workers = 1,
+              const VisitedSetOptions& visited_options = VisitedSetOptions(),
+              const HostPolicy& host_policy = HostPolicy(),
+              const FrontierSpillOptions& spill_options = FrontierSpillOptions());
+
+    /**
+     * Log every admitted URL to a journal (call before init)
+     * @param journal Journal receiving admissions, or nullptr
+     */
+    void set_journal(CrawlJournal* journal);
+
+    /**
+     * Called with the host key of every host the frontier queues for the
+     * first time, and the URL that brought it, under its partition lock:
+     * must be quick and must not call back into the frontier (add_task()
+     * excepted)
+     */
+    using HostCallback = std::function<void(std::string_view host, std::string_view url)>;
+
+    /**
+     * Report new hosts, e.g. to resolve them ahead of their first fetch (call before init)
+     * @param callback Receives new host keys, or empty
+     */
+    void set_new_host_callback(HostCallback callback);
+
+    /**
+     * Called once, with the message, when visited-set or frontier spill
+     * I/O fails; the URLs involved are dropped and the crawl should stop.
+     * May run under frontier locks: must not call back into the frontier
+     */
+    using ErrorCallback = std::function<void(const std::string& error)>;
+
+    /**
+     * Report spill failures (call before init)
+     * @param callback Receives the first error, or empty
+     */
+    void set_error_callback(ErrorCallback callback);
+
+    /**
+     * Re-admit URLs replayed from a journal (call after init)
+     * Every URL is marked visited; those not in completed are queued
+     * again. Nothing is logged, the journal already holds them
+     * @param entries Admitted URLs (moved from)
+     * @param completed Fingerprints of URLs that finished
+     * @return Number of URLs queued
+     */
+    size_t restore(std::vector<FrontierEntry>& entries,
+                   const std::unordered_set<uint64_t>& completed);
+
     /**
      * Try to dequeue next URL to crawl
-     * @param url Output parameter for dequeued URL
-     * @return true if URL was dequeued, false if queue empty
+     * Pops the worker's own partition, otherwise takes from a peer.
+     * The URL counts against its host's limits until release_host()
+     * @param entry Output parameter for dequeued URL
+     * @param worker_id Partition owned by the caller
+     * @param wait_ms Set to the time until a held-back host becomes ready (-1 if none)
+     * @return true if URL was dequeued, false if no host is ready
+     */
+    bool try_dequeue(FrontierEntry& entry, size_t worker_id, int64_t& wait_ms);
+
+    /**
+     * Record that a dequeued URL's fetch finished so its host may fetch again
+     * @param url URL returned by try_dequeue()
+     * @param http_code Response status (0 if the transfer failed)
+     * @return Partition owning the host if it can fetch again now, -1 otherwise
+     */
+    int release_host(const std::string& url, long http_code);
+
+    /**
+     * Attach robots.txt rules to a host (see HostScheduler::set_robots)
+     * Queued URLs the rules disallow are dropped but stay outstanding:
+     * call complete_task() once for each
+     * @param host Host key
+     * @param rules Compiled rules
+     * @return Number of queued URLs dropped
+     */
+    size_t set_robots(std::string_view host, std::shared_ptr<const RobotsRules> rules);
+
+    /**
+     * Count work that is not a queued URL (e.g. a robots.txt fetch) as
+     * outstanding until its complete_task()
      */
-    bool try_dequeue(std::string& url);
-    
+    void add_task();
+
     /**
      * Add URL if not visited
      * @param url URL to add
+     * @param depth Link distance from the seed
      * @return true if added, false if already visited
      */
-    bool add_if_not_visited(const std::string& url);
-    
+    bool add_if_not_visited(const std::string& url, uint32_t depth = 0);
+
     /**
      * Check if has work available
      * @return true if there are URLs to process
      */
     bool has_work() const;
-    
+
     /**
      * Get current queue size (for stats)
      * @return Number of URLs in queue
      */
     size_t queue_size() const;
-    
+
     /**
      * Get number of visited URLs (for stats)
      * @return Number of visited URLs
      */
     size_t visited_count() const;
-    
+
     /**
      * Signal that crawling is complete
      */
     void mark_done();
-    
+
     /**
      * Batch enqueue multiple URLs (called from parser)
-     * @param urls Vector of URLs to enqueue
+     * Groups URLs by shard and takes each shard lock once, then hands
+     * the admitted URLs to their host partitions, one lock per partition
+     * @param urls Vector of URLs to enqueue; admitted ones are moved out
+     * @param depth Link distance from the seed
+     * @param priorities Per-URL priority (higher first); empty for all zero
+     * @return Number of URLs actually added (not counting robots.txt refusals)
+     */
+    int batch_enqueue(std::vector<std::string>& urls, uint32_t depth = 0,
+                      const std::vector<float>& priorities = std::vector<float>());
+
+    /**
+     * Batch enqueue URLs whose fingerprints the caller already computed
+     * @param urls Vector of URLs to enqueue; admitted ones are moved out
+     * @param fingerprints Hash64 of each URL
+     * @param depth Link distance from the seed
+     * @param priorities Per-URL priority (higher first); empty for all zero
      * @return Number of URLs actually added
      */
-    int batch_enqueue(const std::vector<std::string>& urls);
+    int batch_enqueue(std::vector<std::string>& urls, const std::vector<uint64_t>& fingerprints,
+                      uint32_t depth, const std::vector<float>& priorities = std::vector<float>());
+
+    /**
+     * Retire one dequeued URL after its page is fully processed
+     * Links found on the page must be enqueued before this call
+     * @return true if this was the last outstanding URL (crawl ran dry)
+     */
+    bool complete_task();
+
+    /**
+     * Get number of URLs admitted but not yet completed (for stats)
+     */
+    long outstanding_count() const;
+
+    /**
+     * Get number of shards
+     */
+    size_t shard_count() const;
+
+    /**
+     * Snapshot per-shard sizes and lock contention counters (for stats)
+     */
+    std::vector<FrontierShardStats> shard_stats() const;
+
+    /**
+     * Snapshot per-partition queue sizes, hosts and steal counters (for stats)
+     */
+    std::vector<FrontierQueueStats> queue_stats() const;
+
+    /**
+     * Hosts with transfers in flight, across all partitions (for stats)
+     * Holds each partition lock only to copy its busy hosts
+     */
+    std::vector<HostLoad> host_loads() const;
+
+    /**
+     * Visited-set backend in use
+     */
+    VisitedBackend visited_backend() const;
 
 private:
-    std::queue<std::string> to_visit;
-    std::unordered_set<std::string> visited;
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unique_ptr<VisitedSet> visited;
+        std::atomic<size_t> visited_count{0};
+        std::atomic<uint64_t> lock_acquisitions{0};
+        std::atomic<uint64_t> lock_contended{0};
+    };
+
+    // Hosts are owned by one partition, so their limits hold no matter
+    // which worker fetches their URLs
+    // The spill has its own lock so segment I/O never blocks dequeues
+    struct alignas(64) Partition {
+        mutable std::mutex mutex;
+        HostScheduler scheduler;
+        mutable std::mutex spill_mutex;
+        std::unique_ptr<FrontierSpill> spill;   // Null without a spill directory
+        std::atomic<size_t> spilled{0};     // URLs in the spill
+        std::atomic<size_t> size{0};        // In scheduler + spilled; lock-free emptiness check
+        std::atomic<uint64_t> steals{0};
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t num_shards_ = 0;
+    size_t shard_mask = 0;
+    std::unique_ptr<Partition[]> partitions;
+    size_t num_partitions = 0;
+    size_t hot_limit = 0;               // URLs per partition scheduler (0 = unlimited)
+    CrawlJournal* journal = nullptr;
+    HostCallback on_new_host;
+    ErrorCallback on_error;
+    std::atomic<bool> spill_failed{false};
     std::atomic<bool> is_done{false};
     std::atomic<size_t> queue_size_{0};
-    
-    // Minimal lock - ONLY protects the queue operations
-    std::mutex queue_mutex;
+    std::atomic<size_t> visited_size_{0};
+    std::atomic<long> outstanding{0};
+    VisitedBackend backend = VisitedBackend::Fingerprint;
+
+    /**
+     * Pick the shard owning a URL fingerprint
+     */
+    size_t shard_for(uint64_t fingerprint) const;
+
+    /**
+     * Lock a shard, recording whether and how long we had to wait
+     */
+    std::unique_lock<std::mutex> lock_shard(Shard& shard);
+
+    /**
+     * Lock a partition's scheduler, recording how long we had to wait
+     */
+    static std::unique_lock<std::mutex> lock_partition(Partition& partition);
+
+    /**
+     * Insert into a locked shard's visited set
+     * @return true if the URL was new
+     */
+    bool insert_locked(Shard& shard, const std::string& url, uint64_t fingerprint);
+
+    /**
+     * Record a spill failure and pass the first one to on_error
+     */
+    void report_error(const std::exception& error);
+
+    /**
+     * Pick the partition owning a host
+     */
+    size_t partition_for(std::string_view host) const;
+
+    /**
+     * Hand admitted URLs to one partition under one lock
+     * @param log Append them to the journal (if one is set)
+     * @return Number of URLs refused by their host's robots.txt
+     */
+    size_t push_urls(size_t partition_id, std::vector<FrontierEntry>& entries, bool log = true);
+
+    /**
+     * Move one spilled block back into a partition's scheduler
+     * Skips the refill if another thread is already doing one
+     * @return true if URLs were moved
+     */
+    bool refill_partition(Partition& partition);
+
+    /**
+     * Pop a ready URL from one partition
+     * @param next_ready_ms Lowered to the partition's next-ready time
+     */
+    bool pop_partition(Partition& partition, FrontierEntry& entry, int64_t now_ms,
+                       int64_t& next_ready_ms);
 };
 
 #endif // URL_FRONTIER_H
@@ -60,6 +60,12 @@ std::string get_timestamp();
  */
 std::string format_size(size_t bytes);
 
+/**
+ * Create a directory unless it exists (the parent must exist)
+ * @return true if dir is now a directory we can create files in
+ */
+bool ensure_directory(const std::string& dir);
+
 }  // namespace Utils
 
 #endif // UTILS_H
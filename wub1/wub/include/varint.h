@@ -0,0 +1,45 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+/**
+ * LEB128 variable-length integers for the on-disk formats
+ * (frontier segments, crawl journal)
+ */
+namespace Varint {
+
+/**
+ * Append a value, 7 bits per byte
+ */
+inline void put(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * Read a value and advance p
+ * @throws std::runtime_error if the value runs past end
+ */
+inline uint64_t get(const uint8_t*& p, const uint8_t* end) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (p < end && shift < 64) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+        shift += 7;
+    }
+    throw std::runtime_error("truncated varint");
+}
+
+}  // namespace Varint
+
+#endif // VARINT_H
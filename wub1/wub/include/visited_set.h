@@ -0,0 +1,86 @@
+#ifndef VISITED_SET_H
+#define VISITED_SET_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Visited-set storage strategies
+ */
+enum class VisitedBackend {
+    Exact,          // unordered_set of full URLs (~100+ bytes per URL)
+    Fingerprint,    // Open-addressing table of 64-bit URL hashes (~11-16 bytes per URL)
+    Bloom           // Scalable Bloom filter, configurable false-positive rate (~2-3 bytes per URL)
+};
+
+/**
+ * Visited-set settings (per frontier, divided across shards)
+ */
+struct VisitedSetOptions {
+    VisitedBackend backend = VisitedBackend::Fingerprint;
+    double false_positive_rate = 1e-4;  // Bloom: target rate while within capacity
+    size_t expected_urls = 1000000;     // Bloom: initial sizing; grows past it
+    std::string spill_dir;              // Fingerprint: spill sorted runs here when over budget
+    size_t memory_budget_mb = 0;        // Fingerprint: in-memory cap (0 = unlimited, no spill)
+};
+
+/**
+ * Set of seen URLs used by URLFrontier admission
+ * Not thread-safe: each frontier shard owns one and calls it under its lock.
+ * Callers pass the URL together with its Hash64 fingerprint so it is
+ * hashed once per admission
+ */
+class VisitedSet {
+public:
+    virtual ~VisitedSet() = default;
+
+    /**
+     * Record a URL
+     * @param url Normalized URL
+     * @param fingerprint Hash64::hash(url)
+     * @return true if the URL was not seen before (Bloom: definitely new)
+     * @throws std::runtime_error if a spill fails (the URL is not recorded;
+     *         the set stops spilling and stays usable)
+     */
+    virtual bool insert(std::string_view url, uint64_t fingerprint) = 0;
+
+    /**
+     * Number of URLs recorded
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * Heap bytes held by this set
+     */
+    virtual size_t memory_bytes() const = 0;
+
+    /**
+     * Bytes written to disk (spilling backends only)
+     */
+    virtual size_t disk_bytes() const { return 0; }
+
+    /**
+     * Create a backend
+     * @param options Settings for the whole frontier
+     * @param shard_id Shard index (names spill files)
+     * @param num_shards Shard count (capacity and budget are split evenly)
+     */
+    static std::unique_ptr<VisitedSet> create(const VisitedSetOptions& options,
+                                              size_t shard_id, size_t num_shards);
+
+    /**
+     * Printable backend name ("exact", "fingerprint", "bloom")
+     */
+    static const char* backend_name(VisitedBackend backend);
+
+    /**
+     * Parse a backend name
+     * @return false if the name is unknown
+     */
+    static bool parse_backend(const std::string& name, VisitedBackend& backend);
+};
+
+#endif // VISITED_SET_H
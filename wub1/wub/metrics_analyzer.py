@@ -2,14 +2,17 @@
 """
 Web Crawler Metrics Analyzer (Pure Python)
 Generates text-based metrics and simple HTML visualization
+
+Usage: metrics_analyzer.py [metrics.csv]   (default build/metrics.csv)
 """
 
 import csv
+import sys
 from pathlib import Path
 from statistics import mean, stdev
 
 # Read metrics
-csv_file = Path('build/metrics.csv')
+csv_file = Path(sys.argv[1]) if len(sys.argv) > 1 else Path('build/metrics.csv')
 if not csv_file.exists():
     print(f"Error: {csv_file} not found")
     exit(1)
@@ -55,6 +58,27 @@ print(f"Average crawl time:      {mean(r['total_ms'] for r in data) / 1000:.2f}
 
 print()
 
+# Seeds crawled with more than one thread count (e.g. bench/scaling.sh)
+scaling = {}
+for row in data:
+    scaling.setdefault(row['seed_url'], {}).setdefault(row['num_threads'], []).append(row['throughput'])
+scaling = {seed: runs for seed, runs in scaling.items() if len(runs) > 1}
+
+if scaling:
+    print("=" * 70)
+    print("THROUGHPUT BY THREAD COUNT".center(70))
+    print("=" * 70)
+    for seed, runs in scaling.items():
+        base = mean(runs[min(runs)])
+        print(seed)
+        print(f"  {'Threads':<8} {'Runs':<6} {'Mean (p/s)':<12} {'Stdev':<10} {'Speedup':<8}")
+        for threads in sorted(runs):
+            values = runs[threads]
+            spread = stdev(values) if len(values) > 1 else 0.0
+            print(f"  {threads:<8} {len(values):<6} {mean(values):<12.2f} {spread:<10.2f} "
+                  f"{mean(values) / base:.2f}x")
+    print()
+
 # Generate HTML report
 html_content = """<!DOCTYPE html>
 <html>
@@ -178,7 +202,35 @@ for row in data:
 
 html_content += """            </div>
         </div>
-        
+"""
+
+if scaling:
+    html_content += """
+        <h2>📈 Throughput vs Threads</h2>
+        <div class="chart-row">
+"""
+    for seed, runs in scaling.items():
+        base = mean(runs[min(runs)])
+        best = max(mean(values) for values in runs.values())
+        html_content += f"""            <div class="chart">
+                <h3><code>{seed}</code></h3>
+"""
+        for threads in sorted(runs):
+            value = mean(runs[threads])
+            percentage = (value / best) * 100
+            html_content += f"""                <div class="bar-chart-item">
+                    <div class="bar-label">{threads} thread(s)</div>
+                    <div class="bar-container">
+                        <div class="bar-fill" style="width: {percentage}%;">{value:.1f} ({value / base:.2f}x)</div>
+                    </div>
+                </div>
+"""
+        html_content += """            </div>
+"""
+    html_content += """        </div>
+"""
+
+html_content += """        
         <div class="footer">
             <p>Report generated from metrics.csv | Web Crawler Performance Analysis</p>
         </div>
@@ -188,7 +240,7 @@ html_content += """            </div>
 """
 
 # Save HTML
-html_file = Path('build/metrics_report.html')
+html_file = csv_file.with_name('metrics_report.html')
 with open(html_file, 'w') as f:
     f.write(html_content)
 
@@ -196,5 +248,5 @@ print(f"✓ HTML report saved to: {html_file}")
 print()
 print("=" * 70)
 print("To view the report in your browser:")
-print(f"  open build/metrics_report.html")
+print(f"  open {html_file}")
 print("=" * 70)
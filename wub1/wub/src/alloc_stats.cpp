@@ -0,0 +1,96 @@
+#include "alloc_stats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Slots are shared by threads whose index collides; 64 covers the
+// thread counts the crawler runs with
+const unsigned SLOTS = 64;
+
+struct alignas(64) Slot {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> bytes;
+};
+
+// Zero-initialized static storage: usable before any constructor runs
+Slot slots[SLOTS];
+std::atomic<unsigned> next_slot{0};
+
+// Plain integer so the TLS access needs no initialization guard
+thread_local unsigned thread_slot = SLOTS;
+
+inline Slot& my_slot() {
+    if (thread_slot == SLOTS) {
+        thread_slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOTS;
+    }
+    return slots[thread_slot];
+}
+
+void* counted_alloc(std::size_t size) {
+    if (size == 0) {
+        size = 1;
+    }
+    while (true) {
+        void* p = std::malloc(size);
+        if (p) {
+            Slot& slot = my_slot();
+            slot.allocations.fetch_add(1, std::memory_order_relaxed);
+            slot.bytes.fetch_add(size, std::memory_order_relaxed);
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            return nullptr;
+        }
+        handler();
+    }
+}
+
+void counted_free(void* p) {
+    if (p) {
+        my_slot().frees.fetch_add(1, std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+}  // namespace
+
+AllocStats AllocStats::snapshot() {
+    AllocStats total;
+    for (const Slot& slot : slots) {
+        total.allocations += slot.allocations.load(std::memory_order_relaxed);
+        total.frees += slot.frees.load(std::memory_order_relaxed);
+        total.bytes += slot.bytes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// Replacing these four covers the array and sized forms too: their
+// default definitions forward here. Over-aligned allocations keep the
+// library's own versions and are not counted
+void* operator new(std::size_t size) {
+    void* p = counted_alloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted_alloc(size);
+    } catch (...) {
+        return nullptr;         // A new_handler may throw
+    }
+}
+
+void operator delete(void* p) noexcept {
+    counted_free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    counted_free(p);
+}
@@ -0,0 +1,815 @@
+#include "cluster_node.h"
+#include "hash64.h"
+#include "varint.h"
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+// Hosts are spread over nodes by a different hash than the one that picks
+// their frontier partition, or each node would fill only some partitions
+const uint64_t OWNER_SEED = 0x2545f4914f6cdd1dULL;
+
+// Graph frames are cut at about this many payload bytes
+const size_t GRAPH_CHUNK_BYTES = 1 << 20;
+
+// A longer frame means the stream is broken
+const uint32_t MAX_FRAME_BYTES = 64u << 20;
+
+const size_t FRAME_HEADER_BYTES = 5;
+const int CONNECT_RETRY_MS = 100;
+
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool send_all(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Frame header (u32 little-endian payload length, u8 type), then the payload
+bool send_frame(int fd, uint8_t type, const std::vector<uint8_t>& payload) {
+    uint8_t header[FRAME_HEADER_BYTES];
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    for (int i = 0; i < 4; i++) {
+        header[i] = static_cast<uint8_t>(size >> (8 * i));
+    }
+    header[4] = type;
+    return send_all(fd, header, sizeof(header)) && send_all(fd, payload.data(), payload.size());
+}
+
+// IPv4 address of a "host:port" entry
+bool resolve(const std::string& address, sockaddr_in& out) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+        return false;
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result) {
+        return false;
+    }
+    std::memcpy(&out, result->ai_addr, sizeof(out));
+    freeaddrinfo(result);
+    return true;
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint32_t get_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+void put_float(std::vector<uint8_t>& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put_u32(out, bits);
+}
+
+float get_float(const uint8_t*& p, const uint8_t* end) {
+    if (end - p < 4) {
+        throw std::runtime_error("truncated frame");
+    }
+    uint32_t bits = get_u32(p);
+    p += 4;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void put_string(std::vector<uint8_t>& out, std::string_view value) {
+    Varint::put(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+std::string_view get_string(const uint8_t*& p, const uint8_t* end) {
+    uint64_t size = Varint::get(p, end);
+    if (size > static_cast<uint64_t>(end - p)) {
+        throw std::runtime_error("truncated frame");
+    }
+    std::string_view value(reinterpret_cast<const char*>(p), static_cast<size_t>(size));
+    p += size;
+    return value;
+}
+
+}  // namespace
+
+/**
+ * Outgoing side of one peer
+ */
+struct ClusterNode::Peer {
+    std::mutex write_mutex;         // Guards fd and unreachable; one frame at a time
+    int fd = -1;
+    bool unreachable = false;       // Gave up connecting; links for it are dropped
+    std::mutex batch_mutex;
+    std::vector<uint8_t> batch;     // Encoded links not sent yet
+    uint64_t batch_urls = 0;
+};
+
+/**
+ * Incoming connection, only touched by the receiver thread
+ */
+struct ClusterNode::Connection {
+    int fd = -1;
+    int node = -1;                  // From its Hello frame
+    std::vector<uint8_t> in;        // Bytes read that don't make a whole frame yet
+    bool closed = false;
+};
+
+ClusterNode::ClusterNode() = default;
+
+ClusterNode::~ClusterNode() {
+    stop();
+}
+
+bool ClusterNode::parse_nodes(const std::string& list, std::vector<std::string>& nodes) {
+    nodes.clear();
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        std::string entry = list.substr(pos, comma - pos);
+        size_t colon = entry.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == entry.size() ||
+            entry.find_first_not_of("0123456789", colon + 1) != std::string::npos) {
+            return false;
+        }
+        nodes.push_back(entry);
+        pos = comma + 1;
+    }
+    return !nodes.empty();
+}
+
+void ClusterNode::listen(const std::vector<std::string>& nodes, int self) {
+    if (self < 0 || static_cast<size_t>(self) >= nodes.size()) {
+        throw std::runtime_error("cluster node id out of range");
+    }
+    sockaddr_in addr{};
+    if (!resolve(nodes[self], addr)) {
+        throw std::runtime_error("cannot resolve cluster address " + nodes[self]);
+    }
+
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("cannot create cluster socket: ") + std::strerror(errno));
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, 64) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("cannot listen on " + nodes[self] + ": " + std::strerror(error));
+    }
+    addresses = nodes;
+    self_id = self;
+    listen_fd = fd;
+
+    // Links may be sent as soon as the crawl threads run, before start()
+    peers.reset(new Peer[addresses.size()]);
+    reports.assign(addresses.size(), Report());
+}
+
+void ClusterNode::start(UrlSink url_sink, StatusProbe status_probe, StopHandler stop_handler,
+                        uint64_t page_limit) {
+    if (!enabled() || running.load()) {
+        return;
+    }
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        throw std::runtime_error("cannot start cluster node: eventfd failed");
+    }
+    sink = std::move(url_sink);
+    probe = std::move(status_probe);
+    on_stop = std::move(stop_handler);
+    max_pages = page_limit;
+    last_wave.clear();
+    last_wave_balanced = false;
+    graph_frames.assign(addresses.size(), {});
+    graph_done.assign(addresses.size(), false);
+
+    running.store(true);
+    receiver = std::thread(&ClusterNode::run_receiver, this);
+    sender = std::thread(&ClusterNode::run_sender, this);
+}
+
+void ClusterNode::detach_sink() {
+    std::lock_guard<std::mutex> lock(sink_mutex);
+    sink = nullptr;
+}
+
+void ClusterNode::stop() {
+    if (running.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(sender_mutex);
+            sender_cv.notify_all();
+        }
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+        sender.join();
+        receiver.join();
+        for (size_t node = 0; node < addresses.size(); node++) {
+            if (peers[node].fd >= 0) {
+                ::close(peers[node].fd);
+                peers[node].fd = -1;
+            }
+        }
+        ::close(wake_fd);
+        wake_fd = -1;
+    }
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+    }
+}
+
+int ClusterNode::owner(std::string_view host) const {
+    return static_cast<int>(Hash64::mix(Hash64::hash(host) ^ OWNER_SEED) % addresses.size());
+}
+
+void ClusterNode::send(int node, std::string_view url, uint32_t depth, float priority) {
+    if (stopped.load()) {
+        return;
+    }
+    // Counted before it can arrive, so the receiver never runs ahead
+    urls_sent.fetch_add(1);
+    Peer& peer = peers[node];
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(peer.batch_mutex);
+        Varint::put(peer.batch, depth);
+        put_float(peer.batch, priority);
+        put_string(peer.batch, url);
+        full = ++peer.batch_urls >= BATCH_URLS;
+    }
+    if (full) {
+        std::lock_guard<std::mutex> lock(sender_mutex);
+        flush_now = true;
+        sender_cv.notify_one();
+    }
+}
+
+bool ClusterNode::write_frame(int node, Frame type, const std::vector<uint8_t>& payload) {
+    Peer& peer = peers[node];
+    std::lock_guard<std::mutex> lock(peer.write_mutex);
+    if (peer.unreachable) {
+        return false;
+    }
+
+    if (peer.fd < 0) {
+        sockaddr_in addr{};
+        bool resolved = resolve(addresses[node], addr);
+        int64_t deadline = steady_now_ms() + CONNECT_TIMEOUT_MS;
+        while (resolved && running.load()) {
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                peer.fd = fd;
+                break;
+            }
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            if (steady_now_ms() >= deadline) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_MS));
+        }
+        if (peer.fd < 0) {
+            peer.unreachable = true;
+            std::cerr << "[ERROR] Cluster node " << node << " (" << addresses[node]
+                      << ") is unreachable; links for it are dropped" << std::endl;
+            return false;
+        }
+        int one = 1;
+        setsockopt(peer.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        // Introduce ourselves: the peer learns which node this stream is from
+        std::vector<uint8_t> hello;
+        Varint::put(hello, static_cast<uint64_t>(self_id));
+        Varint::put(hello, addresses.size());
+        if (!send_frame(peer.fd, static_cast<uint8_t>(Frame::Hello), hello)) {
+            ::close(peer.fd);
+            peer.fd = -1;
+            peer.unreachable = true;
+            return false;
+        }
+        bytes_sent.fetch_add(FRAME_HEADER_BYTES + hello.size(), std::memory_order_relaxed);
+    }
+
+    if (!send_frame(peer.fd, static_cast<uint8_t>(type), payload)) {
+        std::cerr << "[ERROR] Lost connection to cluster node " << node << " ("
+                  << addresses[node] << ")" << std::endl;
+        ::close(peer.fd);
+        peer.fd = -1;
+        peer.unreachable = true;
+        return false;
+    }
+    bytes_sent.fetch_add(FRAME_HEADER_BYTES + payload.size(), std::memory_order_relaxed);
+    return true;
+}
+
+void ClusterNode::flush_peer(int node) {
+    Peer& peer = peers[node];
+    std::vector<uint8_t> payload;
+    uint64_t count;
+    {
+        std::lock_guard<std::mutex> lock(peer.batch_mutex);
+        if (peer.batch_urls == 0) {
+            return;
+        }
+        count = peer.batch_urls;
+        payload.reserve(peer.batch.size() + 10);
+        Varint::put(payload, count);
+        payload.insert(payload.end(), peer.batch.begin(), peer.batch.end());
+        peer.batch.clear();
+        peer.batch_urls = 0;
+    }
+    if (write_frame(node, Frame::Urls, payload)) {
+        batches_sent.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // Never going to arrive: take them out of the balance
+        urls_dropped.fetch_add(count);
+        urls_sent.fetch_sub(count);
+    }
+}
+
+ClusterNode::Report ClusterNode::local_report() {
+    Report report;
+    report.received = urls_received.load();
+    probe(report.idle, report.pages);
+    report.sent = urls_sent.load();
+    return report;
+}
+
+void ClusterNode::check_termination() {
+    bool done = false;
+    uint64_t pages = 0;
+    {
+        std::lock_guard<std::mutex> lock(report_mutex);
+        Report own = local_report();
+        own.sequence = reports[0].sequence + 1;
+        reports[0] = own;
+
+        bool all_reported = true;
+        for (const Report& report : reports) {
+            all_reported = all_reported && report.sequence > 0;
+            pages += report.pages;
+        }
+        if (max_pages > 0 && pages >= max_pages) {
+            done = true;
+        } else if (all_reported) {
+            // A wave is complete once every node reported again since the last
+            bool wave = true;
+            for (size_t i = 0; i < reports.size() && !last_wave.empty(); i++) {
+                wave = wave && reports[i].sequence > last_wave[i].sequence;
+            }
+            if (wave) {
+                bool balanced = true;
+                bool unchanged = !last_wave.empty();
+                uint64_t sent = 0;
+                uint64_t received = 0;
+                for (size_t i = 0; i < reports.size(); i++) {
+                    balanced = balanced && reports[i].idle;
+                    sent += reports[i].sent;
+                    received += reports[i].received;
+                    unchanged = unchanged && reports[i].sent == last_wave[i].sent &&
+                                reports[i].received == last_wave[i].received;
+                }
+                balanced = balanced && sent == received;
+                done = balanced && last_wave_balanced && unchanged;
+                last_wave = reports;
+                last_wave_balanced = balanced;
+            }
+        }
+    }
+    if (done) {
+        std::cout << "[CLUSTER] Crawl finished: " << pages << " pages on "
+                  << addresses.size() << " nodes" << std::endl;
+        finish(true);
+    }
+}
+
+void ClusterNode::finish(bool broadcast) {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        if (stopped.exchange(true)) {
+            return;
+        }
+    }
+    if (broadcast) {
+        std::vector<uint8_t> empty;
+        for (size_t node = 0; node < addresses.size(); node++) {
+            if (static_cast<int>(node) != self_id) {
+                write_frame(static_cast<int>(node), Frame::Stop, empty);
+            }
+        }
+    }
+    stop_cv.notify_all();
+    if (on_stop) {
+        on_stop();
+    }
+}
+
+void ClusterNode::wait_stop() {
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    stop_cv.wait(lock, [this]() { return stopped.load(); });
+}
+
+void ClusterNode::run_sender() {
+    int64_t next_status = 0;
+    std::vector<uint8_t> payload;
+    while (running.load()) {
+        {
+            std::unique_lock<std::mutex> lock(sender_mutex);
+            sender_cv.wait_for(lock, std::chrono::milliseconds(FLUSH_MS),
+                               [this]() { return flush_now || !running.load(); });
+            flush_now = false;
+        }
+        if (!running.load()) {
+            break;
+        }
+        for (size_t node = 0; node < addresses.size(); node++) {
+            if (static_cast<int>(node) != self_id) {
+                flush_peer(static_cast<int>(node));
+            }
+        }
+
+        int64_t now = steady_now_ms();
+        if (now < next_status || stopped.load()) {
+            continue;
+        }
+        next_status = now + STATUS_MS;
+        if (coordinator()) {
+            check_termination();
+            continue;
+        }
+        Report report = local_report();
+        payload.clear();
+        Varint::put(payload, static_cast<uint64_t>(self_id));
+        payload.push_back(report.idle ? 1 : 0);
+        Varint::put(payload, report.sent);
+        Varint::put(payload, report.received);
+        Varint::put(payload, report.pages);
+        if (!write_frame(0, Frame::Status, payload)) {
+            std::cerr << "[ERROR] Cluster coordinator unreachable; stopping" << std::endl;
+            finish(false);
+        }
+    }
+}
+
+void ClusterNode::dispatch(Connection& connection, Frame type, const uint8_t* p,
+                           const uint8_t* end) {
+    if (type != Frame::Hello && connection.node < 0) {
+        throw std::runtime_error("frame before hello");
+    }
+    switch (type) {
+    case Frame::Hello: {
+        uint64_t node = Varint::get(p, end);
+        uint64_t size = Varint::get(p, end);
+        if (size != addresses.size() || node >= size) {
+            throw std::runtime_error("node list differs from ours");
+        }
+        connection.node = static_cast<int>(node);
+        break;
+    }
+    case Frame::Urls: {
+        // Runs of equal depth go to the sink together
+        std::lock_guard<std::mutex> sink_lock(sink_mutex);
+        uint64_t count = Varint::get(p, end);
+        if (!sink) {
+            urls_received.fetch_add(count);     // Detached: the local crawl is over
+            break;
+        }
+        std::vector<std::string> urls;
+        std::vector<float> priorities;
+        uint32_t run_depth = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            uint32_t depth = static_cast<uint32_t>(Varint::get(p, end));
+            float priority = get_float(p, end);
+            std::string_view url = get_string(p, end);
+            if (!urls.empty() && depth != run_depth) {
+                sink(urls, run_depth, priorities);
+                urls.clear();
+                priorities.clear();
+            }
+            run_depth = depth;
+            urls.emplace_back(url);
+            priorities.push_back(priority);
+        }
+        if (!urls.empty()) {
+            sink(urls, run_depth, priorities);
+        }
+        // Only now: a report must not count links that aren't queued yet
+        urls_received.fetch_add(count);
+        break;
+    }
+    case Frame::Status: {
+        if (!coordinator()) {
+            throw std::runtime_error("status sent to a node other than 0");
+        }
+        Report report;
+        uint64_t node = Varint::get(p, end);
+        if (p >= end || node >= addresses.size()) {
+            throw std::runtime_error("bad status frame");
+        }
+        report.idle = *p++ != 0;
+        report.sent = Varint::get(p, end);
+        report.received = Varint::get(p, end);
+        report.pages = Varint::get(p, end);
+        std::lock_guard<std::mutex> lock(report_mutex);
+        report.sequence = reports[node].sequence + 1;
+        reports[node] = report;
+        break;
+    }
+    case Frame::Stop:
+        finish(false);
+        break;
+    case Frame::GraphNames:
+    case Frame::GraphLinks: {
+        std::lock_guard<std::mutex> lock(graph_mutex);
+        graph_frames[connection.node].emplace_back(type, std::vector<uint8_t>(p, end));
+        break;
+    }
+    case Frame::GraphEnd: {
+        // Kept as the marker of a whole graph (an empty one has nothing else)
+        std::lock_guard<std::mutex> lock(graph_mutex);
+        graph_frames[connection.node].emplace_back(type, std::vector<uint8_t>());
+        graph_done[connection.node] = true;
+        graph_cv.notify_all();
+        break;
+    }
+    default:
+        throw std::runtime_error("unknown frame type");
+    }
+}
+
+void ClusterNode::run_receiver() {
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::vector<pollfd> fds;
+    std::vector<uint8_t> chunk(64 * 1024);
+
+    while (running.load()) {
+        fds.clear();
+        fds.push_back(pollfd{wake_fd, POLLIN, 0});
+        fds.push_back(pollfd{listen_fd, POLLIN, 0});
+        for (const auto& connection : connections) {
+            fds.push_back(pollfd{connection->fd, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            continue;                   // EINTR
+        }
+        if (!running.load()) {
+            break;
+        }
+
+        size_t polled = connections.size();
+        if (fds[1].revents & POLLIN) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                auto connection = std::make_unique<Connection>();
+                connection->fd = fd;
+                connections.push_back(std::move(connection));
+            }
+        }
+
+        for (size_t i = 0; i < polled; i++) {
+            if (!fds[i + 2].revents) {
+                continue;
+            }
+            Connection& connection = *connections[i];
+            ssize_t got = ::read(connection.fd, chunk.data(), chunk.size());
+            if (got < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            if (got <= 0) {
+                connection.closed = true;
+            } else {
+                bytes_received.fetch_add(static_cast<uint64_t>(got), std::memory_order_relaxed);
+                connection.in.insert(connection.in.end(), chunk.begin(), chunk.begin() + got);
+
+                // Handle every whole frame; keep a partial one for the next read
+                size_t pos = 0;
+                try {
+                    while (connection.in.size() - pos >= FRAME_HEADER_BYTES) {
+                        uint32_t size = get_u32(connection.in.data() + pos);
+                        if (size > MAX_FRAME_BYTES) {
+                            throw std::runtime_error("oversized frame");
+                        }
+                        if (connection.in.size() - pos - FRAME_HEADER_BYTES < size) {
+                            break;
+                        }
+                        const uint8_t* body = connection.in.data() + pos + FRAME_HEADER_BYTES;
+                        dispatch(connection, static_cast<Frame>(connection.in[pos + 4]), body,
+                                 body + size);
+                        pos += FRAME_HEADER_BYTES + size;
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "[WARNING] Dropping cluster connection from node "
+                              << connection.node << ": " << e.what() << std::endl;
+                    connection.closed = true;
+                }
+                connection.in.erase(connection.in.begin(), connection.in.begin() + pos);
+            }
+
+            if (connection.closed) {
+                if (connection.node == 0 && !coordinator() && !stopped.load()) {
+                    std::cerr << "[ERROR] Lost the cluster coordinator; stopping" << std::endl;
+                    finish(false);
+                }
+                if (connection.node >= 0) {
+                    // A graph cut short is no use: unblock gather() without it
+                    std::lock_guard<std::mutex> lock(graph_mutex);
+                    if (!graph_done[connection.node] && stopped.load()) {
+                        graph_frames[connection.node].clear();
+                        graph_done[connection.node] = true;
+                        graph_cv.notify_all();
+                    }
+                }
+                ::close(connection.fd);
+            }
+        }
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                         [](const std::unique_ptr<Connection>& c) { return c->closed; }),
+                          connections.end());
+    }
+
+    for (const auto& connection : connections) {
+        ::close(connection->fd);
+    }
+}
+
+void ClusterNode::send_graph(const StorageManager& storage) {
+    const DomainTable& table = storage.domains();
+    const CsrGraph& graph = storage.graph();
+    const std::vector<int>& visits = storage.visit_counts();
+
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> payload;
+    uint64_t count = 0;
+    auto emit = [&](Frame type) {
+        payload.clear();
+        Varint::put(payload, count);
+        payload.insert(payload.end(), body.begin(), body.end());
+        if (!write_frame(0, type, payload)) {
+            throw std::runtime_error("cannot send the graph to cluster node 0");
+        }
+        body.clear();
+        count = 0;
+    };
+
+    // Names first, in ID order: link frames refer to domains by position
+    for (size_t id = 0; id < table.size(); id++) {
+        put_string(body, table.name(static_cast<uint32_t>(id)));
+        count++;
+        if (body.size() >= GRAPH_CHUNK_BYTES) {
+            emit(Frame::GraphNames);
+        }
+    }
+    if (count > 0) {
+        emit(Frame::GraphNames);
+    }
+
+    for (uint32_t v = 0; v < graph.num_nodes(); v++) {
+        int visited = v < visits.size() ? visits[v] : 0;
+        uint64_t degree = graph.out_degree(v);
+        if (visited == 0 && degree == 0) {
+            continue;                   // Destination-only: its name is enough
+        }
+        Varint::put(body, v);
+        Varint::put(body, static_cast<uint64_t>(visited));
+        Varint::put(body, degree);
+        for (uint64_t e = graph.offsets[v]; e < graph.offsets[v + 1]; e++) {
+            Varint::put(body, graph.targets[e]);
+            Varint::put(body, graph.weights.empty() ? 1 : graph.weights[e]);
+        }
+        count++;
+        if (body.size() >= GRAPH_CHUNK_BYTES) {
+            emit(Frame::GraphLinks);
+        }
+    }
+    if (count > 0) {
+        emit(Frame::GraphLinks);
+    }
+
+    payload.clear();
+    if (!write_frame(0, Frame::GraphEnd, payload)) {
+        throw std::runtime_error("cannot send the graph to cluster node 0");
+    }
+}
+
+size_t ClusterNode::gather(StorageManager& storage, int timeout_seconds) {
+    std::vector<std::vector<std::pair<Frame, std::vector<uint8_t>>>> frames(addresses.size());
+    std::vector<bool> done;
+    {
+        std::unique_lock<std::mutex> lock(graph_mutex);
+        graph_cv.wait_for(lock, std::chrono::seconds(timeout_seconds), [this]() {
+            for (size_t node = 0; node < graph_done.size(); node++) {
+                if (static_cast<int>(node) != self_id && !graph_done[node]) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        frames.swap(graph_frames);
+        graph_frames.assign(addresses.size(), {});
+        done = graph_done;
+    }
+
+    size_t merged = 0;
+    std::vector<uint32_t> ids;          // Sender's domain position -> our ID
+    std::vector<WeightedEdge> edges;
+    for (size_t node = 0; node < addresses.size(); node++) {
+        if (static_cast<int>(node) == self_id) {
+            continue;
+        }
+        if (!done[node] || frames[node].empty() || frames[node].back().first != Frame::GraphEnd) {
+            std::cerr << "[WARNING] No graph from cluster node " << node
+                      << "; ranking without it" << std::endl;
+            continue;
+        }
+        ids.clear();
+        try {
+            for (const auto& frame : frames[node]) {
+                if (frame.first == Frame::GraphEnd) {
+                    break;
+                }
+                const uint8_t* p = frame.second.data();
+                const uint8_t* end = p + frame.second.size();
+                uint64_t count = Varint::get(p, end);
+                for (uint64_t i = 0; i < count; i++) {
+                    if (frame.first == Frame::GraphNames) {
+                        ids.push_back(storage.restore_domain(get_string(p, end)));
+                        continue;
+                    }
+                    uint64_t source = Varint::get(p, end);
+                    int visits = static_cast<int>(Varint::get(p, end));
+                    uint64_t degree = Varint::get(p, end);
+                    edges.clear();
+                    for (uint64_t e = 0; e < degree; e++) {
+                        uint64_t target = Varint::get(p, end);
+                        uint32_t weight = static_cast<uint32_t>(Varint::get(p, end));
+                        if (target >= ids.size()) {
+                            throw std::runtime_error("link to an unknown domain");
+                        }
+                        edges.push_back(WeightedEdge{ids[target], weight});
+                    }
+                    if (source >= ids.size()) {
+                        throw std::runtime_error("links of an unknown domain");
+                    }
+                    storage.merge_remote_domain(ids[source], edges, visits);
+                }
+            }
+            merged++;
+        } catch (const std::exception& e) {
+            std::cerr << "[WARNING] Graph from cluster node " << node << " is damaged ("
+                      << e.what() << "); merged in part" << std::endl;
+        }
+        frames[node].clear();
+        frames[node].shrink_to_fit();
+    }
+    return merged;
+}
+
+ClusterStats ClusterNode::stats() const {
+    ClusterStats s;
+    s.urls_sent = urls_sent.load();
+    s.urls_received = urls_received.load();
+    s.urls_dropped = urls_dropped.load();
+    s.batches_sent = batches_sent.load(std::memory_order_relaxed);
+    s.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+    s.bytes_received = bytes_received.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,475 @@
+#include "crawl_journal.h"
+#include "varint.h"
+#include "logger.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Appenders write their buffer out once it reaches this size
+const size_t FLUSH_BYTES = 1 << 20;
+
+const char* MANIFEST_NAME = "MANIFEST";
+const char* MANIFEST_MAGIC = "crawl-journal 1";
+
+// Page log record kinds; RECORD_PAGE (one varint per link) is only
+// read back from older journals, new pages are logged as RECORD_EDGES
+const uint8_t RECORD_PAGE = 1;
+const uint8_t RECORD_DONE = 2;
+const uint8_t RECORD_EDGES = 3;
+
+void write_all(int fd, const uint8_t* p, size_t n, const std::string& path) {
+    while (n > 0) {
+        ssize_t written = ::write(fd, p, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("journal write failed: " + path);
+        }
+        p += written;
+        n -= static_cast<size_t>(written);
+    }
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    uint8_t bytes[sizeof(uint64_t)];
+    std::memcpy(bytes, &value, sizeof(value));
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+void need(const uint8_t* p, const uint8_t* end, size_t n) {
+    if (static_cast<size_t>(end - p) < n) {
+        throw std::runtime_error("truncated journal record");
+    }
+}
+
+}  // namespace
+
+/**
+ * One append-only log with a buffered writer
+ */
+struct CrawlJournal::LogFile {
+    std::string name;
+    std::string path;
+    int fd = -1;
+    size_t file_bytes = 0;      // Written to the file so far
+    size_t valid_bytes = 0;     // Covered by the last manifest
+    std::mutex mutex;
+    std::vector<uint8_t> buffer;
+
+    ~LogFile() {
+        if (fd >= 0) close(fd);
+    }
+
+    void append(const std::vector<uint8_t>& record) {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer.insert(buffer.end(), record.begin(), record.end());
+        if (buffer.size() >= FLUSH_BYTES) {
+            write_locked();
+        }
+    }
+
+    /**
+     * Write the buffer out
+     * @return File length (every record appended before this call)
+     */
+    size_t flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        write_locked();
+        return file_bytes;
+    }
+
+    void write_locked() {
+        write_all(fd, buffer.data(), buffer.size(), path);
+        file_bytes += buffer.size();
+        buffer.clear();
+    }
+};
+
+CrawlJournal::CrawlJournal() = default;
+
+CrawlJournal::~CrawlJournal() {
+    if (timer.joinable()) {
+        stop();
+    }
+}
+
+std::unique_ptr<CrawlJournal::LogFile> CrawlJournal::open_log(const std::string& name,
+                                                              size_t valid_bytes) const {
+    auto log = std::make_unique<LogFile>();
+    log->name = name;
+    log->path = directory + "/" + name;
+    log->fd = ::open(log->path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (log->fd < 0) {
+        throw std::runtime_error("cannot open journal file " + log->path);
+    }
+    // Drop whatever was written after the last checkpoint
+    if (ftruncate(log->fd, static_cast<off_t>(valid_bytes)) != 0 ||
+        lseek(log->fd, 0, SEEK_END) < 0) {
+        throw std::runtime_error("cannot truncate journal file " + log->path);
+    }
+    log->file_bytes = valid_bytes;
+    log->valid_bytes = valid_bytes;
+    return log;
+}
+
+void CrawlJournal::open(const std::string& dir, size_t num_partitions, size_t num_workers,
+                        bool resume) {
+    directory = dir;
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("cannot create journal directory " + dir);
+    }
+
+    // name -> checkpointed length
+    std::map<std::string, size_t> lengths;
+    std::string manifest_path = dir + "/" + MANIFEST_NAME;
+    std::ifstream manifest(manifest_path);
+    if (manifest.is_open()) {
+        if (!resume) {
+            throw std::runtime_error(dir + " already holds a checkpoint; use --resume");
+        }
+        std::string line;
+        std::getline(manifest, line);
+        if (line != MANIFEST_MAGIC) {
+            throw std::runtime_error("unrecognized journal manifest " + manifest_path);
+        }
+        while (std::getline(manifest, line)) {
+            std::istringstream fields(line);
+            std::string key;
+            fields >> key;
+            if (key == "file") {
+                std::string name;
+                size_t bytes = 0;
+                fields >> name >> bytes;
+                lengths[name] = bytes;
+            } else if (key == "domains") {
+                fields >> domains_logged;
+            } else if (key == "pages") {
+                uint64_t pages = 0;
+                fields >> pages;
+                pages_logged.store(pages);
+            } else if (key == "urls") {
+                uint64_t urls = 0;
+                fields >> urls;
+                urls_logged.store(urls);
+            }
+        }
+        loaded = true;
+    } else if (resume) {
+        std::cout << "[WARNING] No checkpoint in " << dir << "; starting a new crawl" << std::endl;
+    }
+
+    auto take = [&lengths](const std::string& name) {
+        auto it = lengths.find(name);
+        size_t bytes = (it != lengths.end()) ? it->second : 0;
+        if (it != lengths.end()) lengths.erase(it);
+        return bytes;
+    };
+
+    domain_log = open_log("domains.log", take("domains.log"));
+    for (size_t i = 0; i < num_partitions; i++) {
+        std::string name = "admit-p" + std::to_string(i) + ".log";
+        admit_logs.push_back(open_log(name, take(name)));
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+        std::string name = "pages-t" + std::to_string(i) + ".log";
+        page_logs.push_back(open_log(name, take(name)));
+    }
+    // Logs of partitions or workers this run doesn't have are still replayed
+    for (const auto& entry : lengths) {
+        frozen_logs.push_back(open_log(entry.first, entry.second));
+    }
+}
+
+bool CrawlJournal::resumed() const {
+    return loaded;
+}
+
+void CrawlJournal::log_admitted(size_t partition, const std::vector<FrontierEntry>& entries) {
+    if (entries.empty()) {
+        return;
+    }
+    std::vector<uint8_t> record;
+    record.reserve(entries.size() * 64);
+    for (const auto& entry : entries) {
+        Varint::put(record, entry.url.size());
+        record.insert(record.end(), entry.url.begin(), entry.url.end());
+        Varint::put(record, entry.depth);
+        uint8_t priority[sizeof(float)];
+        std::memcpy(priority, &entry.priority, sizeof(float));
+        record.insert(record.end(), priority, priority + sizeof(float));
+    }
+    admit_logs[partition % admit_logs.size()]->append(record);
+    urls_logged.fetch_add(entries.size(), std::memory_order_relaxed);
+}
+
+void CrawlJournal::log_page(size_t worker, uint64_t url_fingerprint, uint32_t source,
+                            const std::vector<WeightedEdge>& edges) {
+    std::vector<uint8_t> record;
+    record.reserve(16 + edges.size() * 4);
+    record.push_back(RECORD_EDGES);
+    put_u64(record, url_fingerprint);
+    Varint::put(record, source);
+    Varint::put(record, edges.size());
+    for (const WeightedEdge& edge : edges) {
+        Varint::put(record, edge.target);
+        Varint::put(record, edge.weight);
+    }
+    page_logs[worker % page_logs.size()]->append(record);
+    pages_logged.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CrawlJournal::log_done(size_t worker, uint64_t url_fingerprint) {
+    std::vector<uint8_t> record;
+    record.push_back(RECORD_DONE);
+    put_u64(record, url_fingerprint);
+    page_logs[worker % page_logs.size()]->append(record);
+}
+
+void CrawlJournal::checkpoint(const DomainTable& domains) {
+    std::lock_guard<std::mutex> lock(checkpoint_mutex);
+    auto started = std::chrono::steady_clock::now();
+
+    // Pages first, then the admissions their links produced, then the
+    // domains they reference (see the class comment)
+    std::vector<std::pair<LogFile*, size_t>> cut;
+    for (auto& log : page_logs) {
+        cut.emplace_back(log.get(), log->flush());
+    }
+    uint64_t pages = pages_logged.load();
+    for (auto& log : admit_logs) {
+        cut.emplace_back(log.get(), log->flush());
+    }
+    uint64_t urls = urls_logged.load();
+
+    size_t domain_count = domains.size();
+    std::vector<uint8_t> names;
+    for (size_t id = domains_logged; id < domain_count; id++) {
+        const std::string& name = domains.name(static_cast<uint32_t>(id));
+        Varint::put(names, name.size());
+        names.insert(names.end(), name.begin(), name.end());
+    }
+    domain_log->append(names);
+    cut.emplace_back(domain_log.get(), domain_log->flush());
+
+    for (auto& entry : cut) {
+        if (entry.second != entry.first->valid_bytes && fdatasync(entry.first->fd) != 0) {
+            throw std::runtime_error("journal sync failed: " + entry.first->path);
+        }
+    }
+
+    std::string manifest_path = directory + "/" + MANIFEST_NAME;
+    std::string temp_path = manifest_path + ".tmp";
+    {
+        std::ostringstream out;
+        out << MANIFEST_MAGIC << "\n";
+        for (const auto& entry : cut) {
+            out << "file " << entry.first->name << " " << entry.second << "\n";
+        }
+        for (const auto& log : frozen_logs) {
+            out << "file " << log->name << " " << log->valid_bytes << "\n";
+        }
+        out << "domains " << domain_count << "\n";
+        out << "pages " << pages << "\n";
+        out << "urls " << urls << "\n";
+        std::string text = out.str();
+
+        int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("cannot write " + temp_path);
+        }
+        write_all(fd, reinterpret_cast<const uint8_t*>(text.data()), text.size(), temp_path);
+        bool synced = fsync(fd) == 0;
+        close(fd);
+        if (!synced || std::rename(temp_path.c_str(), manifest_path.c_str()) != 0) {
+            throw std::runtime_error("cannot replace " + manifest_path);
+        }
+    }
+
+    for (auto& entry : cut) {
+        entry.first->valid_bytes = entry.second;
+    }
+    domains_logged = domain_count;
+
+    size_t bytes = 0;
+    for (const auto& entry : cut) {
+        bytes += entry.second;
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+    // Runs on the timer thread: format privately and log, std::cout's
+    // format state belongs to the progress thread
+    std::ostringstream line;
+    line << "Checkpoint: " << pages << " pages, " << urls << " URLs, " << domain_count
+         << " domains | " << std::fixed << std::setprecision(1) << bytes / 1024.0
+         << " KB journal | " << elapsed << " ms";
+    Log::message(LogLevel::Info, line.str());
+}
+
+void CrawlJournal::start(int interval_seconds, const DomainTable& domains) {
+    timer_domains = &domains;
+    stopping = false;
+    timer = std::thread([this, interval_seconds]() {
+        std::unique_lock<std::mutex> lock(timer_mutex);
+        while (!timer_cv.wait_for(lock, std::chrono::seconds(interval_seconds),
+                                  [this]() { return stopping; })) {
+            lock.unlock();
+            try {
+                checkpoint(*timer_domains);
+            } catch (const std::exception& e) {
+                Log::message(LogLevel::Error, std::string("Checkpoint failed: ") + e.what());
+            }
+            lock.lock();
+        }
+    });
+}
+
+void CrawlJournal::stop() {
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex);
+        stopping = true;
+    }
+    timer_cv.notify_all();
+    if (timer.joinable()) {
+        timer.join();
+    }
+    if (timer_domains) {
+        try {
+            checkpoint(*timer_domains);
+        } catch (const std::exception& e) {
+            Log::message(LogLevel::Error, std::string("Final checkpoint failed: ") + e.what());
+        }
+        timer_domains = nullptr;
+    }
+}
+
+void CrawlJournal::scan(const LogFile& log,
+                        const std::function<void(const uint8_t*, const uint8_t*)>& visit) {
+    if (log.valid_bytes == 0) {
+        return;
+    }
+    void* map = mmap(nullptr, log.valid_bytes, PROT_READ, MAP_PRIVATE, log.fd, 0);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("cannot mmap journal file " + log.path);
+    }
+    madvise(map, log.valid_bytes, MADV_SEQUENTIAL);
+    const uint8_t* begin = static_cast<const uint8_t*>(map);
+    try {
+        visit(begin, begin + log.valid_bytes);
+    } catch (...) {
+        munmap(map, log.valid_bytes);
+        throw;
+    }
+    munmap(map, log.valid_bytes);
+}
+
+std::vector<const CrawlJournal::LogFile*> CrawlJournal::logs_with_prefix(
+        const std::string& prefix) const {
+    std::vector<const LogFile*> logs;
+    auto add = [&](const std::vector<std::unique_ptr<LogFile>>& list) {
+        for (const auto& log : list) {
+            if (log->name.compare(0, prefix.size(), prefix) == 0) {
+                logs.push_back(log.get());
+            }
+        }
+    };
+    add(admit_logs);
+    add(page_logs);
+    add(frozen_logs);
+    return logs;
+}
+
+void CrawlJournal::replay_domains(const std::function<void(std::string_view)>& visit) const {
+    size_t remaining = domains_logged;
+    scan(*domain_log, [&](const uint8_t* p, const uint8_t* end) {
+        while (p < end && remaining > 0) {
+            size_t length = static_cast<size_t>(Varint::get(p, end));
+            need(p, end, length);
+            visit(std::string_view(reinterpret_cast<const char*>(p), length));
+            p += length;
+            remaining--;
+        }
+    });
+}
+
+void CrawlJournal::replay_pages(const std::function<void(uint64_t, uint32_t,
+                                                         std::vector<WeightedEdge>&)>& page,
+                                const std::function<void(uint64_t)>& done) const {
+    std::vector<WeightedEdge> edges;
+    std::vector<uint32_t> targets;
+    for (const LogFile* log : logs_with_prefix("pages-")) {
+        scan(*log, [&](const uint8_t* p, const uint8_t* end) {
+            while (p < end) {
+                need(p, end, 1 + sizeof(uint64_t));
+                uint8_t kind = *p++;
+                uint64_t fingerprint;
+                std::memcpy(&fingerprint, p, sizeof(fingerprint));
+                p += sizeof(fingerprint);
+                if (kind == RECORD_DONE) {
+                    done(fingerprint);
+                    continue;
+                }
+                if (kind != RECORD_PAGE && kind != RECORD_EDGES) {
+                    throw std::runtime_error("corrupt page log " + log->path);
+                }
+                uint32_t source = static_cast<uint32_t>(Varint::get(p, end));
+                size_t count = static_cast<size_t>(Varint::get(p, end));
+                edges.clear();
+                if (kind == RECORD_EDGES) {
+                    for (size_t i = 0; i < count; i++) {
+                        WeightedEdge edge;
+                        edge.target = static_cast<uint32_t>(Varint::get(p, end));
+                        edge.weight = static_cast<uint32_t>(Varint::get(p, end));
+                        edges.push_back(edge);
+                    }
+                } else {
+                    // One entry per link: sort and count repeats
+                    targets.clear();
+                    for (size_t i = 0; i < count; i++) {
+                        targets.push_back(static_cast<uint32_t>(Varint::get(p, end)));
+                    }
+                    std::sort(targets.begin(), targets.end());
+                    for (uint32_t target : targets) {
+                        if (!edges.empty() && edges.back().target == target) {
+                            edges.back().weight++;
+                        } else {
+                            edges.push_back(WeightedEdge{target, 1});
+                        }
+                    }
+                }
+                page(fingerprint, source, edges);
+            }
+        });
+    }
+}
+
+void CrawlJournal::replay_admissions(const std::function<void(FrontierEntry&&)>& visit) const {
+    for (const LogFile* log : logs_with_prefix("admit-")) {
+        scan(*log, [&](const uint8_t* p, const uint8_t* end) {
+            while (p < end) {
+                FrontierEntry entry;
+                size_t length = static_cast<size_t>(Varint::get(p, end));
+                need(p, end, length);
+                entry.url.assign(reinterpret_cast<const char*>(p), length);
+                p += length;
+                entry.depth = static_cast<uint32_t>(Varint::get(p, end));
+                need(p, end, sizeof(float));
+                std::memcpy(&entry.priority, p, sizeof(float));
+                p += sizeof(float);
+                visit(std::move(entry));
+            }
+        });
+    }
+}
@@ -0,0 +1,41 @@
+#include "csr_graph.h"
+
+uint64_t CsrGraph::out_weight(uint32_t v) const {
+    if (weights.empty()) {
+        return out_degree(v);
+    }
+    uint64_t total = 0;
+    for (uint64_t e = offsets[v]; e < offsets[v + 1]; e++) {
+        total += weights[e];
+    }
+    return total;
+}
+
+CsrGraph CsrGraph::transpose() const {
+    const size_t n = num_nodes();
+    CsrGraph reversed;
+    reversed.offsets.assign(n + 1, 0);
+    reversed.targets.resize(targets.size());
+    reversed.weights.resize(weights.size());
+
+    // Count in-degrees, prefix-sum into offsets
+    for (uint32_t dst : targets) {
+        reversed.offsets[dst + 1]++;
+    }
+    for (size_t v = 0; v < n; v++) {
+        reversed.offsets[v + 1] += reversed.offsets[v];
+    }
+
+    // Scatter sources; walking sources in order keeps each list sorted
+    std::vector<uint64_t> cursor(reversed.offsets.begin(), reversed.offsets.end() - 1);
+    for (size_t src = 0; src < n; src++) {
+        for (uint64_t e = offsets[src]; e < offsets[src + 1]; e++) {
+            uint64_t slot = cursor[targets[e]]++;
+            reversed.targets[slot] = static_cast<uint32_t>(src);
+            if (!weights.empty()) {
+                reversed.weights[slot] = weights[e];
+            }
+        }
+    }
+    return reversed;
+}
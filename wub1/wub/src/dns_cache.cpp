@@ -0,0 +1,463 @@
+#include "dns_cache.h"
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <cstring>
+
+#ifdef HAVE_CARES
+#include <ares.h>
+#endif
+
+namespace {
+
+// Addresses handed to curl per name; more only lengthen the entry
+const size_t MAX_ADDRESSES = 8;
+
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Like curl's own resolver: ask for IPv6 only if this host can use it
+bool ipv6_works() {
+    int fd = socket(AF_INET6, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+bool is_ipv4(std::string_view name) {
+    char text[INET_ADDRSTRLEN];
+    if (name.size() >= sizeof(text)) {
+        return false;
+    }
+    std::memcpy(text, name.data(), name.size());
+    text[name.size()] = '\0';
+    in_addr addr;
+    return inet_pton(AF_INET, text, &addr) == 1;
+}
+
+/**
+ * Split a URL into host name and port
+ * @return false for IP literals and anything that isn't http(s)
+ */
+bool split_url(std::string_view url, std::string_view& name, int& port) {
+    size_t start;
+    if (url.compare(0, 7, "http://") == 0) {
+        start = 7;
+        port = 80;
+    } else if (url.compare(0, 8, "https://") == 0) {
+        start = 8;
+        port = 443;
+    } else {
+        return false;
+    }
+    size_t end = url.find_first_of("/?#", start);
+    std::string_view authority = url.substr(start, end == std::string_view::npos ? end : end - start);
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        authority.remove_prefix(at + 1);
+    }
+    if (authority.empty() || authority[0] == '[') {
+        return false;                   // IPv6 literal: nothing to resolve
+    }
+    size_t colon = authority.rfind(':');
+    name = authority.substr(0, colon);
+    if (colon != std::string_view::npos) {
+        int value = 0;
+        for (char c : authority.substr(colon + 1)) {
+            if (c < '0' || c > '9' || value > 65535) {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+        }
+        if (value > 0) {
+            port = value;
+        }
+    }
+    return !name.empty() && !is_ipv4(name);
+}
+
+// Strip ":port" from a frontier host key
+std::string_view host_name(std::string_view host) {
+    size_t at = host.rfind('@');
+    if (at != std::string_view::npos) {
+        host.remove_prefix(at + 1);
+    }
+    if (!host.empty() && host[0] == '[') {
+        return std::string_view();
+    }
+    size_t colon = host.rfind(':');
+    return colon == std::string_view::npos ? host : host.substr(0, colon);
+}
+
+// Append one address in CURLOPT_RESOLVE syntax, skipping repeats
+void append_address(std::string& out, size_t& count, const sockaddr* addr) {
+    char text[INET6_ADDRSTRLEN + 2];
+    if (addr->sa_family == AF_INET) {
+        const auto* in = reinterpret_cast<const sockaddr_in*>(addr);
+        inet_ntop(AF_INET, &in->sin_addr, text, sizeof(text));
+    } else if (addr->sa_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const sockaddr_in6*>(addr);
+        text[0] = '[';
+        inet_ntop(AF_INET6, &in6->sin6_addr, text + 1, sizeof(text) - 2);
+        std::strcat(text, "]");
+    } else {
+        return;
+    }
+    if (count >= MAX_ADDRESSES) {
+        return;
+    }
+    std::string_view value(text);
+    size_t pos = 0;
+    while (pos < out.size()) {
+        size_t comma = out.find(',', pos);
+        if (comma == std::string::npos) comma = out.size();
+        if (std::string_view(out).substr(pos, comma - pos) == value) {
+            return;
+        }
+        pos = comma + 1;
+    }
+    if (!out.empty()) {
+        out += ',';
+    }
+    out += value;
+    count++;
+}
+
+}  // namespace
+
+#ifdef HAVE_CARES
+
+/**
+ * One c-ares channel, only touched by the resolver thread
+ */
+struct DnsCache::Backend {
+    ares_channel channel = nullptr;
+    size_t active = 0;              // Lookups started and not yet answered
+    int family = AF_UNSPEC;
+
+    // Lookups in flight at once; the rest wait in the queue
+    static const size_t MAX_ACTIVE = 256;
+};
+
+namespace {
+
+struct Query {
+    DnsCache* cache;
+    std::string name;
+};
+
+}  // namespace
+
+const char* DnsCache::backend_name() {
+    return "c-ares";
+}
+
+#else
+
+struct DnsCache::Backend {
+    int family = AF_UNSPEC;
+};
+
+const char* DnsCache::backend_name() {
+    return "getaddrinfo";
+}
+
+#endif
+
+DnsCache::DnsCache() = default;
+
+DnsCache::~DnsCache() {
+    stop();
+}
+
+void DnsCache::start() {
+    if (running) {
+        return;
+    }
+    backend = std::make_unique<Backend>();
+    backend->family = ipv6_works() ? AF_UNSPEC : AF_INET;
+#ifdef HAVE_CARES
+    ares_library_init(ARES_LIB_INIT_ALL);
+    int status = ares_init(&backend->channel);
+    if (status != ARES_SUCCESS) {
+        backend.reset();
+        ares_library_cleanup();
+        throw std::runtime_error(std::string("Cannot start DNS resolver: ") + ares_strerror(status));
+    }
+#endif
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+#ifdef HAVE_CARES
+        ares_destroy(backend->channel);
+        ares_library_cleanup();
+#endif
+        backend.reset();
+        throw std::runtime_error("Cannot start DNS resolver: eventfd failed");
+    }
+    running = true;
+    resolver = std::thread(&DnsCache::run, this);
+}
+
+void DnsCache::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t written = write(wake_fd, &one, sizeof(one));
+    (void)written;
+    resolver.join();
+#ifdef HAVE_CARES
+    ares_destroy(backend->channel);     // Answers still pending are dropped
+    ares_library_cleanup();
+#endif
+    backend.reset();
+    close(wake_fd);
+    wake_fd = -1;
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    queue.clear();
+}
+
+void DnsCache::prefetch(std::string_view host) {
+    std::string_view name = host_name(host);
+    if (name.empty() || is_ipv4(name)) {
+        return;                         // IP literal
+    }
+    request(name, steady_now_ms());
+}
+
+void DnsCache::request(std::string_view name, int64_t now_ms) {
+    if (!running) {
+        return;
+    }
+    std::string key(name);
+    {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        auto it = cache.find(key);
+        if (it != cache.end() && (it->second.pending || it->second.expires_ms > now_ms)) {
+            return;
+        }
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        auto it = cache.find(key);
+        if (it == cache.end()) {
+            if (cache.size() >= MAX_HOSTS) {
+                return;                 // Left to curl's resolver
+            }
+            cache.emplace(key, Entry());
+        } else if (it->second.pending || it->second.expires_ms > now_ms) {
+            return;                     // Another thread got here first
+        } else {
+            it->second.pending = true;  // Expired: refresh
+        }
+    }
+
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        was_empty = queue.empty();
+        queue.push_back(std::move(key));
+    }
+    if (was_empty) {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+bool DnsCache::resolve_entry(std::string_view url, std::string& entry) {
+    std::string_view name;
+    int port = 0;
+    if (!split_url(url, name, port)) {
+        return false;
+    }
+    int64_t now = steady_now_ms();
+    {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        auto it = cache.find(std::string(name));
+        if (it != cache.end() && !it->second.addresses.empty() && it->second.expires_ms > now) {
+            // "+" makes curl expire the entry like one it resolved itself
+            entry.assign("+");
+            entry.append(name);
+            entry += ':';
+            entry += std::to_string(port);
+            entry += ':';
+            entry += it->second.addresses;
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    request(name, now);
+    return false;
+}
+
+void DnsCache::store(const std::string& name, std::string addresses, int ttl_seconds) {
+    if (addresses.empty()) {
+        failed.fetch_add(1, std::memory_order_relaxed);
+        ttl_seconds = NEGATIVE_TTL_SECONDS;
+    } else {
+        resolved.fetch_add(1, std::memory_order_relaxed);
+        ttl_seconds = std::clamp(ttl_seconds, MIN_TTL_SECONDS, MAX_TTL_SECONDS);
+    }
+    std::unique_lock<std::shared_mutex> lock(cache_mutex);
+    Entry& entry = cache[name];
+    entry.addresses = std::move(addresses);
+    entry.expires_ms = steady_now_ms() + static_cast<int64_t>(ttl_seconds) * 1000;
+    entry.pending = false;
+}
+
+DnsStats DnsCache::stats() const {
+    DnsStats s;
+    {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        s.hosts = cache.size();
+    }
+    s.resolved = resolved.load(std::memory_order_relaxed);
+    s.failed = failed.load(std::memory_order_relaxed);
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    return s;
+}
+
+#ifdef HAVE_CARES
+
+void DnsCache::run() {
+    ares_addrinfo_hints hints{};
+    hints.ai_family = backend->family;
+    hints.ai_socktype = SOCK_STREAM;
+
+    auto on_answer = [](void* arg, int status, int /*timeouts*/, ares_addrinfo* result) {
+        Query* query = static_cast<Query*>(arg);
+        DnsCache* self = query->cache;
+        self->backend->active--;
+        if (status != ARES_EDESTRUCTION) {
+            std::string addresses;
+            size_t count = 0;
+            int ttl = MAX_TTL_SECONDS;
+            if (status == ARES_SUCCESS && result) {
+                for (ares_addrinfo_node* node = result->nodes; node; node = node->ai_next) {
+                    append_address(addresses, count, node->ai_addr);
+                    ttl = std::min(ttl, node->ai_ttl);
+                }
+            }
+            self->store(query->name, std::move(addresses), ttl);
+        }
+        if (result) {
+            ares_freeaddrinfo(result);
+        }
+        delete query;
+    };
+
+    std::vector<std::string> batch;
+    while (running) {
+        // Start queued lookups while there is room on the channel
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            while (!queue.empty() && backend->active + batch.size() < Backend::MAX_ACTIVE) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+        for (std::string& name : batch) {
+            backend->active++;          // The answer may arrive inside the call
+            Query* query = new Query{this, std::move(name)};
+            ares_getaddrinfo(backend->channel, query->name.c_str(), nullptr, &hints,
+                             on_answer, query);
+        }
+
+        ares_socket_t sockets[ARES_GETSOCK_MAXNUM];
+        int bits = ares_getsock(backend->channel, sockets, ARES_GETSOCK_MAXNUM);
+        pollfd fds[ARES_GETSOCK_MAXNUM + 1];
+        nfds_t nfds = 0;
+        fds[nfds++] = pollfd{wake_fd, POLLIN, 0};
+        for (int i = 0; i < ARES_GETSOCK_MAXNUM; i++) {
+            short events = 0;
+            if (ARES_GETSOCK_READABLE(bits, i)) events |= POLLIN;
+            if (ARES_GETSOCK_WRITABLE(bits, i)) events |= POLLOUT;
+            if (events) {
+                fds[nfds++] = pollfd{sockets[i], events, 0};
+            }
+        }
+
+        int timeout = -1;
+        if (backend->active > 0) {
+            timeval tv;
+            if (ares_timeout(backend->channel, nullptr, &tv)) {
+                timeout = static_cast<int>(tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000);
+            }
+        }
+        if (poll(fds, nfds, timeout) < 0) {
+            continue;                   // EINTR
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            ssize_t got = read(wake_fd, &count, sizeof(count));
+            (void)got;
+        }
+        for (nfds_t i = 1; i < nfds; i++) {
+            ares_socket_t readable = (fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+                                     ? fds[i].fd : ARES_SOCKET_BAD;
+            ares_socket_t writable = (fds[i].revents & POLLOUT) ? fds[i].fd : ARES_SOCKET_BAD;
+            if (readable != ARES_SOCKET_BAD || writable != ARES_SOCKET_BAD) {
+                ares_process_fd(backend->channel, readable, writable);
+            }
+        }
+        ares_process_fd(backend->channel, ARES_SOCKET_BAD, ARES_SOCKET_BAD);   // Timeouts
+    }
+}
+
+#else
+
+void DnsCache::run() {
+    addrinfo hints{};
+    hints.ai_family = backend->family;
+    hints.ai_socktype = SOCK_STREAM;
+
+    while (running) {
+        pollfd wake{wake_fd, POLLIN, 0};
+        if (poll(&wake, 1, -1) < 0) {
+            continue;
+        }
+        uint64_t count;
+        ssize_t got = read(wake_fd, &count, sizeof(count));
+        (void)got;
+
+        while (running) {
+            std::string name;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (queue.empty()) {
+                    break;
+                }
+                name = std::move(queue.front());
+                queue.pop_front();
+            }
+            std::string addresses;
+            size_t found = 0;
+            addrinfo* result = nullptr;
+            if (getaddrinfo(name.c_str(), nullptr, &hints, &result) == 0) {
+                for (addrinfo* node = result; node; node = node->ai_next) {
+                    append_address(addresses, found, node->ai_addr);
+                }
+                freeaddrinfo(result);
+            }
+            store(name, std::move(addresses), DEFAULT_TTL_SECONDS);
+        }
+    }
+}
+
+#endif
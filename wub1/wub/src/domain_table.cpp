@@ -0,0 +1,73 @@
+#include "domain_table.h"
+#include <functional>
+
+DomainTable::DomainTable(size_t num_shards) {
+    // Power-of-two shard count so shard selection is a mask
+    size_t count = 1;
+    while (count < num_shards) {
+        count <<= 1;
+    }
+    shards.reset(new Shard[count]);
+    shard_mask = count - 1;
+}
+
+DomainTable::Shard& DomainTable::shard_for(std::string_view domain) const {
+    size_t h = std::hash<std::string_view>{}(domain);
+    h ^= h >> 29;
+    return shards[h & shard_mask];
+}
+
+uint32_t DomainTable::intern(std::string_view domain) {
+    Shard& shard = shard_for(domain);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.ids.find(domain);
+    if (it != shard.ids.end()) {
+        return it->second;
+    }
+
+    // First sighting: append the name and hand out the next dense ID.
+    // The shard lock is still held, so no other thread can race us on
+    // this particular domain
+    uint32_t id;
+    std::string_view stored;
+    {
+        std::lock_guard<std::mutex> names_lock(names_mutex);
+        id = static_cast<uint32_t>(names.size());
+        names.emplace_back(domain);
+        stored = names.back();
+    }
+    shard.ids.emplace(stored, id);
+    return id;
+}
+
+uint32_t DomainTable::find(std::string_view domain) const {
+    const Shard& shard = shard_for(domain);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.ids.find(domain);
+    return (it != shard.ids.end()) ? it->second : INVALID_ID;
+}
+
+const std::string& DomainTable::name(uint32_t id) const {
+    std::lock_guard<std::mutex> lock(names_mutex);
+    return names[id];
+}
+
+size_t DomainTable::size() const {
+    std::lock_guard<std::mutex> lock(names_mutex);
+    return names.size();
+}
+
+size_t DomainTable::memory_bytes() const {
+    std::lock_guard<std::mutex> names_lock(names_mutex);
+    size_t bytes = 0;
+    for (const auto& name : names) {
+        bytes += sizeof(std::string);
+        if (name.capacity() > 15) {
+            bytes += name.capacity() + 1;       // Heap buffer beyond SSO
+        }
+    }
+    // Rough per-entry cost of the shard index: node + key + bucket pointer
+    bytes += names.size() * (sizeof(void*) * 2 + sizeof(std::string_view) + sizeof(uint32_t) + sizeof(size_t));
+    return bytes;
+}
@@ -1,8 +1,55 @@
 #include "downloader.h"
-#include "utils.h"
+#include "parsed_url.h"
 #include <curl/curl.h>
-#include <regex>
+#include <algorithm>
 #include <iostream>
+#include <mutex>
+
+namespace {
+
+/**
+ * Owns the CURLSH object and the locks libcurl asks for
+ * One mutex per curl_lock_data so DNS and TLS lookups don't serialize
+ */
+struct CurlShare {
+    CURLSH* share = nullptr;
+    std::mutex locks[CURL_LOCK_DATA_LAST];
+
+    CurlShare() {
+        share = curl_share_init();
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock_callback);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock_callback);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+
+    ~CurlShare() {
+        curl_share_cleanup(share);
+    }
+
+    static void lock_callback(CURL* /*handle*/, curl_lock_data data,
+                              curl_lock_access /*access*/, void* userp) {
+        static_cast<CurlShare*>(userp)->locks[data].lock();
+    }
+
+    static void unlock_callback(CURL* /*handle*/, curl_lock_data data, void* userp) {
+        static_cast<CurlShare*>(userp)->locks[data].unlock();
+    }
+};
+
+}  // namespace
+
+Downloader::~Downloader() {
+    if (handle) {
+        curl_easy_cleanup(handle);
+    }
+}
+
+CURLSH* Downloader::shared_handle() {
+    static CurlShare instance;
+    return instance.share;
+}
 
 // libcurl write callback
 size_t Downloader::write_callback(void* contents, size_t size, 
@@ -11,28 +58,94 @@ size_t Downloader::write_callback(void* contents, size_t size,
     return size * nmemb;
 }
 
+size_t Downloader::body_callback(char* contents, size_t size, size_t nmemb,
+                                 BodyTarget* target) {
+    size_t bytes = size * nmemb;
+    if (!target->started) {
+        target->started = true;
+        long http_code = 0;
+        curl_easy_getinfo(target->easy, CURLINFO_RESPONSE_CODE, &http_code);
+        target->deliver = is_success(http_code);
+
+        // curl hands us decoded bytes; Content-Length still counts the
+        // encoded ones, so it can't size the buffer
+#if LIBCURL_VERSION_NUM >= 0x075300
+        curl_header* encoding = nullptr;
+        if (curl_easy_header(target->easy, "Content-Encoding", 0, CURLH_HEADER, -1,
+                             &encoding) == CURLHE_OK) {
+            std::string_view value = encoding->value;
+            target->encoded = !value.empty() && value != "identity";
+        }
+#else
+        // No header API before 7.83: treat every body as possibly compressed
+        target->encoded = target->max_decoded_bytes > 0;
+#endif
+
+        // One allocation for the whole body when the length is announced
+        curl_off_t length = -1;
+        curl_easy_getinfo(target->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (target->deliver && target->buffer && length > 0 && !target->encoded) {
+            size_t expected = static_cast<size_t>(length);
+            if (target->max_bytes > 0) {
+                expected = std::min(expected, target->max_bytes);
+            }
+            target->buffer->reserve(expected);
+        }
+    }
+    if (!target->deliver) {
+        return bytes;
+    }
+
+    // A compressed body also stops at the decoded limit (zip bombs)
+    size_t limit = target->max_bytes;
+    bool decode_limit = false;
+    if (target->encoded && target->max_decoded_bytes > 0 &&
+        (limit == 0 || target->max_decoded_bytes < limit)) {
+        limit = target->max_decoded_bytes;
+        decode_limit = true;
+    }
+    size_t take = bytes;
+    if (limit > 0 && target->received + bytes > limit) {
+        take = limit - target->received;
+        target->truncated = true;
+        target->decode_limited = decode_limit;
+    }
+    target->received += take;
+
+    if (target->consumer) {
+        if (!target->consumer->consume(std::string_view(contents, take))) {
+            target->truncated = true;
+        }
+    } else {
+        target->buffer->append(contents, take);
+    }
+    if (target->content) {
+        target->content->update(std::string_view(contents, take));
+    }
+    // Returning less than offered makes curl abort the transfer
+    return target->truncated ? 0 : bytes;
+}
+
 std::string Downloader::download(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        return "";
+    // Keep the handle between calls: its connection cache stays warm
+    if (!handle) {
+        handle = curl_easy_init();
+        if (!handle) {
+            return "";
+        }
     }
+    CURL* curl = handle;
 
+    // Buffered BodyTarget, so the decoded limit applies here too
     std::string readBuffer;
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, 
-                     "Mozilla/5.0 (X11; Linux x86_64) WebCrawler/1.0");
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    BodyTarget target;
+    target.buffer = &readBuffer;
+    target.easy = curl;
+    configure_handle(curl, url, &target);
     
     CURLcode res = curl_easy_perform(curl);
     
-    if (res != CURLE_OK) {
-        curl_easy_cleanup(curl);
+    if (res != CURLE_OK && !(res == CURLE_WRITE_ERROR && target.truncated)) {
         return "";
     }
     
@@ -40,45 +153,112 @@ std::string Downloader::download(const std::string& url) {
     long http_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
     
-    curl_easy_cleanup(curl);
-    
     // Only return content for successful responses
-    if (http_code >= 200 && http_code < 300) {
+    if (is_success(http_code)) {
         return readBuffer;
     }
     
     return "";
 }
 
-std::string Downloader::get_domain(const std::string& url) {
-    // Extract domain from URL
-    std::regex domain_regex(R"(^https?://([^/]+))");
-    std::smatch match;
+void Downloader::set_compression(bool enabled, size_t max_decoded) {
+    compression = enabled;
+    max_decoded_bytes = max_decoded;
+}
+
+void Downloader::configure_handle(CURL* curl, const std::string& url,
+                                  std::string* buffer) {
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, buffer);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, 
+                     "Mozilla/5.0 (X11; Linux x86_64) WebCrawler/1.0");
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    // Required for multi-threaded use: no signals from the resolver
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
     
-    if (std::regex_search(url, match, domain_regex)) {
-        std::string domain = match[1];
-        // Remove 'www.' prefix if present
-        if (Utils::starts_with(domain, "www.")) {
-            domain = domain.substr(4);
-        }
-        return Utils::to_lowercase(domain);
+    // Connection reuse: keep connections alive, share DNS/TLS caches,
+    // and prefer multiplexing onto an existing HTTP/2 connection
+    curl_easy_setopt(curl, CURLOPT_SHARE, shared_handle());
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+    // "" offers every encoding this libcurl was built to decode
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, compression ? "" : nullptr);
+}
+
+void Downloader::configure_handle(CURL* curl, const std::string& url,
+                                  BodyTarget* target) {
+    configure_handle(curl, url, target->buffer);
+    target->max_decoded_bytes = max_decoded_bytes;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, body_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, target);
+}
+
+bool Downloader::is_success(long http_code) {
+    return http_code >= 200 && http_code < 300;
+}
+
+bool Downloader::is_not_modified(long http_code) {
+    return http_code == 304;
+}
+
+curl_slist* Downloader::conditional_headers(std::string_view etag,
+                                            std::string_view last_modified) {
+    curl_slist* headers = nullptr;
+    std::string line;
+    if (!etag.empty()) {
+        line.assign("If-None-Match: ").append(etag);
+        headers = curl_slist_append(headers, line.c_str());
     }
-    
-    return "";
+    if (!last_modified.empty()) {
+        line.assign("If-Modified-Since: ").append(last_modified);
+        headers = curl_slist_append(headers, line.c_str());
+    }
+    return headers;
+}
+
+void Downloader::response_validators(CURL* curl, std::string& etag, std::string& last_modified) {
+    etag.clear();
+    last_modified.clear();
+#if LIBCURL_VERSION_NUM >= 0x075300
+    // Request -1: the last response, after any redirects
+    curl_header* header = nullptr;
+    if (curl_easy_header(curl, "ETag", 0, CURLH_HEADER, -1, &header) == CURLHE_OK) {
+        etag = header->value;
+    }
+    if (curl_easy_header(curl, "Last-Modified", 0, CURLH_HEADER, -1, &header) == CURLHE_OK) {
+        last_modified = header->value;
+    }
+#else
+    // No header API before 7.83: no validators, so re-crawls only
+    // compare body hashes
+    (void)curl;
+#endif
+}
+
+std::string Downloader::get_domain(const std::string& url) {
+    ParsedUrl parsed;
+    if (!ParsedUrl::parse(url, parsed)) {
+        return "";
+    }
+    return std::string(parsed.domain());
 }
 
 bool Downloader::is_valid_url(const std::string& url) {
-    // Check if URL starts with http:// or https://
-    return Utils::starts_with(url, "http://") || 
-           Utils::starts_with(url, "https://");
+    ParsedUrl parsed;
+    return ParsedUrl::parse(url, parsed);
 }
 
 std::string Downloader::get_protocol(const std::string& url) {
-    if (Utils::starts_with(url, "https://")) {
-        return "https";
-    }
-    if (Utils::starts_with(url, "http://")) {
-        return "http";
+    ParsedUrl parsed;
+    if (!ParsedUrl::parse(url, parsed)) {
+        return "";
     }
-    return "";
+    return std::string(parsed.scheme());
 }
@@ -0,0 +1,215 @@
+#include "fetch_cache.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[8] = {'W', 'U', 'B', 'F', 'E', 'T', 'C', 'H'};
+const uint32_t VERSION = 1;
+const size_t HEADER_BYTES = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+
+void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    uint8_t bytes[sizeof(uint64_t)];
+    std::memcpy(bytes, &value, sizeof(value));
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+void put_string(std::vector<uint8_t>& out, std::string_view text) {
+    Varint::put(out, text.size());
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+uint64_t get_u64(const uint8_t*& p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return value;
+}
+
+void need(const uint8_t* p, const uint8_t* end, size_t n) {
+    if (static_cast<size_t>(end - p) < n) {
+        throw std::runtime_error("truncated fetch cache record");
+    }
+}
+
+std::string_view get_string(const uint8_t*& p, const uint8_t* end) {
+    size_t length = static_cast<size_t>(Varint::get(p, end));
+    need(p, end, length);
+    std::string_view text(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return text;
+}
+
+}  // namespace
+
+FetchCache::FetchCache() = default;
+
+FetchCache::~FetchCache() {
+    if (base) {
+        munmap(const_cast<uint8_t*>(base), size);
+    }
+}
+
+void FetchCache::open(const std::string& cache_path) {
+    path = cache_path;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno != ENOENT) {
+        throw std::runtime_error("cannot open fetch cache " + path + ": " + std::strerror(errno));
+    }
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot read fetch cache " + path);
+        }
+        size_t bytes = static_cast<size_t>(info.st_size);
+        if (bytes > 0) {
+            void* map = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot mmap fetch cache " + path);
+            }
+            base = static_cast<const uint8_t*>(map);
+            size = bytes;
+        }
+        ::close(fd);
+    }
+    if (base) {
+        uint32_t version = 0;
+        if (size >= HEADER_BYTES) {
+            std::memcpy(&version, base + sizeof(MAGIC), sizeof(version));
+        }
+        if (size < HEADER_BYTES || std::memcmp(base, MAGIC, sizeof(MAGIC)) != 0 ||
+            version != VERSION) {
+            throw std::runtime_error("not a fetch cache: " + path);
+        }
+        load();
+    }
+
+    out = std::make_unique<OutputFile>(path);
+    uint32_t header[2] = {VERSION, 0};
+    out->write_block(MAGIC, sizeof(MAGIC));
+    out->write_block(header, sizeof(header));
+}
+
+void FetchCache::load() {
+    madvise(const_cast<uint8_t*>(base), size, MADV_SEQUENTIAL);
+    const uint8_t* p = base + HEADER_BYTES;
+    const uint8_t* end = base + size;
+    const uint8_t* record = p;
+    try {
+        while (p < end) {
+            record = p;
+            size_t length = static_cast<size_t>(Varint::get(p, end));
+            need(p, end, length);
+            const uint8_t* record_end = p + length;
+
+            // Decode the whole record once so lookups and replays never fail
+            need(p, record_end, 2 * sizeof(uint64_t));
+            uint64_t url_key = get_u64(p);
+            p += sizeof(uint64_t);
+            get_string(p, record_end);
+            get_string(p, record_end);
+            uint64_t links = Varint::get(p, record_end);
+            for (uint64_t i = 0; i < links; i++) {
+                get_string(p, record_end);
+            }
+            if (p != record_end) {
+                throw std::runtime_error("malformed fetch cache record");
+            }
+
+            index[url_key] = static_cast<uint32_t>(slots.size());
+            slots.push_back(Slot{url_key, static_cast<uint64_t>(record - base),
+                                 static_cast<uint64_t>(record_end - record)});
+        }
+    } catch (const std::runtime_error&) {
+        std::cerr << "[WARNING] Fetch cache " << path << ": ignoring "
+                  << (end - record) << " bytes after a damaged record" << std::endl;
+    }
+    revisited.reset(new std::atomic<bool>[slots.size()]());
+    counters.loaded = index.size();
+}
+
+bool FetchCache::find(uint64_t url_key, CachedPage& page) const {
+    auto it = index.find(url_key);
+    if (it == index.end()) {
+        return false;
+    }
+    const Slot& slot = slots[it->second];
+    const uint8_t* p = base + slot.offset;
+    const uint8_t* end = p + slot.bytes;
+    Varint::get(p, end);
+    p += sizeof(uint64_t);
+    page.content_hash = get_u64(p);
+    page.etag = get_string(p, end);
+    page.last_modified = get_string(p, end);
+    page.links = std::string_view(reinterpret_cast<const char*>(p), static_cast<size_t>(end - p));
+    page.slot = it->second;
+    return true;
+}
+
+void FetchCache::store(uint64_t url_key, uint64_t content_hash, std::string_view etag,
+                       std::string_view last_modified, const std::vector<ParsedUrl>& links) {
+    std::vector<uint8_t> body;
+    size_t link_bytes = 0;
+    for (const ParsedUrl& link : links) {
+        link_bytes += link.str().size() + 2;
+    }
+    body.reserve(32 + etag.size() + last_modified.size() + link_bytes);
+    put_u64(body, url_key);
+    put_u64(body, content_hash);
+    put_string(body, etag);
+    put_string(body, last_modified);
+    Varint::put(body, links.size());
+    for (const ParsedUrl& link : links) {
+        put_string(body, link.str());
+    }
+    std::vector<uint8_t> length;
+    Varint::put(length, body.size());
+
+    supersede(url_key);
+    std::lock_guard<std::mutex> lock(out_mutex);
+    out->write_block(length.data(), length.size());
+    out->write_block(body.data(), body.size());
+    counters.stored++;
+}
+
+void FetchCache::keep(const CachedPage& page) {
+    const Slot& slot = slots[page.slot];
+    revisited[page.slot].store(true, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(out_mutex);
+    out->write_block(base + slot.offset, slot.bytes);
+    counters.kept++;
+}
+
+void FetchCache::supersede(uint64_t url_key) {
+    auto it = index.find(url_key);
+    if (it != index.end()) {
+        revisited[it->second].store(true, std::memory_order_relaxed);
+    }
+}
+
+void FetchCache::commit() {
+    std::lock_guard<std::mutex> lock(out_mutex);
+    // Older records of a URL were replaced in the index by later ones
+    for (uint32_t s = 0; s < slots.size(); s++) {
+        const Slot& slot = slots[s];
+        if (!revisited[s].load(std::memory_order_relaxed) && index.find(slot.url_key)->second == s) {
+            out->write_block(base + slot.offset, slot.bytes);
+            counters.carried++;
+        }
+    }
+    out->commit();
+    out.reset();
+}
+
+FetchCacheStats FetchCache::stats() const {
+    std::lock_guard<std::mutex> lock(out_mutex);
+    return counters;
+}
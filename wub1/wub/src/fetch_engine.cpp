@@ -0,0 +1,541 @@
+#include "fetch_engine.h"
+#include "object_pool.h"
+#include "logger.h"
+#include "metrics.h"
+#include <curl/curl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+// Bodies whose buffer grew beyond this are freed instead of pooled
+const size_t MAX_POOLED_BODY = 1 << 20;
+
+/**
+ * State for one in-flight transfer, attached via CURLOPT_PRIVATE
+ */
+struct Transfer {
+    CURL* easy = nullptr;
+    FetchResult result;
+    BodyTarget target;
+    Hash64::Stream content;             // Body hash (conditional mode)
+    curl_slist* headers = nullptr;      // Conditional request headers
+    curl_slist* resolve = nullptr;      // Cached addresses of the host
+
+    ~Transfer() {
+        curl_slist_free_all(headers);
+        curl_slist_free_all(resolve);
+    }
+};
+
+}  // namespace
+
+/**
+ * Per-thread event loop state
+ * Only touched by its own I/O thread, except wake_fd
+ */
+struct FetchEngine::IoLoop {
+    int id = 0;
+    CURLM* multi = nullptr;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    int64_t deadline_ms = -1;   // Steady-clock deadline set by curl's timer, -1 if unset
+    size_t budget = 0;          // Max transfers in flight on this loop
+    size_t active = 0;          // Transfers currently in flight on this loop
+    std::unordered_set<CURL*> handles;      // Attached to the multi handle
+    std::vector<CURL*> idle_handles;        // Finished, kept for reuse
+    std::vector<Transfer*> idle_transfers;  // Finished, kept for reuse
+    ObjectPool<std::string> bodies;         // Body buffers handed back by recycle_body()
+    std::atomic<size_t> active_count{0};    // Mirror of active for other threads
+    std::atomic<bool> parked{false};        // Waiting in epoll with nothing in flight
+    std::atomic<int64_t> retry_at_ms{-1};   // Poll the source again at this time, -1 if unset
+    std::atomic<bool> filling{false};       // In fill_loop: retry_at_ms is read right after
+};
+
+namespace {
+
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// curl tells us which sockets to watch; mirror that into epoll
+int socket_callback(CURL* /*easy*/, curl_socket_t s, int what,
+                    void* userp, void* /*socketp*/) {
+    int epoll_fd = *static_cast<int*>(userp);
+
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, s, nullptr);
+        return 0;
+    }
+
+    epoll_event ev{};
+    ev.data.fd = s;
+    if (what & CURL_POLL_IN) ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT) ev.events |= EPOLLOUT;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, s, &ev) != 0 && errno == ENOENT) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s, &ev);
+    }
+    return 0;
+}
+
+// curl asks for a single timer; the event loop turns it into the epoll timeout
+int timer_callback(CURLM* /*multi*/, long timeout_ms, void* userp) {
+    *static_cast<int64_t*>(userp) = (timeout_ms < 0) ? -1 : steady_now_ms() + timeout_ms;
+    return 0;
+}
+
+}  // namespace
+
+FetchEngine::FetchEngine() = default;
+
+FetchEngine::~FetchEngine() {
+    stop();
+}
+
+void FetchEngine::start(int io_threads, int max_inflight,
+                        Source source_fn, Sink sink_fn) {
+    source = std::move(source_fn);
+    sink = std::move(sink_fn);
+    running.store(true);
+
+    if (io_threads < 1) io_threads = 1;
+    size_t per_loop = static_cast<size_t>(max_inflight) / io_threads;
+    if (per_loop < 1) per_loop = 1;
+
+    for (int i = 0; i < io_threads; i++) {
+        auto loop = std::make_unique<IoLoop>();
+        loop->id = i;
+        loop->budget = per_loop;
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = loop->wake_fd;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+
+        loop->multi = curl_multi_init();
+        curl_multi_setopt(loop->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(loop->multi, CURLMOPT_MAXCONNECTS, static_cast<long>(per_loop));
+        curl_multi_setopt(loop->multi, CURLMOPT_SOCKETFUNCTION, socket_callback);
+        curl_multi_setopt(loop->multi, CURLMOPT_SOCKETDATA, &loop->epoll_fd);
+        curl_multi_setopt(loop->multi, CURLMOPT_TIMERFUNCTION, timer_callback);
+        curl_multi_setopt(loop->multi, CURLMOPT_TIMERDATA, &loop->deadline_ms);
+
+        loops.push_back(std::move(loop));
+    }
+
+    for (auto& loop : loops) {
+        threads.emplace_back(&FetchEngine::run_loop, this, std::ref(*loop));
+    }
+}
+
+void FetchEngine::notify() {
+    for (size_t i = 0; i < loops.size(); i++) {
+        notify(static_cast<int>(i));
+    }
+}
+
+void FetchEngine::notify(int loop_id) {
+    IoLoop& loop = *loops[loop_id % loops.size()];
+    // Only wake loops that have room for more work
+    if (loop.active_count.load() < loop.budget) {
+        uint64_t one = 1;
+        ssize_t written = write(loop.wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void FetchEngine::notify_idle() {
+    uint64_t one = 1;
+    for (auto& loop : loops) {
+        if (loop->parked.load()) {
+            ssize_t written = write(loop->wake_fd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+}
+
+void FetchEngine::retry_after(int loop_id, int64_t delay_ms) {
+    IoLoop& loop = *loops[loop_id % loops.size()];
+    int64_t when = steady_now_ms() + std::max<int64_t>(delay_ms, 0);
+    int64_t current = loop.retry_at_ms.load();
+    while ((current < 0 || when < current) &&
+           !loop.retry_at_ms.compare_exchange_weak(current, when)) {
+    }
+    if (!loop.parked.load() || loop.filling.load()) {
+        // Running, or filling and about to read the new time: waking it
+        // would only make it spin (the source calls this from the loop)
+        return;
+    }
+    // A parked loop computed its timeout before this; wake it to recompute
+    uint64_t one = 1;
+    ssize_t written = write(loop.wake_fd, &one, sizeof(one));
+    (void)written;
+}
+
+void FetchEngine::set_max_body_bytes(size_t max_bytes) {
+    max_body_bytes = max_bytes;
+}
+
+void FetchEngine::set_compression(bool enabled, size_t max_decoded_bytes) {
+    downloader.set_compression(enabled, max_decoded_bytes);
+}
+
+void FetchEngine::set_conditional(bool enabled) {
+    conditional = enabled;
+}
+
+void FetchEngine::set_dns_cache(DnsCache* cache) {
+    dns_cache = cache;
+}
+
+void FetchEngine::set_stream_factory(StreamFactory factory) {
+    stream_factory = std::move(factory);
+}
+
+void FetchEngine::recycle_body(int loop_id, std::string&& body) {
+    if (loops.empty() || body.capacity() > MAX_POOLED_BODY) {
+        return;
+    }
+    body.clear();
+    loops[loop_id % loops.size()]->bodies.release(std::move(body));
+}
+
+int FetchEngine::loop_count() const {
+    return static_cast<int>(loops.size());
+}
+
+void FetchEngine::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    for (auto& loop : loops) {
+        ssize_t written = write(loop->wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    for (auto& loop : loops) {
+        for (CURL* easy : loop->idle_handles) {
+            curl_easy_cleanup(easy);
+        }
+        for (Transfer* transfer : loop->idle_transfers) {
+            delete transfer;
+        }
+        curl_multi_cleanup(loop->multi);
+        close(loop->epoll_fd);
+        close(loop->wake_fd);
+    }
+    threads.clear();
+    loops.clear();
+}
+
+size_t FetchEngine::inflight() const {
+    return inflight_.load();
+}
+
+FetchStats FetchEngine::stats() const {
+    FetchStats result;
+    result.connections_reused = connections_reused.load();
+    result.connections_new = connections_new.load();
+    result.http2_transfers = http2_transfers.load();
+    result.handles_reused = handles_reused.load();
+    result.bodies_reused = bodies_reused.load();
+    result.compressed_transfers = compressed_transfers.load();
+    return result;
+}
+
+void FetchEngine::fill_loop(IoLoop& loop) {
+    FetchRequest request;
+    std::string resolve_entry;
+
+    loop.filling.store(true);
+    while (loop.active < loop.budget && running.load() && source(loop.id, request)) {
+        Transfer* transfer;
+        if (!loop.idle_transfers.empty()) {
+            transfer = loop.idle_transfers.back();
+            loop.idle_transfers.pop_back();
+        } else {
+            transfer = new Transfer();
+        }
+        if (!loop.idle_handles.empty()) {
+            transfer->easy = loop.idle_handles.back();
+            loop.idle_handles.pop_back();
+            handles_reused.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            transfer->easy = curl_easy_init();
+        }
+        if (stream_factory) {
+            transfer->result.stream = stream_factory(loop.id, request);
+        }
+        transfer->result.url = std::move(request.url);
+        transfer->result.loop_id = loop.id;
+        transfer->result.kind = request.kind;
+        transfer->result.depth = request.depth;
+        if (!transfer->easy) {
+            sink(std::move(transfer->result));
+            transfer->result = FetchResult();
+            loop.idle_transfers.push_back(transfer);
+            continue;
+        }
+
+        BodyTarget& target = transfer->target;
+        target = BodyTarget();
+        target.easy = transfer->easy;
+        target.max_bytes = max_body_bytes;
+        target.consumer = transfer->result.stream.get();
+        if (!target.consumer) {
+            if (loop.bodies.acquire(transfer->result.body)) {
+                bodies_reused.fetch_add(1, std::memory_order_relaxed);
+            }
+            target.buffer = &transfer->result.body;
+        }
+        downloader.configure_handle(transfer->easy, transfer->result.url, &target);
+        if (conditional) {
+            transfer->content.reset();
+            target.content = &transfer->content;
+            // Pooled handles keep their options: always replace the list
+            transfer->headers = Downloader::conditional_headers(request.etag, request.last_modified);
+            curl_easy_setopt(transfer->easy, CURLOPT_HTTPHEADER, transfer->headers);
+        }
+        if (dns_cache) {
+            // Also replaced every time; a miss clears the pooled handle's list
+            if (dns_cache->resolve_entry(transfer->result.url, resolve_entry)) {
+                transfer->resolve = curl_slist_append(nullptr, resolve_entry.c_str());
+            }
+            curl_easy_setopt(transfer->easy, CURLOPT_RESOLVE, transfer->resolve);
+        }
+        curl_easy_setopt(transfer->easy, CURLOPT_PRIVATE, transfer);
+
+        curl_multi_add_handle(loop.multi, transfer->easy);
+        loop.handles.insert(transfer->easy);
+        loop.active++;
+        loop.active_count.store(loop.active);
+        inflight_.fetch_add(1);
+    }
+    loop.filling.store(false);
+}
+
+void FetchEngine::record_timings(CURL* easy, bool new_connection) {
+    // curl reports each phase as microseconds since the transfer started
+    curl_off_t lookup = 0, connect = 0, tls = 0, pretransfer = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &lookup);
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(easy, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+
+    auto phase = [](Metric metric, curl_off_t from, curl_off_t to) {
+        if (to >= from) {
+            Metrics::record(metric, static_cast<uint64_t>(to - from) * 1000);
+        }
+    };
+    if (new_connection) {
+        phase(Metric::DnsTime, 0, lookup);
+        phase(Metric::ConnectTime, lookup, connect);
+        if (tls > 0) {
+            phase(Metric::TlsTime, connect, tls);
+        }
+    }
+    if (first_byte > 0) {
+        phase(Metric::FirstByteTime, pretransfer, first_byte);
+        phase(Metric::TransferTime, first_byte, total);
+    }
+}
+
+void FetchEngine::drain_completed(IoLoop& loop) {
+    int pending = 0;
+    CURLMsg* msg = nullptr;
+
+    while ((msg = curl_multi_info_read(loop.multi, &pending)) != nullptr) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        CURL* easy = msg->easy_handle;
+        Transfer* transfer = nullptr;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+
+        FetchResult& result = transfer->result;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &result.http_code);
+        // A transfer we stopped at its budget is a complete, shorter page
+        result.truncated = msg->data.result == CURLE_WRITE_ERROR && transfer->target.truncated;
+        result.ok = (msg->data.result == CURLE_OK || result.truncated) &&
+                    Downloader::is_success(result.http_code);
+        result.not_modified = msg->data.result == CURLE_OK &&
+                              Downloader::is_not_modified(result.http_code);
+        result.body_bytes = transfer->target.received;
+        if (!result.ok) {
+            // The stream stays attached so its owner can recycle it
+            result.body.clear();
+        } else if (result.stream) {
+            result.stream->finish();
+        }
+        if (conditional && result.ok) {
+            result.content_hash = transfer->content.digest();
+            Downloader::response_validators(easy, result.etag, result.last_modified);
+        }
+        Metrics::add(Counter::Transfers);
+        Metrics::add(Counter::BodyBytes, result.body_bytes);
+        // What the link carried for the same bodies, before curl decoded them
+        if (result.ok) {
+            curl_off_t wire_bytes = 0;
+            curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &wire_bytes);
+            Metrics::add(Counter::WireBytes, static_cast<uint64_t>(std::max<curl_off_t>(wire_bytes, 0)));
+        }
+        if (transfer->target.encoded) {
+            compressed_transfers.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (transfer->target.decode_limited) {
+            Metrics::add(Counter::DecodeLimited);
+            Log::message(LogLevel::Warning, "Compressed body cut at the decoded size limit: " + result.url);
+        }
+        Metrics::count_status(result.http_code);
+        if (!result.ok && !result.not_modified) {
+            Metrics::add(Counter::FetchErrors);
+        }
+
+        if (msg->data.result == CURLE_OK || result.truncated) {
+            long num_connects = 0;
+            long http_version = 0;
+            curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &num_connects);
+            curl_easy_getinfo(easy, CURLINFO_HTTP_VERSION, &http_version);
+            if (num_connects == 0) {
+                connections_reused.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                connections_new.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (http_version == CURL_HTTP_VERSION_2_0) {
+                http2_transfers.fetch_add(1, std::memory_order_relaxed);
+            }
+            record_timings(easy, num_connects > 0);
+        }
+
+        // Keep the handle: the multi handle owns the connection pool, the
+        // easy handle keeps its allocations and options
+        curl_multi_remove_handle(loop.multi, easy);
+        curl_slist_free_all(transfer->headers);
+        transfer->headers = nullptr;
+        curl_slist_free_all(transfer->resolve);
+        transfer->resolve = nullptr;
+        loop.handles.erase(easy);
+        loop.idle_handles.push_back(easy);
+        loop.active--;
+        loop.active_count.store(loop.active);
+        inflight_.fetch_sub(1);
+
+        sink(std::move(result));
+        result = FetchResult();
+        loop.idle_transfers.push_back(transfer);
+    }
+}
+
+void FetchEngine::run_loop(IoLoop& loop) {
+    const int max_events = 64;
+    epoll_event events[max_events];
+    int still_running = 0;
+    Log::set_thread_name("io" + std::to_string(loop.id));
+
+    while (running.load()) {
+        fill_loop(loop);
+
+        // Advertise that we are about to park, then look once more: a
+        // producer that pushed before seeing the flag is caught by the
+        // second fill, one that pushed after it writes our eventfd
+        if (loop.active == 0) {
+            loop.parked.store(true);
+            fill_loop(loop);
+            if (loop.active > 0) {
+                loop.parked.store(false);
+            }
+        }
+
+        // With nothing scheduled we park on the wake eventfd; the 1 s cap
+        // only guards against a missed notify
+        int wait_ms = 1000;
+        int64_t now_ms = steady_now_ms();
+        int64_t retry_at = loop.retry_at_ms.load();
+        if (retry_at >= 0 && retry_at <= now_ms) {
+            // Held-back URLs are due: poll the source right away
+            loop.retry_at_ms.store(-1);
+            wait_ms = 0;
+        } else {
+            if (loop.deadline_ms >= 0) {
+                int64_t remaining = loop.deadline_ms - now_ms;
+                wait_ms = remaining > 0 ? static_cast<int>(std::min<int64_t>(remaining, wait_ms)) : 0;
+            }
+            if (retry_at >= 0) {
+                wait_ms = std::min(wait_ms, static_cast<int>(retry_at - now_ms));
+            }
+        }
+        int n;
+        if (loop.active == 0 && wait_ms > 0) {
+            // Nothing in flight: the loop is starved or every host is held back
+            Metrics::ScopedTimer idle(Metric::IoIdle);
+            n = epoll_wait(loop.epoll_fd, events, max_events, wait_ms);
+        } else {
+            n = epoll_wait(loop.epoll_fd, events, max_events, wait_ms);
+        }
+        loop.parked.store(false);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            Log::message(LogLevel::Error, "epoll_wait failed in fetch engine");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == loop.wake_fd) {
+                uint64_t value = 0;
+                ssize_t got = read(loop.wake_fd, &value, sizeof(value));
+                (void)got;
+                continue;
+            }
+
+            int mask = 0;
+            if (events[i].events & EPOLLIN) mask |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) mask |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) mask |= CURL_CSELECT_ERR;
+            curl_multi_socket_action(loop.multi, fd, mask, &still_running);
+        }
+
+        if (loop.deadline_ms >= 0 && loop.deadline_ms <= steady_now_ms()) {
+            // curl's timer is one-shot: it re-arms it from inside the call
+            // if it still needs one, otherwise an idle loop would spin
+            loop.deadline_ms = -1;
+            curl_multi_socket_action(loop.multi, CURL_SOCKET_TIMEOUT, 0, &still_running);
+        }
+
+        drain_completed(loop);
+    }
+
+    // Abort whatever is still in flight
+    for (CURL* easy : loop.handles) {
+        Transfer* transfer = nullptr;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+        curl_multi_remove_handle(loop.multi, easy);
+        curl_easy_cleanup(easy);
+        delete transfer;
+        inflight_.fetch_sub(1);
+    }
+    loop.handles.clear();
+    loop.active = 0;
+}
@@ -0,0 +1,205 @@
+#include "frontier_spill.h"
+#include "varint.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// URLs per front-coded block
+const size_t BLOCK_URLS = 4096;
+
+// Segments are sealed once they reach this size
+const size_t SEGMENT_BYTES = 64 << 20;
+
+// Block header: URL count and payload bytes
+const size_t BLOCK_HEADER = 2 * sizeof(uint32_t);
+
+}  // namespace
+
+FrontierSpill::FrontierSpill(std::string dir, size_t partition_id) {
+    prefix = std::move(dir) + "/frontier-" + std::to_string(getpid()) +
+             "-p" + std::to_string(partition_id) + "-seg";
+    pending.reserve(BLOCK_URLS);
+}
+
+FrontierSpill::~FrontierSpill() {
+    for (auto& segment : segments) {
+        discard(segment);
+    }
+}
+
+void FrontierSpill::push(FrontierEntry&& entry) {
+    pending.push_back(std::move(entry));
+    queued++;
+    if (pending.size() >= BLOCK_URLS) {
+        flush_block();
+    }
+}
+
+void FrontierSpill::flush_block() {
+    // Sorting puts each host's URLs next to each other, so most of every
+    // URL is a prefix shared with the one before it
+    std::sort(pending.begin(), pending.end(),
+              [](const FrontierEntry& a, const FrontierEntry& b) { return a.url < b.url; });
+
+    block.assign(BLOCK_HEADER, 0);
+    const std::string* previous = nullptr;
+    for (const auto& entry : pending) {
+        size_t shared = 0;
+        if (previous) {
+            size_t limit = std::min(previous->size(), entry.url.size());
+            while (shared < limit && (*previous)[shared] == entry.url[shared]) {
+                shared++;
+            }
+        }
+        Varint::put(block, shared);
+        Varint::put(block, entry.url.size() - shared);
+        block.insert(block.end(), entry.url.begin() + shared, entry.url.end());
+        Varint::put(block, entry.depth);
+        uint8_t priority[sizeof(float)];
+        std::memcpy(priority, &entry.priority, sizeof(float));
+        block.insert(block.end(), priority, priority + sizeof(float));
+        previous = &entry.url;
+    }
+    uint32_t header[2] = {static_cast<uint32_t>(pending.size()),
+                          static_cast<uint32_t>(block.size() - BLOCK_HEADER)};
+    std::memcpy(block.data(), header, BLOCK_HEADER);
+
+    if (!back_open) {
+        Segment segment;
+        segment.path = prefix + std::to_string(next_segment++) + ".bin";
+        segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (segment.fd < 0) {
+            throw std::runtime_error("cannot create frontier segment " + segment.path);
+        }
+        segments.push_back(std::move(segment));
+        back_open = true;
+    }
+
+    Segment& segment = segments.back();
+    const uint8_t* p = block.data();
+    size_t left = block.size();
+    while (left > 0) {
+        ssize_t n = ::write(segment.fd, p, left);
+        if (n < 0) {
+            throw std::runtime_error("frontier segment write failed");
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    segment.bytes += block.size();
+    segment.urls += pending.size();
+    total_urls += pending.size();
+    total_bytes += block.size();
+    pending.clear();
+
+    if (segment.bytes >= SEGMENT_BYTES) {
+        seal();
+    }
+}
+
+void FrontierSpill::seal() {
+    back_open = false;
+}
+
+size_t FrontierSpill::refill(std::vector<FrontierEntry>& out) {
+    if (segments.empty()) {
+        // Nothing on disk: hand back the unwritten buffer directly
+        size_t count = pending.size();
+        for (auto& entry : pending) {
+            out.push_back(std::move(entry));
+        }
+        pending.clear();
+        queued -= count;
+        return count;
+    }
+
+    Segment& segment = segments.front();
+    if (segments.size() == 1 && back_open) {
+        // Reading the segment being written: later blocks start a new one
+        seal();
+    }
+
+    if (!segment.map) {
+        void* map = mmap(nullptr, segment.bytes, PROT_READ, MAP_SHARED, segment.fd, 0);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("cannot mmap frontier segment " + segment.path);
+        }
+        madvise(map, segment.bytes, MADV_SEQUENTIAL);
+        segment.map = static_cast<const uint8_t*>(map);
+    }
+
+    uint32_t header[2];
+    std::memcpy(header, segment.map + segment.offset, BLOCK_HEADER);
+    const uint8_t* p = segment.map + segment.offset + BLOCK_HEADER;
+    const uint8_t* end = p + header[1];
+    segment.offset += BLOCK_HEADER + header[1];
+
+    out.reserve(out.size() + header[0]);
+    std::string previous;
+    for (uint32_t i = 0; i < header[0]; i++) {
+        size_t shared = static_cast<size_t>(Varint::get(p, end));
+        size_t suffix = static_cast<size_t>(Varint::get(p, end));
+        FrontierEntry entry;
+        entry.url.reserve(shared + suffix);
+        entry.url.assign(previous, 0, shared);
+        entry.url.append(reinterpret_cast<const char*>(p), suffix);
+        p += suffix;
+        entry.depth = static_cast<uint32_t>(Varint::get(p, end));
+        std::memcpy(&entry.priority, p, sizeof(float));
+        p += sizeof(float);
+        previous = entry.url;
+        out.push_back(std::move(entry));
+    }
+    queued -= header[0];
+
+    if (segment.offset >= segment.bytes) {
+        discard(segment);
+        segments.pop_front();
+    }
+    return header[0];
+}
+
+void FrontierSpill::discard(Segment& segment) {
+    if (segment.map) {
+        munmap(const_cast<uint8_t*>(segment.map), segment.bytes);
+        segment.map = nullptr;
+    }
+    if (segment.fd >= 0) {
+        close(segment.fd);
+        segment.fd = -1;
+    }
+    if (!segment.path.empty()) {
+        unlink(segment.path.c_str());
+        segment.path.clear();
+    }
+}
+
+size_t FrontierSpill::size() const {
+    return queued;
+}
+
+size_t FrontierSpill::buffered() const {
+    return pending.size();
+}
+
+size_t FrontierSpill::disk_bytes() const {
+    size_t bytes = 0;
+    for (const auto& segment : segments) {
+        bytes += segment.bytes;
+    }
+    return bytes;
+}
+
+uint64_t FrontierSpill::urls_written() const {
+    return total_urls;
+}
+
+uint64_t FrontierSpill::bytes_written() const {
+    return total_bytes;
+}
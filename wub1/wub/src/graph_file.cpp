@@ -0,0 +1,149 @@
+#include "graph_file.h"
+#include "output_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[8] = {'W', 'U', 'B', 'G', 'R', 'A', 'P', 'H'};
+
+static_assert(sizeof(int) == sizeof(int32_t), "visit counts are written as int32");
+static_assert(sizeof(GraphFileHeader) % 8 == 0, "header keeps the sections 8-byte aligned");
+
+uint64_t align_up(uint64_t value) {
+    return (value + GRAPH_FILE_ALIGNMENT - 1) / GRAPH_FILE_ALIGNMENT * GRAPH_FILE_ALIGNMENT;
+}
+
+}  // namespace
+
+namespace GraphFile {
+
+void write(const std::string& path, const GraphColumns& columns) {
+    const DomainTable& domains = *columns.domains;
+    const CsrGraph& graph = *columns.graph;
+    const uint64_t n = graph.num_nodes();
+    const uint64_t m = graph.num_edges();
+    if (columns.visit_counts->size() != n || domains.size() < n) {
+        throw std::runtime_error("graph file " + path + ": columns do not match the graph");
+    }
+    static const uint64_t empty_offsets = 0;     // A graph that was never merged
+
+    // Name ranges first: their total is the size of the Names section
+    std::vector<uint64_t> name_offsets(n + 1, 0);
+    for (uint64_t v = 0; v < n; v++) {
+        name_offsets[v + 1] = name_offsets[v] + domains.name(static_cast<uint32_t>(v)).size();
+    }
+
+    bool has_weights = !graph.weights.empty();
+    bool has_ranks = columns.ranks && columns.ranks->size() == n;
+    uint64_t sizes[GRAPH_SECTION_COUNT] = {
+        (n + 1) * sizeof(uint64_t),
+        name_offsets[n],
+        (n + 1) * sizeof(uint64_t),
+        m * sizeof(uint32_t),
+        has_weights ? m * sizeof(uint32_t) : 0,
+        n * sizeof(int32_t),
+        has_ranks ? n * sizeof(double) : 0,
+    };
+
+    GraphFileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = GRAPH_FILE_VERSION;
+    header.section_count = static_cast<uint32_t>(GRAPH_SECTION_COUNT);
+    header.num_nodes = n;
+    header.num_edges = m;
+    uint64_t at = align_up(sizeof(header));
+    for (size_t s = 0; s < GRAPH_SECTION_COUNT; s++) {
+        header.sections[s] = GraphFileSection{at, sizes[s]};
+        at = align_up(at + sizes[s]);
+    }
+
+    OutputFile out(path);
+    out.write_block(&header, sizeof(header));
+    out.pad_to(GRAPH_FILE_ALIGNMENT);
+    out.write_block(name_offsets.data(), sizes[0]);
+    out.pad_to(GRAPH_FILE_ALIGNMENT);
+    for (uint64_t v = 0; v < n; v++) {
+        out.append(domains.name(static_cast<uint32_t>(v)));
+    }
+    // The columns go out from the vectors they live in
+    const void* blocks[] = {
+        graph.offsets.empty() ? &empty_offsets : graph.offsets.data(),
+        graph.targets.data(),
+        graph.weights.data(),
+        columns.visit_counts->data(),
+        has_ranks ? columns.ranks->data() : nullptr,
+    };
+    for (size_t s = 2; s < GRAPH_SECTION_COUNT; s++) {
+        out.pad_to(GRAPH_FILE_ALIGNMENT);
+        if (sizes[s] > 0) {
+            out.write_block(blocks[s - 2], sizes[s]);
+        }
+    }
+    out.commit();
+}
+
+}  // namespace GraphFile
+
+GraphFileView::~GraphFileView() {
+    if (base) {
+        munmap(const_cast<char*>(base), size);
+    }
+}
+
+void GraphFileView::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open graph file " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(GraphFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("not a graph file: " + path);
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    void* map = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("cannot mmap graph file " + path);
+    }
+    if (base) {
+        munmap(const_cast<char*>(base), size);
+    }
+    base = static_cast<const char*>(map);
+    size = bytes;
+    header = reinterpret_cast<const GraphFileHeader*>(base);
+
+    bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header->version == GRAPH_FILE_VERSION &&
+                 header->section_count == GRAPH_SECTION_COUNT;
+    for (size_t s = 0; valid && s < GRAPH_SECTION_COUNT; s++) {
+        const GraphFileSection& section = header->sections[s];
+        valid = section.offset % GRAPH_FILE_ALIGNMENT == 0 && section.offset <= size &&
+                section.bytes <= size - section.offset;
+    }
+    const uint64_t n = header->num_nodes;
+    const uint64_t m = header->num_edges;
+    auto bytes_of = [&](GraphSection s) { return header->sections[static_cast<size_t>(s)].bytes; };
+    valid = valid && bytes_of(GraphSection::NameOffsets) == (n + 1) * sizeof(uint64_t) &&
+            bytes_of(GraphSection::Offsets) == (n + 1) * sizeof(uint64_t) &&
+            bytes_of(GraphSection::Targets) == m * sizeof(uint32_t) &&
+            (bytes_of(GraphSection::Weights) == 0 || bytes_of(GraphSection::Weights) == m * sizeof(uint32_t)) &&
+            bytes_of(GraphSection::VisitCounts) == n * sizeof(int32_t) &&
+            (bytes_of(GraphSection::Ranks) == 0 || bytes_of(GraphSection::Ranks) == n * sizeof(double));
+    valid = valid && section<uint64_t>(GraphSection::NameOffsets)[n] == bytes_of(GraphSection::Names) &&
+            offsets()[n] == m;
+    if (!valid) {
+        throw std::runtime_error("corrupt graph file " + path);
+    }
+}
+
+std::string_view GraphFileView::name(uint64_t v) const {
+    const uint64_t* ranges = section<uint64_t>(GraphSection::NameOffsets);
+    const char* names = base + header->sections[static_cast<size_t>(GraphSection::Names)].offset;
+    return std::string_view(names + ranges[v], ranges[v + 1] - ranges[v]);
+}
@@ -0,0 +1,123 @@
+#include "hash64.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint64_t SECRET[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+inline void mum(uint64_t& a, uint64_t& b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+}
+
+inline uint64_t mum_mix(uint64_t a, uint64_t b) {
+    mum(a, b);
+    return a ^ b;
+}
+
+inline uint64_t read8(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint64_t read4(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint64_t read3(const uint8_t* p, size_t k) {
+    return (static_cast<uint64_t>(p[0]) << 16) |
+           (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+}  // namespace
+
+namespace Hash64 {
+
+uint64_t hash(std::string_view data, uint64_t seed) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+    size_t len = data.size();
+    seed ^= mum_mix(seed ^ SECRET[0], SECRET[1]);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mum_mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                see1 = mum_mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ see1);
+                see2 = mum_mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mum_mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    a ^= SECRET[1];
+    b ^= seed;
+    mum(a, b);
+    return mum_mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+}
+
+void Stream::update(std::string_view piece) {
+    if (piece.empty()) {
+        return;
+    }
+    length += piece.size();
+    if (pending > 0) {
+        size_t take = std::min(BLOCK_BYTES - pending, piece.size());
+        std::memcpy(block + pending, piece.data(), take);
+        pending += take;
+        piece.remove_prefix(take);
+        if (pending < BLOCK_BYTES) {
+            return;
+        }
+        state = hash(std::string_view(block, BLOCK_BYTES), state);
+        pending = 0;
+    }
+    // Whole blocks are hashed in place; only a partial tail is copied
+    while (piece.size() >= BLOCK_BYTES) {
+        state = hash(piece.substr(0, BLOCK_BYTES), state);
+        piece.remove_prefix(BLOCK_BYTES);
+    }
+    std::memcpy(block, piece.data(), piece.size());
+    pending = piece.size();
+}
+
+uint64_t Stream::digest() const {
+    return hash(std::string_view(block, pending), state ^ mix(length));
+}
+
+void Stream::reset() {
+    state = 0;
+    length = 0;
+    pending = 0;
+}
+
+}  // namespace Hash64
@@ -0,0 +1,255 @@
+#include "host_scheduler.h"
+#include "robots_rules.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// First back-off after a 429/503 when no crawl delay is configured
+const int MIN_BACKOFF_MS = 1000;
+
+}  // namespace
+
+bool HostScheduler::item_less(const Item& a, const Item& b) {
+    if (a.entry.priority != b.entry.priority) return a.entry.priority < b.entry.priority;
+    return a.sequence > b.sequence;
+}
+
+bool HostScheduler::ready_less(const ReadyEntry& a, const ReadyEntry& b) {
+    if (a.priority != b.priority) return a.priority < b.priority;
+    return a.sequence > b.sequence;
+}
+
+bool HostScheduler::waiting_less(const WaitingEntry& a, const WaitingEntry& b) {
+    return a.time_ms > b.time_ms;
+}
+
+void HostScheduler::set_policy(const HostPolicy& new_policy) {
+    policy = new_policy;
+    if (policy.max_connections < 1) {
+        policy.max_connections = 1;
+    }
+}
+
+uint32_t HostScheduler::host_id(std::string_view host) {
+    auto it = host_ids.find(host);
+    if (it != host_ids.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(hosts.size());
+    hosts.emplace_back();
+    HostQueue& queue = hosts.back();
+    queue.name.assign(host.data(), host.size());
+    queue.crawl_delay_ms = policy.crawl_delay_ms;
+    queue.gated = policy.wait_for_robots;
+    host_ids.emplace(queue.name, id);
+    return id;
+}
+
+bool HostScheduler::push(std::string_view host, FrontierEntry&& entry, int64_t now_ms) {
+    uint32_t id = host_id(host);
+    HostQueue& queue = hosts[id];
+    if (queue.robots && !queue.robots->allowed(path_of(entry.url))) {
+        return false;
+    }
+
+    uint64_t sequence = next_sequence++;
+    queue.urls.push_back(Item{std::move(entry), sequence});
+    std::push_heap(queue.urls.begin(), queue.urls.end(), item_less);
+    queued++;
+
+    if (!queue.scheduled) {
+        if (!queue.gated && queue.inflight < policy.max_connections) {
+            schedule(id, now_ms);
+        }
+    } else if (queue.ready && queue.urls.front().sequence == sequence) {
+        // The new URL is now the host's best: re-key its ready entry and
+        // let the old one go stale
+        queue.version++;
+        push_ready(id);
+    }
+    return true;
+}
+
+size_t HostScheduler::set_robots(std::string_view host, std::shared_ptr<const RobotsRules> rules,
+                                 int64_t now_ms) {
+    uint32_t id = host_id(host);
+    HostQueue& queue = hosts[id];
+    int robots_delay = std::min(rules->crawl_delay_ms(), policy.max_crawl_delay_ms);
+    queue.crawl_delay_ms = std::max(policy.crawl_delay_ms, robots_delay);
+    queue.robots = std::move(rules);
+    queue.gated = false;
+
+    // Drop what was queued while the rules were being fetched
+    size_t before = queue.urls.size();
+    const RobotsRules& robots = *queue.robots;
+    queue.urls.erase(std::remove_if(queue.urls.begin(), queue.urls.end(),
+                                    [&](const Item& item) {
+                                        return !robots.allowed(path_of(item.entry.url));
+                                    }),
+                     queue.urls.end());
+    size_t dropped = before - queue.urls.size();
+    queued -= dropped;
+    if (queue.urls.empty()) {
+        std::vector<Item>().swap(queue.urls);
+    } else if (dropped > 0) {
+        std::make_heap(queue.urls.begin(), queue.urls.end(), item_less);
+    }
+
+    // Its heap entries may point at a dropped URL: re-key them
+    queue.scheduled = false;
+    queue.ready = false;
+    if (!queue.urls.empty() && queue.inflight < policy.max_connections) {
+        schedule(id, now_ms);
+    }
+    return dropped;
+}
+
+bool HostScheduler::has_host(std::string_view host) const {
+    return host_ids.find(host) != host_ids.end();
+}
+
+void HostScheduler::push_ready(uint32_t id) {
+    const HostQueue& queue = hosts[id];
+    ready_heap.push_back(ReadyEntry{queue.urls.front().entry.priority,
+                                    queue.urls.front().sequence, id, queue.version});
+    std::push_heap(ready_heap.begin(), ready_heap.end(), ready_less);
+}
+
+void HostScheduler::schedule(uint32_t id, int64_t now_ms) {
+    HostQueue& queue = hosts[id];
+    queue.version++;
+    queue.scheduled = true;
+    queue.ready = queue.next_allowed_ms <= now_ms;
+
+    if (queue.ready) {
+        push_ready(id);
+    } else {
+        waiting_heap.push_back(WaitingEntry{queue.next_allowed_ms, id, queue.version});
+        std::push_heap(waiting_heap.begin(), waiting_heap.end(), waiting_less);
+    }
+}
+
+void HostScheduler::promote(int64_t now_ms) {
+    while (!waiting_heap.empty() && waiting_heap.front().time_ms <= now_ms) {
+        WaitingEntry top = waiting_heap.front();
+        std::pop_heap(waiting_heap.begin(), waiting_heap.end(), waiting_less);
+        waiting_heap.pop_back();
+
+        HostQueue& queue = hosts[top.host];
+        if (queue.version != top.version || !queue.scheduled || queue.ready) {
+            continue;
+        }
+        queue.ready = true;
+        push_ready(top.host);
+    }
+}
+
+bool HostScheduler::pop(int64_t now_ms, FrontierEntry& entry, int64_t& next_ready_ms) {
+    promote(now_ms);
+
+    while (!ready_heap.empty()) {
+        ReadyEntry top = ready_heap.front();
+        std::pop_heap(ready_heap.begin(), ready_heap.end(), ready_less);
+        ready_heap.pop_back();
+
+        HostQueue& queue = hosts[top.host];
+        if (queue.version != top.version || !queue.ready) {
+            continue;
+        }
+
+        std::pop_heap(queue.urls.begin(), queue.urls.end(), item_less);
+        entry = std::move(queue.urls.back().entry);
+        queue.urls.pop_back();
+        queued--;
+
+        queue.scheduled = false;
+        queue.ready = false;
+        if (queue.inflight++ == 0) {
+            queue.busy_slot = static_cast<uint32_t>(busy.size());
+            busy.push_back(top.host);
+        }
+        queue.next_allowed_ms = now_ms + queue.crawl_delay_ms;
+
+        if (queue.urls.empty()) {
+            // Most hosts are seen once; don't keep their heap capacity
+            std::vector<Item>().swap(queue.urls);
+        } else if (queue.inflight < policy.max_connections) {
+            schedule(top.host, now_ms);
+        }
+        return true;
+    }
+
+    next_ready_ms = waiting_heap.empty() ? -1 : waiting_heap.front().time_ms;
+    return false;
+}
+
+bool HostScheduler::release(std::string_view host, long http_code, int64_t now_ms) {
+    auto it = host_ids.find(host);
+    if (it == host_ids.end()) {
+        return false;
+    }
+
+    uint32_t id = it->second;
+    HostQueue& queue = hosts[id];
+    if (queue.inflight > 0 && --queue.inflight == 0) {
+        // Swap-remove from the busy list
+        uint32_t last = busy.back();
+        busy[queue.busy_slot] = last;
+        hosts[last].busy_slot = queue.busy_slot;
+        busy.pop_back();
+    }
+
+    if (http_code == 429 || http_code == 503) {
+        // Throttled: back off exponentially and give the slot to other hosts
+        int first = std::min(std::max(MIN_BACKOFF_MS, queue.crawl_delay_ms), policy.max_backoff_ms);
+        queue.backoff_ms = queue.backoff_ms > 0 ? std::min(queue.backoff_ms * 2, policy.max_backoff_ms)
+                                                : first;
+        queue.next_allowed_ms = std::max(queue.next_allowed_ms, now_ms + queue.backoff_ms);
+        // Re-schedule below at the new time; older heap entries go stale
+        queue.scheduled = false;
+        queue.ready = false;
+        backoffs++;
+    } else if (http_code > 0) {
+        queue.backoff_ms = 0;
+    }
+
+    if (!queue.scheduled && !queue.gated && !queue.urls.empty() &&
+        queue.inflight < policy.max_connections) {
+        schedule(id, now_ms);
+    }
+    return queue.ready;
+}
+
+size_t HostScheduler::size() const {
+    return queued;
+}
+
+size_t HostScheduler::host_count() const {
+    return hosts.size();
+}
+
+uint64_t HostScheduler::backoff_count() const {
+    return backoffs;
+}
+
+void HostScheduler::busy_hosts(std::vector<HostLoad>& out) const {
+    for (uint32_t id : busy) {
+        out.push_back(HostLoad{hosts[id].name, hosts[id].inflight});
+    }
+}
+
+std::string_view HostScheduler::host_key(std::string_view url) {
+    size_t begin = url.find("://");
+    begin = (begin == std::string_view::npos) ? 0 : begin + 3;
+    size_t end = url.find_first_of("/?#", begin);
+    if (end == std::string_view::npos) {
+        end = url.size();
+    }
+    return url.substr(begin, end - begin);
+}
+
+std::string_view HostScheduler::path_of(std::string_view url) {
+    std::string_view host = host_key(url);
+    return url.substr(static_cast<size_t>(host.data() - url.data()) + host.size());
+}
@@ -0,0 +1,273 @@
+#include "incremental_pagerank.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Pushes between checks for new batches, so producers never wait long
+const size_t PUSH_BUDGET = 65536;
+
+// Minimum spacing between snapshots while work keeps arriving
+const std::chrono::milliseconds PUBLISH_INTERVAL(200);
+
+}  // namespace
+
+IncrementalPageRank::~IncrementalPageRank() {
+    stop();
+}
+
+void IncrementalPageRank::start(double damping_factor, double push_threshold) {
+    if (running()) {
+        return;
+    }
+    damping = damping_factor;
+    threshold = push_threshold;
+    stopping = false;
+    std::atomic_store(&published, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>()));
+    active.store(true, std::memory_order_release);
+    worker = std::thread(&IncrementalPageRank::run, this);
+}
+
+void IncrementalPageRank::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        stopping = true;
+    }
+    pending_cv.notify_one();
+    worker.join();
+    active.store(false, std::memory_order_release);
+}
+
+void IncrementalPageRank::update_out_edges(uint32_t source, std::vector<WeightedEdge> targets) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending.push_back(Batch{source, std::move(targets)});
+    }
+    pending_cv.notify_one();
+}
+
+void IncrementalPageRank::add_out_edges(uint32_t source, std::vector<WeightedEdge> targets) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending.push_back(Batch{source, std::move(targets), true});
+    }
+    pending_cv.notify_one();
+}
+
+std::shared_ptr<const IncrementalPageRank::Snapshot> IncrementalPageRank::snapshot() const {
+    return std::atomic_load(&published);
+}
+
+double IncrementalPageRank::rank(uint32_t id) const {
+    auto snap = snapshot();
+    if (!snap || id >= snap->scores.size() || snap->total <= 0.0) {
+        return 0.0;
+    }
+    return snap->scores[id] / snap->total;
+}
+
+std::vector<double> IncrementalPageRank::estimates(size_t num_nodes) const {
+    std::vector<double> out(num_nodes, 0.0);
+    auto snap = snapshot();
+    if (!snap || snap->total <= 0.0) {
+        return out;
+    }
+    size_t n = std::min(num_nodes, snap->scores.size());
+    double inv_total = 1.0 / snap->total;
+    for (size_t v = 0; v < n; v++) {
+        out[v] = snap->scores[v] * inv_total;
+    }
+    return out;
+}
+
+std::vector<std::pair<uint32_t, double>> IncrementalPageRank::top(size_t k) const {
+    std::vector<std::pair<uint32_t, double>> best;
+    auto snap = snapshot();
+    if (!snap || snap->total <= 0.0 || k == 0) {
+        return best;
+    }
+
+    // Min-heap of the k best seen so far
+    auto worse = [](const std::pair<uint32_t, double>& a, const std::pair<uint32_t, double>& b) {
+        return a.second > b.second;
+    };
+    for (size_t v = 0; v < snap->scores.size(); v++) {
+        double score = snap->scores[v] / snap->total;
+        if (best.size() < k) {
+            best.emplace_back(static_cast<uint32_t>(v), score);
+            std::push_heap(best.begin(), best.end(), worse);
+        } else if (score > best.front().second) {
+            std::pop_heap(best.begin(), best.end(), worse);
+            best.back() = {static_cast<uint32_t>(v), score};
+            std::push_heap(best.begin(), best.end(), worse);
+        }
+    }
+    std::sort_heap(best.begin(), best.end(), worse);
+    return best;
+}
+
+void IncrementalPageRank::ensure_node(uint32_t id) {
+    if (id < estimate.size()) {
+        return;
+    }
+    size_t old_size = estimate.size();
+    size_t new_size = static_cast<size_t>(id) + 1;
+    out_edges.resize(new_size);
+    out_weight.resize(new_size, 0);
+    estimate.resize(new_size, 0.0);
+    residual.resize(new_size, 0.0);
+    queued.resize(new_size, 0);
+
+    // Every node brings its own teleport mass
+    for (size_t v = old_size; v < new_size; v++) {
+        add_residual(static_cast<uint32_t>(v), 1.0 - damping);
+    }
+}
+
+double IncrementalPageRank::limit(uint32_t id) const {
+    uint64_t degree = out_weight[id];
+    return threshold * static_cast<double>(std::max<uint64_t>(degree, 1));
+}
+
+void IncrementalPageRank::add_residual(uint32_t id, double delta) {
+    residual[id] += delta;
+    double magnitude = std::fabs(residual[id]);
+    if (!queued[id] && magnitude > limit(id)) {
+        queued[id] = 1;
+        work.emplace(magnitude, id);
+    }
+}
+
+void IncrementalPageRank::apply(Batch& batch) {
+    uint32_t u = batch.source;
+    ensure_node(u);
+    if (batch.add && u < out_edges.size() && !out_edges[u].empty()) {
+        // The new link set is the union, counts added up; both lists are
+        // ordered by target, so one merge pass does it
+        std::vector<WeightedEdge> merged(out_edges[u].size() + batch.targets.size());
+        std::merge(out_edges[u].begin(), out_edges[u].end(), batch.targets.begin(), batch.targets.end(),
+                   merged.begin(),
+                   [](const WeightedEdge& a, const WeightedEdge& b) { return a.target < b.target; });
+        size_t out = 0;
+        for (size_t i = 0; i < merged.size(); i++) {
+            if (out > 0 && merged[out - 1].target == merged[i].target) {
+                merged[out - 1].weight += merged[i].weight;
+            } else {
+                merged[out++] = merged[i];
+            }
+        }
+        merged.resize(out);
+        batch.targets.swap(merged);
+    }
+    uint64_t new_weight = 0;
+    for (const WeightedEdge& edge : batch.targets) {
+        ensure_node(edge.target);
+        new_weight += edge.weight;
+    }
+
+    // u's current estimate was spread over the old links; move that
+    // share to the new links (residuals may go negative, pushes are signed)
+    std::vector<WeightedEdge>& links = out_edges[u];
+    double p = estimate[u];
+    if (p != 0.0) {
+        if (out_weight[u] > 0) {
+            double share = damping * p / static_cast<double>(out_weight[u]);
+            for (const WeightedEdge& edge : links) {
+                add_residual(edge.target, -share * edge.weight);
+            }
+        }
+        if (new_weight > 0) {
+            double share = damping * p / static_cast<double>(new_weight);
+            for (const WeightedEdge& edge : batch.targets) {
+                add_residual(edge.target, share * edge.weight);
+            }
+        }
+    }
+    links.swap(batch.targets);
+    out_weight[u] = new_weight;
+    batches++;
+}
+
+void IncrementalPageRank::push(uint32_t u) {
+    double r = residual[u];
+    residual[u] = 0.0;
+    estimate[u] += r;
+    pushes++;
+
+    const std::vector<WeightedEdge>& links = out_edges[u];
+    if (out_weight[u] == 0) {
+        return;                         // Dangling: mass stays here
+    }
+    double share = damping * r / static_cast<double>(out_weight[u]);
+    for (const WeightedEdge& edge : links) {
+        add_residual(edge.target, share * edge.weight);
+    }
+}
+
+void IncrementalPageRank::publish() {
+    auto snap = std::make_shared<Snapshot>();
+    snap->scores = estimate;
+    for (double p : estimate) {
+        snap->total += p;
+    }
+    snap->pushes = pushes;
+    snap->batches = batches;
+    std::atomic_store(&published, std::shared_ptr<const Snapshot>(std::move(snap)));
+}
+
+void IncrementalPageRank::run() {
+    auto last_publish = std::chrono::steady_clock::now();
+    bool dirty = false;
+    std::vector<Batch> batch_list;
+
+    while (true) {
+        bool finishing;
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex);
+            if (work.empty()) {
+                pending_cv.wait(lock, [this]() { return stopping || !pending.empty(); });
+            }
+            batch_list.swap(pending);
+            finishing = stopping;
+        }
+
+        for (auto& batch : batch_list) {
+            apply(batch);
+        }
+        dirty |= !batch_list.empty();
+        batch_list.clear();
+
+        // Largest residual first; stale entries are skipped
+        size_t budget = finishing ? SIZE_MAX : PUSH_BUDGET;
+        while (!work.empty() && budget > 0) {
+            uint32_t u = work.top().second;
+            work.pop();
+            queued[u] = 0;
+            if (std::fabs(residual[u]) > limit(u)) {
+                push(u);
+                budget--;
+                dirty = true;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (dirty && (work.empty() || now - last_publish >= PUBLISH_INTERVAL)) {
+            publish();
+            last_publish = now;
+            dirty = false;
+        }
+
+        if (finishing && work.empty()) {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            if (pending.empty()) {
+                break;
+            }
+        }
+    }
+
+    publish();
+}
@@ -0,0 +1,318 @@
+#include "link_scanner.h"
+#include "simd_scan.h"
+#include <algorithm>
+
+namespace {
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+inline bool is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline char lower_ascii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+inline std::string_view trim_view(std::string_view value) {
+    size_t first = 0;
+    while (first < value.size() && is_space(value[first])) first++;
+    size_t last = value.size();
+    while (last > first && is_space(value[last - 1])) last--;
+    return value.substr(first, last - first);
+}
+
+}  // namespace
+
+LinkScanner::LinkScanner(std::string_view html_view) : html(html_view), keep_from(html_view.size()) {}
+
+LinkScanner::LinkScanner(std::string_view html_view, LinkScanState& state, bool last)
+    : html(html_view), stream(&state), partial(!last), resume_mode(state.mode),
+      keep_from(html_view.size()) {
+    if (resume_mode == LinkScanState::Mode::Tag) {
+        // The tag name was carried over; its attributes start this buffer
+        in_tag = true;
+        tag = state.name;
+        resume_mode = LinkScanState::Mode::Text;
+    }
+}
+
+size_t LinkScanner::consumed() const {
+    return keep_from;
+}
+
+void LinkScanner::stall(size_t from, LinkScanState::Mode mode, std::string_view name) {
+    stream->mode = mode;
+    stream->name = std::string(name);  // name may view the old value
+    keep_from = from;
+    stalled = true;
+    in_tag = false;
+    pos = html.size();
+}
+
+size_t LinkScanner::find_byte(size_t from, char c) const {
+    const char* begin = html.data();
+    const char* hit = Simd::find_char(begin + from, begin + html.size(), c);
+    return static_cast<size_t>(hit - begin);
+}
+
+bool LinkScanner::name_equals(std::string_view name, std::string_view lower) {
+    if (name.size() != lower.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < name.size(); i++) {
+        if (lower_ascii(name[i]) != lower[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LinkScanner::skip_past(std::string_view needle, LinkScanState::Mode mode) {
+    const size_t start = pos;
+    while (true) {
+        size_t found = find_byte(pos, needle[0]);
+        if (found >= html.size()) {
+            if (partial) {
+                // Keep just enough to match a needle split across buffers
+                size_t tail = needle.size() - 1;
+                size_t from = html.size() - std::min(html.size() - start, tail);
+                stall(from, mode);
+                return;
+            }
+            pos = html.size();
+            return;
+        }
+        if (html.compare(found, needle.size(), needle) == 0) {
+            pos = found + needle.size();
+            return;
+        }
+        pos = found + 1;
+    }
+}
+
+void LinkScanner::skip_raw_text(std::string_view closing_name) {
+    // Raw text ends at "</name" followed by a non-name character
+    while (pos < html.size()) {
+        size_t lt = find_byte(pos, '<');
+        if (lt + 1 >= html.size()) {
+            if (partial) {
+                stall(std::min(lt, html.size()), LinkScanState::Mode::RawText, closing_name);
+                return;
+            }
+            pos = html.size();
+            return;
+        }
+        if (html[lt + 1] != '/') {
+            pos = lt + 1;
+            continue;
+        }
+        size_t name_start = lt + 2;
+        if (partial && name_start + closing_name.size() >= html.size()) {
+            // Can't tell yet whether this is the closing tag
+            stall(lt, LinkScanState::Mode::RawText, closing_name);
+            return;
+        }
+        if (name_start + closing_name.size() <= html.size() &&
+            name_equals(html.substr(name_start, closing_name.size()), closing_name)) {
+            size_t after = name_start + closing_name.size();
+            if (after >= html.size() || !is_alpha(html[after])) {
+                pos = lt;
+                return;
+            }
+        }
+        pos = lt + 2;
+    }
+    if (partial) {
+        stall(html.size(), LinkScanState::Mode::RawText, closing_name);
+    }
+}
+
+bool LinkScanner::skip_non_start_tag() {
+    // pos is at '<'
+    if (pos + 1 >= html.size()) {
+        if (partial) {
+            stall(pos, LinkScanState::Mode::Text);
+            return true;
+        }
+        pos = html.size();
+        return true;
+    }
+
+    char c = html[pos + 1];
+    if (c == '!') {
+        if (partial && pos + 4 > html.size()) {
+            stall(pos, LinkScanState::Mode::Text);     // Comment or not: undecided
+        } else if (html.compare(pos, 4, "<!--") == 0) {
+            pos += 4;
+            skip_past("-->", LinkScanState::Mode::Comment);
+        } else {
+            skip_past(">", LinkScanState::Mode::Markup);   // <!DOCTYPE ...>, <![CDATA[ ...>
+        }
+        return true;
+    }
+    if (c == '?' || c == '/') {
+        skip_past(">", LinkScanState::Mode::Markup);   // Processing instruction or end tag
+        return true;
+    }
+    if (!is_alpha(c)) {
+        pos++;                         // Stray '<' in text
+        return true;
+    }
+    return false;
+}
+
+void LinkScanner::end_start_tag() {
+    in_tag = false;
+    if (name_equals(tag, "script")) {
+        skip_raw_text("script");
+    } else if (name_equals(tag, "style")) {
+        skip_raw_text("style");
+    }
+}
+
+bool LinkScanner::scan_attributes(LinkToken& token) {
+    const size_t n = html.size();
+    const char* base = html.data();
+
+    while (pos < n) {
+        // A streamed buffer that ends inside this attribute resumes here
+        size_t attr_start = pos;
+
+        // Jump straight to the next '=' or '>': attribute names and
+        // valueless attributes are never inspected byte by byte
+        size_t hit = static_cast<size_t>(
+            Simd::find_char2(base + pos, base + n, '=', '>') - base);
+        if (hit >= n) {
+            break;
+        }
+        if (html[hit] == '>') {
+            pos = hit + 1;
+            end_start_tag();
+            return false;
+        }
+
+        // Walk back from '=' over whitespace, then over the name
+        size_t name_end = hit;
+        while (name_end > pos && is_space(html[name_end - 1])) name_end--;
+        size_t name_start = name_end;
+        while (name_start > pos && !is_space(html[name_start - 1]) &&
+               html[name_start - 1] != '/' && html[name_start - 1] != '"' &&
+               html[name_start - 1] != '\'') {
+            name_start--;
+        }
+        std::string_view name = html.substr(name_start, name_end - name_start);
+
+        pos = hit + 1;
+        while (pos < n && is_space(html[pos])) pos++;
+        if (pos >= n) {
+            pos = attr_start;
+            break;
+        }
+
+        // Attribute value: quoted or unquoted
+        std::string_view value;
+        char quote = html[pos];
+        if (quote == '"' || quote == '\'') {
+            size_t value_start = pos + 1;
+            size_t close = find_byte(value_start, quote);
+            if (close >= n) {
+                pos = attr_start;
+                break;
+            }
+            value = html.substr(value_start, close - value_start);
+            pos = close + 1;
+        } else {
+            size_t value_start = pos;
+            while (pos < n && !is_space(html[pos]) && html[pos] != '>') pos++;
+            if (pos >= n && partial) {
+                pos = attr_start;       // The value may go on in the next buffer
+                break;
+            }
+            value = html.substr(value_start, pos - value_start);
+        }
+
+        bool is_href = name_equals(name, "href");
+        if (is_href || name_equals(name, "src")) {
+            value = trim_view(value);
+            if (!value.empty()) {
+                token.url = value;
+                token.tag = tag;
+                token.attr = is_href ? LinkAttr::Href : LinkAttr::Src;
+                return true;
+            }
+        }
+    }
+
+    if (partial) {
+        stall(std::min(pos, n), LinkScanState::Mode::Tag, tag);
+        return false;
+    }
+    pos = n;
+    in_tag = false;
+    return false;
+}
+
+bool LinkScanner::next(LinkToken& token) {
+    const size_t n = html.size();
+
+    if (resume_mode != LinkScanState::Mode::Text) {
+        // Finish the construct the previous buffer ended in
+        LinkScanState::Mode mode = resume_mode;
+        resume_mode = LinkScanState::Mode::Text;
+        if (mode == LinkScanState::Mode::Comment) {
+            skip_past("-->", mode);
+        } else if (mode == LinkScanState::Mode::Markup) {
+            skip_past(">", mode);
+        } else {
+            skip_raw_text(stream->name);
+        }
+    }
+
+    while (!stalled) {
+        if (in_tag) {
+            if (scan_attributes(token)) {
+                return true;
+            }
+            continue;
+        }
+
+        size_t lt = find_byte(pos, '<');
+        if (text_sink) {
+            text_sink->text(html.substr(pos, std::min(lt, n) - pos));
+            if (lt < n) {
+                text_sink->boundary();
+            }
+        }
+        if (lt >= n) {
+            pos = n;
+            break;
+        }
+        pos = lt;
+
+        if (skip_non_start_tag()) {
+            continue;
+        }
+
+        // Start tag name
+        size_t name_start = pos + 1;
+        pos = name_start;
+        while (pos < n && !is_space(html[pos]) && html[pos] != '>' && html[pos] != '/') {
+            pos++;
+        }
+        if (pos >= n && partial) {
+            stall(lt, LinkScanState::Mode::Text);
+            break;
+        }
+        tag = html.substr(name_start, pos - name_start);
+        in_tag = true;
+    }
+
+    if (partial && !stalled) {
+        stream->mode = LinkScanState::Mode::Text;
+        stream->name.clear();
+    }
+    return false;
+}
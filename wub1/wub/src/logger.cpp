@@ -0,0 +1,372 @@
+#include "logger.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t RECORD_BYTES = 256;
+const size_t RING_SLOTS = 1024;                 // Power of two
+
+// The writer wakes this often; a ring only fills if its thread logs
+// RING_SLOTS records faster than that
+const std::chrono::milliseconds DRAIN_INTERVAL(20);
+
+struct Record {
+    uint64_t time_ns;           // Since Log::start()
+    uint64_t key;
+    uint64_t a;
+    uint64_t b;
+    LogLevel level;
+    LogEvent what;
+    uint16_t text_size;
+    char text[RECORD_BYTES - 4 * sizeof(uint64_t) - 4];
+};
+static_assert(sizeof(Record) == RECORD_BYTES, "log records are fixed-size slots");
+
+// Single producer (its thread), single consumer (whoever holds drain_mutex)
+struct Ring {
+    alignas(64) std::atomic<uint64_t> head{0};  // Next slot the producer fills
+    alignas(64) std::atomic<uint64_t> tail{0};  // Next slot the consumer reads
+    std::atomic<uint64_t> dropped{0};
+    std::string name;                           // Changed only under drain_mutex
+    Record slots[RING_SLOTS];
+};
+
+struct EventFormat {
+    const char* name;
+    const char* a;              // Field names; nullptr when unused
+    const char* b;
+    const char* text;
+};
+
+// Indexed by LogEvent
+const EventFormat FORMATS[] = {
+    {"message", nullptr, nullptr, "text"},
+    {"page_fetched", "bytes", "truncated", "domain"},
+    {"fetch_failed", nullptr, nullptr, "url"},
+    {"url_rejected", nullptr, nullptr, "url"},
+    {"links_found", "links", "domains", nullptr},
+    {"urls_enqueued", "new", nullptr, nullptr},
+    {"near_duplicate", "links", nullptr, nullptr},
+    {"worker_stopped", "pages", nullptr, nullptr},
+};
+
+// Indexed by LogLevel
+const char* LEVEL_NAMES[] = {"ERROR", "WARN", "INFO", "DEBUG"};
+
+// Read on every call without a lock
+std::atomic<bool> active{false};
+std::atomic<int> max_level{static_cast<int>(LogLevel::Info)};
+std::atomic<uint32_t> sample_every{1};
+std::atomic<uint64_t> sampled_out{0};
+std::atomic<uint64_t> written{0};
+std::chrono::steady_clock::time_point started_at;
+
+// Rings are kept until exit: a thread may log after stop()
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<Ring>> rings;
+thread_local Ring* my_ring = nullptr;
+
+// Drain state
+struct Pending {
+    Record record;
+    const Ring* ring;
+};
+std::mutex drain_mutex;
+std::vector<Pending> batch;
+std::string out_buffer;
+int out_fd = STDOUT_FILENO;
+
+// Writer thread
+std::mutex writer_mutex;
+std::condition_variable writer_cv;
+bool stopping = false;
+std::thread writer;
+
+Ring* register_ring(std::string name) {
+    auto ring = std::make_unique<Ring>();
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    if (name.empty()) {
+        name = "thread" + std::to_string(rings.size());
+    }
+    ring->name = std::move(name);
+    my_ring = ring.get();
+    rings.push_back(std::move(ring));
+    return my_ring;
+}
+
+void append_number(std::string& out, uint64_t value) {
+    char digits[24];
+    int n = std::snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(value));
+    out.append(digits, static_cast<size_t>(n));
+}
+
+// Values with spaces, quotes or '=' are quoted so lines stay splittable
+void append_value(std::string& out, std::string_view value) {
+    bool plain = !value.empty() && value.find_first_of(" \t\"=\\") == std::string_view::npos;
+    if (plain) {
+        out.append(value);
+        return;
+    }
+    out.push_back('"');
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+void format_record(const Pending& pending, std::string& out) {
+    const Record& r = pending.record;
+    const EventFormat& format = FORMATS[static_cast<size_t>(r.what)];
+
+    char stamp[48];
+    int n = std::snprintf(stamp, sizeof(stamp), "%llu.%06llu ",
+                          static_cast<unsigned long long>(r.time_ns / 1000000000ULL),
+                          static_cast<unsigned long long>((r.time_ns / 1000ULL) % 1000000ULL));
+    out.append(stamp, static_cast<size_t>(n));
+    out.append(LEVEL_NAMES[static_cast<size_t>(r.level)]);
+    out.push_back(' ');
+    out.append(pending.ring->name);
+    out.push_back(' ');
+    out.append(format.name);
+    if (r.key != 0) {
+        n = std::snprintf(stamp, sizeof(stamp), " page=%016llx", static_cast<unsigned long long>(r.key));
+        out.append(stamp, static_cast<size_t>(n));
+    }
+    if (format.a) {
+        out.push_back(' ');
+        out.append(format.a);
+        out.push_back('=');
+        append_number(out, r.a);
+    }
+    if (format.b) {
+        out.push_back(' ');
+        out.append(format.b);
+        out.push_back('=');
+        append_number(out, r.b);
+    }
+    if (format.text) {
+        out.push_back(' ');
+        out.append(format.text);
+        out.push_back('=');
+        append_value(out, std::string_view(r.text, r.text_size));
+    }
+    out.push_back('\n');
+}
+
+void write_out(const std::string& data) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::write(out_fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;                     // Nowhere left to report it
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+}
+
+// Move every queued record out of the rings and write them in time order
+void drain() {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    batch.clear();
+    {
+        std::lock_guard<std::mutex> rings_lock(rings_mutex);
+        for (const auto& ring : rings) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            for (; tail < head; tail++) {
+                batch.push_back(Pending{ring->slots[tail & (RING_SLOTS - 1)], ring.get()});
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    // Each ring is already in order; stable keeps a thread's ties in order
+    std::stable_sort(batch.begin(), batch.end(), [](const Pending& x, const Pending& y) {
+        return x.record.time_ns < y.record.time_ns;
+    });
+    out_buffer.clear();
+    for (const Pending& pending : batch) {
+        format_record(pending, out_buffer);
+    }
+    write_out(out_buffer);
+    written.fetch_add(batch.size(), std::memory_order_relaxed);
+}
+
+void writer_loop() {
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (!stopping) {
+        writer_cv.wait_for(lock, DRAIN_INTERVAL, []() { return stopping; });
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+}  // namespace
+
+namespace Log {
+
+void start(const LogOptions& options) {
+    if (active.load(std::memory_order_acquire)) {
+        return;
+    }
+    if (!options.path.empty()) {
+        int fd = ::open(options.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open log file " + options.path + ": " +
+                                     std::strerror(errno));
+        }
+        out_fd = fd;
+    }
+    max_level.store(static_cast<int>(options.level), std::memory_order_relaxed);
+    sample_every.store(std::max<uint32_t>(options.sample, 1), std::memory_order_relaxed);
+    started_at = std::chrono::steady_clock::now();
+    stopping = false;
+    active.store(true, std::memory_order_release);
+    writer = std::thread(writer_loop);
+}
+
+void stop() {
+    if (!writer.joinable()) {
+        return;
+    }
+    active.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        stopping = true;
+    }
+    writer_cv.notify_one();
+    writer.join();
+    drain();
+    if (out_fd != STDOUT_FILENO) {
+        ::close(out_fd);
+        out_fd = STDOUT_FILENO;
+    }
+}
+
+void flush() {
+    drain();
+}
+
+void set_thread_name(std::string_view name) {
+    if (my_ring) {
+        std::lock_guard<std::mutex> lock(drain_mutex);
+        my_ring->name = std::string(name);
+        return;
+    }
+    register_ring(std::string(name));
+}
+
+bool enabled(LogLevel level) {
+    return active.load(std::memory_order_acquire) &&
+           static_cast<int>(level) <= max_level.load(std::memory_order_relaxed);
+}
+
+void event(LogLevel level, LogEvent what, uint64_t key, uint64_t a, uint64_t b,
+           std::string_view text) {
+    if (!enabled(level)) {
+        return;
+    }
+    if (key != 0) {
+        uint32_t every = sample_every.load(std::memory_order_relaxed);
+        if (every > 1 && key % every != 0) {
+            sampled_out.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    Ring* ring = my_ring ? my_ring : register_ring(std::string());
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Record& r = ring->slots[head & (RING_SLOTS - 1)];
+    r.time_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started_at).count());
+    r.key = key;
+    r.a = a;
+    r.b = b;
+    r.level = level;
+    r.what = what;
+    size_t n = std::min(text.size(), sizeof(r.text));
+    if (n > 0) {
+        std::memcpy(r.text, text.data(), n);   // A default text has null data
+    }
+    r.text_size = static_cast<uint16_t>(n);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void message(LogLevel level, std::string_view text) {
+    event(level, LogEvent::Message, 0, 0, 0, text);
+}
+
+LogCounters counters() {
+    LogCounters totals;
+    totals.written = written.load(std::memory_order_relaxed);
+    totals.sampled_out = sampled_out.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    for (const auto& ring : rings) {
+        totals.dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+bool parse_level(const std::string& name, LogLevel& level) {
+    if (name == "error") {
+        level = LogLevel::Error;
+    } else if (name == "warning") {
+        level = LogLevel::Warning;
+    } else if (name == "info") {
+        level = LogLevel::Info;
+    } else if (name == "debug") {
+        level = LogLevel::Debug;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::Error: return "error";
+        case LogLevel::Warning: return "warning";
+        case LogLevel::Info: return "info";
+        case LogLevel::Debug: return "debug";
+    }
+    return "info";
+}
+
+}  // namespace Log
+
+namespace {
+
+// Declared after the state above, so it is destroyed first: an early
+// return from main still writes out the log and joins the writer
+struct StopAtExit {
+    ~StopAtExit() { Log::stop(); }
+} stop_at_exit;
+
+}  // namespace
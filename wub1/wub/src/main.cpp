@@ -5,26 +5,331 @@
 #include <fstream>
 #include <thread_manager.h>
 #include <storage_manager.h>
+#include <crawl_config.h>
+#include <metrics_server.h>
+#include <cluster_node.h>
+#include <utils.h>
 
 void print_usage(const char* program_name) {
     std::cout << "\n╔═══════════════════════════════════════════════════════════╗" << std::endl;
     std::cout << "║         Multithreaded Web Crawler (Lock-Free)           ║" << std::endl;
     std::cout << "╚═══════════════════════════════════════════════════════════╝" << std::endl;
-    std::cout << "\nUsage: " << program_name << " <seed_url> <max_pages> <num_threads>" << std::endl;
+    std::cout << "\nUsage: " << program_name << " <seed_url> <max_pages> <num_threads> [options]" << std::endl;
     std::cout << "\nArguments:" << std::endl;
     std::cout << "  seed_url     - Starting URL (e.g., https://example.com)" << std::endl;
     std::cout << "  max_pages    - Maximum number of pages to crawl (e.g., 100)" << std::endl;
-    std::cout << "  num_threads  - Number of worker threads (e.g., 4)" << std::endl;
+    std::cout << "  num_threads  - Number of parser worker threads (e.g., 4)" << std::endl;
+    std::cout << "\nOptions:" << std::endl;
+    std::cout << "  --io-threads <n>    - Event-loop threads driving downloads (default 2)" << std::endl;
+    std::cout << "  --max-inflight <n>  - Concurrent transfers across I/O threads (default 512)" << std::endl;
+    std::cout << "  --store-threads <n> - Threads that store parsed pages and queue their links (default 0 = parsers do it)" << std::endl;
+    std::cout << "  --parse-queue <n>   - Downloaded pages waiting for a parser before fetches pause (default 1024)" << std::endl;
+    std::cout << "  --store-queue <n>   - Parsed pages waiting for a store thread before parsers pause (default 1024)" << std::endl;
+    std::cout << "  --shards <n>        - Lock-striped frontier shards (default 64)" << std::endl;
+    std::cout << "  --pr-iterations <n> - PageRank iteration cap (default 30)" << std::endl;
+    std::cout << "  --pr-tolerance <x>  - Stop PageRank once the L1 change is below x (default 1e-6)" << std::endl;
+    std::cout << "  --live-pagerank <0|1> - Update ranks incrementally during the crawl (default 1)" << std::endl;
+    std::cout << "  --visited <kind>    - Visited set: exact, fingerprint or bloom (default fingerprint)" << std::endl;
+    std::cout << "  --visited-fpr <p>   - Bloom false-positive rate (default 1e-4)" << std::endl;
+    std::cout << "  --visited-capacity <n> - Bloom initial sizing in URLs (default 1000000)" << std::endl;
+    std::cout << "  --visited-mem-mb <n> - Fingerprint memory cap before spilling (needs --visited-spill)" << std::endl;
+    std::cout << "  --visited-spill <dir> - Directory for fingerprint spill runs" << std::endl;
+    std::cout << "  --host-connections <n> - Transfers in flight per host (default 4)" << std::endl;
+    std::cout << "  --crawl-delay <ms>  - Minimum gap between fetches from one host (default 0)" << std::endl;
+    std::cout << "  --robots <0|1>      - Fetch each host's robots.txt first and obey it (default 1)" << std::endl;
+    std::cout << "  --max-crawl-delay <ms> - Cap for a robots.txt Crawl-delay (default 30000)" << std::endl;
+    std::cout << "  --sitemaps <0|1>    - Queue the URLs of sitemaps listed in robots.txt (default 0)" << std::endl;
+    std::cout << "  --sitemap <url>     - Queue the URLs of this sitemap or sitemap index" << std::endl;
+    std::cout << "  --priority <kind>   - Frontier order: fifo, depth or pagerank (default depth)" << std::endl;
+    std::cout << "  --frontier-mem <n>  - Queued URLs kept in memory before spilling (needs --frontier-spill)" << std::endl;
+    std::cout << "  --frontier-spill <dir> - Directory for frontier segment files" << std::endl;
+    std::cout << "  --checkpoint <dir>  - Journal the crawl here for resuming" << std::endl;
+    std::cout << "  --checkpoint-interval <s> - Seconds between checkpoints (default 30)" << std::endl;
+    std::cout << "  --resume <dir>      - Continue the crawl checkpointed in dir" << std::endl;
+    std::cout << "  --fetch-cache <path> - Re-crawl conditionally; unchanged pages replay cached links" << std::endl;
+    std::cout << "  --stream-parse <0|1> - Parse links while bodies download (default 1)" << std::endl;
+    std::cout << "  --max-page-kb <n>   - Stop downloading a page after n KiB (default 0 = unlimited)" << std::endl;
+    std::cout << "  --max-links <n>     - Stop reading a page after n links (default 0 = unlimited)" << std::endl;
+    std::cout << "  --compression <0|1> - Ask for gzip/deflate/brotli/zstd bodies and decode them on the fly (default 1)" << std::endl;
+    std::cout << "  --max-decoded-kb <n> - Cut a compressed page once it decodes past n KiB (default 32768, 0 = unlimited)" << std::endl;
+    std::cout << "  --near-dup <bits>   - Don't follow links of pages within bits (1-7) of a recent page's SimHash (default 0 = off)" << std::endl;
+    std::cout << "  --dns-prefetch <0|1> - Resolve new hosts in the background and hand curl the addresses (default 1)" << std::endl;
+    std::cout << "  --cluster <host:port,...> - Share the crawl between these nodes (same list on every node)" << std::endl;
+    std::cout << "  --node-id <n>       - This node's index in the --cluster list (default 0, the coordinator)" << std::endl;
+    std::cout << "  --log-level <level> - error, warning, info or debug (per-URL events; default info)" << std::endl;
+    std::cout << "  --log-sample <n>    - Log per-URL events for 1 in n pages (default 1)" << std::endl;
+    std::cout << "  --log-file <path>   - Write the log here instead of stdout" << std::endl;
+    std::cout << "  --metrics-interval <s> - Seconds between stage latency dumps (default 10, 0 = end only)" << std::endl;
+    std::cout << "  --metrics-file <path> - Write the final stage latencies as CSV" << std::endl;
+    std::cout << "  --metrics-port <n>  - Serve Prometheus metrics at http://<bind>:<n>/metrics (default 0 = off)" << std::endl;
+    std::cout << "  --metrics-bind <ip> - Address of the metrics endpoint (default 127.0.0.1)" << std::endl;
+    std::cout << "  --graph-file <path> - Binary graph export (default crawl_graph.bin, \"\" = none)" << std::endl;
     std::cout << "\nExample:" << std::endl;
     std::cout << "  " << program_name << " https://example.com 100 4" << std::endl;
     std::cout << "\nOutput:" << std::endl;
     std::cout << "  crawled_pages.csv     - Pages crawled with link counts" << std::endl;
     std::cout << "  pagerank_results.csv  - PageRank scores for each domain" << std::endl;
+    std::cout << "  crawl_graph.bin       - Domains, CSR edges, visit counts and ranks (mmap-able)" << std::endl;
     std::cout << std::endl;
 }
 
+/**
+ * Parse optional --flag value pairs after the positional arguments
+ * @return false on unknown flag or malformed value
+ */
+bool parse_options(int argc, char* argv[], CrawlConfig& config) {
+    for (int i = 4; i < argc; i++) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "[ERROR] Missing value for " << flag << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        try {
+            if (flag == "--io-threads") {
+                config.io_threads = std::stoi(value);
+            } else if (flag == "--max-inflight") {
+                config.max_inflight = std::stoi(value);
+            } else if (flag == "--store-threads") {
+                config.store_threads = std::stoi(value);
+            } else if (flag == "--parse-queue") {
+                config.parse_queue = std::stoul(value);
+            } else if (flag == "--store-queue") {
+                config.store_queue = std::stoul(value);
+            } else if (flag == "--shards") {
+                config.frontier_shards = std::stoi(value);
+            } else if (flag == "--pr-iterations") {
+                config.pagerank_iterations = std::stoi(value);
+            } else if (flag == "--pr-tolerance") {
+                config.pagerank_tolerance = std::stod(value);
+            } else if (flag == "--live-pagerank") {
+                config.live_pagerank = std::stoi(value) != 0;
+            } else if (flag == "--visited") {
+                if (!VisitedSet::parse_backend(value, config.visited.backend)) {
+                    std::cerr << "[ERROR] Unknown visited set: " << value << std::endl;
+                    return false;
+                }
+            } else if (flag == "--visited-fpr") {
+                config.visited.false_positive_rate = std::stod(value);
+            } else if (flag == "--visited-capacity") {
+                config.visited.expected_urls = std::stoul(value);
+            } else if (flag == "--visited-mem-mb") {
+                config.visited.memory_budget_mb = std::stoul(value);
+            } else if (flag == "--visited-spill") {
+                config.visited.spill_dir = value;
+            } else if (flag == "--host-connections") {
+                config.politeness.max_connections = std::stoi(value);
+            } else if (flag == "--crawl-delay") {
+                config.politeness.crawl_delay_ms = std::stoi(value);
+            } else if (flag == "--robots") {
+                config.robots = std::stoi(value) != 0;
+            } else if (flag == "--max-crawl-delay") {
+                config.politeness.max_crawl_delay_ms = std::stoi(value);
+            } else if (flag == "--sitemaps") {
+                config.sitemaps = std::stoi(value) != 0;
+            } else if (flag == "--sitemap") {
+                config.sitemap_url = value;
+            } else if (flag == "--priority") {
+                if (value == "fifo") {
+                    config.priority = FrontierPriority::Fifo;
+                } else if (value == "depth") {
+                    config.priority = FrontierPriority::Depth;
+                } else if (value == "pagerank") {
+                    config.priority = FrontierPriority::PageRank;
+                } else {
+                    std::cerr << "[ERROR] Unknown priority: " << value << std::endl;
+                    return false;
+                }
+            } else if (flag == "--frontier-mem") {
+                config.frontier_spill.max_memory_urls = std::stoul(value);
+            } else if (flag == "--frontier-spill") {
+                config.frontier_spill.dir = value;
+            } else if (flag == "--checkpoint") {
+                config.checkpoint_dir = value;
+            } else if (flag == "--checkpoint-interval") {
+                config.checkpoint_interval = std::stoi(value);
+            } else if (flag == "--resume") {
+                config.checkpoint_dir = value;
+                config.resume = true;
+            } else if (flag == "--fetch-cache") {
+                config.fetch_cache = value;
+            } else if (flag == "--stream-parse") {
+                config.stream_parse = std::stoi(value) != 0;
+            } else if (flag == "--max-page-kb") {
+                config.max_page_bytes = std::stoul(value) * 1024;
+            } else if (flag == "--max-links") {
+                config.max_page_links = std::stoul(value);
+            } else if (flag == "--compression") {
+                config.compression = std::stoi(value) != 0;
+            } else if (flag == "--max-decoded-kb") {
+                config.max_decoded_bytes = std::stoul(value) * 1024;
+            } else if (flag == "--near-dup") {
+                config.near_duplicate_bits = std::stoi(value);
+            } else if (flag == "--dns-prefetch") {
+                config.dns_prefetch = std::stoi(value) != 0;
+            } else if (flag == "--cluster") {
+                if (!ClusterNode::parse_nodes(value, config.cluster_nodes)) {
+                    std::cerr << "[ERROR] --cluster needs host:port entries: " << value << std::endl;
+                    return false;
+                }
+            } else if (flag == "--node-id") {
+                config.cluster_node = std::stoi(value);
+            } else if (flag == "--log-level") {
+                if (!Log::parse_level(value, config.log.level)) {
+                    std::cerr << "[ERROR] Unknown log level: " << value << std::endl;
+                    return false;
+                }
+            } else if (flag == "--log-sample") {
+                config.log.sample = static_cast<uint32_t>(std::stoul(value));
+            } else if (flag == "--log-file") {
+                config.log.path = value;
+            } else if (flag == "--metrics-interval") {
+                config.metrics_interval = std::stoi(value);
+            } else if (flag == "--metrics-file") {
+                config.metrics_file = value;
+            } else if (flag == "--metrics-port") {
+                config.metrics_port = std::stoi(value);
+            } else if (flag == "--metrics-bind") {
+                config.metrics_bind = value;
+            } else if (flag == "--graph-file") {
+                config.graph_file = value;
+            } else {
+                std::cerr << "[ERROR] Unknown option: " << flag << std::endl;
+                return false;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] Invalid value for " << flag << ": " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    if (config.io_threads <= 0 || config.io_threads > 64) {
+        std::cerr << "[ERROR] --io-threads must be between 1 and 64" << std::endl;
+        return false;
+    }
+
+    if (config.max_inflight <= 0) {
+        std::cerr << "[ERROR] --max-inflight must be positive" << std::endl;
+        return false;
+    }
+
+    if (config.store_threads < 0 || config.store_threads > 64) {
+        std::cerr << "[ERROR] --store-threads must be between 0 and 64" << std::endl;
+        return false;
+    }
+
+    if (config.parse_queue == 0 || config.parse_queue > (1u << 20) ||
+        config.store_queue == 0 || config.store_queue > (1u << 20)) {
+        std::cerr << "[ERROR] --parse-queue and --store-queue must be between 1 and 1048576" << std::endl;
+        return false;
+    }
+
+    if (config.frontier_shards <= 0 || config.frontier_shards > 4096) {
+        std::cerr << "[ERROR] --shards must be between 1 and 4096" << std::endl;
+        return false;
+    }
+
+    if (config.pagerank_iterations <= 0) {
+        std::cerr << "[ERROR] --pr-iterations must be positive" << std::endl;
+        return false;
+    }
+
+    if (config.pagerank_tolerance < 0.0) {
+        std::cerr << "[ERROR] --pr-tolerance must not be negative" << std::endl;
+        return false;
+    }
+
+    if (config.visited.false_positive_rate <= 0.0 || config.visited.false_positive_rate >= 1.0) {
+        std::cerr << "[ERROR] --visited-fpr must be between 0 and 1" << std::endl;
+        return false;
+    }
+
+    if (config.visited.memory_budget_mb > 0 && config.visited.spill_dir.empty()) {
+        std::cerr << "[ERROR] --visited-mem-mb needs --visited-spill <dir>" << std::endl;
+        return false;
+    }
+
+    // Spill files are first created mid-crawl; catch a bad directory now
+    if (!config.visited.spill_dir.empty() && !Utils::ensure_directory(config.visited.spill_dir)) {
+        std::cerr << "[ERROR] Cannot create files in --visited-spill directory "
+                  << config.visited.spill_dir << std::endl;
+        return false;
+    }
+
+    if (config.politeness.max_connections <= 0) {
+        std::cerr << "[ERROR] --host-connections must be positive" << std::endl;
+        return false;
+    }
+
+    if (config.politeness.crawl_delay_ms < 0) {
+        std::cerr << "[ERROR] --crawl-delay must not be negative" << std::endl;
+        return false;
+    }
+
+    if (config.politeness.max_crawl_delay_ms < 0) {
+        std::cerr << "[ERROR] --max-crawl-delay must not be negative" << std::endl;
+        return false;
+    }
+    config.politeness.wait_for_robots = config.robots;
+
+    if (config.frontier_spill.max_memory_urls > 0 && config.frontier_spill.dir.empty()) {
+        std::cerr << "[ERROR] --frontier-mem needs --frontier-spill <dir>" << std::endl;
+        return false;
+    }
+
+    if (!config.frontier_spill.dir.empty() && !Utils::ensure_directory(config.frontier_spill.dir)) {
+        std::cerr << "[ERROR] Cannot create files in --frontier-spill directory "
+                  << config.frontier_spill.dir << std::endl;
+        return false;
+    }
+
+    if (config.metrics_interval < 0) {
+        std::cerr << "[ERROR] --metrics-interval must not be negative" << std::endl;
+        return false;
+    }
+
+    if (config.near_duplicate_bits < 0 || config.near_duplicate_bits > 7) {
+        std::cerr << "[ERROR] --near-dup must be between 0 and 7" << std::endl;
+        return false;
+    }
+
+    if (config.metrics_port < 0 || config.metrics_port > 65535) {
+        std::cerr << "[ERROR] --metrics-port must be between 0 and 65535" << std::endl;
+        return false;
+    }
+
+    if (config.log.sample == 0) {
+        std::cerr << "[ERROR] --log-sample must be positive" << std::endl;
+        return false;
+    }
+
+    if (config.checkpoint_interval <= 0) {
+        std::cerr << "[ERROR] --checkpoint-interval must be positive" << std::endl;
+        return false;
+    }
+
+    if (!config.cluster_nodes.empty()) {
+        if (config.cluster_node < 0 ||
+            config.cluster_node >= static_cast<int>(config.cluster_nodes.size())) {
+            std::cerr << "[ERROR] --node-id must index the --cluster list" << std::endl;
+            return false;
+        }
+        if (!config.checkpoint_dir.empty()) {
+            std::cerr << "[ERROR] --cluster cannot be combined with --checkpoint or --resume" << std::endl;
+            return false;
+        }
+    }
+
+    if (config.priority == FrontierPriority::PageRank && !config.live_pagerank) {
+        std::cout << "[WARNING] --priority pagerank needs live ranks; falling back to depth" << std::endl;
+    }
+
+    return true;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 4) {
+    if (argc < 4) {
         print_usage(argv[0]);
         return 1;
     }
@@ -65,23 +370,112 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    CrawlConfig config;
+    config.seed_url = seed_url;
+    config.max_pages = max_pages;
+    config.num_threads = num_threads;
+    if (!parse_options(argc, argv, config)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Log::start(config.log);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << std::endl;
+        return 1;
+    }
 
+    // Bind the metrics endpoint up front so a taken port fails before crawling
+    MetricsServer telemetry;
+    if (config.metrics_port > 0) {
+        try {
+            telemetry.listen(config.metrics_bind, config.metrics_port);
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
+    // Likewise the cluster address: peers connect to it as soon as they start
+    ClusterNode cluster;
+    if (!config.cluster_nodes.empty()) {
+        try {
+            cluster.listen(config.cluster_nodes, config.cluster_node);
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "[CLUSTER] Node " << config.cluster_node << " listening on "
+                  << config.cluster_nodes[config.cluster_node] << std::endl;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
     
     // Initialize storage
+    // One link buffer (and journal page log) per thread that stores pages
+    int writers = config.store_threads > 0 ? config.store_threads : num_threads;
     StorageManager storage;
-    storage.init(num_threads);
+    storage.init(writers);
+    if (config.live_pagerank) {
+        storage.start_live_pagerank();
+    }
     
     // Crawling - measure time
     std::cout << "\n[TIMING] Starting crawling..." << std::endl;
     auto crawl_start = std::chrono::high_resolution_clock::now();
     
+    // Open the crawl journal (and its checkpoint, when resuming)
+    CrawlJournal journal;
+    if (!config.checkpoint_dir.empty()) {
+        try {
+            journal.open(config.checkpoint_dir, static_cast<size_t>(config.io_threads),
+                         static_cast<size_t>(writers), config.resume);
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Load the previous run's fetch cache; this run's replaces it at the end
+    FetchCache fetch_cache;
+    if (!config.fetch_cache.empty()) {
+        try {
+            fetch_cache.open(config.fetch_cache);
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     // Start crawling
     ThreadManager crawler;
-    crawler.start(num_threads, max_pages, seed_url, storage);
+    crawler.start(config, storage, config.checkpoint_dir.empty() ? nullptr : &journal,
+                  fetch_cache.is_open() ? &fetch_cache : nullptr,
+                  cluster.enabled() ? &cluster : nullptr);
+    if (config.metrics_port > 0) {
+        telemetry.start([&crawler](PrometheusText& out) { crawler.write_prometheus(out); });
+        std::cout << "[INFO] Metrics endpoint: http://" << config.metrics_bind << ":"
+                  << config.metrics_port << "/metrics" << std::endl;
+    }
     
     // Wait for all threads to complete
     crawler.wait_completion();
+    if (fetch_cache.is_open()) {
+        try {
+            fetch_cache.commit();
+            FetchCacheStats cache_stats = fetch_cache.stats();
+            std::cout << "[INFO] Fetch cache: " << cache_stats.kept << " unchanged, "
+                      << cache_stats.stored << " stored, " << cache_stats.carried
+                      << " not revisited -> " << config.fetch_cache << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+        }
+    }
+    if (cluster.enabled()) {
+        // A node that hit the page limit on its own still waits for the coordinator
+        cluster.wait_stop();
+    }
     
     auto crawl_end = std::chrono::high_resolution_clock::now();
     auto crawl_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -93,19 +487,53 @@ int main(int argc, char* argv[]) {
     std::cout << "\n[TIMING] Starting domain counting..." << std::endl;
     auto domain_count_start = std::chrono::high_resolution_clock::now();
     
-    storage.merge_all_buffers();
+    // The coordinator ranks the whole cluster's graph: fold the others in first
+    if (cluster.enabled() && cluster.coordinator()) {
+        size_t merged = cluster.gather(storage, 300);
+        std::cout << "[CLUSTER] Merged graphs of " << merged << " of "
+                  << cluster.size() - 1 << " nodes" << std::endl;
+    }
+
+    // Crawl threads are idle by now; merge with as many cores
+    storage.merge_all_buffers(config.num_threads);
     
     auto domain_count_end = std::chrono::high_resolution_clock::now();
     auto domain_count_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
         domain_count_end - domain_count_start);
     std::cout << "[TIMING] Domain counting completed in " << std::fixed << std::setprecision(3)
               << domain_count_duration.count() << " ms" << std::endl;
+
+    if (cluster.enabled()) {
+        ClusterStats cluster_stats = cluster.stats();
+        std::cout << "[CLUSTER] Links sent: " << cluster_stats.urls_sent << " in "
+                  << cluster_stats.batches_sent << " batches (" << cluster_stats.bytes_sent
+                  << " bytes) | Received: " << cluster_stats.urls_received << " ("
+                  << cluster_stats.bytes_received << " bytes) | Dropped: "
+                  << cluster_stats.urls_dropped << std::endl;
+    }
+
+    // Other nodes hand their graphs to the coordinator and are done
+    if (cluster.enabled() && !cluster.coordinator()) {
+        try {
+            cluster.send_graph(storage);
+            std::cout << "[CLUSTER] Graph sent to the coordinator" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+        }
+        cluster.stop();
+        telemetry.stop();
+        Log::stop();
+        curl_global_cleanup();
+        return crawler.stopped_by_error() ? 1 : 0;
+    }
     
     // PageRank computation - measure time
     std::cout << "\n[TIMING] Starting PageRank computation..." << std::endl;
     auto pagerank_start = std::chrono::high_resolution_clock::now();
     
-    storage.compute_pagerank(30);
+    // Crawl threads are idle by now; rank with the same number of cores
+    storage.compute_pagerank(config.pagerank_iterations, config.pagerank_tolerance,
+                             config.num_threads);
     
     auto pagerank_end = std::chrono::high_resolution_clock::now();
     auto pagerank_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -114,7 +542,18 @@ int main(int argc, char* argv[]) {
               << pagerank_duration.count() << " ms" << std::endl;
     
     // Export results
-    storage.export_to_csv("crawled_pages.csv", "pagerank_results.csv");
+    auto export_start = std::chrono::high_resolution_clock::now();
+    try {
+        storage.export_to_csv("crawled_pages.csv", "pagerank_results.csv");
+        if (!config.graph_file.empty()) {
+            storage.export_binary(config.graph_file);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] " << e.what() << std::endl;
+    }
+    auto export_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - export_start);
+    std::cout << "[TIMING] Export completed in " << export_duration.count() << " ms" << std::endl;
     
     // Log metrics to CSV
     int pages_crawled = crawler.get_pages_crawled();
@@ -148,7 +587,15 @@ int main(int argc, char* argv[]) {
     std::cout << "  CSV files generated:" << std::endl;
     std::cout << "    - crawled_pages.csv" << std::endl;
     std::cout << "    - pagerank_results.csv" << std::endl;
+    if (!config.graph_file.empty()) {
+        std::cout << "  Graph file:      " << config.graph_file << std::endl;
+    }
     std::cout << std::endl;
     
-    return 0;
+    // Scrapes read the crawler; stop serving before it goes away
+    cluster.stop();
+    telemetry.stop();
+    Log::stop();
+    curl_global_cleanup();
+    return crawler.stopped_by_error() ? 1 : 0;
 }
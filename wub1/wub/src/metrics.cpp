@@ -0,0 +1,296 @@
+#include "metrics.h"
+#include "metrics_server.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+
+// Slots are shared by threads whose index collides; 64 covers the
+// thread counts the crawler runs with
+const unsigned SLOTS = 64;
+
+struct alignas(64) Slot {
+    std::atomic<uint64_t> counts[METRIC_COUNT][LatencyHistogram::BUCKETS];
+    std::atomic<uint64_t> sums[METRIC_COUNT];
+    std::atomic<uint64_t> maxima[METRIC_COUNT];
+    std::atomic<uint64_t> counters[COUNTER_COUNT];
+    std::atomic<uint64_t> statuses[STATUS_CODES];
+};
+
+// Zero-initialized static storage; pages no thread touches stay unmapped
+Slot slots[SLOTS];
+std::atomic<unsigned> next_slot{0};
+thread_local unsigned thread_slot = SLOTS;
+
+inline Slot& my_slot() {
+    if (thread_slot == SLOTS) {
+        thread_slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOTS;
+    }
+    return slots[thread_slot];
+}
+
+const char* METRIC_NAMES[] = {
+    "dns", "connect", "tls", "first_byte", "transfer",
+    "parse", "frontier_lock_wait", "enqueue_batch", "io_idle", "worker_idle",
+    "store_queue_wait", "store_idle",
+};
+
+const char* COUNTER_NAMES[] = {
+    "transfers", "fetch_errors", "body_bytes", "links_found", "urls_admitted",
+    "pages_replayed", "near_duplicates", "parse_queue_full",
+    "wire_bytes", "decode_limited", "robots_disallowed", "sitemap_urls",
+};
+
+const char* COUNTER_HELP[] = {
+    "Finished transfers",
+    "Transfers that failed or got a non-2xx status other than 304",
+    "Body bytes received (after decompression)",
+    "Links extracted from pages",
+    "URLs new to the frontier",
+    "Unchanged pages whose links were replayed from the fetch cache",
+    "Pages whose links were not enqueued because their text nearly matched a recent page",
+    "Transfers not started because the parse queue was full",
+    "Wire bytes of the bodies in body_bytes, before decompression",
+    "Compressed bodies cut at the decoded size limit",
+    "Admitted URLs dropped because their host's robots.txt disallows them",
+    "Page URLs read from sitemaps",
+};
+
+void print_value(std::ostream& out, Metric metric, double value) {
+    if (Metrics::is_time(metric)) {
+        out << std::fixed << std::setprecision(3) << value / 1e6 << "ms";
+    } else {
+        out << std::fixed << std::setprecision(1) << value;
+    }
+}
+
+}  // namespace
+
+size_t LatencyHistogram::bucket_of(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent >= MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+    int shift = exponent - SUB_BITS;
+    return static_cast<size_t>(SUB_BUCKETS + static_cast<uint64_t>(shift) * SUB_BUCKETS +
+                               ((value >> shift) - SUB_BUCKETS));
+}
+
+uint64_t LatencyHistogram::bucket_low(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    size_t k = bucket - SUB_BUCKETS;
+    int shift = static_cast<int>(k / SUB_BUCKETS);
+    return (SUB_BUCKETS + k % SUB_BUCKETS) << shift;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total) + 0.999999);
+    rank = std::max<uint64_t>(1, std::min(rank, total));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            uint64_t low = bucket_low(b);
+            uint64_t width = (b + 1 < BUCKETS) ? bucket_low(b + 1) - low : 1;
+            return std::min(low + (width - 1) / 2, max);
+        }
+    }
+    return max;
+}
+
+MetricsSnapshot MetricsSnapshot::since(const MetricsSnapshot& earlier) const {
+    MetricsSnapshot delta = *this;
+    for (size_t m = 0; m < METRIC_COUNT; m++) {
+        LatencyHistogram& h = delta.histograms[m];
+        const LatencyHistogram& before = earlier.histograms[m];
+        for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++) {
+            h.counts[b] -= before.counts[b];
+        }
+        h.total -= before.total;
+        h.sum -= before.sum;
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        delta.counters[c] -= earlier.counters[c];
+    }
+    for (size_t code = 0; code < STATUS_CODES; code++) {
+        delta.statuses[code] -= earlier.statuses[code];
+    }
+    return delta;
+}
+
+namespace Metrics {
+
+void record(Metric metric, uint64_t value) {
+    Slot& slot = my_slot();
+    size_t m = static_cast<size_t>(metric);
+    slot.counts[m][LatencyHistogram::bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    slot.sums[m].fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = slot.maxima[m].load(std::memory_order_relaxed);
+    while (value > seen &&
+           !slot.maxima[m].compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void add(Counter counter, uint64_t amount) {
+    my_slot().counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void count_status(long http_code) {
+    size_t code = http_code < 0 ? 0 : std::min<size_t>(static_cast<size_t>(http_code), STATUS_CODES - 1);
+    my_slot().statuses[code].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t total(Counter counter) {
+    uint64_t sum = 0;
+    for (const Slot& slot : slots) {
+        sum += slot.counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+MetricsSnapshot snapshot() {
+    MetricsSnapshot snap;
+    for (const Slot& slot : slots) {
+        for (size_t m = 0; m < METRIC_COUNT; m++) {
+            LatencyHistogram& h = snap.histograms[m];
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++) {
+                uint64_t n = slot.counts[m][b].load(std::memory_order_relaxed);
+                h.counts[b] += n;
+                h.total += n;
+            }
+            h.sum += slot.sums[m].load(std::memory_order_relaxed);
+            h.max = std::max(h.max, slot.maxima[m].load(std::memory_order_relaxed));
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; c++) {
+            snap.counters[c] += slot.counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t code = 0; code < STATUS_CODES; code++) {
+            snap.statuses[code] += slot.statuses[code].load(std::memory_order_relaxed);
+        }
+    }
+    return snap;
+}
+
+const char* name(Metric metric) {
+    return METRIC_NAMES[static_cast<size_t>(metric)];
+}
+
+const char* name(Counter counter) {
+    return COUNTER_NAMES[static_cast<size_t>(counter)];
+}
+
+bool is_time(Metric metric) {
+    return metric != Metric::EnqueueBatch;
+}
+
+void print(std::ostream& out, const MetricsSnapshot& snapshot, const char* tag) {
+    for (size_t m = 0; m < METRIC_COUNT; m++) {
+        const LatencyHistogram& h = snapshot.histograms[m];
+        if (h.total == 0) {
+            continue;
+        }
+        Metric metric = static_cast<Metric>(m);
+        out << tag << " " << std::left << std::setw(19) << name(metric) << std::right
+            << " n=" << std::setw(7) << h.total << "  p50=";
+        print_value(out, metric, static_cast<double>(h.percentile(0.50)));
+        out << "  p90=";
+        print_value(out, metric, static_cast<double>(h.percentile(0.90)));
+        out << "  p99=";
+        print_value(out, metric, static_cast<double>(h.percentile(0.99)));
+        out << "  max=";
+        print_value(out, metric, static_cast<double>(h.max));
+        out << "  mean=";
+        print_value(out, metric, h.mean());
+        out << "\n";
+    }
+    out << tag << " counters";
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        out << " " << name(static_cast<Counter>(c)) << "=" << snapshot.counters[c];
+    }
+    out << std::endl;
+}
+
+void write_csv(const std::string& path, const MetricsSnapshot& snapshot) {
+    std::ofstream csv(path);
+    if (!csv) {
+        throw std::runtime_error("cannot write metrics file " + path);
+    }
+    csv << "metric,count,p50,p90,p99,p999,max,mean\n";
+    for (size_t m = 0; m < METRIC_COUNT; m++) {
+        const LatencyHistogram& h = snapshot.histograms[m];
+        Metric metric = static_cast<Metric>(m);
+        // Times in microseconds, counts as recorded
+        double scale = is_time(metric) ? 1e-3 : 1.0;
+        csv << name(metric) << "," << h.total << std::fixed << std::setprecision(3);
+        for (double q : {0.50, 0.90, 0.99, 0.999}) {
+            csv << "," << static_cast<double>(h.percentile(q)) * scale;
+        }
+        csv << "," << static_cast<double>(h.max) * scale << "," << h.mean() * scale << "\n";
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        csv << name(static_cast<Counter>(c)) << "," << snapshot.counters[c] << ",,,,,,\n";
+    }
+    if (!csv) {
+        throw std::runtime_error("cannot write metrics file " + path);
+    }
+}
+
+void write_prometheus(PrometheusText& out, const MetricsSnapshot& snapshot) {
+    const double quantiles[] = {0.5, 0.9, 0.99};
+    const char* quantile_names[] = {"0.5", "0.9", "0.99"};
+
+    out.family("crawler_stage_seconds", "summary",
+               "Time spent in each pipeline stage (quantiles over the whole crawl)");
+    for (size_t m = 0; m < METRIC_COUNT; m++) {
+        Metric metric = static_cast<Metric>(m);
+        if (!is_time(metric)) {
+            continue;
+        }
+        const LatencyHistogram& h = snapshot.histograms[m];
+        for (size_t q = 0; q < 3; q++) {
+            // Empty summaries report NaN quantiles, as client libraries do
+            out.sample("crawler_stage_seconds", "stage", name(metric), "quantile", quantile_names[q],
+                       h.total ? static_cast<double>(h.percentile(quantiles[q])) / 1e9 : std::nan(""));
+        }
+        out.sample("crawler_stage_seconds_sum", "stage", name(metric), static_cast<double>(h.sum) / 1e9);
+        out.sample("crawler_stage_seconds_count", "stage", name(metric), static_cast<double>(h.total));
+    }
+
+    const LatencyHistogram& batches = snapshot[Metric::EnqueueBatch];
+    out.family("crawler_enqueue_batch_urls", "summary", "URLs per frontier enqueue batch");
+    for (size_t q = 0; q < 3; q++) {
+        out.sample("crawler_enqueue_batch_urls", "quantile", quantile_names[q],
+                   batches.total ? static_cast<double>(batches.percentile(quantiles[q])) : std::nan(""));
+    }
+    out.sample("crawler_enqueue_batch_urls_sum", static_cast<double>(batches.sum));
+    out.sample("crawler_enqueue_batch_urls_count", static_cast<double>(batches.total));
+
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        std::string family = std::string("crawler_") + name(static_cast<Counter>(c)) + "_total";
+        out.family(family, "counter", COUNTER_HELP[c]);
+        out.sample(family, static_cast<double>(snapshot.counters[c]));
+    }
+
+    out.family("crawler_responses_total", "counter",
+               "Finished transfers by HTTP status (code 0: the transfer failed)");
+    for (size_t code = 0; code < STATUS_CODES; code++) {
+        if (snapshot.statuses[code] > 0) {
+            out.sample("crawler_responses_total", "code", std::to_string(code),
+                       static_cast<double>(snapshot.statuses[code]));
+        }
+    }
+}
+
+}  // namespace Metrics
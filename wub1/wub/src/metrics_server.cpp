@@ -0,0 +1,236 @@
+#include "metrics_server.h"
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// A scraper that stalls mid-request must not hold the endpoint for long
+const int CLIENT_TIMEOUT_MS = 2000;
+
+// Request head size limit; the path is all that is read from it
+const size_t MAX_REQUEST_BYTES = 8192;
+
+void send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;                     // Client went away
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void respond(int fd, const char* status, const char* type, const std::string& body, bool head) {
+    char header[256];
+    int n = std::snprintf(header, sizeof(header),
+                          "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                          "Connection: close\r\n\r\n",
+                          status, type, body.size());
+    send_all(fd, header, static_cast<size_t>(n));
+    if (!head) {
+        send_all(fd, body.data(), body.size());
+    }
+}
+
+}  // namespace
+
+void PrometheusText::family(std::string_view name, const char* type, std::string_view help) {
+    text.append("# HELP ").append(name).push_back(' ');
+    text.append(help).push_back('\n');
+    text.append("# TYPE ").append(name).push_back(' ');
+    text.append(type).push_back('\n');
+}
+
+void PrometheusText::sample(std::string_view name, double value) {
+    text.append(name);
+    value_line(value);
+}
+
+void PrometheusText::sample(std::string_view name, std::string_view label,
+                            std::string_view label_value, double value) {
+    text.append(name).push_back('{');
+    label_pair(label, label_value);
+    text.push_back('}');
+    value_line(value);
+}
+
+void PrometheusText::sample(std::string_view name, std::string_view label,
+                            std::string_view label_value, std::string_view label2,
+                            std::string_view label2_value, double value) {
+    text.append(name).push_back('{');
+    label_pair(label, label_value);
+    text.push_back(',');
+    label_pair(label2, label2_value);
+    text.push_back('}');
+    value_line(value);
+}
+
+void PrometheusText::label_pair(std::string_view label, std::string_view value) {
+    text.append(label).append("=\"");
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            text.push_back('\\');
+            text.push_back(c);
+        } else if (c == '\n') {
+            text.append("\\n");
+        } else {
+            text.push_back(c);
+        }
+    }
+    text.push_back('"');
+}
+
+void PrometheusText::value_line(double value) {
+    char digits[32];
+    int n;
+    if (std::isnan(value)) {
+        n = std::snprintf(digits, sizeof(digits), " NaN\n");
+    } else if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        // Counters and integer gauges print exactly
+        n = std::snprintf(digits, sizeof(digits), " %.0f\n", value);
+    } else {
+        n = std::snprintf(digits, sizeof(digits), " %.9g\n", value);
+    }
+    text.append(digits, static_cast<size_t>(n));
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::listen(const std::string& address, int port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (port <= 0 || port > 65535 || inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        throw std::runtime_error("invalid metrics address " + address + ":" + std::to_string(port));
+    }
+
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("cannot create metrics socket: ") + std::strerror(errno));
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd, 16) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("cannot listen on " + address + ":" + std::to_string(port) +
+                                 ": " + std::strerror(error));
+    }
+    listen_fd = fd;
+}
+
+void MetricsServer::start(Render page) {
+    if (listen_fd < 0 || running.load()) {
+        return;
+    }
+    render = std::move(page);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    running.store(true);
+    thread = std::thread(&MetricsServer::run, this);
+}
+
+void MetricsServer::stop() {
+    if (thread.joinable()) {
+        running.store(false);
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+        thread.join();
+    }
+    if (wake_fd >= 0) {
+        ::close(wake_fd);
+        wake_fd = -1;
+    }
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+    }
+}
+
+uint64_t MetricsServer::scrapes() const {
+    return scrapes_.load(std::memory_order_relaxed);
+}
+
+void MetricsServer::run() {
+    pollfd fds[2];
+    fds[0] = pollfd{listen_fd, POLLIN, 0};
+    fds[1] = pollfd{wake_fd, POLLIN, 0};
+
+    while (running.load()) {
+        int ready = ::poll(fds, 2, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) {
+            return;                     // stop()
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        int client = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        timeval timeout{CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        handle(client);
+        ::close(client);
+    }
+}
+
+void MetricsServer::handle(int client_fd) {
+    // Read the request head; only its first line matters
+    std::string request;
+    char chunk[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.find("\n\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES) {
+        ssize_t n = ::recv(client_fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (request.empty()) return;
+            break;
+        }
+        request.append(chunk, static_cast<size_t>(n));
+    }
+
+    size_t method_end = request.find(' ');
+    size_t path_end = method_end == std::string::npos ? std::string::npos
+                                                      : request.find_first_of(" \r\n?", method_end + 1);
+    if (path_end == std::string::npos) {
+        respond(client_fd, "400 Bad Request", "text/plain", "bad request\n", false);
+        return;
+    }
+    std::string_view method(request.data(), method_end);
+    std::string_view path(request.data() + method_end + 1, path_end - method_end - 1);
+    bool head = method == "HEAD";
+    if (method != "GET" && !head) {
+        respond(client_fd, "405 Method Not Allowed", "text/plain", "GET only\n", false);
+        return;
+    }
+    if (path != "/metrics") {
+        respond(client_fd, "404 Not Found", "text/plain", "metrics are at /metrics\n", head);
+        return;
+    }
+
+    PrometheusText page;
+    render(page);
+    scrapes_.fetch_add(1, std::memory_order_relaxed);
+    respond(client_fd, "200 OK", "text/plain; version=0.0.4; charset=utf-8", page.str(), head);
+}
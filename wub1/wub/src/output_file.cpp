@@ -0,0 +1,126 @@
+#include "output_file.h"
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const size_t BUFFER_BYTES = 1 << 20;
+
+// Longest std::to_chars output we ask for: an integer, or "%.*f" of a
+// rank-sized double with a few digits
+const size_t MAX_NUMBER_CHARS = 64;
+
+}  // namespace
+
+OutputFile::OutputFile(const std::string& file_path)
+    : path(file_path), temp_path(file_path + ".tmp"), buffer(new char[BUFFER_BYTES]) {
+    fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("cannot create " + temp_path + ": " + std::strerror(errno));
+    }
+}
+
+OutputFile::~OutputFile() {
+    if (fd >= 0) {
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+    }
+}
+
+char* OutputFile::reserve(size_t n) {
+    if (used + n > BUFFER_BYTES) {
+        flush();
+    }
+    return buffer.get() + used;
+}
+
+void OutputFile::append(std::string_view text) {
+    if (text.size() > BUFFER_BYTES / 2) {
+        write_block(text.data(), text.size());
+        return;
+    }
+    std::memcpy(reserve(text.size()), text.data(), text.size());
+    used += text.size();
+}
+
+void OutputFile::append(char c) {
+    *reserve(1) = c;
+    used++;
+}
+
+void OutputFile::append(uint64_t value) {
+    char* out = reserve(MAX_NUMBER_CHARS);
+    used = static_cast<size_t>(std::to_chars(out, out + MAX_NUMBER_CHARS, value).ptr - buffer.get());
+}
+
+void OutputFile::append_fixed(double value, int precision) {
+    char* out = reserve(MAX_NUMBER_CHARS);
+    auto result = std::to_chars(out, out + MAX_NUMBER_CHARS, value, std::chars_format::fixed, precision);
+    if (result.ec != std::errc()) {
+        // Too long for the slot (huge magnitude); fall back to printf
+        std::string text(static_cast<size_t>(std::snprintf(nullptr, 0, "%.*f", precision, value)), '\0');
+        std::snprintf(text.data(), text.size() + 1, "%.*f", precision, value);
+        append(text);
+        return;
+    }
+    used = static_cast<size_t>(result.ptr - buffer.get());
+}
+
+void OutputFile::write_block(const void* data, size_t bytes) {
+    if (used + bytes <= BUFFER_BYTES) {
+        std::memcpy(buffer.get() + used, data, bytes);
+        used += bytes;
+        return;
+    }
+    flush(data, bytes);
+}
+
+void OutputFile::pad_to(size_t alignment) {
+    uint64_t pad = (alignment - offset() % alignment) % alignment;
+    if (pad > 0) {
+        std::memset(reserve(pad), 0, pad);
+        used += pad;
+    }
+}
+
+void OutputFile::flush(const void* data, size_t bytes) {
+    iovec parts[2] = {{buffer.get(), used}, {const_cast<void*>(data), bytes}};
+    int first = used > 0 ? 0 : 1;
+    int count = bytes > 0 ? 2 : 1;
+    uint64_t total = used + bytes;
+    while (first < count) {
+        ssize_t n = ::writev(fd, parts + first, count - first);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("write failed: " + temp_path + ": " + std::strerror(errno));
+        }
+        // Skip what went out, possibly ending inside a part
+        size_t left = static_cast<size_t>(n);
+        while (first < count && left >= parts[first].iov_len) {
+            left -= parts[first].iov_len;
+            first++;
+        }
+        if (first < count) {
+            parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + left;
+            parts[first].iov_len -= left;
+        }
+    }
+    written += total;
+    used = 0;
+}
+
+void OutputFile::commit() {
+    flush();
+    int status = ::close(fd);
+    fd = -1;
+    if (status != 0 || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        ::unlink(temp_path.c_str());
+        throw std::runtime_error("cannot write " + path + ": " + std::strerror(errno));
+    }
+}
@@ -0,0 +1,242 @@
+#include "pagerank.h"
+#include "simd_math.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Below this many (nodes + edges) per thread the barriers cost more
+// than the sweep they split
+const size_t MIN_WORK_PER_THREAD = 32768;
+
+/**
+ * Reusable barrier; the last thread to arrive runs a completion step
+ * before anyone is released (std::barrier needs C++20)
+ */
+class Barrier {
+public:
+    explicit Barrier(size_t count) : count(count) {}
+
+    template <typename Completion>
+    void arrive_and_wait(Completion&& on_complete) {
+        std::unique_lock<std::mutex> lock(mutex);
+        size_t gen = generation;
+        if (++arrived == count) {
+            on_complete();
+            arrived = 0;
+            generation++;
+            cv.notify_all();
+            return;
+        }
+        cv.wait(lock, [&]() { return gen != generation; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t count;
+    size_t arrived = 0;
+    size_t generation = 0;
+};
+
+struct alignas(64) Partial {
+    double value = 0.0;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+/**
+ * Split [0, n) into threads ranges of roughly equal nodes + in-edges
+ */
+std::vector<size_t> partition_by_in_edges(const CsrGraph& in, size_t threads) {
+    const size_t n = in.num_nodes();
+    const uint64_t total = in.num_edges() + n;
+    std::vector<size_t> bounds(threads + 1, n);
+    bounds[0] = 0;
+
+    // offsets[v] + v is the work before node v and is monotonic
+    size_t v = 0;
+    for (size_t t = 1; t < threads; t++) {
+        uint64_t target = total * t / threads;
+        size_t lo = v, hi = n;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (in.offsets[mid] + mid < target) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        v = lo;
+        bounds[t] = v;
+    }
+    return bounds;
+}
+
+}  // namespace
+
+namespace PageRank {
+
+PageRankStats compute(const CsrGraph& graph, const PageRankOptions& options,
+                      std::vector<double>& ranks) {
+    auto start = std::chrono::steady_clock::now();
+    PageRankStats stats;
+    const size_t N = graph.num_nodes();
+    if (N == 0) {
+        ranks.clear();
+        return stats;
+    }
+
+    // Warm start from a previous estimate, renormalized; otherwise uniform
+    double initial_sum = 0.0;
+    if (options.warm_start && ranks.size() == N) {
+        initial_sum = Simd::sum(ranks.data(), N);
+    }
+    if (initial_sum > 0.0) {
+        Simd::scale(ranks.data(), N, 1.0 / initial_sum);
+    } else {
+        ranks.assign(N, 1.0 / static_cast<double>(N));
+    }
+
+    // Pull needs in-edges; per-node reciprocal degree and dangling mask
+    // turn the contribution and dangling passes into plain array kernels.
+    // The degree counts links, so a weighted edge passes weight times
+    // the contribution of a single link
+    CsrGraph in = graph.transpose();
+    std::vector<double> inv_degree(N);
+    std::vector<double> dangling(N);
+    for (size_t v = 0; v < N; v++) {
+        uint64_t degree = graph.out_weight(static_cast<uint32_t>(v));
+        inv_degree[v] = degree ? 1.0 / static_cast<double>(degree) : 0.0;
+        dangling[v] = degree ? 0.0 : 1.0;
+    }
+
+    size_t work = N + graph.num_edges();
+    size_t threads = std::max<size_t>(1, std::min<size_t>(
+        static_cast<size_t>(std::max(options.num_threads, 1)),
+        work / MIN_WORK_PER_THREAD));
+    stats.threads = static_cast<int>(threads);
+    std::vector<size_t> bounds = partition_by_in_edges(in, threads);
+
+    if (options.log_iterations) {
+        std::cout << "[INFO] PageRank: " << N << " nodes, " << graph.num_edges()
+                  << " edges, " << threads << " thread(s), setup "
+                  << std::fixed << std::setprecision(3) << elapsed_ms(start) << " ms" << std::endl;
+    }
+
+    const double damping = options.damping;
+    const double teleport = (1.0 - damping) / static_cast<double>(N);
+    const uint64_t* in_offsets = in.offsets.data();
+    const uint32_t* in_sources = in.targets.data();
+    const uint32_t* in_weights = in.weights.empty() ? nullptr : in.weights.data();
+
+    std::vector<double> next(N);
+    std::vector<double> contrib(N);
+    double* current_ranks = ranks.data();
+    double* next_ranks = next.data();
+
+    // Shared between threads; written only inside barrier completions
+    std::vector<Partial> partial(threads);
+    Barrier barrier(threads);
+    double base = 0.0;
+    double inv_sum = 1.0;
+    bool stop = false;
+    auto iteration_start = std::chrono::steady_clock::now();
+
+    auto sum_partials = [&]() {
+        double total = 0.0;
+        for (const auto& p : partial) total += p.value;
+        return total;
+    };
+
+    auto worker = [&](size_t t) {
+        const size_t lo = bounds[t];
+        const size_t len = bounds[t + 1] - lo;
+
+        while (true) {
+            // 1) Contribution of each source and this range's dangling mass
+            Simd::multiply(contrib.data() + lo, current_ranks + lo, inv_degree.data() + lo, len);
+            partial[t].value = Simd::dot(current_ranks + lo, dangling.data() + lo, len);
+            barrier.arrive_and_wait([&]() {
+                base = teleport + damping * sum_partials() / static_cast<double>(N);
+            });
+
+            // 2) Pull: every node sums the contributions of its in-edges
+            for (size_t v = lo; v < lo + len; v++) {
+                double incoming = 0.0;
+                if (in_weights) {
+                    for (uint64_t e = in_offsets[v]; e < in_offsets[v + 1]; e++) {
+                        incoming += contrib[in_sources[e]] * in_weights[e];
+                    }
+                } else {
+                    for (uint64_t e = in_offsets[v]; e < in_offsets[v + 1]; e++) {
+                        incoming += contrib[in_sources[e]];
+                    }
+                }
+                next_ranks[v] = base + damping * incoming;
+            }
+            partial[t].value = Simd::sum(next_ranks + lo, len);
+            barrier.arrive_and_wait([&]() {
+                double total = sum_partials();
+                inv_sum = (total > 0.0) ? 1.0 / total : 1.0;
+            });
+
+            // 3) Normalize to force numerical conservation = 1.0, then
+            //    measure how far the ranks moved
+            Simd::scale(next_ranks + lo, len, inv_sum);
+            partial[t].value = Simd::l1_distance(next_ranks + lo, current_ranks + lo, len);
+            barrier.arrive_and_wait([&]() {
+                stats.residual = sum_partials();
+                stats.iterations++;
+                std::swap(current_ranks, next_ranks);
+
+                if (options.log_iterations) {
+                    std::ostringstream line;
+                    line << "[PAGERANK] iter " << std::setw(3) << stats.iterations
+                         << "  residual " << std::scientific << std::setprecision(3) << stats.residual
+                         << "  " << std::fixed << std::setprecision(3)
+                         << elapsed_ms(iteration_start) << " ms";
+                    std::cout << line.str() << std::endl;
+                }
+                iteration_start = std::chrono::steady_clock::now();
+
+                stats.converged = stats.residual < options.tolerance;
+                stop = stats.converged || stats.iterations >= options.max_iterations;
+            });
+
+            if (stop) {
+                break;
+            }
+        }
+    };
+
+    if (options.max_iterations > 0) {
+        std::vector<std::thread> pool;
+        for (size_t t = 1; t < threads; t++) {
+            pool.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    // Final ranks may be sitting in the scratch buffer after the swaps
+    if (current_ranks != ranks.data()) {
+        ranks.swap(next);
+    }
+
+    stats.elapsed_ms = elapsed_ms(start);
+    return stats;
+}
+
+}  // namespace PageRank
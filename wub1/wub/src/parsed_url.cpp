@@ -0,0 +1,271 @@
+#include "parsed_url.h"
+
+namespace {
+
+const size_t MAX_URL_LENGTH = 10000;
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+inline bool is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline char lower_ascii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+std::string_view trim_view(std::string_view value) {
+    size_t first = 0;
+    while (first < value.size() && is_space(value[first])) first++;
+    size_t last = value.size();
+    while (last > first && is_space(value[last - 1])) last--;
+    return value.substr(first, last - first);
+}
+
+bool iequals(std::string_view a, std::string_view lower) {
+    if (a.size() != lower.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (lower_ascii(a[i]) != lower[i]) return false;
+    }
+    return true;
+}
+
+/**
+ * Length of a URI scheme at the start of s, including the ':'
+ * @return 0 if s does not start with "scheme:"
+ */
+size_t scheme_length(std::string_view s) {
+    if (s.empty() || !is_alpha(s[0])) return 0;
+    for (size_t i = 1; i < s.size(); i++) {
+        char c = s[i];
+        if (c == ':') return i + 1;
+        if (!is_alpha(c) && !is_digit(c) && c != '+' && c != '-' && c != '.') return 0;
+    }
+    return 0;
+}
+
+// Two-level public suffixes under ccTLDs (co.uk, com.au, ...)
+bool is_second_level_suffix(std::string_view label) {
+    static const std::string_view common[] = {
+        "co", "com", "net", "org", "gov", "edu", "ac", "or", "ne", "go", "gob", "mil"
+    };
+    for (auto candidate : common) {
+        if (label == candidate) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+std::string ParsedUrl::release() {
+    std::string out = std::move(href);
+    *this = ParsedUrl();
+    return out;
+}
+
+std::string_view ParsedUrl::port() const {
+    return (port_end > host_end) ? view(host_end + 1, port_end) : std::string_view();
+}
+
+std::string_view ParsedUrl::query() const {
+    return (path_end < href.size()) ? view(path_end + 1, static_cast<uint32_t>(href.size()))
+                                    : std::string_view();
+}
+
+std::string_view ParsedUrl::domain() const {
+    std::string_view authority = view(host_begin, port_end);
+    if (authority.size() > 4 && authority.compare(0, 4, "www.") == 0) {
+        authority.remove_prefix(4);
+    }
+    return authority;
+}
+
+std::string_view ParsedUrl::registrable_domain() const {
+    std::string_view h = host();
+    if (h.empty() || h[0] == '[' || is_digit(h.back())) {
+        return h;                       // IP literal
+    }
+
+    size_t last_dot = h.rfind('.');
+    if (last_dot == std::string_view::npos || last_dot == 0) {
+        return h;
+    }
+    size_t second_dot = h.rfind('.', last_dot - 1);
+    if (second_dot == std::string_view::npos) {
+        return h;
+    }
+
+    // "bbc.co.uk": keep three labels when the second-level label is a
+    // generic suffix under a two-letter country code
+    std::string_view tld = h.substr(last_dot + 1);
+    std::string_view sld = h.substr(second_dot + 1, last_dot - second_dot - 1);
+    if (tld.size() == 2 && is_second_level_suffix(sld)) {
+        if (second_dot == 0) return h;
+        size_t third_dot = h.rfind('.', second_dot - 1);
+        return (third_dot == std::string_view::npos) ? h : h.substr(third_dot + 1);
+    }
+    return h.substr(second_dot + 1);
+}
+
+void ParsedUrl::remove_dot_segments(std::string_view path, std::string& out) {
+    out.clear();
+    out.reserve(path.size());
+
+    size_t i = 0;
+    while (i < path.size()) {
+        // Next segment runs from i (a '/') to the following '/'
+        size_t seg_start = i + 1;
+        size_t seg_end = path.find('/', seg_start);
+        if (seg_end == std::string_view::npos) seg_end = path.size();
+        std::string_view segment = path.substr(seg_start, seg_end - seg_start);
+        bool last = (seg_end == path.size());
+
+        if (segment == ".") {
+            if (last) out.push_back('/');
+        } else if (segment == "..") {
+            size_t cut = out.rfind('/');
+            out.resize(cut == std::string::npos ? 0 : cut);
+            if (last) out.push_back('/');
+        } else {
+            out.push_back('/');
+            out.append(segment.data(), segment.size());
+        }
+        i = seg_end;
+    }
+}
+
+bool ParsedUrl::parse(std::string_view input, ParsedUrl& out) {
+    std::string_view s = trim_view(input);
+    if (s.empty() || s.size() > MAX_URL_LENGTH) {
+        return false;
+    }
+
+    size_t scheme_len = scheme_length(s);
+    if (scheme_len == 0) return false;
+    std::string_view scheme_part = s.substr(0, scheme_len - 1);
+    bool https = iequals(scheme_part, "https");
+    if (!https && !iequals(scheme_part, "http")) return false;
+    if (s.compare(scheme_len, 2, "//") != 0) return false;
+
+    // Split off the fragment, then query, path and authority
+    size_t hash = s.find('#', scheme_len + 2);
+    if (hash != std::string_view::npos) s = s.substr(0, hash);
+
+    size_t authority_begin = scheme_len + 2;
+    size_t authority_end = s.find_first_of("/?", authority_begin);
+    if (authority_end == std::string_view::npos) authority_end = s.size();
+    std::string_view authority = s.substr(authority_begin, authority_end - authority_begin);
+
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) authority.remove_prefix(at + 1);
+
+    std::string_view host_part = authority;
+    std::string_view port_part;
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    if (colon != std::string_view::npos &&
+        (bracket == std::string_view::npos || colon > bracket)) {
+        host_part = authority.substr(0, colon);
+        port_part = authority.substr(colon + 1);
+        for (char c : port_part) {
+            if (!is_digit(c)) return false;
+        }
+    }
+    if (host_part.empty()) return false;
+    if ((https && port_part == "443") || (!https && port_part == "80")) {
+        port_part = std::string_view();
+    }
+
+    std::string_view rest = s.substr(authority_end);
+    size_t question = rest.find('?');
+    std::string_view path_part = rest.substr(0, question);
+    std::string_view query_part;
+    bool has_query = question != std::string_view::npos;
+    if (has_query) query_part = rest.substr(question + 1);
+
+    // Assemble the normalized form
+    ParsedUrl result;
+    std::string& h = result.href;
+    h.reserve(s.size());
+    h.append(https ? "https" : "http");
+    result.scheme_end = static_cast<uint32_t>(h.size());
+    h.append("://");
+    result.host_begin = static_cast<uint32_t>(h.size());
+    for (char c : host_part) h.push_back(lower_ascii(c));
+    result.host_end = static_cast<uint32_t>(h.size());
+    if (!port_part.empty()) {
+        h.push_back(':');
+        h.append(port_part.data(), port_part.size());
+    }
+    result.port_end = static_cast<uint32_t>(h.size());
+
+    // Scratch kept per thread: only the result allocates
+    thread_local std::string clean_path;
+    remove_dot_segments(path_part, clean_path);
+    if (clean_path != "/" || has_query) {
+        h.append(clean_path);
+    }
+    result.path_end = static_cast<uint32_t>(h.size());
+
+    if (has_query) {
+        h.push_back('?');
+        h.append(query_part.data(), query_part.size());
+    }
+
+    if (h.size() > MAX_URL_LENGTH) return false;
+    out = std::move(result);
+    return true;
+}
+
+bool ParsedUrl::resolve(const ParsedUrl& base, std::string_view reference,
+                        ParsedUrl& out) {
+    std::string_view ref = trim_view(reference);
+
+    if (scheme_length(ref) > 0) {
+        return parse(ref, out);         // Absolute (non-http schemes fail here)
+    }
+
+    // Scratch kept per thread: only the parsed result allocates
+    thread_local std::string target;
+
+    if (ref.size() >= 2 && ref[0] == '/' && ref[1] == '/') {
+        target.assign(base.scheme().data(), base.scheme().size());
+        target.push_back(':');
+        target.append(ref.data(), ref.size());
+        return parse(target, out);
+    }
+
+    if (ref.empty() || ref[0] == '#') {
+        out = base;
+        return !out.empty();
+    }
+
+    // Same authority from here on
+    target.assign(base.href, 0, base.port_end);
+
+    if (ref[0] == '/') {
+        target.append(ref.data(), ref.size());
+    } else if (ref[0] == '?') {
+        std::string_view base_path = base.path();
+        target.append(base_path.empty() ? std::string_view("/") : base_path);
+        target.append(ref.data(), ref.size());
+    } else {
+        // Merge: directory of the base path + reference
+        std::string_view base_path = base.path();
+        size_t slash = base_path.rfind('/');
+        if (slash == std::string_view::npos) {
+            target.push_back('/');
+        } else {
+            target.append(base_path.substr(0, slash + 1));
+        }
+        target.append(ref.data(), ref.size());
+    }
+
+    return parse(target, out);
+}
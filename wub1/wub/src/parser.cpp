@@ -1,188 +1,218 @@
 #include "parser.h"
 #include "utils.h"
-#include <regex>
-#include <iostream>
-#include <algorithm>
+#include "link_scanner.h"
+#include <chrono>
+
+namespace {
+
+// Longest unfinished construct carried between pieces of a streamed body
+const size_t MAX_CARRY = 64 * 1024;
+
+// Adds the lifetime of a scope to a nanosecond total
+class Stopwatch {
+public:
+    explicit Stopwatch(uint64_t& sum) : total(sum), started(std::chrono::steady_clock::now()) {}
+    ~Stopwatch() {
+        total += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+    }
+
+private:
+    uint64_t& total;
+    std::chrono::steady_clock::time_point started;
+};
+
+}  // namespace
 
 std::vector<std::string> Parser::extract_links(const std::string& html, 
                                                const std::string& base_url) {
     std::vector<std::string> links;
     
-    if (html.empty() || html.length() > 100000000) {  // 100MB safety limit
+    ParsedUrl base;
+    if (!ParsedUrl::parse(base_url, base)) {
         return links;
     }
     
-    try {
-        // Regex to match href attributes in anchor tags
-        std::regex href_regex(R"(href\s*=\s*[\"']([^\"']+)[\"'])");
-        std::smatch match;
-        
-        std::string::const_iterator searchStart(html.cbegin());
-        
-        while (std::regex_search(searchStart, html.cend(), match, href_regex)) {
-            std::string url = match[1];
-            
-            // Validate extracted URL
-            if (url.empty() || url.length() > 10000) {
-                searchStart = match.suffix().first;
-                continue;
-            }
-            
-            // Resolve relative URLs
-            if (is_relative_url(url)) {
-                url = resolve_relative_url(base_url, url);
-            }
-            
-            // Normalize and validate
-            url = normalize_url(url);
-            if (is_valid_url(url)) {
-                links.push_back(url);
-            }
-            
-            searchStart = match.suffix().first;
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "[ERROR] Exception in extract_links: " << e.what() << std::endl;
+    std::vector<ParsedUrl> parsed = extract_parsed_links(html, base);
+    links.reserve(parsed.size());
+    for (auto& link : parsed) {
+        links.push_back(link.release());
     }
-    
     return links;
 }
 
-std::string Parser::extract_domain(const std::string& url) {
-    try {
-        std::regex domain_regex(R"(^https?://([^/]+))");
-        std::smatch match;
-        
-        if (std::regex_search(url, match, domain_regex)) {
-            std::string domain = match[1];
-            // Remove 'www.' prefix if present
-            if (Utils::starts_with(domain, "www.")) {
-                domain = domain.substr(4);
-            }
-            return Utils::to_lowercase(domain);
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "[ERROR] Exception in extract_domain: " << e.what() << std::endl;
+std::vector<ParsedUrl> Parser::extract_parsed_links(std::string_view html,
+                                                    const ParsedUrl& page) {
+    if (html.empty() || html.length() > 100000000) {  // 100MB safety limit
+        return {};
     }
     
-    return "";
+    LinkExtractor extractor(page);
+    extractor.scan(html);
+    return std::move(extractor.links());
 }
 
-bool Parser::is_valid_url(const std::string& url) {
-    // Must start with http or https
-    if (!Utils::starts_with(url, "http://") && 
-        !Utils::starts_with(url, "https://")) {
-        return false;
+LinkExtractor::LinkExtractor(const ParsedUrl& page_url, size_t link_limit, bool text_fingerprint)
+    : page(page_url), base(&page), max_links(link_limit), fingerprint(text_fingerprint) {}
+
+void LinkExtractor::reset(const ParsedUrl& page_url, size_t link_limit, bool text_fingerprint) {
+    page = page_url;
+    base = &page;
+    base_seen = false;
+    max_links = link_limit;
+    full = false;
+    fingerprint = text_fingerprint;
+    text_hash.reset();
+    parse_ns = 0;
+    state.mode = LinkScanState::Mode::Text;
+    state.name.clear();
+    carry.clear();
+    found.clear();
+}
+
+bool LinkExtractor::handle(const LinkToken& token) {
+    // <base href> overrides the page URL for everything after it
+    if (LinkScanner::name_equals(token.tag, "base")) {
+        if (!base_seen && token.attr == LinkAttr::Href) {
+            if (ParsedUrl::resolve(page, token.url, base_override)) {
+                base = &base_override;
+            }
+            base_seen = true;
+        }
+        return true;
     }
     
-    // Must not be too long
-    if (url.length() > 10000) {
-        return false;
+    if (!is_followable(token)) {
+        return true;
     }
     
-    // Must have a domain
-    std::string domain = extract_domain(url);
-    return !domain.empty();
+    // Validate extracted URL
+    if (token.url.length() > 10000) {
+        return true;
+    }
+    
+    // Resolve, normalize and validate in one pass
+    if (ParsedUrl::resolve(*base, token.url, link)) {
+        found.push_back(std::move(link));
+        if (max_links > 0 && found.size() >= max_links) {
+            full = true;
+            return false;
+        }
+    }
+    return true;
 }
 
-std::string Parser::normalize_url(const std::string& url) {
-    std::string normalized = url;
+bool LinkExtractor::consume(std::string_view chunk) {
+    if (full) {
+        return false;
+    }
+    Stopwatch timer(parse_ns);
     
-    try {
-        // Remove fragment (everything after #)
-        size_t fragment_pos = normalized.find('#');
-        if (fragment_pos != std::string::npos) {
-            normalized = normalized.substr(0, fragment_pos);
-        }
-        
-        // Trim whitespace
-        normalized = Utils::trim(normalized);
-        
-        // Convert to lowercase
-        normalized = Utils::to_lowercase(normalized);
-        
-        // Remove trailing slash from domain only (but keep path structure)
-        if (normalized.length() > 0 && normalized.back() == '/') {
-            // Check if this is just domain/
-            std::regex domain_only_regex(R"(^https?://[^/]+/$)");
-            if (std::regex_match(normalized, domain_only_regex)) {
-                normalized = normalized.substr(0, normalized.length() - 1);
-            }
+    // Scan the piece in place unless a construct from the last one is pending
+    std::string_view view = chunk;
+    if (!carry.empty()) {
+        carry.append(chunk);
+        view = carry;
+    }
+    
+    LinkScanner scanner(view, state);
+    attach(scanner);
+    LinkToken token;
+    while (scanner.next(token)) {
+        if (!handle(token)) {
+            return false;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "[ERROR] Exception in normalize_url: " << e.what() << std::endl;
     }
     
-    return normalized;
+    size_t keep = scanner.consumed();
+    if (view.size() - keep > MAX_CARRY) {
+        // Runaway tag (e.g. an unterminated quote): give it up as the
+        // whole-document scan would
+        carry.clear();
+        state = LinkScanState();
+    } else if (carry.empty()) {
+        carry.assign(view.substr(keep));
+    } else {
+        carry.erase(0, keep);
+    }
+    return true;
 }
 
-std::string Parser::resolve_relative_url(const std::string& base, 
-                                         const std::string& relative) {
-    try {
-        if (Utils::starts_with(relative, "http://") || 
-            Utils::starts_with(relative, "https://")) {
-            return relative;
-        }
-        
-        // Extract base domain and path
-        std::regex base_regex(R"(^(https?://[^/]+)(/?[^?#]*)?)");
-        std::smatch match;
-        
-        if (!std::regex_search(base, match, base_regex)) {
-            return base + "/" + relative;
-        }
-        
-        std::string base_domain = match[1];
-        std::string base_path = match[2];
-        
-        if (Utils::starts_with(relative, "/")) {
-            // Absolute path
-            return base_domain + relative;
-        } else if (Utils::starts_with(relative, "./")) {
-            // Current directory
-            if (base_path.empty() || base_path.back() != '/') {
-                base_path += "/";
-            }
-            return base_domain + base_path + relative.substr(2);
-        } else if (Utils::starts_with(relative, "../")) {
-            // Parent directory - simplified handling
-            return base_domain + "/" + relative;
-        } else {
-            // Relative to current path
-            if (base_path.empty() || base_path.back() != '/') {
-                base_path += "/";
-            }
-            return base_domain + base_path + relative;
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "[ERROR] Exception in resolve_relative_url: " << e.what() << std::endl;
-        return base + "/" + relative;
+void LinkExtractor::finish() {
+    if (full) {
+        return;
+    }
+    Stopwatch timer(parse_ns);
+    LinkScanner scanner(carry, state, true);
+    attach(scanner);
+    LinkToken token;
+    while (scanner.next(token) && handle(token)) {
     }
+    carry.clear();
+    state = LinkScanState();
 }
 
-bool Parser::is_relative_url(const std::string& url) {
-    return !Utils::starts_with(url, "http://") && 
-           !Utils::starts_with(url, "https://");
+void LinkExtractor::scan(std::string_view html) {
+    Stopwatch timer(parse_ns);
+    LinkScanner scanner(html);
+    attach(scanner);
+    LinkToken token;
+    while (scanner.next(token) && handle(token)) {
+    }
 }
 
-std::string Parser::remove_query_fragment(const std::string& url) {
-    std::string result = url;
-    
-    try {
-        // Remove query string
-        size_t query_pos = result.find('?');
-        if (query_pos != std::string::npos) {
-            result = result.substr(0, query_pos);
-        }
-        
-        // Remove fragment
-        size_t fragment_pos = result.find('#');
-        if (fragment_pos != std::string::npos) {
-            result = result.substr(0, fragment_pos);
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "[ERROR] Exception in remove_query_fragment: " << e.what() << std::endl;
+void LinkExtractor::attach(LinkScanner& scanner) {
+    if (fingerprint) {
+        scanner.set_text_sink(&text_hash);
     }
-    
-    return result;
-}
\ No newline at end of file
+}
+
+std::vector<ParsedUrl>& LinkExtractor::links() {
+    return found;
+}
+
+bool LinkExtractor::limit_reached() const {
+    return full;
+}
+
+bool LinkExtractor::is_followable(const LinkToken& token) {
+    // Every href is a navigation target; src only when it embeds a document
+    if (token.attr == LinkAttr::Href) {
+        return true;
+    }
+    return LinkScanner::name_equals(token.tag, "iframe") ||
+           LinkScanner::name_equals(token.tag, "frame");
+}
+
+std::string Parser::extract_domain(const std::string& url) {
+    ParsedUrl parsed;
+    if (!ParsedUrl::parse(url, parsed)) {
+        return "";
+    }
+    return std::string(parsed.domain());
+}
+
+bool Parser::is_valid_url(const std::string& url) {
+    // Absolute http/https URL with a host, within the length limit
+    ParsedUrl parsed;
+    return ParsedUrl::parse(url, parsed);
+}
+
+std::string Parser::normalize_url(const std::string& url) {
+    ParsedUrl parsed;
+    if (!ParsedUrl::parse(url, parsed)) {
+        return Utils::trim(url);
+    }
+    return parsed.release();
+}
+
+std::string Parser::resolve_relative_url(const std::string& base, 
+                                         const std::string& relative) {
+    ParsedUrl parsed_base;
+    ParsedUrl resolved;
+    if (!ParsedUrl::parse(base, parsed_base) ||
+        !ParsedUrl::resolve(parsed_base, relative, resolved)) {
+        return "";
+    }
+    return resolved.release();
+}
@@ -0,0 +1,89 @@
+#include "robots_fetcher.h"
+#include "host_scheduler.h"
+#include <utility>
+
+void RobotsFetcher::request_robots(std::string_view url) {
+    FetchRequest request;
+    request.url = robots_url(url);
+    request.kind = FetchKind::Robots;
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(std::move(request));
+    queued.store(pending.size());
+    requested.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool RobotsFetcher::request_sitemap(const std::string& url, uint32_t nesting) {
+    if (nesting > MAX_NESTING) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sitemaps_seen.size() >= MAX_SITEMAPS || !sitemaps_seen.insert(url).second) {
+        return false;
+    }
+    FetchRequest request;
+    request.url = url;
+    request.kind = FetchKind::Sitemap;
+    request.depth = nesting;
+    pending.push_back(std::move(request));
+    queued.store(pending.size());
+    return true;
+}
+
+bool RobotsFetcher::next(FetchRequest& request) {
+    // Checked on every fill of every loop: stay off the lock when idle
+    if (queued.load() == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.empty()) {
+        return false;
+    }
+    request = std::move(pending.front());
+    pending.pop_front();
+    queued.store(pending.size());
+    return true;
+}
+
+std::shared_ptr<const RobotsRules> RobotsFetcher::rules_for(const FetchResult& result,
+                                                            std::string_view agent) {
+    if (result.ok) {
+        fetched.fetch_add(1, std::memory_order_relaxed);
+        auto rules = RobotsRules::parse(result.body, agent);
+        if (rules->crawl_delay_ms() > 0) {
+            delayed_hosts.fetch_add(1, std::memory_order_relaxed);
+        }
+        return rules;
+    }
+    if (result.http_code >= 400 && result.http_code < 500 && result.http_code != 429) {
+        missing.fetch_add(1, std::memory_order_relaxed);
+        return RobotsRules::parse(std::string_view(), agent);
+    }
+    // Server error, throttled or no answer: assume a complete disallow
+    unreachable.fetch_add(1, std::memory_order_relaxed);
+    return RobotsRules::disallow_all();
+}
+
+std::string RobotsFetcher::robots_url(std::string_view url) {
+    size_t scheme_end = url.find("://");
+    std::string_view scheme = scheme_end == std::string_view::npos ? std::string_view("http")
+                                                                    : url.substr(0, scheme_end);
+    std::string robots;
+    robots.reserve(scheme.size() + url.size() + 14);
+    robots.append(scheme);
+    robots.append("://");
+    robots.append(HostScheduler::host_key(url));
+    robots.append("/robots.txt");
+    return robots;
+}
+
+RobotsStats RobotsFetcher::stats() const {
+    RobotsStats stats;
+    stats.requested = requested.load(std::memory_order_relaxed);
+    stats.fetched = fetched.load(std::memory_order_relaxed);
+    stats.missing = missing.load(std::memory_order_relaxed);
+    stats.unreachable = unreachable.load(std::memory_order_relaxed);
+    stats.delayed_hosts = delayed_hosts.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.sitemaps = sitemaps_seen.size();
+    return stats;
+}
@@ -0,0 +1,284 @@
+#include "robots_rules.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <utility>
+
+namespace {
+
+// Trie while it is being built; flattened into RobotsRules::nodes
+struct BuildNode {
+    std::map<uint8_t, uint32_t> children;
+    int8_t rule = 0;
+};
+
+struct Rule {
+    std::string_view path;
+    bool allow;
+};
+
+// Longest Crawl-delay we keep (the politeness policy caps it further)
+const double MAX_DELAY_SECONDS = 86400.0;
+
+std::string_view trim(std::string_view text) {
+    size_t begin = 0;
+    while (begin < text.size() && std::isspace(static_cast<unsigned char>(text[begin]))) {
+        begin++;
+    }
+    size_t end = text.size();
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+        end--;
+    }
+    return text.substr(begin, end - begin);
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+std::shared_ptr<const RobotsRules> RobotsRules::parse(std::string_view text, std::string_view agent) {
+    auto compiled = std::make_shared<RobotsRules>();
+    if (text.size() > MAX_BYTES) {
+        text = text.substr(0, MAX_BYTES);
+    }
+
+    // Rules of the groups naming us and of the "*" groups; a group is a
+    // run of User-agent lines followed by its rules
+    std::vector<Rule> ours;
+    std::vector<Rule> star;
+    double ours_delay = -1.0;
+    double star_delay = -1.0;
+    bool have_ours = false;
+    bool have_star = false;
+    bool group_ours = false;
+    bool group_star = false;
+    bool in_agents = false;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t comment = line.find('#');
+        if (comment != std::string_view::npos) {
+            line = line.substr(0, comment);
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view key = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (iequals(key, "user-agent")) {
+            if (!in_agents) {
+                group_ours = false;
+                group_star = false;
+            }
+            in_agents = true;
+            std::string_view token = value.substr(0, value.find_first_of("/ \t"));
+            if (token == "*") {
+                group_star = true;
+                have_star = true;
+            } else if (!token.empty() && iequals(token, agent)) {
+                group_ours = true;
+                have_ours = true;
+            }
+            continue;
+        }
+        if (iequals(key, "sitemap")) {
+            // Not part of any group
+            if (!value.empty()) {
+                compiled->sitemap_urls.emplace_back(value);
+            }
+            continue;
+        }
+
+        in_agents = false;
+        if (!group_ours && !group_star) {
+            continue;
+        }
+        bool allow = iequals(key, "allow");
+        if (allow || iequals(key, "disallow")) {
+            if (value.empty()) {
+                continue;               // "Disallow:" blocks nothing
+            }
+            if (group_ours) {
+                ours.push_back(Rule{value, allow});
+            }
+            if (group_star) {
+                star.push_back(Rule{value, allow});
+            }
+        } else if (iequals(key, "crawl-delay")) {
+            std::string number(value);
+            char* number_end = nullptr;
+            double seconds = std::strtod(number.c_str(), &number_end);
+            if (number_end != number.c_str() && seconds >= 0.0) {
+                seconds = std::min(seconds, MAX_DELAY_SECONDS);
+                if (group_ours) {
+                    ours_delay = std::max(ours_delay, seconds);
+                }
+                if (group_star) {
+                    star_delay = std::max(star_delay, seconds);
+                }
+            }
+        }
+    }
+
+    const std::vector<Rule>& chosen = have_ours ? ours : star;
+    double delay = have_ours ? ours_delay : (have_star ? star_delay : -1.0);
+    compiled->delay_ms = delay > 0.0 ? static_cast<int>(delay * 1000.0) : 0;
+    compiled->rules = chosen.size();
+
+    // Plain prefixes go into the trie; a trailing '*' adds nothing
+    std::vector<BuildNode> build(1);
+    for (const Rule& rule : chosen) {
+        std::string_view path = rule.path;
+        while (path.size() > 1 && path.back() == '*') {
+            path.remove_suffix(1);
+        }
+        if (path.find_first_of("*$") != std::string_view::npos) {
+            compiled->patterns.push_back(Pattern{std::string(path), rule.allow});
+            continue;
+        }
+        uint32_t node = 0;
+        for (char c : path) {
+            uint8_t byte = static_cast<uint8_t>(c);
+            auto it = build[node].children.find(byte);
+            if (it == build[node].children.end()) {
+                uint32_t child = static_cast<uint32_t>(build.size());
+                build[node].children.emplace(byte, child);
+                build.emplace_back();
+                node = child;
+            } else {
+                node = it->second;
+            }
+        }
+        // The same path allowed and disallowed: Allow wins
+        int8_t value = rule.allow ? 1 : -1;
+        build[node].rule = std::max(build[node].rule, value);
+        if (build[node].rule == 0) {
+            build[node].rule = value;
+        }
+    }
+
+    // Breadth-first flattening keeps each node's edges together
+    compiled->nodes.resize(build.size());
+    std::vector<uint32_t> flat_id(build.size(), 0);
+    std::deque<uint32_t> pending = {0};
+    uint32_t next_id = 1;
+    while (!pending.empty()) {
+        uint32_t id = pending.front();
+        pending.pop_front();
+        Node& node = compiled->nodes[flat_id[id]];
+        node.rule = build[id].rule;
+        node.first_edge = static_cast<uint32_t>(compiled->edge_bytes.size());
+        node.edge_count = static_cast<uint16_t>(build[id].children.size());
+        for (const auto& child : build[id].children) {
+            flat_id[child.second] = next_id++;
+            compiled->edge_bytes.push_back(child.first);
+            compiled->edge_targets.push_back(flat_id[child.second]);
+            pending.push_back(child.second);
+        }
+    }
+    return compiled;
+}
+
+std::shared_ptr<const RobotsRules> RobotsRules::disallow_all() {
+    return parse("User-agent: *\nDisallow: /\n", "*");
+}
+
+bool RobotsRules::allowed(std::string_view path) const {
+    if (path.empty()) {
+        path = "/";
+    }
+
+    // Deepest rule on the walk = longest matching prefix
+    long best_length = -1;
+    bool best_allow = true;
+    uint32_t node = 0;
+    for (size_t i = 0; i < path.size(); i++) {
+        const Node& current = nodes[node];
+        uint8_t byte = static_cast<uint8_t>(path[i]);
+        uint32_t end = current.first_edge + current.edge_count;
+        uint32_t next = 0;
+        for (uint32_t edge = current.first_edge; edge < end && edge_bytes[edge] <= byte; edge++) {
+            if (edge_bytes[edge] == byte) {
+                next = edge_targets[edge];
+                break;
+            }
+        }
+        if (next == 0) {
+            break;                      // The root is never a child
+        }
+        node = next;
+        if (nodes[node].rule != 0) {
+            best_length = static_cast<long>(i + 1);
+            best_allow = nodes[node].rule > 0;
+        }
+    }
+
+    for (const Pattern& pattern : patterns) {
+        long length = static_cast<long>(pattern.pattern.size());
+        if (length < best_length || (length == best_length && (best_allow || !pattern.allow))) {
+            continue;
+        }
+        if (pattern_matches(pattern.pattern, path)) {
+            best_length = length;
+            best_allow = pattern.allow;
+        }
+    }
+    return best_allow;
+}
+
+bool RobotsRules::pattern_matches(std::string_view pattern, std::string_view path) {
+    bool anchored = !pattern.empty() && pattern.back() == '$';
+    if (anchored) {
+        pattern.remove_suffix(1);
+    }
+
+    // Greedy glob with backtracking to the last '*'; without '$' the
+    // pattern only has to match a prefix
+    size_t p = 0;
+    size_t s = 0;
+    size_t star = std::string_view::npos;
+    size_t mark = 0;
+    while (true) {
+        if (p == pattern.size() && (!anchored || s == path.size())) {
+            return true;
+        }
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            mark = s;
+            continue;
+        }
+        if (p < pattern.size() && s < path.size() && pattern[p] == path[s]) {
+            p++;
+            s++;
+            continue;
+        }
+        if (star != std::string_view::npos && mark < path.size()) {
+            p = star + 1;
+            s = ++mark;
+            continue;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,300 @@
+#include "simd_math.h"
+#include "simd_scan.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WUB_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define WUB_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Simd {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Scalar fallback (also finishes the tails of the vector versions)
+// ---------------------------------------------------------------------------
+
+double sum_scalar(const double* a, size_t n) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) total += a[i];
+    return total;
+}
+
+double dot_scalar(const double* a, const double* b, size_t n) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) total += a[i] * b[i];
+    return total;
+}
+
+void multiply_scalar(double* dst, const double* a, const double* b, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = a[i] * b[i];
+}
+
+void scale_scalar(double* a, size_t n, double factor) {
+    for (size_t i = 0; i < n; i++) a[i] *= factor;
+}
+
+double l1_scalar(const double* a, const double* b, size_t n) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) total += std::fabs(a[i] - b[i]);
+    return total;
+}
+
+#if WUB_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// SSE2: two doubles per register, two accumulators
+// ---------------------------------------------------------------------------
+
+inline double hsum_sse2(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+double sum_sse2(const double* a, size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(a + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(a + i + 2));
+    }
+    return hsum_sse2(_mm_add_pd(acc0, acc1)) + sum_scalar(a + i, n - i);
+}
+
+double dot_sse2(const double* a, const double* b, size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    return hsum_sse2(_mm_add_pd(acc0, acc1)) + dot_scalar(a + i, b + i, n - i);
+}
+
+void multiply_sse2(double* dst, const double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    multiply_scalar(dst + i, a + i, b + i, n - i);
+}
+
+void scale_sse2(double* a, size_t n, double factor) {
+    const __m128d f = _mm_set1_pd(factor);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(a + i, _mm_mul_pd(_mm_loadu_pd(a + i), f));
+    }
+    scale_scalar(a + i, n - i, factor);
+}
+
+double l1_sse2(const double* a, const double* b, size_t n) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2));
+        acc0 = _mm_add_pd(acc0, _mm_andnot_pd(sign, d0));
+        acc1 = _mm_add_pd(acc1, _mm_andnot_pd(sign, d1));
+    }
+    return hsum_sse2(_mm_add_pd(acc0, acc1)) + l1_scalar(a + i, b + i, n - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: four doubles per register, two accumulators
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+inline double hsum_avx2(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    return hsum_sse2(_mm_add_pd(lo, hi));
+}
+
+__attribute__((target("avx2")))
+double sum_avx2(const double* a, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(a + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(a + i + 4));
+    }
+    return hsum_avx2(_mm256_add_pd(acc0, acc1)) + sum_sse2(a + i, n - i);
+}
+
+__attribute__((target("avx2")))
+double dot_avx2(const double* a, const double* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4),
+                                                 _mm256_loadu_pd(b + i + 4)));
+    }
+    return hsum_avx2(_mm256_add_pd(acc0, acc1)) + dot_sse2(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void multiply_avx2(double* dst, const double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    multiply_sse2(dst + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void scale_avx2(double* a, size_t n, double factor) {
+    const __m256d f = _mm256_set1_pd(factor);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), f));
+    }
+    scale_sse2(a + i, n - i, factor);
+}
+
+__attribute__((target("avx2")))
+double l1_avx2(const double* a, const double* b, size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+        acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, d0));
+        acc1 = _mm256_add_pd(acc1, _mm256_andnot_pd(sign, d1));
+    }
+    return hsum_avx2(_mm256_add_pd(acc0, acc1)) + l1_sse2(a + i, b + i, n - i);
+}
+
+#endif  // WUB_SIMD_X86
+
+#if WUB_SIMD_NEON
+
+// ---------------------------------------------------------------------------
+// NEON (AArch64 has float64x2)
+// ---------------------------------------------------------------------------
+
+double sum_neon(const double* a, size_t n) {
+    float64x2_t acc0 = vdupq_n_f64(0.0), acc1 = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = vaddq_f64(acc0, vld1q_f64(a + i));
+        acc1 = vaddq_f64(acc1, vld1q_f64(a + i + 2));
+    }
+    return vaddvq_f64(vaddq_f64(acc0, acc1)) + sum_scalar(a + i, n - i);
+}
+
+double dot_neon(const double* a, const double* b, size_t n) {
+    float64x2_t acc0 = vdupq_n_f64(0.0), acc1 = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(a + i), vld1q_f64(b + i));
+        acc1 = vfmaq_f64(acc1, vld1q_f64(a + i + 2), vld1q_f64(b + i + 2));
+    }
+    return vaddvq_f64(vaddq_f64(acc0, acc1)) + dot_scalar(a + i, b + i, n - i);
+}
+
+void multiply_neon(double* dst, const double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        vst1q_f64(dst + i, vmulq_f64(vld1q_f64(a + i), vld1q_f64(b + i)));
+    }
+    multiply_scalar(dst + i, a + i, b + i, n - i);
+}
+
+void scale_neon(double* a, size_t n, double factor) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        vst1q_f64(a + i, vmulq_n_f64(vld1q_f64(a + i), factor));
+    }
+    scale_scalar(a + i, n - i, factor);
+}
+
+double l1_neon(const double* a, const double* b, size_t n) {
+    float64x2_t acc0 = vdupq_n_f64(0.0), acc1 = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = vaddq_f64(acc0, vabdq_f64(vld1q_f64(a + i), vld1q_f64(b + i)));
+        acc1 = vaddq_f64(acc1, vabdq_f64(vld1q_f64(a + i + 2), vld1q_f64(b + i + 2)));
+    }
+    return vaddvq_f64(vaddq_f64(acc0, acc1)) + l1_scalar(a + i, b + i, n - i);
+}
+
+#endif  // WUB_SIMD_NEON
+
+}  // namespace
+
+// Called once per node range per pass, so checking the level on every
+// call costs nothing measurable
+
+double sum(const double* a, size_t n) {
+    switch (active_level()) {
+#if WUB_SIMD_X86
+        case Level::AVX2: return sum_avx2(a, n);
+        case Level::SSE2: return sum_sse2(a, n);
+#endif
+#if WUB_SIMD_NEON
+        case Level::NEON: return sum_neon(a, n);
+#endif
+        default: return sum_scalar(a, n);
+    }
+}
+
+double dot(const double* a, const double* b, size_t n) {
+    switch (active_level()) {
+#if WUB_SIMD_X86
+        case Level::AVX2: return dot_avx2(a, b, n);
+        case Level::SSE2: return dot_sse2(a, b, n);
+#endif
+#if WUB_SIMD_NEON
+        case Level::NEON: return dot_neon(a, b, n);
+#endif
+        default: return dot_scalar(a, b, n);
+    }
+}
+
+void multiply(double* dst, const double* a, const double* b, size_t n) {
+    switch (active_level()) {
+#if WUB_SIMD_X86
+        case Level::AVX2: multiply_avx2(dst, a, b, n); return;
+        case Level::SSE2: multiply_sse2(dst, a, b, n); return;
+#endif
+#if WUB_SIMD_NEON
+        case Level::NEON: multiply_neon(dst, a, b, n); return;
+#endif
+        default: multiply_scalar(dst, a, b, n); return;
+    }
+}
+
+void scale(double* a, size_t n, double factor) {
+    switch (active_level()) {
+#if WUB_SIMD_X86
+        case Level::AVX2: scale_avx2(a, n, factor); return;
+        case Level::SSE2: scale_sse2(a, n, factor); return;
+#endif
+#if WUB_SIMD_NEON
+        case Level::NEON: scale_neon(a, n, factor); return;
+#endif
+        default: scale_scalar(a, n, factor); return;
+    }
+}
+
+double l1_distance(const double* a, const double* b, size_t n) {
+    switch (active_level()) {
+#if WUB_SIMD_X86
+        case Level::AVX2: return l1_avx2(a, b, n);
+        case Level::SSE2: return l1_sse2(a, b, n);
+#endif
+#if WUB_SIMD_NEON
+        case Level::NEON: return l1_neon(a, b, n);
+#endif
+        default: return l1_scalar(a, b, n);
+    }
+}
+
+}  // namespace Simd
@@ -0,0 +1,265 @@
+#include "simd_scan.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WUB_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define WUB_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Simd {
+
+namespace {
+
+using FindCharFn = const char* (*)(const char*, const char*, char);
+using FindChar2Fn = const char* (*)(const char*, const char*, char, char);
+
+// ---------------------------------------------------------------------------
+// Scalar fallback
+// ---------------------------------------------------------------------------
+
+const char* find_char_scalar(const char* p, const char* end, char c) {
+    for (; p < end; p++) {
+        if (*p == c) return p;
+    }
+    return end;
+}
+
+const char* find_char2_scalar(const char* p, const char* end, char a, char b) {
+    for (; p < end; p++) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+#if WUB_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// SSE2 (x86-64 baseline). SSE4.2's pcmpistri is slower than two
+// pcmpeqb + pmovmskb for one or two needles, so it isn't used here
+// ---------------------------------------------------------------------------
+
+const char* find_char_sse2(const char* p, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+    return find_char_scalar(p, end, c);
+}
+
+const char* find_char2_sse2(const char* p, const char* end, char a, char b) {
+    const __m128i na = _mm_set1_epi8(a);
+    const __m128i nb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, na), _mm_cmpeq_epi8(chunk, nb));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+    return find_char2_scalar(p, end, a, b);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2, compiled for the target only in these functions
+// ---------------------------------------------------------------------------
+
+// Most searches inside a tag end within a few bytes, so the first
+// 16 bytes are probed with SSE2 before switching to 32-byte blocks
+
+__attribute__((target("avx2")))
+const char* find_char_avx2(const char* p, const char* end, char c) {
+    if (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(c)));
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return find_char_sse2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* find_char2_avx2(const char* p, const char* end, char a, char b) {
+    if (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(a)),
+                                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8(b)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+    const __m256i na = _mm256_set1_epi8(a);
+    const __m256i nb = _mm256_set1_epi8(b);
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, na),
+                                       _mm256_cmpeq_epi8(chunk, nb));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return find_char2_sse2(p, end, a, b);
+}
+
+#endif  // WUB_SIMD_X86
+
+#if WUB_SIMD_NEON
+
+// ---------------------------------------------------------------------------
+// NEON: narrow the 16-byte compare result to a 64-bit nibble mask
+// ---------------------------------------------------------------------------
+
+inline uint64_t neon_mask(uint8x16_t eq) {
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+const char* find_char_neon(const char* p, const char* end, char c) {
+    const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+    while (end - p >= 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint64_t mask = neon_mask(vceqq_u8(chunk, needle));
+        if (mask) return p + (__builtin_ctzll(mask) >> 2);
+        p += 16;
+    }
+    return find_char_scalar(p, end, c);
+}
+
+const char* find_char2_neon(const char* p, const char* end, char a, char b) {
+    const uint8x16_t na = vdupq_n_u8(static_cast<uint8_t>(a));
+    const uint8x16_t nb = vdupq_n_u8(static_cast<uint8_t>(b));
+    while (end - p >= 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint64_t mask = neon_mask(vorrq_u8(vceqq_u8(chunk, na), vceqq_u8(chunk, nb)));
+        if (mask) return p + (__builtin_ctzll(mask) >> 2);
+        p += 16;
+    }
+    return find_char2_scalar(p, end, a, b);
+}
+
+#endif  // WUB_SIMD_NEON
+
+// ---------------------------------------------------------------------------
+// Runtime dispatch
+// ---------------------------------------------------------------------------
+
+bool cpu_supports(Level level) {
+    switch (level) {
+        case Level::Scalar:
+            return true;
+#if WUB_SIMD_X86
+        case Level::SSE2:
+            return true;
+        case Level::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#if WUB_SIMD_NEON
+        case Level::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+Level best_level() {
+#if WUB_SIMD_X86
+    return cpu_supports(Level::AVX2) ? Level::AVX2 : Level::SSE2;
+#elif WUB_SIMD_NEON
+    return Level::NEON;
+#else
+    return Level::Scalar;
+#endif
+}
+
+struct Dispatch {
+    Level level = Level::Scalar;
+    FindCharFn find_char = find_char_scalar;
+    FindChar2Fn find_char2 = find_char2_scalar;
+
+    void select(Level requested) {
+        level = requested;
+        switch (requested) {
+#if WUB_SIMD_X86
+            case Level::SSE2:
+                find_char = find_char_sse2;
+                find_char2 = find_char2_sse2;
+                return;
+            case Level::AVX2:
+                find_char = find_char_avx2;
+                find_char2 = find_char2_avx2;
+                return;
+#endif
+#if WUB_SIMD_NEON
+            case Level::NEON:
+                find_char = find_char_neon;
+                find_char2 = find_char2_neon;
+                return;
+#endif
+            default:
+                level = Level::Scalar;
+                find_char = find_char_scalar;
+                find_char2 = find_char2_scalar;
+                return;
+        }
+    }
+};
+
+Dispatch make_dispatch() {
+    Dispatch d;
+    d.select(best_level());
+    return d;
+}
+
+// Selected once during static initialization; plain global so the hot
+// path is a single indirect call with no init guard
+Dispatch active = make_dispatch();
+
+Dispatch& dispatch() {
+    return active;
+}
+
+}  // namespace
+
+Level active_level() {
+    return dispatch().level;
+}
+
+const char* level_name(Level level) {
+    switch (level) {
+        case Level::SSE2: return "sse2";
+        case Level::AVX2: return "avx2";
+        case Level::NEON: return "neon";
+        default: return "scalar";
+    }
+}
+
+bool force_level(Level level) {
+    if (!cpu_supports(level)) {
+        return false;
+    }
+    dispatch().select(level);
+    return true;
+}
+
+const char* find_char(const char* begin, const char* end, char c) {
+    return dispatch().find_char(begin, end, c);
+}
+
+const char* find_char2(const char* begin, const char* end, char a, char b) {
+    return dispatch().find_char2(begin, end, a, b);
+}
+
+}  // namespace Simd
@@ -0,0 +1,133 @@
+#include "simhash.h"
+#include "hash64.h"
+#include <algorithm>
+
+namespace {
+
+// Words are hashed on their first bytes only; keeps the carry bounded
+const size_t MAX_WORD_BYTES = 64;
+
+// ASCII letters and digits, and every byte of a multi-byte UTF-8 sequence
+struct WordTable {
+    bool word[256];
+
+    WordTable() {
+        for (int c = 0; c < 256; c++) {
+            word[c] = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                      (c >= 'A' && c <= 'Z') || c >= 0x80;
+        }
+    }
+};
+
+const WordTable WORD_CHARS;
+
+inline bool is_word(char c) {
+    return WORD_CHARS.word[static_cast<unsigned char>(c)];
+}
+
+}  // namespace
+
+SimHash::SimHash() {
+    reset();
+}
+
+void SimHash::reset() {
+    std::fill(votes, votes + BITS, 0);
+    previous = 0;
+    count = 0;
+    partial.clear();
+}
+
+void SimHash::add_word(std::string_view word) {
+    uint64_t h = Hash64::hash(word.substr(0, MAX_WORD_BYTES));
+    uint64_t feature = Hash64::mix(previous * 0x9e3779b97f4a7c15ULL ^ h);
+    previous = h;
+    count++;
+    for (int b = 0; b < BITS; b++) {
+        votes[b] += static_cast<int32_t>((feature >> b) & 1) * 2 - 1;
+    }
+}
+
+void SimHash::text(std::string_view run) {
+    const size_t n = run.size();
+    size_t i = 0;
+    if (!partial.empty()) {
+        // Finish the word the last run ended in
+        while (i < n && is_word(run[i])) i++;
+        partial.append(run.data(), std::min(i, MAX_WORD_BYTES - partial.size()));
+        if (i == n) {
+            return;
+        }
+        add_word(partial);
+        partial.clear();
+    }
+    while (i < n) {
+        while (i < n && !is_word(run[i])) i++;
+        size_t start = i;
+        while (i < n && is_word(run[i])) i++;
+        if (i == n) {
+            // May go on in the next run
+            partial.assign(run.data() + start, std::min(n - start, MAX_WORD_BYTES));
+            break;
+        }
+        add_word(run.substr(start, i - start));
+    }
+}
+
+void SimHash::boundary() {
+    if (!partial.empty()) {
+        add_word(partial);
+        partial.clear();
+    }
+}
+
+uint64_t SimHash::digest() {
+    boundary();
+    uint64_t fingerprint = 0;
+    for (int b = 0; b < BITS; b++) {
+        if (votes[b] > 0) {
+            fingerprint |= 1ULL << b;
+        }
+    }
+    return fingerprint;
+}
+
+SimHashIndex::SimHashIndex(int distance, int bucket_bits)
+    : max_distance(std::clamp(distance, 1, 7)), bands(max_distance + 1),
+      buckets(size_t(1) << bucket_bits),
+      slots(new uint64_t[static_cast<size_t>(bands) * buckets * BUCKET_SLOTS]()),
+      cursors(new uint8_t[static_cast<size_t>(bands) * buckets]()) {}
+
+size_t SimHashIndex::bucket_of(uint64_t fingerprint, int band) const {
+    int first = band * 64 / bands;
+    int last = (band + 1) * 64 / bands;
+    uint64_t value = fingerprint >> first;
+    if (last - first < 64) {
+        value &= (1ULL << (last - first)) - 1;
+    }
+    uint64_t h = Hash64::mix(value + static_cast<uint64_t>(band + 1) * 0x9e3779b97f4a7c15ULL);
+    return static_cast<size_t>(band) * buckets + (h & (buckets - 1));
+}
+
+bool SimHashIndex::check_and_insert(uint64_t fingerprint) {
+    size_t seen[8];       // Bucket of each band
+    for (int band = 0; band < bands; band++) {
+        size_t bucket = bucket_of(fingerprint, band);
+        seen[band] = bucket;
+        std::lock_guard<std::mutex> lock(stripes[bucket % LOCK_STRIPES]);
+        const uint64_t* slot = slots.get() + bucket * BUCKET_SLOTS;
+        for (size_t s = 0; s < BUCKET_SLOTS; s++) {
+            if (slot[s] != 0 && __builtin_popcountll(slot[s] ^ fingerprint) <= max_distance) {
+                return true;
+            }
+        }
+    }
+    // New content: make it findable from every band
+    for (int band = 0; band < bands; band++) {
+        size_t bucket = seen[band];
+        std::lock_guard<std::mutex> lock(stripes[bucket % LOCK_STRIPES]);
+        slots[bucket * BUCKET_SLOTS + cursors[bucket]] = fingerprint;
+        cursors[bucket] = static_cast<uint8_t>((cursors[bucket] + 1) % BUCKET_SLOTS);
+    }
+    return false;
+}
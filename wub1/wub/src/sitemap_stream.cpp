@@ -0,0 +1,214 @@
+#include "sitemap_stream.h"
+#include <algorithm>
+#include <cctype>
+#include <utility>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const std::string_view LOC_OPEN = "<loc>";
+const std::string_view LOC_CLOSE = "</loc>";
+const std::string_view INDEX_ROOT = "<sitemapindex";
+
+// Bytes kept after the last complete <loc>, enough for a split tag
+const size_t TAG_TAIL = INDEX_ROOT.size() - 1;
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+}  // namespace
+
+#ifdef HAVE_ZLIB
+struct SitemapStream::Inflater {
+    z_stream stream{};
+    bool ready = false;
+    bool ended = false;             // Past the end of the gzip member
+    size_t produced = 0;
+    char out[64 * 1024];
+
+    Inflater() { ready = inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK; }
+    ~Inflater() {
+        if (ready) inflateEnd(&stream);
+    }
+};
+#else
+struct SitemapStream::Inflater {};
+#endif
+
+SitemapStream::SitemapStream(Flush flush_callback) : flush(std::move(flush_callback)) {}
+
+SitemapStream::~SitemapStream() = default;
+
+bool SitemapStream::can_inflate() {
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SitemapStream::consume(std::string_view chunk) {
+    if (!started) {
+        started = true;
+        if (chunk.size() >= 2 && static_cast<unsigned char>(chunk[0]) == 0x1f &&
+            static_cast<unsigned char>(chunk[1]) == 0x8b) {
+            gzipped = true;
+            if (!can_inflate()) {
+                inflate_failed = true;
+                return false;
+            }
+            inflater = std::make_unique<Inflater>();
+        }
+    }
+    return inflater ? inflate_piece(chunk) : scan(chunk);
+}
+
+bool SitemapStream::inflate_piece(std::string_view chunk) {
+#ifdef HAVE_ZLIB
+    Inflater& z = *inflater;
+    if (z.ended) {
+        return true;                    // Trailing bytes after the member
+    }
+    if (!z.ready) {
+        inflate_failed = true;
+        return false;
+    }
+    z.stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(chunk.data()));
+    z.stream.avail_in = static_cast<uInt>(chunk.size());
+    do {
+        z.stream.next_out = reinterpret_cast<Bytef*>(z.out);
+        z.stream.avail_out = sizeof(z.out);
+        int rc = inflate(&z.stream, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+            inflate_failed = true;      // Corrupt or truncated data
+            return false;
+        }
+        size_t produced = sizeof(z.out) - z.stream.avail_out;
+        z.produced += produced;
+        if (z.produced > MAX_INFLATED_BYTES) {
+            inflate_failed = true;
+            return false;
+        }
+        if (produced > 0 && !scan(std::string_view(z.out, produced))) {
+            return false;
+        }
+        if (rc == Z_STREAM_END) {
+            z.ended = true;
+            return true;
+        }
+    } while (z.stream.avail_out == 0);
+    return true;
+#else
+    (void)chunk;
+    inflate_failed = true;
+    return false;
+#endif
+}
+
+bool SitemapStream::scan(std::string_view chunk) {
+    // Scan the piece in place unless a tag was split across pieces
+    bool joined = !carry.empty();
+    if (joined) {
+        carry.append(chunk.data(), chunk.size());
+    }
+    std::string_view text = joined ? std::string_view(carry) : chunk;
+
+    // The root element comes before the first <loc>
+    if (!index && urls == 0 && batch.empty() && text.find(INDEX_ROOT) != std::string_view::npos) {
+        index = true;
+    }
+
+    size_t pos = 0;
+    size_t keep;
+    while (true) {
+        size_t open = text.find(LOC_OPEN, pos);
+        if (open == std::string_view::npos) {
+            keep = std::max(pos, text.size() > TAG_TAIL ? text.size() - TAG_TAIL : 0);
+            break;
+        }
+        size_t value = open + LOC_OPEN.size();
+        size_t close = text.find(LOC_CLOSE, value);
+        if (close == std::string_view::npos) {
+            // Unfinished: carry it, unless it is already too long to be a URL
+            keep = text.size() - value > MAX_LOC_BYTES ? text.size() - TAG_TAIL : open;
+            break;
+        }
+        if (!add_loc(text.substr(value, close - value))) {
+            carry.clear();
+            return false;
+        }
+        pos = close + LOC_CLOSE.size();
+    }
+
+    if (joined) {
+        carry.erase(0, keep);
+    } else {
+        carry.assign(text.data() + keep, text.size() - keep);
+    }
+    return true;
+}
+
+void SitemapStream::finish() {
+    carry.clear();
+    flush_batch();
+}
+
+bool SitemapStream::add_loc(std::string_view value) {
+    value = trim(value);
+    if (value.size() >= 12 && value.substr(0, 9) == "<![CDATA[" &&
+        value.substr(value.size() - 3) == "]]>") {
+        value = trim(value.substr(9, value.size() - 12));
+    }
+    if (value.empty() || value.size() > MAX_LOC_BYTES) {
+        return true;
+    }
+
+    // The five predefined XML entities; URLs need no others
+    std::string url;
+    url.reserve(value.size());
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '&') {
+            std::string_view rest = value.substr(i);
+            static const std::pair<std::string_view, char> entities[] = {
+                {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''},
+            };
+            bool decoded = false;
+            for (const auto& entity : entities) {
+                if (rest.substr(0, entity.first.size()) == entity.first) {
+                    url.push_back(entity.second);
+                    i += entity.first.size() - 1;
+                    decoded = true;
+                    break;
+                }
+            }
+            if (decoded) {
+                continue;
+            }
+        }
+        url.push_back(value[i]);
+    }
+
+    batch.push_back(std::move(url));
+    urls++;
+    if (batch.size() >= BATCH_URLS) {
+        flush_batch();
+    }
+    return urls < MAX_URLS;
+}
+
+void SitemapStream::flush_batch() {
+    if (batch.empty()) {
+        return;
+    }
+    flush(batch, index);
+    batch.clear();
+}
@@ -1,9 +1,69 @@
 #include "storage_manager.h"
-#include "utils.h"
-#include <fstream>
+#include "hash64.h"
+#include "graph_file.h"
+#include "output_file.h"
 #include <iostream>
 #include <cmath>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+// Below this many buffered domains per thread, starting a thread costs
+// more than the merge work it takes over
+const size_t MIN_DOMAINS_PER_THREAD = 4096;
+
+bool target_less(const WeightedEdge& a, const WeightedEdge& b) {
+    return a.target < b.target;
+}
+
+// Sort edges by target and add up the weights of repeated targets
+void combine_edges(std::vector<WeightedEdge>& edges) {
+    std::sort(edges.begin(), edges.end(), target_less);
+    size_t out = 0;
+    for (size_t i = 0; i < edges.size(); i++) {
+        if (out > 0 && edges[out - 1].target == edges[i].target) {
+            edges[out - 1].weight += edges[i].weight;
+        } else {
+            edges[out++] = edges[i];
+        }
+    }
+    edges.resize(out);
+}
+
+// Append one page's edges to a domain's. The uncombined tail is folded
+// in once it is as long as the combined part, so each edge is
+// re-sorted O(log pages) times rather than once per page
+void append_edges(DomainLinks& links, const std::vector<WeightedEdge>& page_edges) {
+    if (links.edges.empty()) {
+        links.edges = page_edges;
+        links.combined = links.edges.size();
+        return;
+    }
+    links.edges.insert(links.edges.end(), page_edges.begin(), page_edges.end());
+    if (links.edges.size() - links.combined >= links.combined) {
+        combine_edges(links.edges);
+        links.combined = links.edges.size();
+    }
+}
+
+// Run fn(t) for t in [0, threads), the last one on the calling thread
+template <typename Fn>
+void run_parallel(size_t threads, Fn fn) {
+    std::vector<std::thread> helpers;
+    helpers.reserve(threads - 1);
+    for (size_t t = 0; t + 1 < threads; t++) {
+        helpers.emplace_back(fn, t);
+    }
+    fn(threads - 1);
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+}
+
+}  // namespace
 
 void StorageManager::init(int num_threads) {
     thread_buffers.resize(num_threads);
@@ -13,200 +73,319 @@ ThreadLocalBuffer& StorageManager::get_thread_buffer(int thread_id) {
     return thread_buffers[thread_id];
 }
 
-void StorageManager::add_page(int thread_id, const std::string& domain,
-                              const std::vector<std::string>& outgoing_links) {
+uint32_t StorageManager::add_page(int thread_id, std::string_view domain,
+                                  std::vector<ParsedUrl>& outgoing_links, PageLinks& out,
+                                  std::pmr::memory_resource* scratch) {
     auto& buffer = thread_buffers[thread_id];
-    
-    // Extract domains from outgoing links
-    std::vector<std::string> outgoing_domains;
-    for (const auto& link : outgoing_links) {
-        // Extract domain from URL
-        std::string domain_from_link = link;
-        size_t proto_end = domain_from_link.find("://");
-        if (proto_end != std::string::npos) {
-            domain_from_link = domain_from_link.substr(proto_end + 3);
-        }
-        
-        // Remove path
-        size_t path_start = domain_from_link.find('/');
-        if (path_start != std::string::npos) {
-            domain_from_link = domain_from_link.substr(0, path_start);
-        }
-        
-        // Remove www. prefix
-        if (Utils::starts_with(domain_from_link, "www.")) {
-            domain_from_link = domain_from_link.substr(4);
+    uint32_t source = domain_table.intern(domain);
+
+    out.urls.clear();
+    out.fingerprints.clear();
+    out.domain_ids.clear();
+
+    // Fingerprints of the URLs seen on this page: open addressing, at
+    // most half full, 0 marks a free slot
+    size_t slots = 16;
+    while (slots < outgoing_links.size() * 2) {
+        slots <<= 1;
+    }
+    std::pmr::vector<uint64_t> seen(slots, 0, scratch);
+    std::pmr::vector<uint32_t> link_domains(scratch);
+    link_domains.reserve(outgoing_links.size());
+
+    // Links on a page tend to repeat the same domain back to back, so
+    // remember the last one (copied: the link it came from is moved out)
+    std::pmr::string last_domain(scratch);
+    uint32_t last_id = DomainTable::INVALID_ID;
+    for (auto& link : outgoing_links) {
+        std::string_view link_domain = link.domain();
+        if (link_domain.empty()) {
+            continue;
         }
-        
-        domain_from_link = Utils::to_lowercase(domain_from_link);
-        
-        if (!domain_from_link.empty()) {
-            outgoing_domains.push_back(domain_from_link);
+        if (last_id == DomainTable::INVALID_ID || link_domain != last_domain) {
+            last_id = domain_table.intern(link_domain);
+            last_domain.assign(link_domain);
         }
-    }
-    
-    // Store in thread-local buffer
-    buffer.local_graph[domain] = outgoing_domains;
-    buffer.local_visit_count[domain]++;
-    buffer.local_domains.insert(domain);
-}
+        // Every link adds to its edge's weight, repeated URLs included
+        link_domains.push_back(last_id);
 
-void StorageManager::merge_all_buffers() {
-    std::cout << "\n[INFO] Merging thread-local buffers..." << std::endl;
-    
-    for (const auto& buffer : thread_buffers) {
-        // Merge graph
-        for (const auto& [domain, links] : buffer.local_graph) {
-            link_graph[domain] = links;
+        uint64_t fingerprint = Hash64::hash(link.str());
+        uint64_t key = fingerprint ? fingerprint : 1;
+        size_t slot = static_cast<size_t>(key) & (slots - 1);
+        while (seen[slot] != 0 && seen[slot] != key) {
+            slot = (slot + 1) & (slots - 1);
         }
-        
-        // Merge visit counts
-        for (const auto& [domain, count] : buffer.local_visit_count) {
-            visit_count[domain] += count;
+        if (seen[slot] == key) {
+            continue;                   // Same URL earlier on the page
         }
+        seen[slot] = key;
+        out.fingerprints.push_back(fingerprint);
+        out.domain_ids.push_back(last_id);
+        out.urls.push_back(link.release());
     }
-    
-    std::cout << "[INFO] Merged " << link_graph.size() << " unique domains" << std::endl;
-}
 
-void StorageManager::compute_pagerank(int iterations /*= 30*/) {
-    std::cout << "\n[INFO] Computing PageRank (" << iterations << " iterations)..." << std::endl;
-    
-    // 1) Build the full node set (keys + all destinations)
-    std::unordered_set<std::string> nodes;
-    nodes.reserve(link_graph.size() * 2);
-    for (const auto& kv : link_graph) {
-        nodes.insert(kv.first);
-        for (const auto& dst : kv.second) {
-            nodes.insert(dst);
+    // One edge per distinct target domain, weighted by its link count,
+    // added to what this thread saw of the domain so far
+    std::sort(link_domains.begin(), link_domains.end());
+    std::vector<WeightedEdge>& edges = out.edges;
+    edges.clear();
+    for (uint32_t id : link_domains) {
+        if (!edges.empty() && edges.back().target == id) {
+            edges.back().weight++;
+        } else {
+            edges.push_back(WeightedEdge{id, 1});
         }
     }
+    DomainLinks& links = buffer.local_graph[source];
+    append_edges(links, edges);
+    links.visits++;
 
-    size_t N = nodes.size();
-    if (N == 0) {
-        std::cout << "[WARNING] No nodes to rank" << std::endl;
-        return;
+    if (live_ranks.running()) {
+        live_ranks.add_out_edges(source, edges);
     }
+    return source;
+}
 
-    std::cout << "[INFO] Total nodes (including destination-only): " << N << std::endl;
+uint32_t StorageManager::restore_domain(std::string_view domain) {
+    return domain_table.intern(domain);
+}
 
-    // 2) Initialize pagerank for every node
-    pagerank.clear();
-    pagerank.reserve(N);
-    for (const auto& n : nodes) {
-        pagerank[n] = 1.0 / static_cast<double>(N);
+void StorageManager::restore_page(uint32_t source, std::vector<WeightedEdge>& edges) {
+    if (live_ranks.running()) {
+        live_ranks.add_out_edges(source, edges);
     }
 
-    const double damping = 0.85;
-    const double teleport = (1.0 - damping) / static_cast<double>(N);
+    DomainLinks& links = thread_buffers[0].local_graph[source];
+    append_edges(links, edges);
+    links.visits++;
+}
 
-    for (int iter = 0; iter < iterations; ++iter) {
-        std::unordered_map<std::string, double> new_pr;
-        new_pr.reserve(N * 2);
+void StorageManager::merge_remote_domain(uint32_t source, std::vector<WeightedEdge>& edges,
+                                         int visits) {
+    // The crawl is over: live ranks only seed the final PageRank, which
+    // converges to the same result without these edges
+    combine_edges(edges);
+    DomainLinks& links = thread_buffers[0].local_graph[source];
+    append_edges(links, edges);
+    links.visits += visits;
+}
 
-        // Initialize with teleport term
-        for (const auto& n : nodes) {
-            new_pr[n] = teleport;
-        }
+void StorageManager::start_live_pagerank() {
+    live_ranks.start();
+}
 
-        // Compute dangling mass (sources with zero outgoing links)
-        double dangling_mass = 0.0;
-        for (const auto& n : nodes) {
-            auto it = link_graph.find(n);
-            if (it == link_graph.end() || it->second.empty()) {
-                dangling_mass += pagerank[n];
+void StorageManager::merge_all_buffers(int num_threads /*= 1*/) {
+    std::cout << "\n[INFO] Merging thread-local buffers..." << std::endl;
+    
+    const size_t N = domain_table.size();
+    const size_t B = thread_buffers.size();
+    size_t buffered = 0;
+    for (const auto& buffer : thread_buffers) {
+        buffered += buffer.local_graph.size();
+    }
+    const size_t P = std::max<size_t>(1, std::min<size_t>(
+        static_cast<size_t>(std::max(num_threads, 1)), buffered / MIN_DOMAINS_PER_THREAD));
+
+    visit_count.assign(N, 0);
+    std::vector<std::vector<WeightedEdge>> out_lists(N);
+
+    // 1. Split every buffer by owning partition (domain ID mod P);
+    //    threads take buffers in turn
+    struct Entry {
+        uint32_t domain;
+        DomainLinks* links;
+    };
+    std::vector<std::vector<Entry>> slices(B * P);      // [buffer * P + partition]
+    std::atomic<size_t> next_buffer{0};
+    run_parallel(P, [&](size_t) {
+        for (size_t b; (b = next_buffer.fetch_add(1)) < B;) {
+            for (auto& [domain, links] : thread_buffers[b].local_graph) {
+                slices[b * P + domain % P].push_back(Entry{domain, &links});
             }
         }
+    });
 
-        // Distribute contributions by iterating sources and their outgoing edges (O(E))
-        for (const auto& n : nodes) {
-            auto it = link_graph.find(n);
-            if (it == link_graph.end() || it->second.empty()) {
-                continue;
+    // 2. Each partition owner unions its domains' lists from every
+    //    buffer: the first is moved in, later ones appended, and a list
+    //    that is not strictly ascending is sorted with the weights of
+    //    repeated targets added up. Then the degrees are known
+    std::vector<std::vector<uint32_t>> owned(P);        // Crawled domains per partition
+    run_parallel(P, [&](size_t p) {
+        for (size_t b = 0; b < B; b++) {
+            for (const Entry& entry : slices[b * P + p]) {
+                std::vector<WeightedEdge>& list = out_lists[entry.domain];
+                if (visit_count[entry.domain] == 0) {
+                    // First buffer to have it (a buffered domain has visits)
+                    owned[p].push_back(entry.domain);
+                    list = std::move(entry.links->edges);
+                } else {
+                    list.insert(list.end(), entry.links->edges.begin(), entry.links->edges.end());
+                }
+                visit_count[entry.domain] += entry.links->visits;
             }
-
-            const auto& outgoing = it->second;
-            double outdeg = static_cast<double>(outgoing.size());
-            double contribution = damping * (pagerank[n] / outdeg);
-
-            for (const auto& dst : outgoing) {
-                // dst must exist in `nodes` (we built nodes from all outgoing)
-                new_pr[dst] += contribution;
+        }
+        for (uint32_t v : owned[p]) {
+            std::vector<WeightedEdge>& list = out_lists[v];
+            auto unordered = std::adjacent_find(list.begin(), list.end(),
+                [](const WeightedEdge& a, const WeightedEdge& b) { return a.target >= b.target; });
+            if (unordered != list.end()) {
+                combine_edges(list);
             }
         }
+    });
 
-        // Distribute dangling mass uniformly
-        double dangling_share = damping * (dangling_mass / static_cast<double>(N));
-        for (auto& kv : new_pr) {
-            kv.second += dangling_share;
-        }
+    // 3. Prefix-sum the degrees into CSR offsets
+    link_graph.offsets.assign(N + 1, 0);
+    for (size_t v = 0; v < N; v++) {
+        link_graph.offsets[v + 1] = link_graph.offsets[v] + out_lists[v].size();
+    }
+    link_graph.targets.resize(link_graph.offsets[N]);
+    link_graph.weights.resize(link_graph.offsets[N]);
 
-        // Normalize to force numerical conservation = 1.0
-        double sum = 0.0;
-        for (const auto& kv : new_pr) {
-            sum += kv.second;
-        }
-        if (sum > 0.0) {
-            double inv_sum = 1.0 / sum;
-            for (auto& kv : new_pr) {
-                kv.second *= inv_sum;
+    // 4. Owners split their lists into the target and weight columns and
+    //    free them; then every thread frees buffers in turn
+    std::vector<uint64_t> links_per_partition(P, 0);
+    next_buffer.store(0);
+    run_parallel(P, [&](size_t p) {
+        uint64_t links = 0;
+        for (uint32_t v : owned[p]) {
+            uint64_t e = link_graph.offsets[v];
+            for (const WeightedEdge& edge : out_lists[v]) {
+                link_graph.targets[e] = edge.target;
+                link_graph.weights[e] = edge.weight;
+                links += edge.weight;
+                e++;
             }
+            std::vector<WeightedEdge>().swap(out_lists[v]);
+        }
+        links_per_partition[p] = links;
+        for (size_t b; (b = next_buffer.fetch_add(1)) < B;) {
+            thread_buffers[b] = ThreadLocalBuffer();
         }
+    });
 
-        // Commit
-        pagerank.swap(new_pr);
+    size_t crawled = 0;
+    for (const auto& domains : owned) {
+        crawled += domains.size();
     }
+    uint64_t total_links = std::accumulate(links_per_partition.begin(), links_per_partition.end(),
+                                           uint64_t{0});
+    
+    size_t graph_bytes = domain_table.memory_bytes() +
+                         link_graph.offsets.size() * sizeof(uint64_t) +
+                         link_graph.targets.size() * sizeof(uint32_t) +
+                         link_graph.weights.size() * sizeof(uint32_t);
+    std::cout << "[INFO] Merged " << crawled << " unique domains ("
+              << N << " nodes, " << link_graph.num_edges() << " edges from "
+              << total_links << " links, ~"
+              << std::fixed << std::setprecision(1) << graph_bytes / 1024.0
+              << " KB, " << P << " thread(s))" << std::endl;
+}
 
-    std::cout << "[INFO] PageRank computation complete" << std::endl;
-    std::cout << "[INFO] Sum of all PageRank scores: " << std::fixed << std::setprecision(6);
-    double total = 0.0;
-    for (const auto& kv : pagerank) {
-        total += kv.second;
+void StorageManager::compute_pagerank(int iterations /*= 30*/, double tolerance /*= 1e-6*/,
+                                      int num_threads /*= 1*/) {
+    std::cout << "\n[INFO] Computing PageRank (up to " << iterations << " iterations, tolerance "
+              << std::scientific << std::setprecision(1) << tolerance << ")..." << std::endl;
+    
+    // Every interned domain is a node (sources and destination-only)
+    const size_t N = link_graph.num_nodes();
+    if (N == 0) {
+        std::cout << "[WARNING] No nodes to rank" << std::endl;
+        return;
+    }
+
+    std::cout << "[INFO] Total nodes (including destination-only): " << N << std::endl;
+
+    PageRankOptions options;
+    options.max_iterations = iterations;
+    options.tolerance = tolerance;
+    options.num_threads = num_threads;
+
+    // Start from where the live estimates got to during the crawl
+    if (live_ranks.running()) {
+        live_ranks.stop();
+        auto snap = live_ranks.snapshot();
+        std::cout << "[INFO] Warm start from live PageRank (" << snap->batches << " updates, "
+                  << snap->pushes << " pushes)" << std::endl;
+        pagerank = live_ranks.estimates(N);
+        options.warm_start = true;
     }
+    PageRankStats stats = PageRank::compute(link_graph, options, pagerank);
+
+    std::cout << "[INFO] PageRank computation complete: " << stats.iterations << " iterations ("
+              << (stats.converged ? "converged" : "iteration cap") << "), residual "
+              << std::scientific << std::setprecision(3) << stats.residual
+              << ", " << stats.threads << " thread(s)" << std::endl;
+    std::cout << "[INFO] Sum of all PageRank scores: " << std::fixed << std::setprecision(6);
+    double total = std::accumulate(pagerank.begin(), pagerank.end(), 0.0);
     std::cout << total << std::endl;
 }
 
 void StorageManager::export_to_csv(const std::string& crawled_file,
                                    const std::string& ranking_file) {
-    // Export crawled pages
-    std::ofstream crawled_csv(crawled_file);
-    crawled_csv << "domain,outgoing_links,visit_count\n";
+    // Fields are formatted with to_chars straight into the file buffer
+    OutputFile crawled_csv(crawled_file);
+    crawled_csv.append("domain,outgoing_links,visit_count\n");
     
-    for (const auto& [domain, links] : link_graph) {
-        int count = visit_count[domain];
-        crawled_csv << domain << "," << links.size() << "," << count << "\n";
+    const size_t N = link_graph.num_nodes();
+    for (size_t v = 0; v < N; v++) {
+        if (visit_count[v] == 0) {
+            continue;                   // Destination-only
+        }
+        uint32_t id = static_cast<uint32_t>(v);
+        crawled_csv.append(domain_table.name(id));
+        crawled_csv.append(',');
+        crawled_csv.append(link_graph.out_weight(id));
+        crawled_csv.append(',');
+        crawled_csv.append(static_cast<uint64_t>(visit_count[v]));
+        crawled_csv.append('\n');
     }
     
-    crawled_csv.close();
+    crawled_csv.commit();
     std::cout << "[INFO] Exported crawled pages to: " << crawled_file << std::endl;
     
     // Export PageRank results (includes destination-only nodes now)
-    std::ofstream ranking_csv(ranking_file);
-    ranking_csv << "domain,pagerank_score\n";
-    ranking_csv << std::fixed << std::setprecision(6);
+    OutputFile ranking_csv(ranking_file);
+    ranking_csv.append("domain,pagerank_score\n");
     
-    for (const auto& [domain, score] : pagerank) {
-        ranking_csv << domain << "," << score << "\n";
+    for (size_t v = 0; v < pagerank.size(); v++) {
+        ranking_csv.append(domain_table.name(static_cast<uint32_t>(v)));
+        ranking_csv.append(',');
+        ranking_csv.append_fixed(pagerank[v], 6);
+        ranking_csv.append('\n');
     }
     
-    ranking_csv.close();
+    ranking_csv.commit();
     std::cout << "[INFO] Exported PageRank results to: " << ranking_file << std::endl;
 }
 
+void StorageManager::export_binary(const std::string& graph_file) const {
+    GraphColumns columns;
+    columns.domains = &domain_table;
+    columns.graph = &link_graph;
+    columns.visit_counts = &visit_count;
+    columns.ranks = &pagerank;
+    GraphFile::write(graph_file, columns);
+    std::cout << "[INFO] Exported graph (" << link_graph.num_nodes() << " nodes, "
+              << link_graph.num_edges() << " edges) to: " << graph_file << std::endl;
+}
+
 std::vector<std::string> StorageManager::get_all_domains() const {
     std::vector<std::string> domains;
-    for (const auto& [domain, _] : link_graph) {
-        domains.push_back(domain);
+    for (size_t v = 0; v < visit_count.size(); v++) {
+        if (visit_count[v] > 0) {
+            domains.push_back(domain_table.name(static_cast<uint32_t>(v)));
+        }
     }
     return domains;
 }
 
 double StorageManager::get_pagerank(const std::string& domain) const {
-    auto it = pagerank.find(domain);
-    return (it != pagerank.end()) ? it->second : 0.0;
+    uint32_t id = domain_table.find(domain);
+    return (id < pagerank.size()) ? pagerank[id] : 0.0;
 }
 
 int StorageManager::get_visit_count(const std::string& domain) const {
-    auto it = visit_count.find(domain);
-    return (it != visit_count.end()) ? it->second : 0;
+    uint32_t id = domain_table.find(domain);
+    return (id < visit_count.size()) ? visit_count[id] : 0;
 }
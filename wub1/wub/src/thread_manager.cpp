@@ -1,117 +1,849 @@
 #include "thread_manager.h"
+#include "hash64.h"
+#include "alloc_stats.h"
+#include "logger.h"
+#include "metrics.h"
+#include "sitemap_stream.h"
 #include <iostream>
+#include <iomanip>
+#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
 #include <chrono>
 #include <thread>
+#include <cstddef>
+#include <memory_resource>
+
+namespace {
+
+// Initial per-worker arena for per-page temporaries; bigger pages spill
+// to the heap until the arena is reset
+const size_t PAGE_ARENA_BYTES = 64 * 1024;
+
+// Same cap extract_parsed_links applies to a buffered document
+const size_t MAX_BODY_BYTES = 100000000;
+
+// Busiest hosts exported per scrape; keeps the label set bounded
+const size_t EXPORTED_HOSTS = 20;
+
+// Pages with fewer words are never near-duplicates: an empty template or
+// a few navigation words match across unrelated pages
+const size_t MIN_SIMHASH_FEATURES = 32;
+
+// Product token we look for in robots.txt (our User-Agent is ".../WebCrawler/1.0")
+const char* const ROBOTS_AGENT = "WebCrawler";
+
+}  // namespace
+
+void ThreadManager::start(const CrawlConfig& config, StorageManager& storage_manager,
+                          CrawlJournal* crawl_journal, FetchCache* cache,
+                          ClusterNode* cluster_node) {
+    max_pages_limit.store(config.max_pages);
+    priority_mode = config.priority;
+    journal = crawl_journal;
+    fetch_cache = cache;
+    cluster = cluster_node;
+    max_page_links = config.max_page_links;
+    if (config.near_duplicate_bits > 0) {
+        near_duplicates = std::make_unique<SimHashIndex>(config.near_duplicate_bits);
+    } else {
+        near_duplicates.reset();
+    }
+    metrics_interval = config.metrics_interval;
+    metrics_file = config.metrics_file;
+    store_threads = config.store_threads;
+    robots_enabled = config.robots;
+    follow_sitemaps = config.robots && config.sitemaps;
+    parse_queue.init(config.parse_queue);
+    store_queue.init(config.store_queue);
+    parse_credits.store(static_cast<int>(parse_queue.capacity()));
+    alloc_at_start = AllocStats::snapshot();
+    started_at = std::chrono::steady_clock::now();
 
-void ThreadManager::start(int num_threads, int max_pages,
-                          const std::string& seed_url,
-                          StorageManager& storage_manager) {
-    max_pages_limit.store(max_pages);
-    
     std::cout << "\n╔════════════════════════════════════════════════════════╗" << std::endl;
     std::cout << "║      MULTITHREADED WEB CRAWLER (Lock-Free)            ║" << std::endl;
     std::cout << "╚════════════════════════════════════════════════════════╝" << std::endl;
     std::cout << "\n[CONFIG]" << std::endl;
-    std::cout << "  Seed URL:     " << seed_url << std::endl;
-    std::cout << "  Max Pages:    " << max_pages << std::endl;
-    std::cout << "  Threads:      " << num_threads << std::endl;
-    std::cout << "  Mode:         Lock-Free (No Mutexes)" << std::endl;
+    std::cout << "  Seed URL:     " << config.seed_url << std::endl;
+    std::cout << "  Max Pages:    " << config.max_pages << std::endl;
+    std::cout << "  Threads:      " << config.num_threads << std::endl;
+    std::cout << "  I/O Threads:  " << config.io_threads << std::endl;
+    std::cout << "  Max In-Flight:" << config.max_inflight << std::endl;
+    std::cout << "  Pipeline:     parse queue " << parse_queue.capacity() << ", ";
+    if (store_threads > 0) {
+        std::cout << store_threads << " store thread(s) (queue " << store_queue.capacity() << ")";
+    } else {
+        std::cout << "parsers store their own pages";
+    }
+    std::cout << std::endl;
+    std::cout << "  Mode:         Sharded frontier (" << config.frontier_shards
+              << " lock-striped shards, " << VisitedSet::backend_name(config.visited.backend)
+              << " visited set)" << std::endl;
+    std::cout << "  Politeness:   " << config.politeness.max_connections << " connections/host, "
+              << config.politeness.crawl_delay_ms << " ms delay, "
+              << (config.priority == FrontierPriority::PageRank ? "pagerank"
+                  : config.priority == FrontierPriority::Depth ? "depth" : "fifo")
+              << " priority" << std::endl;
+    std::cout << "  Robots:       ";
+    if (robots_enabled) {
+        std::cout << "obeyed as " << ROBOTS_AGENT << ", Crawl-delay <= "
+                  << config.politeness.max_crawl_delay_ms << " ms";
+        if (follow_sitemaps) {
+            std::cout << ", listed sitemaps read";
+        }
+    } else {
+        std::cout << "ignored";
+    }
+    if (!config.sitemap_url.empty()) {
+        std::cout << ", sitemap " << config.sitemap_url;
+    }
+    std::cout << std::endl;
+    std::cout << "  Parsing:      " << (config.stream_parse ? "streamed" : "buffered");
+    if (config.max_page_bytes > 0) {
+        std::cout << ", " << config.max_page_bytes / 1024 << " KiB/page";
+    }
+    if (config.max_page_links > 0) {
+        std::cout << ", " << config.max_page_links << " links/page";
+    }
+    if (config.compression) {
+        std::cout << ", compressed";
+        if (config.max_decoded_bytes > 0) {
+            std::cout << " (decoded <= " << config.max_decoded_bytes / 1024 << " KiB)";
+        }
+    }
+    if (near_duplicates) {
+        std::cout << ", near-duplicates within " << config.near_duplicate_bits << " bits";
+    }
+    std::cout << std::endl;
+    std::cout << "  Logging:      " << Log::level_name(config.log.level);
+    if (config.log.sample > 1) {
+        std::cout << ", 1 in " << config.log.sample << " pages";
+    }
+    std::cout << " to " << (config.log.path.empty() ? "stdout" : config.log.path) << std::endl;
+    if (journal) {
+        std::cout << "  Checkpoint:   " << config.checkpoint_dir << " every "
+                  << config.checkpoint_interval << " s" << std::endl;
+    }
+    if (cluster) {
+        std::cout << "  Cluster:      node " << cluster->self() << " of " << cluster->size()
+                  << (cluster->coordinator() ? " (coordinator)" : "") << std::endl;
+    }
+    if (fetch_cache) {
+        std::cout << "  Fetch Cache:  " << config.fetch_cache << " ("
+                  << fetch_cache->stats().loaded << " pages)" << std::endl;
+    }
+    dns_prefetch = false;
+    if (config.dns_prefetch) {
+        try {
+            dns_cache.start();
+            dns_prefetch = true;
+            std::cout << "  DNS:          " << DnsCache::backend_name() << " prefetch" << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[WARNING] " << e.what() << "; curl resolves every host" << std::endl;
+        }
+    }
     std::cout << "\n[STARTING CRAWL]" << std::endl;
-    
-    frontier.init(seed_url);
-    
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
-    // Create worker threads
-    for (int i = 0; i < num_threads; i++) {
-        workers.emplace_back(&ThreadManager::worker_loop, this, i, 
+
+    // A resumed crawl takes its frontier from the journal, not the seed
+    bool resuming = journal && journal->resumed();
+    std::string seed_url = resuming ? std::string() : config.seed_url;
+    if (cluster && cluster->owner(HostScheduler::host_key(seed_url)) != cluster->self()) {
+        seed_url.clear();           // Its owner starts the crawl; links reach us from there
+    }
+    frontier.set_journal(journal);
+    frontier.set_error_callback([this](const std::string& error) { fail(error); });
+    if (dns_prefetch || robots_enabled) {
+        // First sight of a host: resolve it and fetch its robots.txt while
+        // its URLs wait in the queue
+        frontier.set_new_host_callback([this](std::string_view host, std::string_view url) {
+            if (dns_prefetch) {
+                dns_cache.prefetch(host);
+            }
+            if (robots_enabled) {
+                frontier.add_task();
+                robots.request_robots(url);
+                fetch_engine.notify();
+            }
+        });
+    }
+    frontier.init(seed_url,
+                  static_cast<size_t>(config.frontier_shards),
+                  static_cast<size_t>(config.io_threads), config.visited, config.politeness,
+                  config.frontier_spill);
+    if (resuming) {
+        int restored = restore_from_journal(storage_manager);
+        pages_crawled.store(restored);
+        pages_reserved.store(restored);
+        if (restored >= config.max_pages || frontier.outstanding_count() == 0) {
+            std::cout << "[INFO] Checkpoint already covers this crawl" << std::endl;
+            crawl_done.store(true);
+        }
+    }
+    if (journal) {
+        journal->start(config.checkpoint_interval, storage_manager.domains());
+    }
+    if (!config.sitemap_url.empty() && !crawl_done.load()) {
+        // Like the seed, read by the node owning its host
+        ParsedUrl sitemap;
+        if (!ParsedUrl::parse(config.sitemap_url, sitemap)) {
+            std::cerr << "[WARNING] Ignoring sitemap, not an http(s) URL: " << config.sitemap_url << std::endl;
+        } else if (!cluster || cluster->owner(HostScheduler::host_key(sitemap.str())) == cluster->self()) {
+            request_sitemap(sitemap.release(), 0);
+        }
+    }
+
+    // Create the store stage first: parsers hand it pages from the start
+    for (int i = 0; i < store_threads; i++) {
+        store_workers.emplace_back(&ThreadManager::store_loop, this, i,
+                                   std::ref(storage_manager));
+    }
+
+    // Create parser worker threads
+    for (int i = 0; i < config.num_threads; i++) {
+        workers.emplace_back(&ThreadManager::worker_loop, this, i,
                            std::ref(storage_manager));
     }
-    
-    // Print progress every second
-    std::thread progress_thread([this, num_threads]() {
-        while (pages_crawled.load() < max_pages_limit.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-            
-            std::cout << "[PROGRESS] Pages: " << pages_crawled.load() 
+
+    // Streamed pages reach the workers as extracted links; the carry
+    // between body pieces is all a transfer holds
+    fetch_engine.set_max_body_bytes(config.max_page_bytes);
+    fetch_engine.set_compression(config.compression, config.max_decoded_bytes);
+    fetch_engine.set_conditional(fetch_cache != nullptr);
+    fetch_engine.set_dns_cache(dns_prefetch ? &dns_cache : nullptr);
+    // Extractors are pooled per I/O loop and come back from the workers
+    extractor_pools.clear();
+    loop_pages.assign(static_cast<size_t>(config.io_threads), ParsedUrl());
+    for (int i = 0; i < config.io_threads; i++) {
+        extractor_pools.push_back(std::make_unique<ObjectPool<std::unique_ptr<LinkExtractor>>>(
+            static_cast<size_t>(config.max_inflight)));
+    }
+    // Sitemaps are always streamed; robots.txt is always buffered
+    bool stream_parse = config.stream_parse;
+    fetch_engine.set_stream_factory([this, stream_parse](int loop_id, const FetchRequest& request) {
+        std::unique_ptr<BodyConsumer> consumer;
+        if (request.kind == FetchKind::Sitemap) {
+            uint32_t nesting = request.depth;
+            consumer = std::make_unique<SitemapStream>(
+                [this, nesting](std::vector<std::string>& urls, bool index) {
+                    enqueue_sitemap_urls(urls, index, nesting);
+                });
+            return consumer;
+        }
+        ParsedUrl& page = loop_pages[loop_id];
+        if (request.kind != FetchKind::Page || !stream_parse || !ParsedUrl::parse(request.url, page)) {
+            return consumer;
+        }
+        std::unique_ptr<LinkExtractor> extractor;
+        bool fingerprint = near_duplicates != nullptr;
+        if (extractor_pools[loop_id]->acquire(extractor)) {
+            extractor->reset(page, max_page_links, fingerprint);
+        } else {
+            extractor = std::make_unique<LinkExtractor>(page, max_page_links, fingerprint);
+        }
+        consumer = std::move(extractor);
+        return consumer;
+    });
+
+    // I/O threads pull URLs from the frontier and push finished bodies
+    // to the parser workers
+    fetch_engine.start(config.io_threads, config.max_inflight,
+                       [this](int loop_id, FetchRequest& request) { return next_fetch_url(loop_id, request); },
+                       [this](FetchResult&& result) { on_fetch_complete(std::move(result)); });
+
+    // Links for our hosts arrive from the other nodes; node 0 decides
+    // when the whole cluster has run dry
+    if (cluster) {
+        cluster->start(
+            [this](std::vector<std::string>& urls, uint32_t depth, std::vector<float>& priorities) {
+                if (!crawl_done.load() && frontier.batch_enqueue(urls, depth, priorities) > 0) {
+                    fetch_engine.notify();
+                }
+            },
+            [this](bool& idle, uint64_t& pages) {
+                idle = crawl_done.load() || frontier.outstanding_count() == 0;
+                pages = static_cast<uint64_t>(pages_crawled.load());
+            },
+            [this]() { signal_done(); },
+            static_cast<uint64_t>(config.max_pages));
+    }
+
+    // Print progress every second, stage metrics of the last interval
+    // every metrics_interval seconds
+    progress_thread = std::thread([this, &storage_manager]() {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        MetricsSnapshot last_metrics = Metrics::snapshot();
+        int seconds = 0;
+        auto last_tick = std::chrono::steady_clock::now();
+        int last_pages = pages_crawled.load();
+        uint64_t last_bytes = Metrics::total(Counter::BodyBytes);
+        while (!done_cv.wait_for(lock, std::chrono::milliseconds(1000),
+                                 [this]() { return crawl_done.load(); })) {
+            // Throughput over this tick, for the metrics endpoint
+            auto tick = std::chrono::steady_clock::now();
+            double tick_seconds = std::chrono::duration<double>(tick - last_tick).count();
+            int pages_now = pages_crawled.load();
+            uint64_t bytes_now = Metrics::total(Counter::BodyBytes);
+            if (tick_seconds > 0) {
+                pages_per_second.store((pages_now - last_pages) / tick_seconds);
+                bytes_per_second.store(static_cast<double>(bytes_now - last_bytes) / tick_seconds);
+            }
+            last_tick = tick;
+            last_pages = pages_now;
+            last_bytes = bytes_now;
+
+            FetchStats fetch_stats = fetch_engine.stats();
+            std::cout << "[PROGRESS] Pages: " << pages_crawled.load()
                       << "/" << max_pages_limit.load()
                       << " | Queue: " << frontier.queue_size()
-                      << " | Visited: " << frontier.visited_count() << std::endl;
-            
-            if (frontier.queue_size() == 0 && pages_crawled.load() > 0) {
-                break;
+                      << " | Visited: " << frontier.visited_count()
+                      << " | In-Flight: " << fetch_engine.inflight()
+                      << " | Conn reused: " << fetch_stats.connections_reused
+                      << "/" << (fetch_stats.connections_reused + fetch_stats.connections_new)
+                      << " | H2: " << fetch_stats.http2_transfers
+                      << " | Parse Q: " << parse_queue.size() << "/" << parse_queue.capacity();
+            if (store_threads > 0) {
+                std::cout << " | Store Q: " << store_queue.size() << "/" << store_queue.capacity();
+            }
+            if (storage_manager.live_pagerank().running()) {
+                auto best = storage_manager.live_pagerank().top(1);
+                if (!best.empty()) {
+                    std::cout << " | Top: " << storage_manager.domains().name(best[0].first);
+                }
+            }
+            std::cout << std::endl;
+
+            if (metrics_interval > 0 && ++seconds % metrics_interval == 0) {
+                // Summing the slots takes a moment; don't hold up the workers
+                lock.unlock();
+                MetricsSnapshot now = Metrics::snapshot();
+                Metrics::print(std::cout, now.since(last_metrics), "[METRICS]");
+                last_metrics = now;
+                lock.lock();
             }
         }
     });
-    progress_thread.detach();
+}
+
+int ThreadManager::restore_from_journal(StorageManager& storage_manager) {
+    auto started = std::chrono::steady_clock::now();
+
+    size_t domains = 0;
+    journal->replay_domains([&](std::string_view name) {
+        if (storage_manager.restore_domain(name) != domains) {
+            throw std::runtime_error("journal domain IDs out of order");
+        }
+        domains++;
+    });
+
+    std::unordered_set<uint64_t> completed;
+    int pages = 0;
+    journal->replay_pages(
+        [&](uint64_t fingerprint, uint32_t source, std::vector<WeightedEdge>& edges) {
+            completed.insert(fingerprint);
+            storage_manager.restore_page(source, edges);
+            pages++;
+        },
+        [&](uint64_t fingerprint) { completed.insert(fingerprint); });
+
+    // Re-admit in batches to keep the replay buffer small
+    const size_t batch_size = 4096;
+    std::vector<FrontierEntry> batch;
+    batch.reserve(batch_size);
+    size_t admitted = 0;
+    size_t queued = 0;
+    journal->replay_admissions([&](FrontierEntry&& entry) {
+        batch.push_back(std::move(entry));
+        if (batch.size() == batch_size) {
+            admitted += batch.size();
+            queued += frontier.restore(batch, completed);
+            batch.clear();
+        }
+    });
+    admitted += batch.size();
+    queued += frontier.restore(batch, completed);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    std::cout << "[RESUME] " << domains << " domains, " << pages << " pages, "
+              << admitted << " URLs admitted, " << queued << " queued again | "
+              << elapsed << " ms" << std::endl;
+    return pages;
+}
+
+bool ThreadManager::next_fetch_url(int loop_id, FetchRequest& request) {
+    if (crawl_done.load()) {
+        return false;
+    }
+
+    // robots.txt and sitemaps first: they take no page slot, and hosts
+    // whose robots.txt is pending have URLs waiting on it
+    if (robots.next(request)) {
+        return true;
+    }
+
+    // Reserve a page slot first so we never fetch past max_pages
+    if (pages_reserved.fetch_add(1) >= max_pages_limit.load()) {
+        pages_reserved.fetch_sub(1);
+        return false;
+    }
+
+    // And a parse-queue slot for the result: parsers that fall behind
+    // hold the loops back instead of growing a backlog of bodies
+    while (parse_credits.fetch_sub(1) <= 0) {
+        parse_credits.fetch_add(1);
+        // Flag first, then look again: a parser freeing a slot either
+        // sees the flag and wakes us, or we see its credit here
+        credit_waiters.store(true);
+        if (parse_credits.load() <= 0) {
+            pages_reserved.fetch_sub(1);
+            Metrics::add(Counter::ParseQueueFull);
+            return false;
+        }
+    }
+
+    FrontierEntry entry;
+    int64_t wait_ms = -1;
+    if (!frontier.try_dequeue(entry, static_cast<size_t>(loop_id), wait_ms)) {
+        release_parse_credit();
+        pages_reserved.fetch_sub(1);
+        if (wait_ms >= 0) {
+            // Only held-back hosts have URLs: come back when the first is due
+            fetch_engine.retry_after(loop_id, wait_ms);
+        } else if (!cluster && frontier.outstanding_count() == 0) {
+            // The last URLs were refused by robots.txt on their way back
+            // from the spill, so no page will retire them
+            signal_done();
+        }
+        return false;
+    }
+
+    request.url = std::move(entry.url);
+    request.kind = FetchKind::Page;
+    request.depth = entry.depth;
+    request.etag = std::string_view();
+    request.last_modified = std::string_view();
+    CachedPage cached;
+    if (fetch_cache && fetch_cache->find(Hash64::hash(request.url), cached)) {
+        request.etag = cached.etag;
+        request.last_modified = cached.last_modified;
+    }
+    return true;
+}
+
+void ThreadManager::on_fetch_complete(FetchResult&& result) {
+    // robots.txt and sitemaps were read on the way in; they took no host
+    // slot or parse credit
+    if (result.kind != FetchKind::Page) {
+        if (result.kind == FetchKind::Robots) {
+            on_robots_complete(result);
+        } else if (result.stream && static_cast<SitemapStream*>(result.stream.get())->unreadable()) {
+            Log::message(LogLevel::Warning, SitemapStream::can_inflate()
+                             ? "Compressed sitemap is corrupt or too large, skipped the rest: " + result.url
+                             : "Sitemap is gzip-compressed and zlib is not built in, skipped: " + result.url);
+        }
+        if (result.body.capacity() > 0) {
+            fetch_engine.recycle_body(result.loop_id, std::move(result.body));
+        }
+        finish_url();
+        return;
+    }
+
+    // Free the host's connection slot now rather than after parsing; the
+    // fetching loop refills itself, a host owned by another loop needs a wake
+    int ready_partition = frontier.release_host(result.url, result.http_code);
+    if (ready_partition >= 0 && ready_partition != result.loop_id) {
+        fetch_engine.notify(ready_partition);
+    }
+
+    // Its slot was reserved in next_fetch_url(), so this never blocks an
+    // I/O loop (push() only returns early once the crawl is over)
+    if (!parse_queue.try_push(result)) {
+        parse_queue.push(result);
+    }
+}
+
+void ThreadManager::on_robots_complete(FetchResult& result) {
+    std::shared_ptr<const RobotsRules> rules = robots.rules_for(result, ROBOTS_AGENT);
+    size_t dropped = frontier.set_robots(HostScheduler::host_key(result.url), rules);
+    for (size_t i = 0; i < dropped; i++) {
+        finish_url();
+    }
+    if (follow_sitemaps) {
+        ParsedUrl sitemap;
+        for (const std::string& url : rules->sitemaps()) {
+            if (ParsedUrl::parse(url, sitemap)) {
+                request_sitemap(sitemap.release(), 0);
+            }
+        }
+    }
+    // The host's gate is open: its URLs can go now
+    fetch_engine.notify();
+}
+
+void ThreadManager::request_sitemap(const std::string& url, uint32_t nesting) {
+    // Outstanding before it can be taken, so the crawl can't end under it
+    frontier.add_task();
+    if (!robots.request_sitemap(url, nesting)) {
+        finish_url();
+        return;
+    }
+    fetch_engine.notify();
+}
+
+void ThreadManager::enqueue_sitemap_urls(std::vector<std::string>& urls, bool index,
+                                         uint32_t nesting) {
+    if (crawl_done.load()) {
+        return;
+    }
+
+    // Normalized like extracted links, so the visited set sees one key per page
+    ParsedUrl parsed;
+    size_t kept = 0;
+    for (size_t i = 0; i < urls.size(); i++) {
+        if (ParsedUrl::parse(urls[i], parsed)) {
+            urls[kept++] = parsed.release();
+        }
+    }
+    urls.resize(kept);
+    if (index) {
+        for (const std::string& url : urls) {
+            request_sitemap(url, nesting + 1);
+        }
+        return;
+    }
+    Metrics::add(Counter::SitemapUrls, kept);
+
+    // Listed pages sit one link below the site root
+    const uint32_t depth = 1;
+    float priority = priority_mode == FrontierPriority::Depth ? -static_cast<float>(depth) : 0.0f;
+    if (cluster) {
+        size_t local = 0;
+        for (size_t i = 0; i < urls.size(); i++) {
+            int node = cluster->owner(HostScheduler::host_key(urls[i]));
+            if (node != cluster->self()) {
+                cluster->send(node, urls[i], depth, priority);
+            } else {
+                urls[local++] = std::move(urls[i]);
+            }
+        }
+        urls.resize(local);
+    }
+    std::vector<float> priorities(urls.size(), priority);
+    if (frontier.batch_enqueue(urls, depth, priorities) > 0) {
+        fetch_engine.notify();
+    }
+}
+
+void ThreadManager::finish_url() {
+    if (frontier.complete_task() && !cluster) {
+        // Nothing queued, in flight or being parsed: the crawl ran dry.
+        // A cluster node waits instead: other nodes may still send links
+        signal_done();
+    }
+}
+
+void ThreadManager::signal_done() {
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        crawl_done.store(true);
+    }
+    parse_queue.close();
+    store_queue.close();
+    done_cv.notify_all();
+}
+
+void ThreadManager::fail(const std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        if (stop_error.empty()) {
+            stop_error = error;
+        }
+    }
+    stopped_early.store(true);
+    Log::message(LogLevel::Error, "Stopping the crawl: " + error);
+    signal_done();
+}
+
+void ThreadManager::link_priorities(const PageLinks& links, uint32_t depth,
+                                    const StorageManager& storage_manager,
+                                    std::vector<float>& priorities) const {
+    priorities.assign(links.urls.size(), 0.0f);
+    if (priority_mode == FrontierPriority::Fifo) {
+        return;
+    }
+
+    const IncrementalPageRank& live = storage_manager.live_pagerank();
+    if (priority_mode == FrontierPriority::Depth || !live.running()) {
+        std::fill(priorities.begin(), priorities.end(), -static_cast<float>(depth));
+        return;
+    }
+
+    // One snapshot per page; unseen domains rank zero
+    auto snapshot = live.snapshot();
+    if (!snapshot || snapshot->total <= 0.0) {
+        return;
+    }
+    double scale = 1.0 / (snapshot->total * (1.0 + depth));
+    for (size_t i = 0; i < links.domain_ids.size(); i++) {
+        uint32_t id = links.domain_ids[i];
+        if (id < snapshot->scores.size()) {
+            priorities[i] = static_cast<float>(snapshot->scores[id] * scale);
+        }
+    }
+}
+
+void ThreadManager::route_links(PageLinks& links, std::vector<float>& priorities,
+                                uint32_t depth) {
+    size_t kept = 0;
+    for (size_t i = 0; i < links.urls.size(); i++) {
+        int node = cluster->owner(HostScheduler::host_key(links.urls[i]));
+        if (node != cluster->self()) {
+            cluster->send(node, links.urls[i], depth, priorities[i]);
+            continue;
+        }
+        if (kept != i) {
+            links.urls[kept] = std::move(links.urls[i]);
+            links.fingerprints[kept] = links.fingerprints[i];
+            links.domain_ids[kept] = links.domain_ids[i];
+            priorities[kept] = priorities[i];
+        }
+        kept++;
+    }
+    links.urls.resize(kept);
+    links.fingerprints.resize(kept);
+    links.domain_ids.resize(kept);
+    priorities.resize(kept);
+}
+
+void ThreadManager::recycle(FetchResult& result) {
+    if (result.stream) {
+        // The engine only hands back consumers our factory made
+        std::unique_ptr<LinkExtractor> extractor(static_cast<LinkExtractor*>(result.stream.release()));
+        extractor_pools[result.loop_id % extractor_pools.size()]->release(std::move(extractor));
+    }
+    if (result.body.capacity() > 0) {
+        fetch_engine.recycle_body(result.loop_id, std::move(result.body));
+    }
+}
+
+ThreadManager::StoreScratch::StoreScratch()
+    : arena_buffer(PAGE_ARENA_BYTES), arena(arena_buffer.data(), arena_buffer.size()) {}
+
+void ThreadManager::release_parse_credit() {
+    // Only loops that were turned away need waking; the rest are busy or
+    // will take the credit on their next fill
+    parse_credits.fetch_add(1);
+    if (credit_waiters.load() && credit_waiters.exchange(false)) {
+        fetch_engine.notify();
+    }
 }
 
 void ThreadManager::worker_loop(int thread_id, StorageManager& storage_manager) {
-    Downloader downloader;
-    Parser parser;
-    
-    std::string url;
-    int backoff_ms = 10;
-    
-    while (pages_crawled.load() < max_pages_limit.load()) {
-        // Try to dequeue URL
-        if (frontier.try_dequeue(url)) {
-            backoff_ms = 10;  // Reset backoff
-            
-            std::cout << "[T" << thread_id << "] Downloading: " << url << std::endl;
-            
-            // Download
-            std::string html = downloader.download(url);
-            
-            if (html.empty()) {
-                std::cout << "[T" << thread_id << "] ✗ Failed to download: " << url << std::endl;
-                continue;
+    // The containers below keep their capacity from page to page, so a
+    // warm worker allocates little beyond the URLs it admits
+    Log::set_thread_name("T" + std::to_string(thread_id));
+    const bool staged = store_threads > 0;
+    std::unique_ptr<StoreScratch> scratch;
+    if (!staged) {
+        scratch = std::make_unique<StoreScratch>();
+    }
+    std::unique_ptr<LinkExtractor> buffered_extractor;
+    ParsedPage parsed;
+
+    while (true) {
+        FetchResult result;
+        if (!parse_queue.try_pop(result)) {
+            Metrics::ScopedTimer idle(Metric::WorkerIdle);
+            if (!parse_queue.pop(result)) {
+                break;
             }
-            
-            std::string domain = downloader.get_domain(url);
-            std::cout << "[T" << thread_id << "] ✓ Downloaded (" << html.size() 
-                      << " bytes) from domain: " << domain << std::endl;
-            
-            // Parse links
-            std::vector<std::string> links = parser.extract_links(html, url);
-            std::cout << "[T" << thread_id << "] Found " << links.size() 
-                      << " links on page" << std::endl;
-            
-            // Extract unique domains from links
-            std::unordered_set<std::string> unique_domains;
-            for (const auto& link : links) {
-                std::string link_domain = downloader.get_domain(link);
-                if (!link_domain.empty()) {
-                    unique_domains.insert(link_domain);
+        }
+        release_parse_credit();
+        if (crawl_done.load()) {
+            break;
+        }
+
+        // The URL's fingerprint keys its journal records and log events
+        parsed.url = std::move(result.url);
+        parsed.url_key = Hash64::hash(parsed.url);
+        parsed.depth = result.depth;
+        parsed.loop_id = result.loop_id;
+        parsed.failed = false;
+        parsed.near_duplicate = false;
+        if (staged && !link_lists.acquire(parsed.links)) {
+            parsed.links = std::vector<ParsedUrl>();
+        }
+        parsed.links.clear();
+        const std::string& url = parsed.url;
+        const uint64_t url_key = parsed.url_key;
+        ParsedUrl& page = parsed.page;
+
+        // A page the server reports unchanged keeps its cached links
+        CachedPage cached;
+        bool have_cached = fetch_cache && fetch_cache->find(url_key, cached);
+        bool replay = result.not_modified && have_cached;
+        bool unchanged = replay || (have_cached && result.ok &&
+                                    result.content_hash == cached.content_hash);
+
+        if (!replay && (!result.ok || result.body_bytes == 0)) {
+            Log::event(LogLevel::Debug, LogEvent::FetchFailed, url_key, 0, 0, url);
+            parsed.failed = true;
+        } else if (!ParsedUrl::parse(url, page)) {
+            // Parse the page URL once; links and domains below are views
+            // or moves of parsed results, never re-parsed
+            Log::event(LogLevel::Debug, LogEvent::UrlRejected, url_key, 0, 0, url);
+            parsed.failed = true;
+        }
+        if (parsed.failed) {
+            recycle(result);
+        } else {
+            Log::event(LogLevel::Debug, LogEvent::PageFetched, url_key, result.body_bytes,
+                       result.truncated ? 1 : 0, page.domain());
+
+            // Parse links, unless the I/O thread already did while streaming
+            // or the cache has them. Swapping hands our emptied vector to the
+            // extractor for reuse
+            std::vector<ParsedUrl>& parsed_links = parsed.links;
+            LinkExtractor* scanned = nullptr;
+            if (replay || (unchanged && !result.stream)) {
+                FetchCache::for_each_link(cached, [&](std::string_view link) {
+                    parsed_links.emplace_back();
+                    if (!ParsedUrl::parse(link, parsed_links.back())) {
+                        parsed_links.pop_back();
+                    }
+                });
+                Metrics::add(Counter::PagesReplayed);
+            } else if (result.stream) {
+                scanned = static_cast<LinkExtractor*>(result.stream.get());
+                parsed_links.swap(scanned->links());
+                Metrics::record(Metric::ParseTime, scanned->parse_nanos());
+            } else if (result.body.size() <= MAX_BODY_BYTES) {
+                bool fingerprint = near_duplicates != nullptr;
+                if (buffered_extractor) {
+                    buffered_extractor->reset(page, max_page_links, fingerprint);
+                } else {
+                    buffered_extractor = std::make_unique<LinkExtractor>(page, max_page_links, fingerprint);
                 }
+                buffered_extractor->scan(result.body);
+                parsed_links.swap(buffered_extractor->links());
+                Metrics::record(Metric::ParseTime, buffered_extractor->parse_nanos());
+                scanned = buffered_extractor.get();
             }
-            std::cout << "[T" << thread_id << "] Extracted " << unique_domains.size() 
-                      << " unique domains" << std::endl;
-            
-            // Store in thread-local buffer
-            storage_manager.add_page(thread_id, domain, links);
-            
-            // Enqueue new links
-            int new_urls = frontier.batch_enqueue(links);
-            if (new_urls > 0) {
-                std::cout << "[T" << thread_id << "] Enqueued " << new_urls 
-                          << " new URLs" << std::endl;
+
+            // A page whose text nearly matches a recent one still adds its
+            // edges to the graph, but its links are not followed
+            if (near_duplicates && scanned && scanned->fingerprinting() &&
+                scanned->simhash().features() >= MIN_SIMHASH_FEATURES) {
+                parsed.near_duplicate = near_duplicates->check_and_insert(scanned->simhash().digest());
             }
-            
-            pages_crawled.fetch_add(1);
-            
-        } else {
-            // Queue is empty - busy wait with backoff
-            if (frontier.queue_size() == 0) {
-                if (backoff_ms < 500) {
-                    backoff_ms *= 2;
+            recycle(result);
+            Metrics::add(Counter::LinksFound, parsed_links.size());
+
+            // Remember the page for the next run before its URLs move on
+            if (fetch_cache) {
+                if (unchanged && (replay || (result.etag == cached.etag &&
+                                             result.last_modified == cached.last_modified))) {
+                    fetch_cache->keep(cached);
+                } else {
+                    fetch_cache->store(url_key, result.content_hash, result.etag,
+                                       result.last_modified, parsed_links);
                 }
-                std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
             }
         }
+
+        if (!staged) {
+            store_page(thread_id, storage_manager, parsed, *scratch);
+            continue;
+        }
+        if (!store_queue.try_push(parsed)) {
+            // Storage is the bottleneck: wait for it rather than pile up pages
+            Metrics::ScopedTimer stalled(Metric::StoreQueueWait);
+            if (!store_queue.push(parsed)) {
+                break;
+            }
+        }
+    }
+
+    Log::event(LogLevel::Info, LogEvent::WorkerStopped, 0, scratch ? scratch->pages_done : 0);
+}
+
+void ThreadManager::store_loop(int thread_id, StorageManager& storage_manager) {
+    Log::set_thread_name("S" + std::to_string(thread_id));
+    StoreScratch scratch;
+    ParsedPage parsed;
+    while (true) {
+        if (!store_queue.try_pop(parsed)) {
+            Metrics::ScopedTimer idle(Metric::StoreIdle);
+            if (!store_queue.pop(parsed)) {
+                break;
+            }
+        }
+        if (crawl_done.load()) {
+            break;
+        }
+        store_page(thread_id, storage_manager, parsed, scratch);
+        link_lists.release(std::move(parsed.links));
     }
-    
-    std::cout << "[T" << thread_id << "] Thread finished" << std::endl;
+    Log::event(LogLevel::Info, LogEvent::WorkerStopped, 0, scratch.pages_done);
+}
+
+void ThreadManager::store_page(int writer, StorageManager& storage_manager, ParsedPage& parsed,
+                               StoreScratch& scratch) {
+    const uint64_t url_key = parsed.url_key;
+    if (parsed.failed) {
+        if (journal) {
+            journal->log_done(writer, url_key);
+        }
+        pages_reserved.fetch_sub(1);
+        fetch_engine.notify();
+        finish_url();
+        return;
+    }
+
+    // One pass over the links: domain IDs, distinct URLs with their
+    // fingerprints and the weighted domain edges, stored in the
+    // thread-local buffer. The URL strings are moved, not copied
+    PageLinks& page_links = scratch.page_links;
+    const size_t links_found = parsed.links.size();
+    uint32_t source = storage_manager.add_page(writer, parsed.page.domain(), parsed.links,
+                                               page_links, &scratch.arena);
+    scratch.arena.release();
+    Log::event(LogLevel::Debug, LogEvent::LinksFound, url_key, links_found,
+               page_links.edges.size());
+    uint32_t link_depth = parsed.depth + 1;
+
+    // Enqueue new links on their hosts' partitions; they become
+    // outstanding before this page is retired in finish_url()
+    int new_urls = 0;
+    if (parsed.near_duplicate) {
+        Metrics::add(Counter::NearDuplicates);
+        Log::event(LogLevel::Debug, LogEvent::NearDuplicate, url_key, page_links.urls.size());
+    } else {
+        link_priorities(page_links, link_depth, storage_manager, scratch.priorities);
+        if (cluster) {
+            route_links(page_links, scratch.priorities, link_depth);
+        }
+        new_urls = frontier.batch_enqueue(page_links.urls, page_links.fingerprints,
+                                          link_depth, scratch.priorities);
+    }
+    if (new_urls > 0) {
+        fetch_engine.notify(parsed.loop_id);
+        fetch_engine.notify_idle();
+        Log::event(LogLevel::Debug, LogEvent::UrlsEnqueued, url_key,
+                   static_cast<uint64_t>(new_urls));
+    }
+
+    // Logged after its links so a checkpoint never holds a finished
+    // page whose links are missing
+    if (journal) {
+        journal->log_page(writer, url_key, source, page_links.edges);
+    }
+
+    if (pages_crawled.fetch_add(1) + 1 >= max_pages_limit.load()) {
+        signal_done();
+    }
+    scratch.pages_done++;
+    finish_url();
 }
 
 void ThreadManager::wait_completion() {
@@ -120,12 +852,246 @@ void ThreadManager::wait_completion() {
             thread.join();
         }
     }
-    
+    for (auto& thread : store_workers) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    if (cluster) {
+        // The receiver feeds the frontier and wakes the I/O loops
+        cluster->detach_sink();
+    }
+    fetch_engine.stop();
+    if (dns_prefetch) {
+        dns_cache.stop();
+    }
+    if (progress_thread.joinable()) {
+        progress_thread.join();
+    }
+    if (journal) {
+        // Final checkpoint: URLs still queued or in flight resume next time
+        journal->stop();
+    }
+
     frontier.mark_done();
+    Log::flush();
     std::cout << "\n[CRAWL COMPLETE]" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        if (!stop_error.empty()) {
+            std::cerr << "[ERROR] Crawl stopped early: " << stop_error << std::endl;
+        }
+    }
     std::cout << "Total pages crawled: " << pages_crawled.load() << std::endl;
+
+    FetchStats fetch_stats = fetch_engine.stats();
+    std::cout << "Connections reused: " << fetch_stats.connections_reused
+              << "/" << (fetch_stats.connections_reused + fetch_stats.connections_new)
+              << " | Handles reused: " << fetch_stats.handles_reused
+              << " | HTTP/2 transfers: " << fetch_stats.http2_transfers << std::endl;
+    MetricsSnapshot totals = Metrics::snapshot();
+    uint64_t body_bytes = totals[Counter::BodyBytes];
+    uint64_t wire_bytes = totals[Counter::WireBytes];
+    std::cout << "Compressed transfers: " << fetch_stats.compressed_transfers
+              << " | Wire: " << std::fixed << std::setprecision(1) << wire_bytes / (1024.0 * 1024.0) << " MB"
+              << " | Decoded: " << body_bytes / (1024.0 * 1024.0) << " MB";
+    if (wire_bytes > 0) {
+        std::cout << " (" << std::setprecision(2) << static_cast<double>(body_bytes) / wire_bytes << "x)";
+    }
+    std::cout << " | Cut at decoded limit: " << totals[Counter::DecodeLimited] << std::endl;
+    if (dns_prefetch) {
+        DnsStats dns = dns_cache.stats();
+        std::cout << "DNS cache (" << DnsCache::backend_name() << "): " << dns.hosts << " hosts"
+                  << " | Resolved: " << dns.resolved << " | Failed: " << dns.failed
+                  << " | Transfers pinned: " << dns.hits << "/" << (dns.hits + dns.misses) << std::endl;
+    }
+    std::cout << "Pipeline: parse queue peak " << parse_queue.peak() << "/" << parse_queue.capacity();
+    if (store_threads > 0) {
+        std::cout << " | Store queue peak " << store_queue.peak() << "/" << store_queue.capacity();
+    }
+    std::cout << " | Fetches held back: " << Metrics::snapshot()[Counter::ParseQueueFull]
+              << std::endl;
+    RobotsStats robots_stats = robots.stats();
+    if (robots_enabled || robots_stats.sitemaps > 0) {
+        std::cout << "Robots: " << robots_stats.fetched << "/" << robots_stats.requested << " fetched"
+                  << " | Missing: " << robots_stats.missing
+                  << " | Unreachable: " << robots_stats.unreachable
+                  << " | Crawl-delay hosts: " << robots_stats.delayed_hosts
+                  << " | Disallowed URLs: " << totals[Counter::RobotsDisallowed]
+                  << " | Sitemaps: " << robots_stats.sitemaps
+                  << " (" << totals[Counter::SitemapUrls] << " URLs)" << std::endl;
+    }
+
+    // Heap traffic since start(), all threads
+    AllocStats allocs = AllocStats::snapshot();
+    uint64_t crawl_allocs = allocs.allocations - alloc_at_start.allocations;
+    uint64_t crawl_bytes = allocs.bytes - alloc_at_start.bytes;
+    uint64_t extractors_reused = 0;
+    uint64_t extractors_new = 0;
+    for (const auto& pool : extractor_pools) {
+        extractors_reused += pool->reuse_count();
+        extractors_new += pool->miss_count();
+    }
+    std::cout << "Heap allocations: " << crawl_allocs << " ("
+              << std::fixed << std::setprecision(1) << crawl_bytes / (1024.0 * 1024.0) << " MB)";
+    if (pages_crawled.load() > 0) {
+        std::cout << " | Per page: " << static_cast<double>(crawl_allocs) / pages_crawled.load();
+    }
+    std::cout << " | Extractors reused: " << extractors_reused << "/" << (extractors_reused + extractors_new)
+              << " | Body buffers reused: " << fetch_stats.bodies_reused << std::endl;
+
+    LogCounters log_counters = Log::counters();
+    std::cout << "Log lines: " << log_counters.written << " | Dropped: " << log_counters.dropped
+              << " | Sampled out: " << log_counters.sampled_out << std::endl;
+
+    // Where the time went, over the whole crawl
+    MetricsSnapshot metrics = Metrics::snapshot();
+    Metrics::print(std::cout, metrics, "[METRICS]");
+    if (!metrics_file.empty()) {
+        try {
+            Metrics::write_csv(metrics_file, metrics);
+            std::cout << "[INFO] Stage metrics written to: " << metrics_file << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] " << e.what() << std::endl;
+        }
+    }
+
+    // Per-shard lock contention: acquisitions that found the lock held
+    std::vector<FrontierShardStats> shard_stats = frontier.shard_stats();
+    uint64_t total_acquisitions = 0;
+    uint64_t total_contended = 0;
+    uint64_t worst_contended = 0;
+    size_t visited_total = 0;
+    size_t visited_bytes = 0;
+    size_t spilled_bytes = 0;
+    for (const auto& shard : shard_stats) {
+        total_acquisitions += shard.lock_acquisitions;
+        total_contended += shard.lock_contended;
+        worst_contended = std::max(worst_contended, shard.lock_contended);
+        visited_total += shard.visited;
+        visited_bytes += shard.visited_bytes;
+        spilled_bytes += shard.spilled_bytes;
+    }
+    std::cout << "Frontier shards: " << shard_stats.size()
+              << " | Lock acquisitions: " << total_acquisitions
+              << " | Contended: " << total_contended
+              << " | Worst shard: " << worst_contended << std::endl;
+    std::cout << "Visited set: " << VisitedSet::backend_name(frontier.visited_backend())
+              << " | URLs: " << visited_total
+              << " | Memory: " << std::fixed << std::setprecision(1) << visited_bytes / 1024.0 << " KB";
+    if (visited_total > 0) {
+        std::cout << " (" << static_cast<double>(visited_bytes) / visited_total << " B/URL)";
+    }
+    if (spilled_bytes > 0) {
+        std::cout << " | Spilled: " << spilled_bytes / 1024.0 << " KB";
+    }
+    std::cout << std::endl;
+    std::vector<FrontierQueueStats> queue_stats = frontier.queue_stats();
+    uint64_t spill_urls = 0;
+    uint64_t spill_bytes = 0;
+    size_t spilled = 0;
+    size_t spill_buffered = 0;
+    for (const auto& queue : queue_stats) {
+        spill_urls += queue.spill_urls;
+        spill_bytes += queue.spill_bytes;
+        spilled += queue.spilled;
+        spill_buffered += queue.spill_buffered;
+    }
+    if (spill_urls > 0 || spilled > 0) {
+        // Blocks are written 4096 URLs at a time; a short overflow may
+        // still be waiting in memory
+        std::cout << "Frontier spill: " << spill_urls << " URLs | " << spill_bytes / 1024.0
+                  << " KB written";
+        if (spill_urls > 0) {
+            std::cout << " (" << static_cast<double>(spill_bytes) / spill_urls << " B/URL)";
+        }
+        std::cout << " | Left over the cap: " << spilled << " (" << spill_buffered
+                  << " buffered in memory)" << std::endl;
+    }
+    for (size_t i = 0; i < queue_stats.size(); i++) {
+        std::cout << "  [QUEUE " << i << "] hosts=" << queue_stats[i].hosts
+                  << " steals from this queue=" << queue_stats[i].steals
+                  << " backoffs=" << queue_stats[i].backoffs
+                  << " left=" << queue_stats[i].queued
+                  << " (spilled " << queue_stats[i].spilled << ")" << std::endl;
+    }
+    for (size_t i = 0; i < shard_stats.size(); i++) {
+        if (shard_stats[i].lock_contended > 0) {
+            std::cout << "  [SHARD " << i << "] visited=" << shard_stats[i].visited
+                      << " acquisitions=" << shard_stats[i].lock_acquisitions
+                      << " contended=" << shard_stats[i].lock_contended << std::endl;
+        }
+    }
 }
 
 int ThreadManager::get_pages_crawled() const {
     return pages_crawled.load();
 }
+
+bool ThreadManager::stopped_by_error() const {
+    return stopped_early.load();
+}
+
+void ThreadManager::write_prometheus(PrometheusText& out) const {
+    FetchStats fetch_stats = fetch_engine.stats();
+    double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+
+    out.family("crawler_up", "gauge", "1 while the crawl runs, 0 once it has finished");
+    out.sample("crawler_up", crawl_done.load() ? 0 : 1);
+    out.family("crawler_uptime_seconds", "gauge", "Seconds since the crawl started");
+    out.sample("crawler_uptime_seconds", uptime);
+    out.family("crawler_pages_crawled_total", "counter", "Pages fetched and parsed");
+    out.sample("crawler_pages_crawled_total", pages_crawled.load());
+    out.family("crawler_max_pages", "gauge", "Page limit of the crawl");
+    out.sample("crawler_max_pages", max_pages_limit.load());
+    out.family("crawler_pages_per_second", "gauge", "Pages crawled per second over the last second");
+    out.sample("crawler_pages_per_second", pages_per_second.load());
+    out.family("crawler_bytes_per_second", "gauge", "Body bytes received per second over the last second");
+    out.sample("crawler_bytes_per_second", bytes_per_second.load());
+    out.family("crawler_queue_urls", "gauge", "URLs queued in the frontier");
+    out.sample("crawler_queue_urls", static_cast<double>(frontier.queue_size()));
+    out.family("crawler_visited_urls", "gauge", "URLs admitted to the frontier so far");
+    out.sample("crawler_visited_urls", static_cast<double>(frontier.visited_count()));
+    out.family("crawler_outstanding_urls", "gauge", "URLs admitted but not yet fully processed");
+    out.sample("crawler_outstanding_urls", static_cast<double>(frontier.outstanding_count()));
+    out.family("crawler_inflight_transfers", "gauge", "Transfers in flight");
+    out.sample("crawler_inflight_transfers", static_cast<double>(fetch_engine.inflight()));
+    out.family("crawler_stage_queue_depth", "gauge", "Items waiting between pipeline stages");
+    out.sample("crawler_stage_queue_depth", "stage", "parse", static_cast<double>(parse_queue.size()));
+    out.family("crawler_stage_queue_capacity", "gauge", "Capacity of the queue in front of each stage");
+    out.sample("crawler_stage_queue_capacity", "stage", "parse", static_cast<double>(parse_queue.capacity()));
+    if (store_threads > 0) {
+        out.sample("crawler_stage_queue_depth", "stage", "store", static_cast<double>(store_queue.size()));
+        out.sample("crawler_stage_queue_capacity", "stage", "store", static_cast<double>(store_queue.capacity()));
+    }
+    out.family("crawler_connections_total", "counter", "Finished transfers by connection use");
+    out.sample("crawler_connections_total", "kind", "reused", static_cast<double>(fetch_stats.connections_reused));
+    out.sample("crawler_connections_total", "kind", "new", static_cast<double>(fetch_stats.connections_new));
+    if (dns_prefetch) {
+        DnsStats dns = dns_cache.stats();
+        out.family("crawler_dns_hosts", "gauge", "Host names in the DNS cache");
+        out.sample("crawler_dns_hosts", static_cast<double>(dns.hosts));
+        out.family("crawler_dns_transfers_total", "counter", "Transfers by whether the DNS cache had their host's addresses");
+        out.sample("crawler_dns_transfers_total", "result", "hit", static_cast<double>(dns.hits));
+        out.sample("crawler_dns_transfers_total", "result", "miss", static_cast<double>(dns.misses));
+    }
+
+    // Busiest hosts only: one series per host would be unbounded
+    std::vector<HostLoad> loads = frontier.host_loads();
+    size_t exported = std::min(loads.size(), EXPORTED_HOSTS);
+    std::partial_sort(loads.begin(), loads.begin() + exported, loads.end(),
+                      [](const HostLoad& a, const HostLoad& b) { return a.inflight > b.inflight; });
+    out.family("crawler_busy_hosts", "gauge", "Hosts with a transfer in flight");
+    out.sample("crawler_busy_hosts", static_cast<double>(loads.size()));
+    out.family("crawler_host_inflight", "gauge", "Transfers in flight on the busiest hosts");
+    for (size_t i = 0; i < exported; i++) {
+        out.sample("crawler_host_inflight", "host", loads[i].host, loads[i].inflight);
+    }
+
+    LogCounters log_counters = Log::counters();
+    out.family("crawler_log_dropped_total", "counter", "Log records lost to a full ring");
+    out.sample("crawler_log_dropped_total", static_cast<double>(log_counters.dropped));
+
+    Metrics::write_prometheus(out, Metrics::snapshot());
+}
@@ -1,54 +1,372 @@
 #include "url_frontier.h"
+#include "hash64.h"
+#include "metrics.h"
+#include <algorithm>
 #include <chrono>
-#include <thread>
+#include <utility>
 
-void URLFrontier::init(const std::string& seed_url) {
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    to_visit.push(seed_url);
-    visited.insert(seed_url);
-    queue_size_.store(1);
+namespace {
+
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Take a contended lock, timing only the wait (the uncontended path
+// stays a single try_lock)
+void lock_timed(std::unique_lock<std::mutex>& lock) {
+    Metrics::ScopedTimer wait(Metric::FrontierLockWait);
+    lock.lock();
+}
+
+}  // namespace
+
+void URLFrontier::init(const std::string& seed_url, size_t num_shards,
+                       size_t num_workers, const VisitedSetOptions& visited_options,
+                       const HostPolicy& host_policy,
+                       const FrontierSpillOptions& spill_options) {
+    // Power-of-two shard count so shard selection is a mask
+    size_t count = 1;
+    while (count < num_shards) {
+        count <<= 1;
+    }
+    num_shards_ = count;
+    shard_mask = count - 1;
+    shards.reset(new Shard[count]);
+    backend = visited_options.backend;
+    for (size_t i = 0; i < count; i++) {
+        shards[i].visited = VisitedSet::create(visited_options, i, count);
+    }
+
+    num_partitions = std::max<size_t>(num_workers, 1);
+    partitions.reset(new Partition[num_partitions]);
+    hot_limit = 0;
+    if (!spill_options.dir.empty() && spill_options.max_memory_urls > 0) {
+        hot_limit = std::max<size_t>(spill_options.max_memory_urls / num_partitions, 1);
+    }
+    for (size_t i = 0; i < num_partitions; i++) {
+        partitions[i].scheduler.set_policy(host_policy);
+        if (hot_limit > 0) {
+            partitions[i].spill.reset(new FrontierSpill(spill_options.dir, i));
+        }
+    }
+
+    queue_size_.store(0);
+    visited_size_.store(0);
+    outstanding.store(0);
     is_done.store(false);
+
+    add_if_not_visited(seed_url, 0);
+}
+
+size_t URLFrontier::partition_for(std::string_view host) const {
+    return static_cast<size_t>(Hash64::hash(host) % num_partitions);
+}
+
+size_t URLFrontier::shard_for(uint64_t fingerprint) const {
+    // High half picks the shard; backends hash the full fingerprint
+    return static_cast<size_t>(fingerprint >> 32) & shard_mask;
 }
 
-bool URLFrontier::try_dequeue(std::string& url) {
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    
-    if (to_visit.empty()) {
+std::unique_lock<std::mutex> URLFrontier::lock_shard(Shard& shard) {
+    std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        shard.lock_contended.fetch_add(1, std::memory_order_relaxed);
+        lock_timed(lock);
+    }
+    shard.lock_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    return lock;
+}
+
+std::unique_lock<std::mutex> URLFrontier::lock_partition(Partition& partition) {
+    std::unique_lock<std::mutex> lock(partition.mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        lock_timed(lock);
+    }
+    return lock;
+}
+
+bool URLFrontier::insert_locked(Shard& shard, const std::string& url, uint64_t fingerprint) {
+    try {
+        if (!shard.visited->insert(url, fingerprint)) {
+            return false;
+        }
+    } catch (const std::exception& e) {
+        // Spill failed: the set keeps working in memory, this URL is dropped
+        report_error(e);
         return false;
     }
-    
-    url = to_visit.front();
-    to_visit.pop();
-    queue_size_.store(to_visit.size());
+
+    shard.visited_count.fetch_add(1, std::memory_order_relaxed);
+    visited_size_.fetch_add(1, std::memory_order_relaxed);
     return true;
 }
 
-bool URLFrontier::add_if_not_visited(const std::string& url) {
-    // Validate URL first (no lock needed)
-    if (url.empty() || url.length() > 10000) {
-        return false;
+void URLFrontier::set_journal(CrawlJournal* new_journal) {
+    journal = new_journal;
+}
+
+void URLFrontier::set_new_host_callback(HostCallback callback) {
+    on_new_host = std::move(callback);
+}
+
+void URLFrontier::set_error_callback(ErrorCallback callback) {
+    on_error = std::move(callback);
+}
+
+void URLFrontier::report_error(const std::exception& error) {
+    if (!spill_failed.exchange(true) && on_error) {
+        on_error(error.what());
+    }
+}
+
+size_t URLFrontier::restore(std::vector<FrontierEntry>& entries,
+                            const std::unordered_set<uint64_t>& completed) {
+    std::vector<std::vector<FrontierEntry>> queued(num_partitions);
+    size_t count = 0;
+    for (auto& entry : entries) {
+        if (entry.url.empty() || entry.url.length() > 10000) {
+            continue;
+        }
+        uint64_t fingerprint = Hash64::hash(entry.url);
+        Shard& shard = shards[shard_for(fingerprint)];
+        {
+            auto lock = lock_shard(shard);
+            if (!insert_locked(shard, entry.url, fingerprint)) {
+                continue;
+            }
+        }
+        if (completed.count(fingerprint) == 0) {
+            queued[partition_for(HostScheduler::host_key(entry.url))].push_back(std::move(entry));
+            count++;
+        }
+    }
+
+    for (size_t i = 0; i < num_partitions; i++) {
+        push_urls(i, queued[i], false);
     }
-    
-    std::lock_guard<std::mutex> lock(queue_mutex);
-    
-    // Check if already visited
-    if (visited.find(url) != visited.end()) {
+    return count;
+}
+
+size_t URLFrontier::push_urls(size_t partition_id, std::vector<FrontierEntry>& entries, bool log) {
+    if (entries.empty()) {
+        return 0;
+    }
+
+    // Journal before the URLs can be fetched, so a page is always logged
+    // after the links it produced
+    if (journal && log) {
+        journal->log_admitted(partition_id, entries);
+    }
+
+    // Count as outstanding before the URLs become visible, so a thief
+    // that finishes one immediately can't drive the count to zero
+    outstanding.fetch_add(static_cast<long>(entries.size()));
+
+    Partition& partition = partitions[partition_id];
+    int64_t now_ms = steady_now_ms();
+    size_t kept = entries.size();
+    size_t refused = 0;
+    {
+        auto lock = lock_partition(partition);
+        if (hot_limit > 0) {
+            size_t hot = partition.scheduler.size();
+            kept = (hot >= hot_limit) ? 0 : std::min(kept, hot_limit - hot);
+        }
+        for (size_t i = 0; i < kept; i++) {
+            std::string_view host = HostScheduler::host_key(entries[i].url);
+            if (on_new_host && !partition.scheduler.has_host(host)) {
+                on_new_host(host, entries[i].url);
+            }
+            if (!partition.scheduler.push(host, std::move(entries[i]), now_ms)) {
+                refused++;
+            }
+        }
+        partition.size.fetch_add(kept - refused);
+    }
+
+    size_t dropped = 0;
+    if (kept < entries.size()) {
+        // Over the in-memory cap: the rest goes to disk. After a spill
+        // error the crawl is stopping and they are dropped
+        std::lock_guard<std::mutex> lock(partition.spill_mutex);
+        size_t spilled = 0;
+        try {
+            for (size_t i = kept; i < entries.size() && !spill_failed.load(); i++) {
+                spilled++;                  // Kept in the spill's buffer even if the write fails
+                partition.spill->push(std::move(entries[i]));
+            }
+        } catch (const std::exception& e) {
+            report_error(e);
+        }
+        dropped = entries.size() - kept - spilled;
+        partition.spilled.fetch_add(spilled);
+        partition.size.fetch_add(spilled);
+    }
+    queue_size_.fetch_add(entries.size() - refused - dropped);
+    if (refused + dropped > 0) {
+        // Never visible; the page that found them is still outstanding
+        outstanding.fetch_sub(static_cast<long>(refused + dropped));
+        Metrics::add(Counter::RobotsDisallowed, refused);
+    }
+    return refused;
+}
+
+bool URLFrontier::refill_partition(Partition& partition) {
+    std::vector<FrontierEntry> batch;
+    {
+        std::unique_lock<std::mutex> lock(partition.spill_mutex, std::try_to_lock);
+        if (!lock.owns_lock() || partition.spill->size() == 0) {
+            return false;
+        }
+        try {
+            partition.spill->refill(batch);
+        } catch (const std::exception& e) {
+            report_error(e);
+            return false;
+        }
+        partition.spilled.fetch_sub(batch.size());
+    }
+
+    // partition.size already counts these; they only change tiers
+    int64_t now_ms = steady_now_ms();
+    size_t refused = 0;
+    {
+        auto lock = lock_partition(partition);
+        for (auto& entry : batch) {
+            std::string_view host = HostScheduler::host_key(entry.url);
+            if (on_new_host && !partition.scheduler.has_host(host)) {
+                on_new_host(host, entry.url);
+            }
+            if (!partition.scheduler.push(host, std::move(entry), now_ms)) {
+                refused++;
+            }
+        }
+    }
+    if (refused > 0) {
+        // Retired here; a crawl left with nothing outstanding is noticed
+        // by the next dequeue that comes up empty
+        partition.size.fetch_sub(refused);
+        queue_size_.fetch_sub(refused);
+        outstanding.fetch_sub(static_cast<long>(refused));
+        Metrics::add(Counter::RobotsDisallowed, refused);
+    }
+    return !batch.empty();
+}
+
+bool URLFrontier::pop_partition(Partition& partition, FrontierEntry& entry, int64_t now_ms,
+                                int64_t& next_ready_ms) {
+    if (partition.size.load() == 0) {
         return false;
     }
-    
-    // Insert and add to queue
-    auto result = visited.insert(url);
-    if (result.second) {
-        to_visit.push(url);
-        queue_size_.store(to_visit.size());
+
+    int64_t partition_ready = -1;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool popped = false;
+        size_t hot = 0;
+        {
+            auto lock = lock_partition(partition);
+            popped = partition.scheduler.pop(now_ms, entry, partition_ready);
+            hot = partition.scheduler.size();
+        }
+        if (popped) {
+            partition.size.fetch_sub(1);
+            queue_size_.fetch_sub(1);
+        }
+
+        // Top the scheduler back up from disk before it runs dry. If
+        // nothing in memory is ready (hosts held back), spilled URLs may
+        // be, so refill past the cap, up to twice it
+        bool want = popped ? hot < (hot_limit + 1) / 2 : hot < 2 * hot_limit;
+        bool refilled = want && partition.spilled.load() > 0 && refill_partition(partition);
+        if (popped) {
+            return true;
+        }
+        if (!refilled) {
+            break;
+        }
+    }
+
+    if (partition_ready >= 0 && (next_ready_ms < 0 || partition_ready < next_ready_ms)) {
+        next_ready_ms = partition_ready;
+    }
+    return false;
+}
+
+bool URLFrontier::try_dequeue(FrontierEntry& entry, size_t worker_id, int64_t& wait_ms) {
+    size_t self = worker_id % num_partitions;
+    int64_t now_ms = steady_now_ms();
+    int64_t next_ready_ms = -1;
+
+    if (pop_partition(partitions[self], entry, now_ms, next_ready_ms)) {
         return true;
     }
-    
+
+    // Nothing ready at home: take a ready URL from a peer
+    for (size_t i = 1; i < num_partitions; i++) {
+        Partition& victim = partitions[(self + i) % num_partitions];
+        if (pop_partition(victim, entry, now_ms, next_ready_ms)) {
+            victim.steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    wait_ms = (next_ready_ms < 0) ? -1 : std::max<int64_t>(next_ready_ms - now_ms, 0);
     return false;
 }
 
+int URLFrontier::release_host(const std::string& url, long http_code) {
+    std::string_view host = HostScheduler::host_key(url);
+    size_t partition_id = partition_for(host);
+    Partition& partition = partitions[partition_id];
+
+    auto lock = lock_partition(partition);
+    bool ready = partition.scheduler.release(host, http_code, steady_now_ms());
+    return ready ? static_cast<int>(partition_id) : -1;
+}
+
+size_t URLFrontier::set_robots(std::string_view host, std::shared_ptr<const RobotsRules> rules) {
+    Partition& partition = partitions[partition_for(host)];
+    size_t dropped;
+    {
+        auto lock = lock_partition(partition);
+        dropped = partition.scheduler.set_robots(host, std::move(rules), steady_now_ms());
+    }
+    if (dropped > 0) {
+        partition.size.fetch_sub(dropped);
+        queue_size_.fetch_sub(dropped);
+        Metrics::add(Counter::RobotsDisallowed, dropped);
+    }
+    return dropped;
+}
+
+void URLFrontier::add_task() {
+    outstanding.fetch_add(1);
+}
+
+bool URLFrontier::add_if_not_visited(const std::string& url, uint32_t depth) {
+    // Validate URL first (no lock needed)
+    if (url.empty() || url.length() > 10000) {
+        return false;
+    }
+
+    uint64_t fingerprint = Hash64::hash(url);
+    Shard& shard = shards[shard_for(fingerprint)];
+    {
+        auto lock = lock_shard(shard);
+        if (!insert_locked(shard, url, fingerprint)) {
+            return false;
+        }
+    }
+
+    std::vector<FrontierEntry> admitted(1);
+    admitted[0].url = url;
+    admitted[0].depth = depth;
+    return push_urls(partition_for(HostScheduler::host_key(url)), admitted) == 0;
+}
+
 bool URLFrontier::has_work() const {
-    return !to_visit.empty() && !is_done.load();
+    return queue_size_.load() > 0 && !is_done.load();
 }
 
 size_t URLFrontier::queue_size() const {
@@ -56,21 +374,134 @@ size_t URLFrontier::queue_size() const {
 }
 
 size_t URLFrontier::visited_count() const {
-    return visited.size();
+    return visited_size_.load(std::memory_order_relaxed);
 }
 
 void URLFrontier::mark_done() {
     is_done.store(true);
 }
 
-int URLFrontier::batch_enqueue(const std::vector<std::string>& urls) {
+int URLFrontier::batch_enqueue(std::vector<std::string>& urls, uint32_t depth,
+                               const std::vector<float>& priorities) {
+    // Each URL is hashed once, here
+    thread_local std::vector<uint64_t> fingerprints;
+    fingerprints.resize(urls.size());
+    for (size_t i = 0; i < urls.size(); i++) {
+        fingerprints[i] = Hash64::hash(urls[i]);
+    }
+    return batch_enqueue(urls, fingerprints, depth, priorities);
+}
+
+int URLFrontier::batch_enqueue(std::vector<std::string>& urls,
+                               const std::vector<uint64_t>& fingerprints, uint32_t depth,
+                               const std::vector<float>& priorities) {
+    // Per-thread scratch: the batch bookkeeping reuses its capacity
+    thread_local std::vector<std::pair<uint32_t, uint32_t>> order;
+    thread_local std::vector<std::vector<FrontierEntry>> admitted;
+
+    // Bucket URLs by shard so each shard lock is taken once per batch
+    order.clear();
+    for (size_t i = 0; i < urls.size(); i++) {
+        const auto& url = urls[i];
+        if (url.empty() || url.length() > 10000) {
+            continue;
+        }
+        order.emplace_back(static_cast<uint32_t>(shard_for(fingerprints[i])),
+                           static_cast<uint32_t>(i));
+    }
+    std::sort(order.begin(), order.end());
+
+    // Admitted URLs are bucketed by the partition owning their host
+    admitted.resize(num_partitions);
     int added = 0;
-    
-    for (const auto& url : urls) {
-        if (add_if_not_visited(url)) {
-            added++;
+    size_t pos = 0;
+    while (pos < order.size()) {
+        uint32_t shard_id = order[pos].first;
+        Shard& shard = shards[shard_id];
+
+        auto lock = lock_shard(shard);
+        for (; pos < order.size() && order[pos].first == shard_id; pos++) {
+            uint32_t index = order[pos].second;
+            std::string& url = urls[index];
+            if (insert_locked(shard, url, fingerprints[index])) {
+                size_t partition = partition_for(HostScheduler::host_key(url));
+                FrontierEntry entry;
+                entry.url = std::move(url);
+                entry.depth = depth;
+                entry.priority = (index < priorities.size()) ? priorities[index] : 0.0f;
+                admitted[partition].push_back(std::move(entry));
+                added++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < num_partitions; i++) {
+        if (!admitted[i].empty()) {
+            added -= static_cast<int>(push_urls(i, admitted[i]));
+            admitted[i].clear();
         }
     }
-    
+    Metrics::record(Metric::EnqueueBatch, urls.size());
+    Metrics::add(Counter::UrlsAdmitted, static_cast<uint64_t>(added));
     return added;
 }
+
+bool URLFrontier::complete_task() {
+    return outstanding.fetch_sub(1) == 1;
+}
+
+long URLFrontier::outstanding_count() const {
+    return outstanding.load();
+}
+
+size_t URLFrontier::shard_count() const {
+    return num_shards_;
+}
+
+std::vector<FrontierShardStats> URLFrontier::shard_stats() const {
+    std::vector<FrontierShardStats> stats(num_shards_);
+    for (size_t i = 0; i < num_shards_; i++) {
+        const Shard& shard = shards[i];
+        stats[i].visited = shard.visited_count.load(std::memory_order_relaxed);
+        stats[i].lock_acquisitions = shard.lock_acquisitions.load(std::memory_order_relaxed);
+        stats[i].lock_contended = shard.lock_contended.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        stats[i].visited_bytes = shard.visited->memory_bytes();
+        stats[i].spilled_bytes = shard.visited->disk_bytes();
+    }
+    return stats;
+}
+
+std::vector<FrontierQueueStats> URLFrontier::queue_stats() const {
+    std::vector<FrontierQueueStats> stats(num_partitions);
+    for (size_t i = 0; i < num_partitions; i++) {
+        const Partition& partition = partitions[i];
+        stats[i].queued = partition.size.load(std::memory_order_relaxed);
+        stats[i].steals = partition.steals.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        stats[i].hosts = partition.scheduler.host_count();
+        stats[i].backoffs = partition.scheduler.backoff_count();
+        stats[i].spilled = partition.spilled.load(std::memory_order_relaxed);
+        if (partition.spill) {
+            std::lock_guard<std::mutex> spill_lock(partition.spill_mutex);
+            stats[i].spill_urls = partition.spill->urls_written();
+            stats[i].spill_bytes = partition.spill->bytes_written();
+            stats[i].spill_buffered = partition.spill->buffered();
+        }
+    }
+    return stats;
+}
+
+std::vector<HostLoad> URLFrontier::host_loads() const {
+    std::vector<HostLoad> loads;
+    for (size_t i = 0; i < num_partitions; i++) {
+        const Partition& partition = partitions[i];
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        partition.scheduler.busy_hosts(loads);
+    }
+    return loads;
+}
+
+VisitedBackend URLFrontier::visited_backend() const {
+    return backend;
+}
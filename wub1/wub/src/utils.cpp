@@ -4,6 +4,9 @@
 #include <sstream>
 #include <ctime>
 #include <iomanip>
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace Utils {
 
@@ -108,4 +111,13 @@ std::string format_size(size_t bytes) {
     return oss.str();
 }
 
+bool ensure_directory(const std::string& dir) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+    struct stat info;
+    return stat(dir.c_str(), &info) == 0 && S_ISDIR(info.st_mode) &&
+           access(dir.c_str(), W_OK | X_OK) == 0;
+}
+
 }  // namespace Utils
@@ -0,0 +1,467 @@
+#include "visited_set.h"
+#include "hash64.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// Rough heap cost of one malloc'd block beyond its payload
+const size_t MALLOC_OVERHEAD = 16;
+
+// Sorted spill runs kept before they are merged into one
+const size_t MAX_SPILL_RUNS = 8;
+
+inline size_t reduce(uint64_t hash, size_t range) {
+    return static_cast<size_t>((static_cast<__uint128_t>(hash) * range) >> 64);
+}
+
+// ---------------------------------------------------------------------------
+// Exact: what the frontier used before, kept for comparison and for
+// crawls small enough not to care
+// ---------------------------------------------------------------------------
+
+class ExactVisitedSet : public VisitedSet {
+public:
+    bool insert(std::string_view url, uint64_t) override {
+        auto result = urls.emplace(url);
+        if (result.second && url.size() > 15) {
+            string_heap_bytes += url.size() + 1 + MALLOC_OVERHEAD;   // Beyond SSO
+        }
+        return result.second;
+    }
+
+    size_t size() const override { return urls.size(); }
+
+    size_t memory_bytes() const override {
+        // Node: next pointer + std::string + cached hash, plus bucket array
+        size_t node = sizeof(void*) + sizeof(std::string) + sizeof(size_t) + MALLOC_OVERHEAD;
+        return urls.size() * node + urls.bucket_count() * sizeof(void*) + string_heap_bytes;
+    }
+
+private:
+    std::unordered_set<std::string> urls;
+    size_t string_heap_bytes = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Open-addressing fingerprint table (linear probing, 0 marks empty)
+// ---------------------------------------------------------------------------
+
+class FingerprintTable {
+public:
+    static uint64_t key(uint64_t fingerprint) {
+        return fingerprint ? fingerprint : 1;
+    }
+
+    bool contains(uint64_t fp) const {
+        if (slots.empty()) return false;
+        size_t i = home(fp);
+        while (slots[i] != 0) {
+            if (slots[i] == fp) return true;
+            i = (i + 1) & mask;
+        }
+        return false;
+    }
+
+    /**
+     * Insert a key known to be absent
+     */
+    void insert_new(uint64_t fp) {
+        size_t i = home(fp);
+        while (slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = fp;
+        count++;
+    }
+
+    // Grow before the load factor passes 0.8 (~10-20 bytes per key)
+    bool needs_growth() const {
+        return slots.empty() || (count + 1) * 5 > slots.size() * 4;
+    }
+
+    size_t next_capacity() const {
+        return slots.empty() ? 64 : slots.size() * 2;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<uint64_t> old;
+        old.swap(slots);
+        slots.assign(capacity, 0);
+        mask = capacity - 1;
+        shift = 64 - static_cast<unsigned>(__builtin_ctzll(capacity));
+        count = 0;
+        for (uint64_t fp : old) {
+            if (fp != 0) insert_new(fp);
+        }
+    }
+
+    void clear() {
+        std::fill(slots.begin(), slots.end(), 0);
+        count = 0;
+    }
+
+    const std::vector<uint64_t>& raw() const { return slots; }
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+    size_t memory_bytes() const { return slots.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> slots;
+    size_t mask = 0;
+    unsigned shift = 64;
+    size_t count = 0;
+
+    // URLFrontier picks the shard from fingerprint >> 32, so within one
+    // shard bits 32 .. 32+log2(shards)-1 are the same for every key. The
+    // home slot therefore comes from a Fibonacci hash of the whole
+    // fingerprint, never from a fixed bit range that could overlap them
+    size_t home(uint64_t fp) const {
+        return static_cast<size_t>((fp * 0x9E3779B97F4A7C15ULL) >> shift) & mask;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Bloom filter layer (double hashing, multiply-high index reduction)
+// ---------------------------------------------------------------------------
+
+class BloomLayer {
+public:
+    BloomLayer(size_t capacity, double fpr) : capacity_(std::max<size_t>(capacity, 64)) {
+        double ln2 = std::log(2.0);
+        double bits = -static_cast<double>(capacity_) * std::log(fpr) / (ln2 * ln2);
+        size_t words = std::max<size_t>(1, static_cast<size_t>(std::ceil(bits / 64.0)));
+        words_.assign(words, 0);
+        nbits = words * 64;
+        hashes = static_cast<int>(std::lround(static_cast<double>(nbits) / capacity_ * ln2));
+        hashes = std::min(std::max(hashes, 1), 16);
+    }
+
+    bool maybe_contains(uint64_t fp) const {
+        uint64_t h1 = fp, h2 = Hash64::mix(fp) | 1;
+        for (int i = 0; i < hashes; i++) {
+            size_t bit = reduce(h1 + static_cast<uint64_t>(i) * h2, nbits);
+            if (!(words_[bit >> 6] & (1ULL << (bit & 63)))) return false;
+        }
+        return true;
+    }
+
+    void add(uint64_t fp) {
+        uint64_t h1 = fp, h2 = Hash64::mix(fp) | 1;
+        for (int i = 0; i < hashes; i++) {
+            size_t bit = reduce(h1 + static_cast<uint64_t>(i) * h2, nbits);
+            words_[bit >> 6] |= 1ULL << (bit & 63);
+        }
+        count_++;
+    }
+
+    bool full() const { return count_ >= capacity_; }
+    size_t capacity() const { return capacity_; }
+    size_t count() const { return count_; }
+    size_t memory_bytes() const { return words_.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> words_;
+    size_t nbits = 0;
+    int hashes = 1;
+    size_t capacity_;
+    size_t count_ = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Bloom: scalable filter. When a layer reaches its capacity a new one
+// twice as large with half the false-positive rate is added, so the
+// overall rate stays bounded by ~2x the target however far the crawl runs
+// ---------------------------------------------------------------------------
+
+class BloomVisitedSet : public VisitedSet {
+public:
+    BloomVisitedSet(size_t capacity, double fpr) : next_fpr(fpr) {
+        layers.emplace_back(capacity, next_fpr);
+    }
+
+    bool insert(std::string_view, uint64_t fingerprint) override {
+        for (const auto& layer : layers) {
+            if (layer.maybe_contains(fingerprint)) {
+                return false;
+            }
+        }
+        if (layers.back().full()) {
+            next_fpr *= 0.5;
+            layers.emplace_back(layers.back().capacity() * 2, next_fpr);
+        }
+        layers.back().add(fingerprint);
+        count++;
+        return true;
+    }
+
+    size_t size() const override { return count; }
+
+    size_t memory_bytes() const override {
+        size_t bytes = 0;
+        for (const auto& layer : layers) bytes += layer.memory_bytes();
+        return bytes;
+    }
+
+private:
+    std::vector<BloomLayer> layers;
+    double next_fpr;
+    size_t count = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Fingerprint: exact (to 64-bit collisions) with an optional memory cap.
+// Over budget, the table is written out as a sorted run, mmapped back
+// read-only and fronted by a small in-memory Bloom filter, then cleared
+// ---------------------------------------------------------------------------
+
+struct SpillRun {
+    std::string path;
+    int fd = -1;
+    const uint64_t* keys = nullptr;
+    size_t count = 0;
+    std::unique_ptr<BloomLayer> filter;     // ~1% false positives, 1.2 bytes per key
+
+    ~SpillRun() {
+        if (keys) munmap(const_cast<uint64_t*>(keys), count * sizeof(uint64_t));
+        if (fd >= 0) close(fd);
+        if (!path.empty()) unlink(path.c_str());
+    }
+
+    bool contains(uint64_t fp) const {
+        return filter->maybe_contains(fp) && std::binary_search(keys, keys + count, fp);
+    }
+};
+
+/**
+ * Buffered writer for a run file
+ * A run that is never released (a write failed) is deleted
+ */
+class RunWriter {
+public:
+    explicit RunWriter(const std::string& run_path) : path(run_path) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("cannot create spill file " + path);
+        }
+        buffer.reserve(8192);
+    }
+
+    void add(uint64_t key) {
+        buffer.push_back(key);
+        if (buffer.size() == buffer.capacity()) flush();
+    }
+
+    void flush() {
+        const char* p = reinterpret_cast<const char*>(buffer.data());
+        size_t left = buffer.size() * sizeof(uint64_t);
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0) {
+                throw std::runtime_error("spill write failed");
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        buffer.clear();
+    }
+
+    int release() {
+        flush();
+        int out = fd;
+        fd = -1;
+        return out;
+    }
+
+    ~RunWriter() {
+        if (fd >= 0) {
+            close(fd);
+            unlink(path.c_str());
+        }
+    }
+
+private:
+    std::string path;
+    int fd = -1;
+    std::vector<uint64_t> buffer;
+};
+
+class FingerprintVisitedSet : public VisitedSet {
+public:
+    FingerprintVisitedSet(std::string spill_prefix, size_t budget_bytes)
+        : prefix(std::move(spill_prefix)), budget(budget_bytes) {}
+
+    bool insert(std::string_view, uint64_t fingerprint) override {
+        uint64_t fp = FingerprintTable::key(fingerprint);
+        if (table.contains(fp)) {
+            return false;
+        }
+        for (const auto& run : runs) {
+            if (run->contains(fp)) return false;
+        }
+
+        if (table.needs_growth()) {
+            size_t next = table.next_capacity();
+            if (can_spill() && table.size() > 0 && next * sizeof(uint64_t) > budget) {
+                try {
+                    spill();
+                } catch (...) {
+                    // Nothing is lost; grow in memory from here on
+                    prefix.clear();
+                    throw;
+                }
+            } else {
+                table.rehash(next);
+            }
+        }
+        table.insert_new(fp);
+        count++;
+        return true;
+    }
+
+    size_t size() const override { return count; }
+
+    size_t memory_bytes() const override {
+        size_t bytes = table.memory_bytes();
+        for (const auto& run : runs) bytes += run->filter->memory_bytes();
+        return bytes;
+    }
+
+    size_t disk_bytes() const override {
+        size_t bytes = 0;
+        for (const auto& run : runs) bytes += run->count * sizeof(uint64_t);
+        return bytes;
+    }
+
+private:
+    FingerprintTable table;
+    std::vector<std::unique_ptr<SpillRun>> runs;
+    std::string prefix;
+    size_t budget;
+    size_t count = 0;
+    size_t next_run_id = 0;
+
+    bool can_spill() const { return budget > 0 && !prefix.empty(); }
+
+    std::string run_path() {
+        return prefix + "-run" + std::to_string(next_run_id++) + ".bin";
+    }
+
+    /**
+     * mmap a finished run and build its filter
+     */
+    std::unique_ptr<SpillRun> open_run(const std::string& path, int fd, size_t count) {
+        auto run = std::make_unique<SpillRun>();
+        run->path = path;
+        run->fd = fd;
+        run->count = count;
+        void* map = mmap(nullptr, count * sizeof(uint64_t), PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("cannot mmap spill file " + path);
+        }
+        run->keys = static_cast<const uint64_t*>(map);
+        run->filter = std::make_unique<BloomLayer>(count, 0.01);
+        for (size_t i = 0; i < count; i++) {
+            run->filter->add(run->keys[i]);
+        }
+        return run;
+    }
+
+    void spill() {
+        std::vector<uint64_t> keys;
+        keys.reserve(table.size());
+        for (uint64_t fp : table.raw()) {
+            if (fp != 0) keys.push_back(fp);
+        }
+        std::sort(keys.begin(), keys.end());
+
+        std::string path = run_path();
+        RunWriter writer(path);
+        for (uint64_t key : keys) writer.add(key);
+        runs.push_back(open_run(path, writer.release(), keys.size()));
+        table.clear();
+
+        if (runs.size() > MAX_SPILL_RUNS) {
+            merge_runs();
+        }
+    }
+
+    /**
+     * k-way merge of every run into one file (runs are disjoint)
+     */
+    void merge_runs() {
+        using Cursor = std::pair<uint64_t, size_t>;     // (key, run index)
+        std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+        std::vector<size_t> pos(runs.size(), 0);
+        size_t total = 0;
+        for (size_t r = 0; r < runs.size(); r++) {
+            total += runs[r]->count;
+            if (runs[r]->count > 0) heap.emplace(runs[r]->keys[0], r);
+        }
+
+        std::string path = run_path();
+        RunWriter writer(path);
+        while (!heap.empty()) {
+            auto [key, r] = heap.top();
+            heap.pop();
+            writer.add(key);
+            if (++pos[r] < runs[r]->count) heap.emplace(runs[r]->keys[pos[r]], r);
+        }
+        int fd = writer.release();
+        runs.clear();
+        runs.push_back(open_run(path, fd, total));
+    }
+};
+
+}  // namespace
+
+std::unique_ptr<VisitedSet> VisitedSet::create(const VisitedSetOptions& options,
+                                               size_t shard_id, size_t num_shards) {
+    num_shards = std::max<size_t>(num_shards, 1);
+    switch (options.backend) {
+        case VisitedBackend::Exact:
+            return std::make_unique<ExactVisitedSet>();
+        case VisitedBackend::Bloom: {
+            size_t per_shard = std::max<size_t>(options.expected_urls / num_shards, 1024);
+            return std::make_unique<BloomVisitedSet>(per_shard, options.false_positive_rate);
+        }
+        case VisitedBackend::Fingerprint:
+        default: {
+            std::string prefix;
+            if (!options.spill_dir.empty()) {
+                prefix = options.spill_dir + "/visited-" + std::to_string(getpid()) +
+                         "-s" + std::to_string(shard_id);
+            }
+            size_t budget = options.memory_budget_mb * 1024 * 1024 / num_shards;
+            return std::make_unique<FingerprintVisitedSet>(prefix, budget);
+        }
+    }
+}
+
+const char* VisitedSet::backend_name(VisitedBackend backend) {
+    switch (backend) {
+        case VisitedBackend::Exact: return "exact";
+        case VisitedBackend::Bloom: return "bloom";
+        default: return "fingerprint";
+    }
+}
+
+bool VisitedSet::parse_backend(const std::string& name, VisitedBackend& backend) {
+    if (name == "exact") {
+        backend = VisitedBackend::Exact;
+    } else if (name == "fingerprint") {
+        backend = VisitedBackend::Fingerprint;
+    } else if (name == "bloom") {
+        backend = VisitedBackend::Bloom;
+    } else {
+        return false;
+    }
+    return true;
+}